@@ -83,6 +83,7 @@
 #include <math.h>
 #include "builtin_functions.h"
 #include "util/hash_table.h"
+#include "util/set.h"
 
 #define M_PIf   ((float) M_PI)
 #define M_PI_2f ((float) M_PI_2)
@@ -709,7 +710,9 @@ namespace {
  * function module.
  *
  * It generates IR for every built-in function signature, and organizes them
- * into functions.
+ * into functions.  The IR of a built-in function is only generated the first
+ * time a shader refers to it, as a program uses a handful of the thousands
+ * of signatures.
  */
 class builtin_builder {
 public:
@@ -720,6 +723,7 @@ public:
    void release();
    ir_function_signature *find(_mesa_glsl_parse_state *state,
                                const char *name, exec_list *actual_parameters);
+   ir_function *get_function(const char *name);
 
    /**
     * A shader to hold all the built-in signatures; created by this module.
@@ -733,6 +737,19 @@ public:
 private:
    void *mem_ctx;
 
+   /** Names get_function() already generated the built-ins of. */
+   struct set *generated_names;
+
+   /**
+    * If not NULL, create_builtins() only generates the built-in of that name.
+    */
+   const char *only_name;
+
+   bool wants_function(const char *name) const
+   {
+      return only_name == NULL || strcmp(name, only_name) == 0;
+   }
+
    void create_shader();
    void create_intrinsics();
    void create_builtins();
@@ -1087,7 +1104,7 @@ enum image_function_flags {
  *  @{
  */
 builtin_builder::builtin_builder()
-   : shader(NULL)
+   : shader(NULL), generated_names(NULL), only_name(NULL)
 {
    mem_ctx = NULL;
 }
@@ -1110,7 +1127,7 @@ builtin_builder::find(_mesa_glsl_parse_state *state,
     */
    state->uses_builtin_functions = true;
 
-   ir_function *f = shader->symbols->get_function(name);
+   ir_function *f = get_function(name);
    if (f == NULL)
       return NULL;
 
@@ -1122,6 +1139,26 @@ builtin_builder::find(_mesa_glsl_parse_state *state,
    return sig;
 }
 
+/**
+ * Look up a built-in function by name, generating its signatures if this is
+ * the first time it is asked for.
+ */
+ir_function *
+builtin_builder::get_function(const char *name)
+{
+   ir_function *f = shader->symbols->get_function(name);
+   if (f != NULL || _mesa_set_search(generated_names, name))
+      return f;
+
+   /* Run through the list of built-ins, skipping all the others. */
+   only_name = name;
+   create_builtins();
+   only_name = NULL;
+
+   _mesa_set_add(generated_names, ralloc_strdup(mem_ctx, name));
+   return shader->symbols->get_function(name);
+}
+
 void
 builtin_builder::initialize()
 {
@@ -1130,9 +1167,15 @@ builtin_builder::initialize()
       return;
 
    mem_ctx = ralloc_context(NULL);
+   generated_names = _mesa_set_create(mem_ctx, _mesa_key_hash_string,
+                                      _mesa_key_string_equal);
    create_shader();
+
+   /* The intrinsics are called by the built-ins, so they are all created
+    * upfront.  They don't have bodies, unlike the built-ins, which are only
+    * generated when they are used.
+    */
    create_intrinsics();
-   create_builtins();
 }
 
 void
@@ -1140,6 +1183,7 @@ builtin_builder::release()
 {
    ralloc_free(mem_ctx);
    mem_ctx = NULL;
+   generated_names = NULL;
 
    ralloc_free(shader);
    shader = NULL;
@@ -1372,6 +1416,13 @@ builtin_builder::create_intrinsics()
 void
 builtin_builder::create_builtins()
 {
+/* Don't evaluate the signatures of the functions we aren't asked for. */
+#define add_function(NAME, ...)                  \
+   do {                                          \
+      if (wants_function(NAME))                  \
+         add_function(NAME, __VA_ARGS__);        \
+   } while (0)
+
 #define F(NAME)                                 \
    add_function(#NAME,                          \
                 _##NAME(glsl_type::float_type), \
@@ -3482,6 +3533,7 @@ builtin_builder::create_builtins()
 #undef FIUD_VEC
 #undef FIUBD_VEC
 #undef FIU2_MIXED
+#undef add_function
 }
 
 void
@@ -3518,6 +3570,9 @@ builtin_builder::add_image_function(const char *name,
                                     unsigned flags,
                                     enum ir_intrinsic_id intrinsic_id)
 {
+   if (!wants_function(name))
+      return;
+
    static const glsl_type *const types[] = {
       glsl_type::image1D_type,
       glsl_type::image2D_type,
@@ -6486,7 +6541,7 @@ _mesa_glsl_has_builtin_function(_mesa_glsl_parse_state *state, const char *name)
    ir_function *f;
    bool ret = false;
    mtx_lock(&builtins_lock);
-   f = builtins.shader->symbols->get_function(name);
+   f = builtins.get_function(name);
    if (f != NULL) {
       foreach_in_list(ir_function_signature, sig, &f->signatures) {
          if (sig->is_builtin_available(state)) {
@@ -6500,6 +6555,17 @@ _mesa_glsl_has_builtin_function(_mesa_glsl_parse_state *state, const char *name)
    return ret;
 }
 
+ir_function *
+_mesa_glsl_find_builtin_function_by_name(const char *name)
+{
+   ir_function *f;
+   mtx_lock(&builtins_lock);
+   f = builtins.get_function(name);
+   mtx_unlock(&builtins_lock);
+
+   return f;
+}
+
 gl_shader *
 _mesa_glsl_get_builtin_function_shader()
 {
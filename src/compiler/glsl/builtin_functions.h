@@ -37,6 +37,9 @@ extern bool
 _mesa_glsl_has_builtin_function(_mesa_glsl_parse_state *state,
                                 const char *name);
 
+extern ir_function *
+_mesa_glsl_find_builtin_function_by_name(const char *name);
+
 extern gl_shader *
 _mesa_glsl_get_builtin_function_shader(void);
 
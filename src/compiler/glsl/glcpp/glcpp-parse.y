@@ -128,6 +128,12 @@ static void
 _glcpp_parser_print_expanded_token_list(glcpp_parser_t *parser,
                                         token_list_t *list);
 
+/* Drop the memoized macro expansions, which are stale once a macro is
+ * (re)defined or undefined.
+ */
+static void
+_glcpp_parser_forget_expansions(glcpp_parser_t *parser);
+
 static void
 _glcpp_parser_skip_stack_push_if(glcpp_parser_t *parser, YYLTYPE *loc,
                                  int condition);
@@ -321,6 +327,7 @@ control_line_success:
 		entry = _mesa_hash_table_search (parser->defines, $3);
 		if (entry) {
 			_mesa_hash_table_remove (parser->defines, entry);
+			_glcpp_parser_forget_expansions (parser);
 		}
 	}
 |	HASH_TOKEN IF pp_tokens NEWLINE {
@@ -1368,6 +1375,10 @@ glcpp_parser_create(const struct gl_extensions *extension_list,
    parser->defines = _mesa_hash_table_create(NULL, _mesa_key_hash_string,
                                              _mesa_key_string_equal);
    parser->linalloc = linear_alloc_parent(parser, 0);
+   parser->expansions = _mesa_hash_table_create(NULL, _mesa_key_hash_string,
+                                                _mesa_key_string_equal);
+   parser->expansion_key = _mesa_string_buffer_create(parser, 64);
+   parser->expansion_depends_on_location = false;
    parser->active = NULL;
    parser->lexing_directive = 0;
    parser->lexing_version_directive = 0;
@@ -1414,6 +1425,7 @@ glcpp_parser_destroy(glcpp_parser_t *parser)
 {
    glcpp_lex_destroy (parser->scanner);
    _mesa_hash_table_destroy(parser->defines, NULL);
+   _mesa_hash_table_destroy(parser->expansions, NULL);
    ralloc_free (parser);
 }
 
@@ -1856,13 +1868,17 @@ _glcpp_parser_expand_node(glcpp_parser_t *parser, token_node_t *node,
    /* Special handling for __LINE__ and __FILE__, (not through
     * the hash table). */
    if (*identifier == '_') {
-      if (strcmp(identifier, "__LINE__") == 0)
+      if (strcmp(identifier, "__LINE__") == 0) {
+         parser->expansion_depends_on_location = true;
          return _token_list_create_with_one_integer(parser,
                                                     node->token->location.first_line);
+      }
 
-      if (strcmp(identifier, "__FILE__") == 0)
+      if (strcmp(identifier, "__FILE__") == 0) {
+         parser->expansion_depends_on_location = true;
          return _token_list_create_with_one_integer(parser,
                                                     node->token->location.source);
+      }
    }
 
    /* Look up this identifier in the hash table. */
@@ -1954,6 +1970,145 @@ _parser_active_list_contains(glcpp_parser_t *parser, const char *identifier)
    return 0;
 }
 
+static void
+_glcpp_parser_forget_expansions(glcpp_parser_t *parser)
+{
+   if (parser->expansions->entries)
+      _mesa_hash_table_clear(parser->expansions, NULL);
+}
+
+/* Return a copy of the complete expansion of the macro invocation starting
+ * at 'node', macros in the result included, and set *last as
+ * _glcpp_parser_expand_node does. This is only valid while no macro is
+ * being expanded, in EXPANSION_MODE_IGNORE_DEFINED.
+ *
+ * Shaders tend to invoke the same macros with the same arguments over and
+ * over, so the expansions are memoized per macro and argument tokens. An
+ * expansion that ends with the name of a function-like macro, which may be
+ * invoked with the tokens following it, one that reports an error, and one
+ * that depends on __LINE__ or __FILE__ are not memoized: NULL is returned
+ * and the invocation has to be expanded by _glcpp_parser_expand_node.
+ *
+ * NULL is also returned, with *last set to NULL, when 'node' isn't a macro
+ * name nor __LINE__ or __FILE__, and so doesn't need expanding at all.
+ */
+static token_list_t *
+_glcpp_parser_expand_node_memoized(glcpp_parser_t *parser, token_node_t *node,
+                                   token_node_t **last)
+{
+   struct _mesa_string_buffer *key = parser->expansion_key;
+   const char *key_str;
+   token_t *token = node->token;
+   struct hash_entry *entry;
+   macro_t *macro;
+   token_list_t *expansion;
+   token_node_t *n;
+   uint32_t info_log_length;
+   int error;
+
+   *last = NULL;
+   if (token->type != IDENTIFIER)
+      return NULL;
+
+   entry = _mesa_hash_table_search(parser->defines, token->value.str);
+   macro = entry ? entry->data : NULL;
+   if (macro == NULL) {
+      if (*token->value.str == '_')
+         *last = node;
+      return NULL;
+   }
+
+   *last = node;
+   _mesa_string_buffer_clear(key);
+   _mesa_string_buffer_append(key, macro->identifier);
+
+   if (macro->is_function) {
+      int paren_count = 0;
+
+      /* Find the closing parenthesis as _arguments_parse does, without
+       * building the argument lists.  Anything else than an invocation is
+       * left to _glcpp_parser_expand_node.
+       */
+      for (n = node->next; n && n->token->type == SPACE; n = n->next)
+         ;
+      if (n == NULL || n->token->type != '(')
+         return NULL;
+
+      for (; n; n = n->next) {
+         /* The type is part of the key as an IDENTIFIER and an OTHER
+          * token print the same.  Two characters hold any token type.
+          */
+         char type[3] = { ' ', '0' + n->token->type / 64 % 64,
+                          '0' + n->token->type % 64 };
+
+         _mesa_string_buffer_append_len(key, type, sizeof(type));
+         _token_print(key, n->token);
+
+         if (n->token->type == '(') {
+            paren_count++;
+         } else if (n->token->type == ')') {
+            if (--paren_count == 0)
+               break;
+         }
+      }
+      if (n == NULL)
+         return NULL;
+
+      *last = n;
+   }
+
+   entry = _mesa_hash_table_search(parser->expansions, key->buf);
+   if (entry) {
+      expansion = entry->data;
+      return expansion ? _token_list_copy(parser, expansion) : NULL;
+   }
+
+   /* Expanding the arguments memoizes the invocations in them, which
+    * reuses the key buffer.
+    */
+   key_str = linear_strdup(parser->linalloc, key->buf);
+
+   /* Expand the invocation the way _glcpp_parser_expand_token_list would,
+    * with the macro active while its expansion is rescanned.
+    */
+   info_log_length = parser->info_log->length;
+   error = parser->error;
+   parser->expansion_depends_on_location = false;
+
+   expansion = _glcpp_parser_expand_node(parser, node, last,
+                                         EXPANSION_MODE_IGNORE_DEFINED);
+   if (expansion) {
+      _parser_active_list_push(parser, macro->identifier, NULL);
+      _glcpp_parser_expand_token_list(parser, expansion,
+                                      EXPANSION_MODE_IGNORE_DEFINED);
+      _parser_active_list_pop(parser);
+
+      token = NULL;
+      for (n = expansion->head; n; n = n->next) {
+         if (n->token->type != SPACE)
+            token = n->token;
+      }
+      if (token && token->type == IDENTIFIER &&
+          _mesa_hash_table_search(parser->defines, token->value.str))
+         expansion = NULL;
+   }
+
+   if (expansion == NULL || parser->expansion_depends_on_location ||
+       parser->info_log->length != info_log_length) {
+      /* Throw everything away, errors included, for
+       * _glcpp_parser_expand_node to redo it.
+       */
+      parser->info_log->length = info_log_length;
+      parser->info_log->buf[info_log_length] = '\0';
+      parser->error = error;
+      _mesa_hash_table_insert(parser->expansions, key_str, NULL);
+      return NULL;
+   }
+
+   _mesa_hash_table_insert(parser->expansions, key_str, expansion);
+   return _token_list_copy(parser, expansion);
+}
+
 /* Walk over the token list replacing nodes with their expansion.
  * Whenever nodes are expanded the walking will walk over the new
  * nodes, continuing to expand as necessary. The results are placed in
@@ -2000,6 +2155,40 @@ _glcpp_parser_expand_token_list(glcpp_parser_t *parser, token_list_t *list,
       while (parser->active && parser->active->marker == node)
          _parser_active_list_pop (parser);
 
+      /* Outside of any other expansion, a macro invocation may have been
+       * expanded already and the result can be spliced in as it is.
+       */
+      if (mode == EXPANSION_MODE_IGNORE_DEFINED && parser->active == NULL) {
+         expansion = _glcpp_parser_expand_node_memoized (parser, node, &last);
+         if (expansion) {
+            if (expansion->head) {
+               if (node_prev)
+                  node_prev->next = expansion->head;
+               else
+                  list->head = expansion->head;
+               expansion->tail->next = last->next;
+               if (last == list->tail)
+                  list->tail = expansion->tail;
+               node_prev = expansion->tail;
+            } else {
+               if (node_prev)
+                  node_prev->next = last->next;
+               else
+                  list->head = last->next;
+               if (last == list->tail)
+                  list->tail = node_prev;
+            }
+            node = node_prev ? node_prev->next : list->head;
+            continue;
+         }
+
+         if (last == NULL) {
+            node_prev = node;
+            node = node->next;
+            continue;
+         }
+      }
+
       expansion = _glcpp_parser_expand_node (parser, node, &last, mode);
       if (expansion) {
          token_node_t *n;
@@ -2140,6 +2329,7 @@ _define_object_macro(glcpp_parser_t *parser, YYLTYPE *loc,
    }
 
    _mesa_hash_table_insert (parser->defines, identifier, macro);
+   _glcpp_parser_forget_expansions (parser);
 }
 
 void
@@ -2175,6 +2365,7 @@ _define_function_macro(glcpp_parser_t *parser, YYLTYPE *loc,
    }
 
    _mesa_hash_table_insert(parser->defines, identifier, macro);
+   _glcpp_parser_forget_expansions (parser);
 }
 
 static int
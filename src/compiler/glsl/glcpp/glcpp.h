@@ -188,6 +188,16 @@ struct glcpp_parser {
 	void *linalloc;
 	yyscan_t scanner;
 	struct hash_table *defines;
+
+	/**
+	 * Complete expansions of the macro invocations seen so far, keyed by
+	 * the macro name and argument tokens, or NULL for those which can't
+	 * be reused.  Emptied whenever a macro is defined or undefined.
+	 */
+	struct hash_table *expansions;
+	struct _mesa_string_buffer *expansion_key;
+	bool expansion_depends_on_location;
+
 	active_list_t *active;
 	int lexing_directive;
 	int lexing_version_directive;
@@ -0,0 +1,17 @@
+#define A(x) x + B
+#define B 1
+A(2) A(2)
+#undef B
+#define B 3
+A(2)
+#define L(x) x
+L(__LINE__)
+L(__LINE__)
+#define F(x) (x)
+#define G F
+G(1) G(2)
+#if 0
+a / b /* c
+d */ e // f
+#endif
+A(2)
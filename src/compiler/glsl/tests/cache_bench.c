@@ -0,0 +1,198 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Compares disk_cache_get() latency of the one-file-per-entry layout with
+ * the single-file pack, with a cold and a warm page cache.
+ *
+ * Usage: cache_bench [number of entries] [entry size]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ftw.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "util/disk_cache.h"
+#include "util/os_time.h"
+
+#ifdef ENABLE_SHADER_CACHE
+
+#define CACHE_BENCH_TMP "./cache-bench-tmp"
+
+static int
+remove_entry(const char *path, const struct stat *sb, int typeflag,
+             struct FTW *ftwbuf)
+{
+   return remove(path);
+}
+
+/* Drop the cache files from the page cache, as far as the kernel lets us. */
+static int
+drop_entry(const char *path, const struct stat *sb, int typeflag,
+           struct FTW *ftwbuf)
+{
+   if (typeflag == FTW_F) {
+      int fd = open(path, O_RDONLY | O_CLOEXEC);
+      if (fd != -1) {
+         fdatasync(fd);
+         posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+         close(fd);
+      }
+   }
+   return 0;
+}
+
+static void
+fill_entry(uint8_t *data, size_t size, unsigned index)
+{
+   /* Half random, half repetitive, to be roughly as compressible as real
+    * shader binaries.
+    */
+   for (size_t i = 0; i < size; i++)
+      data[i] = i < size / 2 ? rand() : (uint8_t) (i * index);
+   memcpy(data, &index, sizeof(index));
+}
+
+static bool
+disk_cache_has_entry(struct disk_cache *cache, const cache_key key)
+{
+   void *data = disk_cache_get(cache, key, NULL);
+   bool found = data != NULL;
+
+   free(data);
+   return found;
+}
+
+static int64_t
+time_gets(struct disk_cache *cache, cache_key *keys, unsigned count)
+{
+   int64_t start = os_time_get_nano();
+   unsigned misses = 0;
+
+   for (unsigned i = 0; i < count; i++) {
+      size_t size;
+      void *data = disk_cache_get(cache, keys[i], &size);
+
+      if (!data)
+         misses++;
+      free(data);
+   }
+
+   if (misses)
+      fprintf(stderr, "  %u of %u entries missing\n", misses, count);
+
+   return os_time_get_nano() - start;
+}
+
+static void
+bench_layout(const char *name, bool single_file, unsigned count,
+             size_t entry_size)
+{
+   struct disk_cache *cache;
+   cache_key *keys;
+   uint8_t *data;
+   char *dir;
+   int64_t cold, warm;
+
+   if (asprintf(&dir, CACHE_BENCH_TMP "/%s", name) == -1)
+      return;
+
+   setenv("MESA_GLSL_CACHE_DIR", dir, 1);
+   setenv("MESA_DISK_CACHE_SINGLE_FILE", single_file ? "true" : "false", 1);
+
+   keys = malloc(count * sizeof(cache_key));
+   data = malloc(entry_size);
+
+   cache = disk_cache_create("bench", "cache_bench", 0);
+   if (!cache) {
+      fprintf(stderr, "Failed to create the %s cache\n", name);
+      goto done;
+   }
+
+   for (unsigned i = 0; i < count; i++) {
+      fill_entry(data, entry_size, i);
+      disk_cache_compute_key(cache, data, entry_size, keys[i]);
+      disk_cache_put(cache, keys[i], data, entry_size, NULL);
+   }
+
+   /* The writes are done in order on the cache thread, so all of them have
+    * landed once the last one has.
+    */
+   while (!disk_cache_has_entry(cache, keys[count - 1]))
+      usleep(10000);
+   disk_cache_destroy(cache);
+
+   nftw(dir, drop_entry, 64, FTW_PHYS);
+
+   cache = disk_cache_create("bench", "cache_bench", 0);
+   cold = time_gets(cache, keys, count);
+   warm = time_gets(cache, keys, count);
+   disk_cache_destroy(cache);
+
+   printf("%-12s cold: %8.2f us/get   warm: %8.2f us/get\n", name,
+          cold / 1000.0 / count, warm / 1000.0 / count);
+
+ done:
+   free(data);
+   free(keys);
+   free(dir);
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned count = argc > 1 ? atoi(argv[1]) : 2000;
+   size_t entry_size = argc > 2 ? atoi(argv[2]) : 8192;
+
+   if (count == 0 || entry_size < sizeof(unsigned))
+      return 1;
+
+   nftw(CACHE_BENCH_TMP, remove_entry, 64, FTW_DEPTH | FTW_PHYS);
+   mkdir(CACHE_BENCH_TMP, 0755);
+
+   /* Large enough for nothing to be evicted */
+   setenv("MESA_GLSL_CACHE_MAX_SIZE", "1G", 1);
+
+   printf("%u entries of %zu bytes\n", count, entry_size);
+   bench_layout("per-file", false, count, entry_size);
+   bench_layout("single-file", true, count, entry_size);
+
+   nftw(CACHE_BENCH_TMP, remove_entry, 64, FTW_DEPTH | FTW_PHYS);
+
+   return 0;
+}
+
+#else
+
+int
+main(void)
+{
+   return 0;
+}
+
+#endif /* ENABLE_SHADER_CACHE */
@@ -493,6 +493,169 @@ test_put_key_and_get_key(void)
 
    disk_cache_destroy(cache);
 }
+
+static uint8_t *
+random_data(size_t size)
+{
+   uint8_t *data = malloc(size);
+
+   /* Random bytes don't compress, which keeps the entry sizes predictable */
+   for (size_t i = 0; i < size; i++)
+      data[i] = rand();
+
+   return data;
+}
+
+static void
+test_single_file(void)
+{
+   struct disk_cache *cache;
+   char blob[] = "This is a blob of thirty-seven bytes";
+   uint8_t blob_key[20];
+   char string[] = "While this string has thirty-four";
+   uint8_t string_key[20];
+   uint8_t *data_a, *data_b, *data_c;
+   uint8_t key_a[20], key_b[20], key_c[20];
+   const size_t data_size = 400 * 1024;
+   char *result;
+   size_t size;
+
+   setenv("MESA_DISK_CACHE_SINGLE_FILE", "true", 1);
+   setenv("MESA_GLSL_CACHE_DIR", CACHE_TEST_TMP "/single-file", 1);
+   setenv("MESA_GLSL_CACHE_MAX_SIZE", "1M", 1);
+
+   cache = disk_cache_create("test", "make_check", 0);
+   expect_non_null(cache, "disk_cache_create with MESA_DISK_CACHE_SINGLE_FILE");
+
+   disk_cache_compute_key(cache, blob, sizeof(blob), blob_key);
+   disk_cache_compute_key(cache, string, sizeof(string), string_key);
+
+   result = disk_cache_get(cache, blob_key, &size);
+   expect_null(result, "single-file get with non-existent item (pointer)");
+   expect_equal(size, 0, "single-file get with non-existent item (size)");
+
+   disk_cache_put(cache, blob_key, blob, sizeof(blob), NULL);
+   disk_cache_put(cache, string_key, string, sizeof(string), NULL);
+   wait_until_file_written(cache, blob_key);
+   wait_until_file_written(cache, string_key);
+
+   result = disk_cache_get(cache, blob_key, &size);
+   expect_equal_str(blob, result, "single-file get of existing item (pointer)");
+   expect_equal(size, sizeof(blob), "single-file get of existing item (size)");
+   free(result);
+
+   result = disk_cache_get(cache, string_key, &size);
+   expect_equal_str(string, result,
+                    "single-file get of 2nd existing item (pointer)");
+   expect_equal(size, sizeof(string),
+                "single-file get of 2nd existing item (size)");
+   free(result);
+
+   /* The entries must survive reopening the cache. */
+   disk_cache_destroy(cache);
+   cache = disk_cache_create("test", "make_check", 0);
+
+   expect_true(does_cache_contain(cache, blob_key),
+               "single-file entry persists across disk_cache_create");
+
+   disk_cache_remove(cache, blob_key);
+   expect_true(!does_cache_contain(cache, blob_key),
+               "single-file get after disk_cache_remove");
+   expect_true(does_cache_contain(cache, string_key),
+               "single-file remove leaves other entries alone");
+
+   /* Three 400KB entries don't fit in 1MB, adding the third one must drop
+    * the oldest.
+    */
+   data_a = random_data(data_size);
+   data_b = random_data(data_size);
+   data_c = random_data(data_size);
+   disk_cache_compute_key(cache, data_a, data_size, key_a);
+   disk_cache_compute_key(cache, data_b, data_size, key_b);
+   disk_cache_compute_key(cache, data_c, data_size, key_c);
+
+   disk_cache_put(cache, key_a, data_a, data_size, NULL);
+   wait_until_file_written(cache, key_a);
+   disk_cache_put(cache, key_b, data_b, data_size, NULL);
+   wait_until_file_written(cache, key_b);
+   disk_cache_put(cache, key_c, data_c, data_size, NULL);
+   wait_until_file_written(cache, key_c);
+
+   expect_true(!does_cache_contain(cache, key_a),
+               "single-file eviction drops the oldest entry");
+   expect_true(does_cache_contain(cache, key_b),
+               "single-file eviction keeps recent entries");
+
+   result = disk_cache_get(cache, key_c, &size);
+   expect_true(result && size == data_size &&
+               memcmp(result, data_c, data_size) == 0,
+               "single-file get of the newest entry after eviction");
+   free(result);
+
+   /* Removing a large entry queues a compaction, which must not lose the
+    * other entries.  The queue runs jobs in order, so once the entry put
+    * afterwards is visible, compaction is done.
+    */
+   disk_cache_remove(cache, key_b);
+   disk_cache_put(cache, blob_key, blob, sizeof(blob), NULL);
+   wait_until_file_written(cache, blob_key);
+
+   expect_true(!does_cache_contain(cache, key_b),
+               "single-file get after compaction of a removed entry");
+   expect_true(does_cache_contain(cache, key_c),
+               "single-file compaction keeps live entries");
+
+   free(data_a);
+   free(data_b);
+   free(data_c);
+
+   disk_cache_destroy(cache);
+
+   unsetenv("MESA_DISK_CACHE_SINGLE_FILE");
+}
+
+static void
+test_codecs(void)
+{
+   struct disk_cache *cache;
+   char blob[] = "This is a blob of thirty-seven bytes";
+   uint8_t blob_key[20];
+   char *result;
+   size_t size;
+
+   setenv("MESA_GLSL_CACHE_DIR", CACHE_TEST_TMP "/codecs", 1);
+   setenv("MESA_DISK_CACHE_CODEC", "none", 1);
+
+   cache = disk_cache_create("test", "make_check", 0);
+   expect_non_null(cache, "disk_cache_create with MESA_DISK_CACHE_CODEC");
+
+   disk_cache_compute_key(cache, blob, sizeof(blob), blob_key);
+   disk_cache_put(cache, blob_key, blob, sizeof(blob), NULL);
+   wait_until_file_written(cache, blob_key);
+
+   result = disk_cache_get(cache, blob_key, &size);
+   expect_equal_str(blob, result, "get with the \"none\" codec (pointer)");
+   expect_equal(size, sizeof(blob), "get with the \"none\" codec (size)");
+   free(result);
+
+   expect_true(!disk_cache_set_codec(cache, "zlib"),
+               "MESA_DISK_CACHE_CODEC takes precedence over set_codec");
+
+   disk_cache_destroy(cache);
+
+   /* Entries must stay readable when the codec changes. */
+   unsetenv("MESA_DISK_CACHE_CODEC");
+   cache = disk_cache_create("test", "make_check", 0);
+
+   result = disk_cache_get(cache, blob_key, &size);
+   expect_equal_str(blob, result, "get of an entry written with another codec");
+   free(result);
+
+   expect_true(!disk_cache_set_codec(cache, "no-such-codec"),
+               "set_codec with an unknown codec");
+
+   disk_cache_destroy(cache);
+}
 #endif /* ENABLE_SHADER_CACHE */
 
 int
@@ -507,6 +670,10 @@ main(void)
 
    test_put_key_and_get_key();
 
+   test_single_file();
+
+   test_codecs();
+
    err = rmrf_local(CACHE_TEST_TMP);
    expect_equal(err, 0, "Removing " CACHE_TEST_TMP " again");
 #endif /* ENABLE_SHADER_CACHE */
@@ -0,0 +1,332 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Measures glcpp_preprocess() throughput on large shaders.
+ *
+ * Without arguments, the sources are generated after the patterns of large
+ * shaders found in games: an engine uber-shader with feature switches, an
+ * unrolled light loop and utility macros, a filter unrolled with macros as
+ * shader generators emit it, and plain code without macros.  Shader files
+ * given on the command line, e.g. from shader-db, are measured instead.
+ *
+ * Usage: glcpp_bench [shader file...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "glcpp/glcpp.h"
+#include "main/mtypes.h"
+#include "main/shaderobj.h"
+#include "util/macros.h"
+#include "util/os_time.h"
+#include "util/ralloc.h"
+#include "util/strtod.h"
+
+/* Preprocess each source for at least this long. */
+#define BENCH_MIN_TIME_NS 1000000000ll
+
+void
+_mesa_reference_shader(struct gl_context *ctx, struct gl_shader **ptr,
+                       struct gl_shader *sh)
+{
+   (void) ctx;
+   *ptr = sh;
+}
+
+static const char uber_header[] =
+   "#version 450\n"
+   "#define QUALITY 1\n"
+   "#define NUM_LIGHTS 6\n"
+   "#define USE_NORMAL_MAP 1\n"
+   "#define USE_SHADOWS 1\n"
+   "#define USE_PARALLAX 0\n"
+   "#define USE_FOG 0\n"
+   "#define PI 3.14159265\n"
+   "#define INV_PI (1.0 / PI)\n"
+   "#define saturate(x) clamp((x), 0.0, 1.0)\n"
+   "#define lerp(a, b, t) mix((a), (b), (t))\n"
+   "#define SQR(x) ((x) * (x))\n"
+   "#define SAMPLE(tex, uv) texture(tex, (uv) * u_scale + u_offset)\n"
+   "#define DECODE_NORMAL(n) normalize((n).xyz * 2.0 - 1.0)\n"
+   "#define LUMINANCE(c) dot((c), vec3(0.2126, 0.7152, 0.0722))\n"
+   "#define D_GGX(NoH, a) (SQR(a) * INV_PI / SQR(SQR(NoH) * (SQR(a) - 1.0) + 1.0))\n"
+   "#define F_SCHLICK(f0, VoH) ((f0) + (1.0 - (f0)) * pow(1.0 - (VoH), 5.0))\n"
+   "#define LIGHT_DIR(i) normalize(u_lights[i].position - v_position)\n"
+   "#define SHADOW(i) textureProj(u_shadow_maps[i], v_shadow_coord[i])\n"
+   "\n"
+   "struct light { vec3 position; vec3 color; };\n"
+   "uniform light u_lights[NUM_LIGHTS];\n"
+   "uniform sampler2DShadow u_shadow_maps[NUM_LIGHTS];\n"
+   "uniform sampler2D u_albedo, u_normal, u_height;\n"
+   "uniform vec2 u_scale, u_offset;\n"
+   "uniform float u_roughness, u_desaturate;\n"
+   "in vec3 v_position;\n"
+   "in vec4 v_shadow_coord[NUM_LIGHTS];\n"
+   "\n";
+
+static void
+append_uber_material(struct _mesa_string_buffer *buf, unsigned m)
+{
+   _mesa_string_buffer_printf(buf,
+      "/* Material %u */\n"
+      "vec4 material_%u(vec2 uv, vec3 n_in, vec3 v)\n"
+      "{\n"
+      "#if USE_PARALLAX\n"
+      "   float height = SAMPLE(u_height, uv).r;\n"
+      "   vec2 offset = v.xy / v.z * (height * 0.04 - 0.02);\n"
+      "   uv += offset;\n"
+      "   height = SAMPLE(u_height, uv).r;\n"
+      "   uv += v.xy / v.z * (height * 0.04 - 0.02);\n"
+      "#endif\n"
+      "   vec4 albedo = SAMPLE(u_albedo, uv);\n"
+      "#if USE_NORMAL_MAP\n"
+      "   vec3 n = DECODE_NORMAL(SAMPLE(u_normal, uv));\n"
+      "#else\n"
+      "   vec3 n = n_in;\n"
+      "#endif\n"
+      "   vec3 color = vec3(0.0);\n", m, m);
+
+   for (unsigned i = 0; i < 8; i++) {
+      _mesa_string_buffer_printf(buf,
+         "#if NUM_LIGHTS > %u\n"
+         "   {\n"
+         "      vec3 l = LIGHT_DIR(%u);\n"
+         "      vec3 h = normalize(l + v);\n"
+         "      float NoL = saturate(dot(n, l));\n"
+         "      float NoH = saturate(dot(n, h));\n"
+         "      float VoH = saturate(dot(v, h));\n"
+         "      vec3 spec = F_SCHLICK(vec3(0.04), VoH) * D_GGX(NoH, u_roughness);\n"
+         "#if USE_SHADOWS\n"
+         "      float shadow = SHADOW(%u);\n"
+         "#else\n"
+         "      float shadow = 1.0;\n"
+         "#endif\n"
+         "      color += (albedo.rgb * INV_PI + spec) * u_lights[%u].color * NoL * shadow;\n"
+         "   }\n"
+         "#endif\n", i, i, i, i);
+   }
+
+   _mesa_string_buffer_append(buf,
+      "#if QUALITY >= 2\n"
+      "   /* Screen space ambient occlusion */\n"
+      "   float occlusion = 0.0;\n"
+      "   for (int s = 0; s < 16; s++) {\n"
+      "      vec3 sample_pos = v_position + n * (float(s) / 16.0);\n"
+      "      vec4 clip = u_lights[0].position.xyzz * vec4(sample_pos, 1.0);\n"
+      "      float depth = SAMPLE(u_height, clip.xy / clip.w).r;\n"
+      "      occlusion += saturate(depth - sample_pos.z) * SQR(1.0 - float(s) / 16.0);\n"
+      "   }\n"
+      "   color *= 1.0 - occlusion / 16.0;\n"
+      "#endif\n"
+      "#if USE_FOG\n"
+      "   float fog = saturate(length(v_position) / 1000.0);\n"
+      "   color = lerp(color, vec3(0.5, 0.6, 0.7), SQR(fog));\n"
+      "#endif\n"
+      "   return vec4(lerp(color, vec3(LUMINANCE(color)), u_desaturate), albedo.a);\n"
+      "}\n"
+      "\n");
+}
+
+static const char filter_header[] =
+   "#version 450\n"
+   "#define TEXEL(x, y) (v_uv + vec2(float(x), float(y)) * u_texel_size)\n"
+   "#define TAP(x, y, w) acc += texture(u_source, TEXEL(x, y)) * (w);\n"
+   "#define ROW(y, w0, w1, w2) TAP(-2, y, w0) TAP(-1, y, w1) TAP(0, y, w2) TAP(1, y, w1) TAP(2, y, w0)\n"
+   "#define GAUSS5 ROW(-2, 0.003, 0.013, 0.022) ROW(-1, 0.013, 0.059, 0.097) ROW(0, 0.022, 0.097, 0.159) ROW(1, 0.013, 0.059, 0.097) ROW(2, 0.003, 0.013, 0.022)\n"
+   "#define BOX5 ROW(-2, 0.04, 0.04, 0.04) ROW(-1, 0.04, 0.04, 0.04) ROW(0, 0.04, 0.04, 0.04) ROW(1, 0.04, 0.04, 0.04) ROW(2, 0.04, 0.04, 0.04)\n"
+   "\n"
+   "uniform sampler2D u_source;\n"
+   "uniform vec2 u_texel_size;\n"
+   "in vec2 v_uv;\n"
+   "\n";
+
+static void
+append_filter_pass(struct _mesa_string_buffer *buf, unsigned p)
+{
+   _mesa_string_buffer_printf(buf,
+      "vec4 pass_%u(void)\n"
+      "{\n"
+      "   vec4 acc = vec4(0.0);\n"
+      "   %s\n"
+      "   return acc;\n"
+      "}\n"
+      "\n", p, p % 4 ? "GAUSS5" : "BOX5");
+}
+
+static void
+append_plain_function(struct _mesa_string_buffer *buf, unsigned f)
+{
+   _mesa_string_buffer_printf(buf,
+      "vec3 shade_%u(vec3 n, vec3 l, vec3 v, vec3 albedo, float roughness)\n"
+      "{\n"
+      "   vec3 h = normalize(l + v);\n"
+      "   float NoL = clamp(dot(n, l), 0.0, 1.0);\n"
+      "   float NoH = clamp(dot(n, h), 0.0, 1.0);\n"
+      "   float VoH = clamp(dot(v, h), 0.0, 1.0);\n"
+      "   float a2 = roughness * roughness * roughness * roughness;\n"
+      "   float d = NoH * NoH * (a2 - 1.0) + 1.0;\n"
+      "   float D = a2 / (3.14159265 * d * d);\n"
+      "   vec3 F = vec3(0.04) + vec3(0.96) * pow(1.0 - VoH, 5.0);\n"
+      "   float k = (roughness + 1.0) * (roughness + 1.0) / 8.0;\n"
+      "   float G = NoL / (NoL * (1.0 - k) + k);\n"
+      "   /* The constant is different in every function, as it would be\n"
+      "    * in generated code. */\n"
+      "   return (albedo / 3.14159265 + D * F * G) * NoL * %u.0;\n"
+      "}\n"
+      "\n", f, f);
+}
+
+static char *
+generate_source(void *mem_ctx, const char *name)
+{
+   struct _mesa_string_buffer *buf = _mesa_string_buffer_create(mem_ctx, 4096);
+
+   if (strcmp(name, "uber") == 0) {
+      _mesa_string_buffer_append(buf, uber_header);
+      for (unsigned m = 0; m < 64; m++)
+         append_uber_material(buf, m);
+   } else if (strcmp(name, "filter") == 0) {
+      _mesa_string_buffer_append(buf, filter_header);
+      for (unsigned p = 0; p < 256; p++)
+         append_filter_pass(buf, p);
+   } else {
+      _mesa_string_buffer_append(buf, "#version 450\n");
+      for (unsigned f = 0; f < 512; f++)
+         append_plain_function(buf, f);
+   }
+
+   return buf->buf;
+}
+
+static char *
+load_source(void *mem_ctx, const char *filename)
+{
+   FILE *fp = fopen(filename, "r");
+   char *text;
+   long size;
+
+   if (fp == NULL)
+      return NULL;
+
+   fseek(fp, 0, SEEK_END);
+   size = ftell(fp);
+   fseek(fp, 0, SEEK_SET);
+
+   text = ralloc_size(mem_ctx, size + 1);
+   if (fread(text, 1, size, fp) != (size_t) size)
+      text = NULL;
+   else
+      text[size] = '\0';
+
+   fclose(fp);
+   return text;
+}
+
+/* Returns the time of one glcpp_preprocess() call on the source, the best of
+ * as many as fit in BENCH_MIN_TIME_NS, or -1 on a preprocessing error.
+ */
+static int64_t
+time_preprocess(struct gl_context *gl_ctx, const char *source,
+                size_t *output_size)
+{
+   int64_t best = INT64_MAX, total = 0;
+
+   while (total < BENCH_MIN_TIME_NS) {
+      void *mem_ctx = ralloc_context(NULL);
+      const char *shader = source;
+      char *info_log = ralloc_strdup(mem_ctx, "");
+      int64_t start, time;
+      int ret;
+
+      start = os_time_get_nano();
+      ret = glcpp_preprocess(mem_ctx, &shader, &info_log, NULL, NULL, gl_ctx);
+      time = os_time_get_nano() - start;
+
+      *output_size = strlen(shader);
+      if (ret) {
+         fprintf(stderr, "%s", info_log);
+         ralloc_free(mem_ctx);
+         return -1;
+      }
+      ralloc_free(mem_ctx);
+
+      if (time < best)
+         best = time;
+      total += time;
+   }
+
+   return best;
+}
+
+static void
+bench_source(struct gl_context *gl_ctx, const char *name, const char *source)
+{
+   size_t input_size = strlen(source), output_size;
+   int64_t time = time_preprocess(gl_ctx, source, &output_size);
+
+   if (time < 0) {
+      fprintf(stderr, "Failed to preprocess %s\n", name);
+      return;
+   }
+
+   printf("%-24s %8zu -> %8zu bytes  %9.3f ms  %7.2f MB/s\n", name,
+          input_size, output_size, time / 1000000.0,
+          input_size * 1000.0 / time);
+}
+
+int
+main(int argc, char **argv)
+{
+   static const char *const generated[] = { "uber", "filter", "plain" };
+   void *mem_ctx = ralloc_context(NULL);
+   struct gl_context *gl_ctx = rzalloc(mem_ctx, struct gl_context);
+
+   gl_ctx->API = API_OPENGL_CORE;
+   gl_ctx->Const.DisableGLSLLineContinuations = false;
+
+   _mesa_locale_init();
+
+   if (argc > 1) {
+      for (int i = 1; i < argc; i++) {
+         char *source = load_source(mem_ctx, argv[i]);
+
+         if (source == NULL) {
+            fprintf(stderr, "Failed to read %s\n", argv[i]);
+            continue;
+         }
+         bench_source(gl_ctx, argv[i], source);
+      }
+   } else {
+      for (unsigned i = 0; i < ARRAY_SIZE(generated); i++) {
+         bench_source(gl_ctx, generated[i],
+                      generate_source(mem_ctx, generated[i]));
+      }
+   }
+
+   _mesa_locale_fini();
+   ralloc_free(mem_ctx);
+
+   return 0;
+}
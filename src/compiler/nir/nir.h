@@ -553,7 +553,7 @@ typedef struct nir_ssa_def {
    /** generic SSA definition index. */
    unsigned index;
 
-   /** Index into the live_in and live_out bitfields */
+   /** Index into the live_in and live_out sets */
    unsigned live_index;
 
    /** Instruction which produces this SSA value. */
@@ -1836,9 +1836,12 @@ typedef struct nir_block {
     */
    unsigned dom_pre_index, dom_post_index;
 
-   /* live in and out for this block; used for liveness analysis */
-   BITSET_WORD *live_in;
-   BITSET_WORD *live_out;
+   /* live in and out for this block, as sorted arrays of live_index; used
+    * for liveness analysis
+    */
+   unsigned *live_in;
+   unsigned *live_out;
+   unsigned num_live_in, num_live_out;
 } nir_block;
 
 static inline nir_instr *
@@ -1936,6 +1939,11 @@ typedef enum {
    nir_metadata_live_ssa_defs = 0x4,
    nir_metadata_not_properly_reset = 0x8,
    nir_metadata_loop_analysis = 0x10,
+
+   /** Set by nir_validate_shader() with NIR_VALIDATE=changed, so function
+    * implementations which no pass changed since aren't validated again.
+    */
+   nir_metadata_validated = 0x20,
 } nir_metadata;
 
 typedef struct {
@@ -3148,6 +3156,8 @@ void nir_loop_analyze_impl(nir_function_impl *impl,
                            nir_variable_mode indirect_mask);
 
 bool nir_ssa_defs_interfere(nir_ssa_def *a, nir_ssa_def *b);
+bool nir_ssa_def_is_live_in(nir_ssa_def *def, nir_block *block);
+bool nir_ssa_def_is_live_out(nir_ssa_def *def, nir_block *block);
 
 bool nir_repair_ssa_impl(nir_function_impl *impl);
 bool nir_repair_ssa(nir_shader *shader);
@@ -67,7 +67,7 @@ intersect(nir_block *b1, nir_block *b2)
    return b1;
 }
 
-static bool
+static void
 calc_dominance(nir_block *block)
 {
    nir_block *new_idom = NULL;
@@ -82,12 +82,7 @@ calc_dominance(nir_block *block)
       }
    }
 
-   if (block->imm_dom != new_idom) {
-      block->imm_dom = new_idom;
-      return true;
-   }
-
-   return false;
+   block->imm_dom = new_idom;
 }
 
 static bool
@@ -125,16 +120,17 @@ calc_dom_frontier(nir_block *block)
 static void
 calc_dom_children(nir_function_impl* impl)
 {
-   void *mem_ctx = ralloc_parent(impl);
-
    nir_foreach_block(block, impl) {
       if (block->imm_dom)
          block->imm_dom->num_dom_children++;
    }
 
+   /* The arrays of the previous computation are reused, rather than left
+    * to pile up until the shader is freed.
+    */
    nir_foreach_block(block, impl) {
-      block->dom_children = ralloc_array(mem_ctx, nir_block *,
-                                         block->num_dom_children);
+      block->dom_children = reralloc(block, block->dom_children, nir_block *,
+                                     MAX2(block->num_dom_children, 1));
       block->num_dom_children = 0;
    }
 
@@ -170,13 +166,15 @@ nir_calc_dominance_impl(nir_function_impl *impl)
       init_block(block, impl);
    }
 
-   bool progress = true;
-   while (progress) {
-      progress = false;
-      nir_foreach_block(block, impl) {
-         if (block != nir_start_block(impl))
-            progress |= calc_dominance(block);
-      }
+   /* Blocks are indexed in reverse post-order and NIR control flow is
+    * structured, so the only predecessors which come after a block are the
+    * ends of the loops it heads.  Those are dominated by the block and can't
+    * change its immediate dominator, so a single pass finds all of them,
+    * rather than iterating to a fixed point like the paper does.
+    */
+   nir_foreach_block(block, impl) {
+      if (block != nir_start_block(impl))
+         calc_dominance(block);
    }
 
    nir_foreach_block(block, impl) {
@@ -25,8 +25,7 @@
  */
 
 #include "nir.h"
-#include "nir_worklist.h"
-#include "nir_vla.h"
+#include "util/u_dynarray.h"
 
 /*
  * Basic liveness analysis.  This works only in SSA form.
@@ -40,118 +39,167 @@
  * SSA value may not dominate a use is if the use is in a phi node and the
  * uses in phi no are in the live-out of the corresponding predecessor
  * block but not in the live-in of the block containing the phi node.
+ *
+ * Rather than iterating a dataflow problem over bitsets of every SSA value
+ * in every block, which grows with the square of the shader size, the live
+ * range of each value is found by walking up the CFG from its uses until
+ * its definition is reached.  This is linear in the total size of the live
+ * ranges, and the live sets of each block are stored as sorted arrays of
+ * live indices.
  */
 
+struct live_entry {
+   unsigned block;
+   unsigned live_index;
+};
+
 struct live_ssa_defs_state {
    unsigned num_ssa_defs;
-   unsigned bitset_words;
 
-   nir_block_worklist worklist;
+   /* The last live index added to the live in and out of each block, so a
+    * block is only walked once per definition.
+    */
+   unsigned *last_live_in;
+   unsigned *last_live_out;
+
+   struct util_dynarray live_in;
+   struct util_dynarray live_out;
+
+   /* Blocks left to walk for the current definition */
+   struct util_dynarray stack;
 };
 
-static bool
-index_ssa_def(nir_ssa_def *def, void *void_state)
+static void
+add_live_out(nir_block *block, nir_ssa_def *def,
+             struct live_ssa_defs_state *state)
 {
-   struct live_ssa_defs_state *state = void_state;
-
-   if (def->parent_instr->type == nir_instr_type_ssa_undef)
-      def->live_index = 0;
-   else
-      def->live_index = state->num_ssa_defs++;
+   if (state->last_live_out[block->index] == def->live_index)
+      return;
 
-   return true;
+   state->last_live_out[block->index] = def->live_index;
+   util_dynarray_append(&state->live_out, struct live_entry,
+                        ((struct live_entry) { block->index, def->live_index }));
 }
 
-/* Initialize the liveness data to zero and add the given block to the
- * worklist.
+/* Makes def live in block and, unless block contains the definition, in all
+ * of the blocks leading to it.
  */
-static bool
-init_liveness_block(nir_block *block,
-                    struct live_ssa_defs_state *state)
+static void
+mark_live_in(nir_block *block, nir_ssa_def *def,
+             struct live_ssa_defs_state *state)
 {
-   block->live_in = reralloc(block, block->live_in, BITSET_WORD,
-                             state->bitset_words);
-   memset(block->live_in, 0, state->bitset_words * sizeof(BITSET_WORD));
+   nir_block *def_block = def->parent_instr->block;
+   bool def_is_phi = def->parent_instr->type == nir_instr_type_phi;
 
-   block->live_out = reralloc(block, block->live_out, BITSET_WORD,
-                              state->bitset_words);
-   memset(block->live_out, 0, state->bitset_words * sizeof(BITSET_WORD));
+   util_dynarray_append(&state->stack, nir_block *, block);
 
-   nir_block_worklist_push_head(&state->worklist, block);
+   while (state->stack.size) {
+      block = util_dynarray_pop(&state->stack, nir_block *);
 
-   return true;
+      if (state->last_live_in[block->index] == def->live_index)
+         continue;
+
+      /* Values defined in the block aren't live coming into it, except for
+       * the destinations of its phis.
+       */
+      if (block == def_block && !def_is_phi)
+         continue;
+
+      state->last_live_in[block->index] = def->live_index;
+      util_dynarray_append(&state->live_in, struct live_entry,
+                           ((struct live_entry) { block->index,
+                                                  def->live_index }));
+
+      if (block == def_block)
+         continue;
+
+      set_foreach(block->predecessors, entry) {
+         nir_block *pred = (nir_block *)entry->key;
+
+         add_live_out(pred, def, state);
+         util_dynarray_append(&state->stack, nir_block *, pred);
+      }
+   }
 }
 
 static bool
-set_src_live(nir_src *src, void *void_live)
+index_and_mark_ssa_def(nir_ssa_def *def, void *void_state)
 {
-   BITSET_WORD *live = void_live;
+   struct live_ssa_defs_state *state = void_state;
 
-   if (!src->is_ssa)
+   /* We reserve the index value of 0 for ssa_undef instructions.  Those are
+    * never live, so they're left out of the live sets entirely.
+    */
+   if (def->parent_instr->type == nir_instr_type_ssa_undef) {
+      def->live_index = 0;
       return true;
+   }
 
-   if (src->ssa->live_index == 0)
-      return true;   /* undefined variables are never live */
+   def->live_index = state->num_ssa_defs++;
 
-   BITSET_SET(live, src->ssa->live_index);
+   nir_foreach_use(src, def) {
+      nir_instr *use = src->parent_instr;
 
-   return true;
-}
+      if (use->type == nir_instr_type_phi) {
+         /* Phi sources are live out of the corresponding predecessor. */
+         nir_phi_src *phi_src = exec_node_data(nir_phi_src, src, src);
 
-static bool
-set_ssa_def_dead(nir_ssa_def *def, void *void_live)
-{
-   BITSET_WORD *live = void_live;
+         add_live_out(phi_src->pred, def, state);
+         mark_live_in(phi_src->pred, def, state);
+      } else {
+         mark_live_in(use->block, def, state);
+      }
+   }
 
-   BITSET_CLEAR(live, def->live_index);
+   nir_foreach_if_use(src, def) {
+      /* If conditions are used at the end of the block preceding the if. */
+      nir_block *block =
+         nir_cf_node_as_block(nir_cf_node_prev(&src->parent_if->cf_node));
+
+      mark_live_in(block, def, state);
+   }
 
    return true;
 }
 
-/** Propagates the live in of succ across the edge to the live out of pred
- *
- * Phi nodes exist "between" blocks and all the phi nodes at the start of a
- * block act "in parallel".  When we propagate from the live_in of one
- * block to the live out of the other, we have to kill any writes from phis
- * and make live any sources.
- *
- * Returns true if updating live out of pred added anything
+/* Copies the entries gathered for all blocks into the sorted per-block
+ * arrays, with a counting sort by block.
  */
-static bool
-propagate_across_edge(nir_block *pred, nir_block *succ,
-                      struct live_ssa_defs_state *state)
+static void
+build_live_sets(nir_function_impl *impl, struct util_dynarray *entries,
+                bool live_in)
 {
-   NIR_VLA(BITSET_WORD, live, state->bitset_words);
-   memcpy(live, succ->live_in, state->bitset_words * sizeof *live);
+   unsigned *counts = calloc(impl->num_blocks, sizeof(*counts));
 
-   nir_foreach_instr(instr, succ) {
-      if (instr->type != nir_instr_type_phi)
-         break;
-      nir_phi_instr *phi = nir_instr_as_phi(instr);
+   util_dynarray_foreach(entries, struct live_entry, entry)
+      counts[entry->block]++;
+
+   nir_foreach_block(block, impl) {
+      unsigned **set = live_in ? &block->live_in : &block->live_out;
+      unsigned *num = live_in ? &block->num_live_in : &block->num_live_out;
 
-      assert(phi->dest.is_ssa);
-      set_ssa_def_dead(&phi->dest.ssa, live);
+      *set = reralloc(block, *set, unsigned, MAX2(counts[block->index], 1));
+      *num = 0;
    }
 
-   nir_foreach_instr(instr, succ) {
-      if (instr->type != nir_instr_type_phi)
-         break;
-      nir_phi_instr *phi = nir_instr_as_phi(instr);
+   /* Entries were gathered in increasing order of live index, so the sets
+    * come out sorted.
+    */
+   nir_block **blocks = malloc(impl->num_blocks * sizeof(*blocks));
+   nir_foreach_block(block, impl)
+      blocks[block->index] = block;
 
-      nir_foreach_phi_src(src, phi) {
-         if (src->pred == pred) {
-            set_src_live(&src->src, live);
-            break;
-         }
-      }
-   }
+   util_dynarray_foreach(entries, struct live_entry, entry) {
+      nir_block *block = blocks[entry->block];
 
-   BITSET_WORD progress = 0;
-   for (unsigned i = 0; i < state->bitset_words; ++i) {
-      progress |= live[i] & ~pred->live_out[i];
-      pred->live_out[i] |= live[i];
+      if (live_in)
+         block->live_in[block->num_live_in++] = entry->live_index;
+      else
+         block->live_out[block->num_live_out++] = entry->live_index;
    }
-   return progress != 0;
+
+   free(blocks);
+   free(counts);
 }
 
 void
@@ -159,73 +207,64 @@ nir_live_ssa_defs_impl(nir_function_impl *impl)
 {
    struct live_ssa_defs_state state;
 
-   /* We start at 1 because we reserve the index value of 0 for ssa_undef
-    * instructions.  Those are never live, so their liveness information
-    * can be compacted into a single bit.
-    */
-   state.num_ssa_defs = 1;
-   nir_foreach_block(block, impl) {
-      nir_foreach_instr(instr, block)
-         nir_foreach_ssa_def(instr, index_ssa_def, &state);
-   }
+   /* The walks below keep track of the blocks by index. */
+   nir_metadata_require(impl, nir_metadata_block_index);
 
-   nir_block_worklist_init(&state.worklist, impl->num_blocks, NULL);
-
-   /* We now know how many unique ssa definitions we have and we can go
-    * ahead and allocate live_in and live_out sets and add all of the
-    * blocks to the worklist.
+   state.num_ssa_defs = 1;
+   state.last_live_in = calloc(impl->num_blocks, sizeof(unsigned));
+   state.last_live_out = calloc(impl->num_blocks, sizeof(unsigned));
+   util_dynarray_init(&state.live_in, NULL);
+   util_dynarray_init(&state.live_out, NULL);
+   util_dynarray_init(&state.stack, NULL);
+
+   /* Definitions are indexed in the order of a pre DFS search of the
+    * dominance tree, and the live range of each is found as soon as it is
+    * indexed.
     */
-   state.bitset_words = BITSET_WORDS(state.num_ssa_defs);
    nir_foreach_block(block, impl) {
-      init_liveness_block(block, &state);
+      nir_foreach_instr(instr, block)
+         nir_foreach_ssa_def(instr, index_and_mark_ssa_def, &state);
    }
 
+   build_live_sets(impl, &state.live_in, true);
+   build_live_sets(impl, &state.live_out, false);
 
-   /* We're now ready to work through the worklist and update the liveness
-    * sets of each of the blocks.  By the time we get to this point, every
-    * block in the function implementation has been pushed onto the
-    * worklist in reverse order.  As long as we keep the worklist
-    * up-to-date as we go, everything will get covered.
-    */
-   while (!nir_block_worklist_is_empty(&state.worklist)) {
-      /* We pop them off in the reverse order we pushed them on.  This way
-       * the first walk of the instructions is backwards so we only walk
-       * once in the case of no control flow.
-       */
-      nir_block *block = nir_block_worklist_pop_head(&state.worklist);
+   util_dynarray_fini(&state.stack);
+   util_dynarray_fini(&state.live_out);
+   util_dynarray_fini(&state.live_in);
+   free(state.last_live_out);
+   free(state.last_live_in);
+}
 
-      memcpy(block->live_in, block->live_out,
-             state.bitset_words * sizeof(BITSET_WORD));
+static bool
+live_set_contains(const unsigned *set, unsigned num, unsigned live_index)
+{
+   unsigned lo = 0, hi = num;
 
-      nir_if *following_if = nir_block_get_following_if(block);
-      if (following_if)
-         set_src_live(&following_if->condition, block->live_in);
+   while (lo < hi) {
+      unsigned mid = lo + (hi - lo) / 2;
 
-      nir_foreach_instr_reverse(instr, block) {
-         /* Phi nodes are handled seperately so we want to skip them.  Since
-          * we are going backwards and they are at the beginning, we can just
-          * break as soon as we see one.
-          */
-         if (instr->type == nir_instr_type_phi)
-            break;
+      if (set[mid] < live_index)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
 
-         nir_foreach_ssa_def(instr, set_ssa_def_dead, block->live_in);
-         nir_foreach_src(instr, set_src_live, block->live_in);
-      }
+   return lo < num && set[lo] == live_index;
+}
 
-      /* Walk over all of the predecessors of the current block updating
-       * their live in with the live out of this one.  If anything has
-       * changed, add the predecessor to the work list so that we ensure
-       * that the new information is used.
-       */
-      set_foreach(block->predecessors, entry) {
-         nir_block *pred = (nir_block *)entry->key;
-         if (propagate_across_edge(pred, block, &state))
-            nir_block_worklist_push_tail(&state.worklist, pred);
-      }
-   }
+bool
+nir_ssa_def_is_live_in(nir_ssa_def *def, nir_block *block)
+{
+   return live_set_contains(block->live_in, block->num_live_in,
+                            def->live_index);
+}
 
-   nir_block_worklist_fini(&state.worklist);
+bool
+nir_ssa_def_is_live_out(nir_ssa_def *def, nir_block *block)
+{
+   return live_set_contains(block->live_out, block->num_live_out,
+                            def->live_index);
 }
 
 static bool
@@ -254,13 +293,13 @@ search_for_use_after_instr(nir_instr *start, nir_ssa_def *def)
 static bool
 nir_ssa_def_is_live_at(nir_ssa_def *def, nir_instr *instr)
 {
-   if (BITSET_TEST(instr->block->live_out, def->live_index)) {
+   if (nir_ssa_def_is_live_out(def, instr->block)) {
       /* Since def dominates instr, if def is in the liveout of the block,
        * it's live at instr
        */
       return true;
    } else {
-      if (BITSET_TEST(instr->block->live_in, def->live_index) ||
+      if (nir_ssa_def_is_live_in(def, instr->block) ||
           def->parent_instr->block == instr->block) {
          /* In this case it is either live coming into instr's block or it
           * is defined in the same block.  In this case, we simply need to
@@ -35,6 +35,10 @@ struct match_state {
    bool has_exact_alu;
    unsigned variables_seen;
    nir_alu_src variables[NIR_SEARCH_MAX_VARIABLES];
+
+   /* Automaton states of the SSA values, updated for the replacement */
+   struct util_dynarray *states;
+   const struct per_op_table *pass_op_table;
 };
 
 static bool
@@ -131,6 +135,50 @@ nir_op_matches_search_op(nir_op nop, uint16_t sop)
 
 #undef MATCH_FCONV_CASE
 #undef MATCH_ICONV_CASE
+#undef MATCH_BCONV_CASE
+}
+
+uint16_t
+nir_search_op_for_nir_op(nir_op nop)
+{
+#define MATCH_FCONV_CASE(op) \
+   case nir_op_##op##16: \
+   case nir_op_##op##32: \
+   case nir_op_##op##64: \
+      return nir_search_op_##op;
+
+#define MATCH_ICONV_CASE(op) \
+   case nir_op_##op##1: \
+   case nir_op_##op##8: \
+   case nir_op_##op##16: \
+   case nir_op_##op##32: \
+   case nir_op_##op##64: \
+      return nir_search_op_##op;
+
+#define MATCH_BCONV_CASE(op) \
+   case nir_op_##op##1: \
+   case nir_op_##op##32: \
+      return nir_search_op_##op;
+
+   switch (nop) {
+   MATCH_FCONV_CASE(i2f)
+   MATCH_FCONV_CASE(u2f)
+   MATCH_FCONV_CASE(f2f)
+   MATCH_ICONV_CASE(f2u)
+   MATCH_ICONV_CASE(f2i)
+   MATCH_ICONV_CASE(u2u)
+   MATCH_ICONV_CASE(i2i)
+   MATCH_FCONV_CASE(b2f)
+   MATCH_ICONV_CASE(b2i)
+   MATCH_BCONV_CASE(i2b)
+   MATCH_BCONV_CASE(f2b)
+   default:
+      return nop;
+   }
+
+#undef MATCH_FCONV_CASE
+#undef MATCH_ICONV_CASE
+#undef MATCH_BCONV_CASE
 }
 
 static nir_op
@@ -441,6 +489,9 @@ construct_value(nir_builder *build,
 
       nir_builder_instr_insert(build, &alu->instr);
 
+      nir_algebraic_automaton(&alu->instr, state->states,
+                              state->pass_op_table);
+
       nir_alu_src val;
       val.src = nir_src_for_ssa(&alu->dest.dest.ssa);
       val.negate = false;
@@ -485,6 +536,9 @@ construct_value(nir_builder *build,
          unreachable("Invalid alu source type");
       }
 
+      nir_algebraic_automaton(cval->parent_instr, state->states,
+                              state->pass_op_table);
+
       nir_alu_src val;
       val.src = nir_src_for_ssa(cval);
       val.negate = false;
@@ -499,8 +553,80 @@ construct_value(nir_builder *build,
    }
 }
 
+static uint16_t
+get_state(const struct util_dynarray *states, const nir_src *src)
+{
+   /* Non-SSA sources never match anything but a variable. */
+   if (!src->is_ssa ||
+       src->ssa->index >= util_dynarray_num_elements(states, uint16_t))
+      return 0;
+
+   return *util_dynarray_element(states, uint16_t, src->ssa->index);
+}
+
+/**
+ * Compute the automaton state of the value an instruction defines from the
+ * states of its sources, which must have been computed already.
+ *
+ * The states array grows to hold the SSA values created after it was
+ * allocated, such as the ones of replacement expressions.
+ */
+void
+nir_algebraic_automaton(nir_instr *instr, struct util_dynarray *states,
+                        const struct per_op_table *pass_op_table)
+{
+   unsigned index, num_states;
+   uint16_t state;
+
+   switch (instr->type) {
+   case nir_instr_type_alu: {
+      nir_alu_instr *alu = nir_instr_as_alu(instr);
+      const struct per_op_table *tbl =
+         &pass_op_table[nir_search_op_for_nir_op(alu->op)];
+
+      if (!alu->dest.dest.is_ssa)
+         return;
+
+      index = alu->dest.dest.ssa.index;
+      state = 0;
+
+      if (tbl->num_filtered_states > 0) {
+         /* The table index must match the iteration order of Python's
+          * itertools.product(), which was used to emit the table.
+          */
+         unsigned table_index = 0;
+         for (unsigned i = 0; i < nir_op_infos[alu->op].num_inputs; i++) {
+            table_index = table_index * tbl->num_filtered_states +
+                          tbl->filter[get_state(states, &alu->src[i].src)];
+         }
+         state = tbl->table[table_index];
+      }
+      break;
+   }
+
+   case nir_instr_type_load_const:
+      index = nir_instr_as_load_const(instr)->def.index;
+      state = CONST_STATE;
+      break;
+
+   default:
+      return;
+   }
+
+   num_states = util_dynarray_num_elements(states, uint16_t);
+   if (index >= num_states) {
+      util_dynarray_grow(states, (index + 1 - num_states) * sizeof(uint16_t));
+      memset(util_dynarray_element(states, uint16_t, num_states), 0,
+             (index + 1 - num_states) * sizeof(uint16_t));
+   }
+
+   *util_dynarray_element(states, uint16_t, index) = state;
+}
+
 nir_ssa_def *
 nir_replace_instr(nir_builder *build, nir_alu_instr *instr,
+                  struct util_dynarray *states,
+                  const struct per_op_table *pass_op_table,
                   const nir_search_expression *search,
                   const nir_search_value *replace)
 {
@@ -515,6 +641,8 @@ nir_replace_instr(nir_builder *build, nir_alu_instr *instr,
    state.inexact_match = false;
    state.has_exact_alu = false;
    state.variables_seen = 0;
+   state.states = states;
+   state.pass_op_table = pass_op_table;
 
    if (!match_expression(search, instr, instr->dest.dest.ssa.num_components,
                          swizzle, &state))
@@ -533,6 +661,7 @@ nir_replace_instr(nir_builder *build, nir_alu_instr *instr,
     */
    nir_ssa_def *ssa_val =
       nir_imov_alu(build, val, instr->dest.dest.ssa.num_components);
+   nir_algebraic_automaton(ssa_val->parent_instr, states, pass_op_table);
    nir_ssa_def_rewrite_uses(&instr->dest.dest.ssa, nir_src_for_ssa(ssa_val));
 
    /* We know this one has no more uses because we just rewrote them all,
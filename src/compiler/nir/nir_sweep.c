@@ -68,9 +68,11 @@ sweep_block(nir_shader *nir, nir_block *block)
     */
    ralloc_free(block->live_in);
    block->live_in = NULL;
+   block->num_live_in = 0;
 
    ralloc_free(block->live_out);
    block->live_out = NULL;
+   block->num_live_out = 0;
 
    nir_foreach_instr(instr, block) {
       ralloc_steal(nir, instr);
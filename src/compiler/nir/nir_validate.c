@@ -27,6 +27,7 @@
 
 #include "nir.h"
 #include <assert.h>
+#include <string.h>
 
 /*
  * This file checks for invalid IR indicating a bug somewhere in the compiler.
@@ -51,12 +52,15 @@ typedef struct {
 } reg_validate_state;
 
 typedef struct {
+   /* the SSA value with this index, once its definition has been found */
+   nir_ssa_def *def;
+
    /*
-    * equivalent to the uses in nir_ssa_def, but built up by the validator.
-    * At the end, we verify that the sets have the same entries.
+    * number of uses of the SSA value found by the validator.  At the end, we
+    * verify that they match the uses in nir_ssa_def, which must all be in
+    * the sets of sources found.
     */
-   struct set *uses, *if_uses;
-   nir_function_impl *where_defined;
+   unsigned num_uses, num_if_uses;
 } ssa_def_validate_state;
 
 typedef struct {
@@ -87,11 +91,13 @@ typedef struct {
    /* the current function implementation being validated */
    nir_function_impl *impl;
 
-   /* map of SSA value -> function implementation where it is defined */
-   struct hash_table *ssa_defs;
+   /* array of SSA value index -> validation state (struct above), for the
+    * current function implementation
+    */
+   ssa_def_validate_state *ssa_defs;
 
-   /* bitset of ssa definitions we have found; used to check uniqueness */
-   BITSET_WORD *ssa_defs_found;
+   /* sets of the SSA sources of instructions and ifs found */
+   struct set *ssa_uses, *ssa_if_uses;
 
    /* bitset of registers we have currently found; used to check uniqueness */
    BITSET_WORD *regs_found;
@@ -103,6 +109,9 @@ typedef struct {
 
    /* map of instruction/var/etc to failed assert string */
    struct hash_table *errors;
+
+   /* whether to skip the function implementations already validated */
+   bool skip_validated;
 } validate_state;
 
 static void
@@ -181,23 +190,30 @@ validate_ssa_src(nir_src *src, validate_state *state,
 {
    validate_assert(state, src->ssa != NULL);
 
-   struct hash_entry *entry = _mesa_hash_table_search(state->ssa_defs, src->ssa);
-
-   validate_assert(state, entry);
-
-   if (!entry)
+   if (!src->ssa)
       return;
 
-   ssa_def_validate_state *def_state = (ssa_def_validate_state *)entry->data;
+   /* Definitions are always found before their uses, including those in
+    * phis, so any SSA value which isn't known yet comes from elsewhere.
+    */
+   ssa_def_validate_state *def_state = NULL;
+   if (src->ssa->index < state->impl->ssa_alloc &&
+       state->ssa_defs[src->ssa->index].def == src->ssa)
+      def_state = &state->ssa_defs[src->ssa->index];
 
-   validate_assert(state, def_state->where_defined == state->impl &&
+   validate_assert(state, def_state &&
           "using an SSA value defined in a different function");
 
+   if (!def_state)
+      return;
+
    if (state->instr) {
-      _mesa_set_add(def_state->uses, src);
+      _mesa_set_add(state->ssa_uses, src);
+      def_state->num_uses++;
    } else {
       validate_assert(state, state->if_stmt);
-      _mesa_set_add(def_state->if_uses, src);
+      _mesa_set_add(state->ssa_if_uses, src);
+      def_state->num_if_uses++;
    }
 
    if (bit_size)
@@ -285,8 +301,10 @@ static void
 validate_ssa_def(nir_ssa_def *def, validate_state *state)
 {
    validate_assert(state, def->index < state->impl->ssa_alloc);
-   validate_assert(state, !BITSET_TEST(state->ssa_defs_found, def->index));
-   BITSET_SET(state->ssa_defs_found, def->index);
+   if (def->index < state->impl->ssa_alloc) {
+      validate_assert(state, state->ssa_defs[def->index].def == NULL);
+      state->ssa_defs[def->index].def = def;
+   }
 
    validate_assert(state, def->parent_instr == state->instr);
 
@@ -296,15 +314,6 @@ validate_ssa_def(nir_ssa_def *def, validate_state *state)
 
    list_validate(&def->uses);
    list_validate(&def->if_uses);
-
-   ssa_def_validate_state *def_state = ralloc(state->ssa_defs,
-                                              ssa_def_validate_state);
-   def_state->where_defined = state->impl;
-   def_state->uses = _mesa_set_create(def_state, _mesa_hash_pointer,
-                                      _mesa_key_pointer_equal);
-   def_state->if_uses = _mesa_set_create(def_state, _mesa_hash_pointer,
-                                         _mesa_key_pointer_equal);
-   _mesa_hash_table_insert(state->ssa_defs, def, def_state);
 }
 
 static void
@@ -1016,38 +1025,38 @@ postvalidate_ssa_def(nir_ssa_def *def, void *void_state)
 {
    validate_state *state = void_state;
 
-   struct hash_entry *entry = _mesa_hash_table_search(state->ssa_defs, def);
+   /* Errors were already reported for values with a bad or reused index. */
+   if (def->index >= state->impl->ssa_alloc ||
+       state->ssa_defs[def->index].def != def)
+      return true;
 
-   assume(entry);
-   ssa_def_validate_state *def_state = (ssa_def_validate_state *)entry->data;
+   ssa_def_validate_state *def_state = &state->ssa_defs[def->index];
+   unsigned num_uses = 0, num_if_uses = 0;
+
+   state->instr = def->parent_instr;
 
    nir_foreach_use(src, def) {
-      struct set_entry *entry = _mesa_set_search(def_state->uses, src);
-      validate_assert(state, entry);
-      _mesa_set_remove(def_state->uses, entry);
+      validate_assert(state, src->is_ssa && src->ssa == def);
+      validate_assert(state, _mesa_set_search(state->ssa_uses, src));
+      num_uses++;
    }
 
-   if (def_state->uses->entries != 0) {
-      printf("extra entries in SSA def uses:\n");
-      set_foreach(def_state->uses, entry)
-         printf("%p\n", entry->key);
-
-      abort();
-   }
+   /* All of the uses in the list were found pointing to def, so the uses
+    * found are all in the list iff there are as many of them.
+    */
+   validate_assert(state, num_uses == def_state->num_uses &&
+          "uses found missing from the SSA def uses");
 
    nir_foreach_if_use(src, def) {
-      struct set_entry *entry = _mesa_set_search(def_state->if_uses, src);
-      validate_assert(state, entry);
-      _mesa_set_remove(def_state->if_uses, entry);
+      validate_assert(state, src->is_ssa && src->ssa == def);
+      validate_assert(state, _mesa_set_search(state->ssa_if_uses, src));
+      num_if_uses++;
    }
 
-   if (def_state->if_uses->entries != 0) {
-      printf("extra entries in SSA def uses:\n");
-      set_foreach(def_state->if_uses, entry)
-         printf("%p\n", entry->key);
+   validate_assert(state, num_if_uses == def_state->num_if_uses &&
+          "if uses found missing from the SSA def if uses");
 
-      abort();
-   }
+   state->instr = NULL;
 
    return true;
 }
@@ -1080,11 +1089,9 @@ validate_function_impl(nir_function_impl *impl, validate_state *state)
       prevalidate_reg_decl(reg, false, state);
    }
 
-   state->ssa_defs_found = realloc(state->ssa_defs_found,
-                                   BITSET_WORDS(impl->ssa_alloc) *
-                                   sizeof(BITSET_WORD));
-   memset(state->ssa_defs_found, 0, BITSET_WORDS(impl->ssa_alloc) *
-                                    sizeof(BITSET_WORD));
+   state->ssa_defs = realloc(state->ssa_defs,
+                             impl->ssa_alloc * sizeof(*state->ssa_defs));
+   memset(state->ssa_defs, 0, impl->ssa_alloc * sizeof(*state->ssa_defs));
    exec_list_validate(&impl->body);
    foreach_list_typed(nir_cf_node, node, node, &impl->body) {
       validate_cf_node(node, state);
@@ -1105,6 +1112,11 @@ validate_function(nir_function *func, validate_state *state)
 {
    if (func->impl != NULL) {
       validate_assert(state, func->impl->function == func);
+
+      if (state->skip_validated &&
+          (func->impl->valid_metadata & nir_metadata_validated))
+         return;
+
       validate_function_impl(func->impl, state);
    }
 }
@@ -1114,9 +1126,11 @@ init_validate_state(validate_state *state)
 {
    state->regs = _mesa_hash_table_create(NULL, _mesa_hash_pointer,
                                          _mesa_key_pointer_equal);
-   state->ssa_defs = _mesa_hash_table_create(NULL, _mesa_hash_pointer,
-                                             _mesa_key_pointer_equal);
-   state->ssa_defs_found = NULL;
+   state->ssa_defs = NULL;
+   state->ssa_uses = _mesa_set_create(NULL, _mesa_hash_pointer,
+                                      _mesa_key_pointer_equal);
+   state->ssa_if_uses = _mesa_set_create(NULL, _mesa_hash_pointer,
+                                         _mesa_key_pointer_equal);
    state->regs_found = NULL;
    state->var_defs = _mesa_hash_table_create(NULL, _mesa_hash_pointer,
                                              _mesa_key_pointer_equal);
@@ -1132,8 +1146,9 @@ static void
 destroy_validate_state(validate_state *state)
 {
    _mesa_hash_table_destroy(state->regs, NULL);
-   _mesa_hash_table_destroy(state->ssa_defs, NULL);
-   free(state->ssa_defs_found);
+   free(state->ssa_defs);
+   _mesa_set_destroy(state->ssa_uses, NULL);
+   _mesa_set_destroy(state->ssa_if_uses, NULL);
    free(state->regs_found);
    _mesa_hash_table_destroy(state->var_defs, NULL);
    _mesa_hash_table_destroy(state->errors, NULL);
@@ -1169,8 +1184,18 @@ void
 nir_validate_shader(nir_shader *shader, const char *when)
 {
    static int should_validate = -1;
-   if (should_validate < 0)
-      should_validate = env_var_as_boolean("NIR_VALIDATE", true);
+   static bool only_changed = false;
+   if (should_validate < 0) {
+      /* NIR_VALIDATE=changed only validates again the function
+       * implementations which were changed by a pass, as told by it
+       * throwing away their metadata, which keeps the cost of validating
+       * after every pass proportional to what the passes did.
+       */
+      const char *validate = getenv("NIR_VALIDATE");
+      only_changed = validate && strcmp(validate, "changed") == 0;
+      should_validate = only_changed ||
+                        env_var_as_boolean("NIR_VALIDATE", true);
+   }
    if (!should_validate)
       return;
 
@@ -1179,6 +1204,12 @@ nir_validate_shader(nir_shader *shader, const char *when)
 
    state.shader = shader;
 
+   /* The uses of global registers are checked against all of the function
+    * implementations.
+    */
+   state.skip_validated = only_changed &&
+                          exec_list_is_empty(&shader->registers);
+
    exec_list_validate(&shader->uniforms);
    nir_foreach_variable(var, &shader->uniforms) {
       validate_var_decl(var, true, &state);
@@ -1231,6 +1262,13 @@ nir_validate_shader(nir_shader *shader, const char *when)
    if (_mesa_hash_table_num_entries(state.errors) > 0)
       dump_errors(&state, when);
 
+   if (only_changed) {
+      nir_foreach_function(func, shader) {
+         if (func->impl)
+            func->impl->valid_metadata |= nir_metadata_validated;
+      }
+   }
+
    destroy_validate_state(&state);
 }
 
@@ -20,13 +20,14 @@
 # FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
 # IN THE SOFTWARE.
 
+import itertools
 import unittest
 
 import sys
 import os
 sys.path.insert(1, os.path.join(sys.path[0], '..'))
 
-from nir_algebraic import SearchAndReplace
+from nir_algebraic import SearchAndReplace, TreeAutomaton
 
 # These tests check that the bitsize validator correctly rejects various
 # different kinds of malformed expressions, and documents what the error
@@ -113,4 +114,69 @@ class ValidatorTests(unittest.TestCase):
             "The search expression bit size ('b2i', ('i2b', 'a')) and " \
             "replace expression bit size a may not be the same")
 
+# These tests check that the state the automaton assigns to an expression
+# lists every pattern whose opcodes and constants match the expression, in
+# the order they were given, so that the generated pass tries the same
+# transforms as a search over all of them would.
+
+class AutomatonTests(unittest.TestCase):
+    transforms = [
+        (('fadd', a, 0.0), a),
+        (('fmul', a, 1.0), a),
+        (('fadd', ('fmul', a, b), c), ('ffma', a, b, c)),
+        (('fneg', ('fneg', a)), a),
+        (('fadd', a, ('fneg', a)), 0.0),
+        (('bcsel', ('flt', a, b), a, b), ('fmin', a, b)),
+        (('f2b', ('fneg', a)), ('f2b', a)),
+    ]
+
+    # Expressions over the opcodes above, with 'x' an instruction the
+    # automaton doesn't know about and '#' a constant.
+    def expressions(self, depth):
+        if depth == 0:
+            return ['x', '#']
+        smaller = self.expressions(depth - 1)
+        result = list(smaller)
+        for op, num_srcs in (('fadd', 2), ('fmul', 2), ('fneg', 1),
+                             ('flt', 2), ('bcsel', 3), ('f2b32', 1),
+                             ('fmax', 2)):
+            for srcs in itertools.product(smaller, repeat=num_srcs):
+                result.append((op,) + srcs)
+        return result
+
+    def state(self, automaton, expr):
+        if expr == 'x':
+            return 0
+        if expr == '#':
+            return 1
+        op = expr[0].rstrip('0123456789')
+        if op not in automaton.opcodes:
+            return 0
+        srcs = tuple(automaton.filter[op][self.state(automaton, src)]
+                     for src in expr[1:])
+        return automaton.table[op][srcs]
+
+    def matches(self, pattern, expr):
+        if isinstance(pattern, str):
+            return pattern[0] != '#' or expr == '#'
+        if isinstance(pattern, float):
+            return expr == '#'
+        if isinstance(expr, str) or \
+           pattern[0] != expr[0].rstrip('0123456789'):
+            return False
+        if all(self.matches(p, e) for p, e in zip(pattern[1:], expr[1:])):
+            return True
+        return pattern[0] in ('fadd', 'fmul') and \
+               self.matches(pattern[1], expr[2]) and \
+               self.matches(pattern[2], expr[1])
+
+    def test_state_patterns(self):
+        automaton = TreeAutomaton([SearchAndReplace(t)
+                                   for t in self.transforms])
+        for expr in self.expressions(2):
+            expected = [i for i, t in enumerate(self.transforms)
+                        if self.matches(t[0], expr)]
+            patterns = automaton.state_patterns[self.state(automaton, expr)]
+            self.assertEqual(expected, patterns, str(expr))
+
 unittest.main()
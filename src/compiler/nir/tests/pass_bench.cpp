@@ -0,0 +1,217 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Measures the cost of NIR validation, metadata and a few passes on long
+ * generated shaders of increasing size, as a time per instruction, which
+ * stays flat for the ones scaling linearly with the shader size.
+ *
+ * Each segment of the shaders is a few ALU instructions followed by an if
+ * whose result is merged by a phi, the shape of unrolled loops and inlined
+ * functions in big shaders.
+ *
+ * Usage: pass_bench [max segments]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "nir.h"
+#include "nir_builder.h"
+#include "util/os_time.h"
+
+static nir_shader *
+create_shader(unsigned segments)
+{
+   static const nir_shader_compiler_options options = { };
+   nir_builder b;
+
+   nir_builder_init_simple_shader(&b, NULL, MESA_SHADER_FRAGMENT, &options);
+
+   nir_variable *in = nir_variable_create(b.shader, nir_var_shader_in,
+                                          glsl_vec4_type(), "in");
+   nir_variable *out = nir_variable_create(b.shader, nir_var_shader_out,
+                                           glsl_vec4_type(), "out");
+
+   nir_ssa_def *x = nir_load_var(&b, in);
+   nir_ssa_def *y = nir_fmul(&b, x, x);
+
+   for (unsigned i = 0; i < segments; i++) {
+      x = nir_fadd(&b, x, y);
+      y = nir_ffma(&b, y, x, nir_imm_float(&b, 0.5));
+      nir_ssa_def *cond = nir_flt(&b, nir_channel(&b, x, 0),
+                                  nir_channel(&b, y, 1));
+
+      nir_if *nif = nir_push_if(&b, cond);
+      nir_ssa_def *then_def = nir_fadd(&b, x, nir_imm_float(&b, 1.0));
+      nir_push_else(&b, nif);
+      nir_ssa_def *else_def = nir_fmul(&b, y, nir_imm_float(&b, 2.0));
+      nir_pop_if(&b, nif);
+
+      x = nir_if_phi(&b, then_def, else_def);
+   }
+
+   nir_store_var(&b, out, x, 0xf);
+
+   return b.shader;
+}
+
+static unsigned
+count_instrs(nir_shader *shader)
+{
+   unsigned count = 0;
+
+   nir_foreach_function(function, shader) {
+      if (function->impl) {
+         nir_foreach_block(block, function->impl) {
+            nir_foreach_instr(instr, block)
+               count++;
+         }
+      }
+   }
+
+   return count;
+}
+
+static void
+invalidate_metadata(nir_shader *shader)
+{
+   nir_foreach_function(function, shader) {
+      if (function->impl)
+         nir_metadata_preserve(function->impl, nir_metadata_none);
+   }
+}
+
+static void
+validate(nir_shader *shader)
+{
+   nir_validate_shader(shader, NULL);
+}
+
+static void
+dominance(nir_shader *shader)
+{
+   invalidate_metadata(shader);
+   nir_calc_dominance(shader);
+}
+
+static void
+liveness(nir_shader *shader)
+{
+   invalidate_metadata(shader);
+   nir_foreach_function(function, shader) {
+      if (function->impl) {
+         nir_metadata_require(function->impl,
+                              (nir_metadata)(nir_metadata_block_index |
+                                             nir_metadata_live_ssa_defs));
+      }
+   }
+}
+
+/* Analyses are run a few times on the same shader, keeping the best time. */
+static double
+time_analysis(nir_shader *shader, void (*analysis)(nir_shader *))
+{
+   int64_t best = INT64_MAX;
+
+   for (unsigned i = 0; i < 3; i++) {
+      int64_t start = os_time_get_nano();
+      analysis(shader);
+      best = MIN2(best, os_time_get_nano() - start);
+   }
+
+   return best;
+}
+
+/* Passes change the shader, so they are timed once on a fresh one. */
+static double
+time_pass(unsigned segments, bool (*pass)(nir_shader *))
+{
+   nir_shader *shader = create_shader(segments);
+   int64_t start = os_time_get_nano();
+
+   pass(shader);
+
+   int64_t time = os_time_get_nano() - start;
+   ralloc_free(shader);
+
+   return time;
+}
+
+static bool
+opt_peephole_select(nir_shader *shader)
+{
+   return nir_opt_peephole_select(shader, 8, true, true);
+}
+
+static const struct {
+   const char *name;
+   void (*analysis)(nir_shader *);
+   bool (*pass)(nir_shader *);
+} tests[] = {
+   { "nir_validate_shader", validate, NULL },
+   { "nir_calc_dominance", dominance, NULL },
+   { "nir_live_ssa_defs", liveness, NULL },
+   { "nir_opt_cse", NULL, nir_opt_cse },
+   { "nir_copy_prop", NULL, nir_copy_prop },
+   { "nir_opt_dce", NULL, nir_opt_dce },
+   { "nir_opt_dead_cf", NULL, nir_opt_dead_cf },
+   { "nir_opt_peephole_select", NULL, opt_peephole_select },
+};
+
+int
+main(int argc, char **argv)
+{
+   unsigned max_segments = argc > 1 ? atoi(argv[1]) : 8192;
+
+   printf("%-24s", "ns/instruction");
+   for (unsigned segments = 128; segments <= max_segments; segments *= 4) {
+      nir_shader *shader = create_shader(segments);
+      printf(" %9u", count_instrs(shader));
+      ralloc_free(shader);
+   }
+   printf("\n");
+
+   for (unsigned t = 0; t < ARRAY_SIZE(tests); t++) {
+      printf("%-24s", tests[t].name);
+
+      for (unsigned segments = 128; segments <= max_segments; segments *= 4) {
+         nir_shader *shader = create_shader(segments);
+         unsigned instrs = count_instrs(shader);
+         double time;
+
+         if (tests[t].analysis) {
+            time = time_analysis(shader, tests[t].analysis);
+            ralloc_free(shader);
+         } else {
+            ralloc_free(shader);
+            time = time_pass(segments, tests[t].pass);
+         }
+
+         printf(" %9.1f", time / instrs);
+         fflush(stdout);
+      }
+      printf("\n");
+   }
+
+   return 0;
+}
@@ -530,6 +530,38 @@ draw_set_force_passthrough( struct draw_context *draw, boolean enable )
 }
 
 
+/**
+ * Let the driver store and look up the vertex/geometry shader variants
+ * generated by LLVM, keyed by a SHA1 of everything affecting the code.
+ */
+void
+draw_set_disk_cache_callbacks(struct draw_context *draw,
+                              void *data_cookie,
+                              void (*find_shader)(void *cookie,
+                                                  struct lp_cached_code *cache,
+                                                  const unsigned char ir_sha1_cache_key[20]),
+                              void (*insert_shader)(void *cookie,
+                                                    struct lp_cached_code *cache,
+                                                    const unsigned char ir_sha1_cache_key[20]))
+{
+   draw->disk_cache_find_shader = find_shader;
+   draw->disk_cache_insert_shader = insert_shader;
+   draw->disk_cache_cookie = data_cookie;
+}
+
+
+/**
+ * Tell the draw module which driver-private pipe_resource::flags bit marks
+ * textures stored in tiles (see lp_tiled_texel_offset()).  Zero, the
+ * default, means all textures are linear.
+ */
+void
+draw_set_tiled_texture_flag(struct draw_context *draw, unsigned flag)
+{
+   draw->tiled_texture_flag = flag;
+}
+
+
 
 /**
  * Allocate an extra vertex/geometry shader vertex attribute, if it doesn't
@@ -52,7 +52,9 @@
 
 #include "tgsi/tgsi_exec.h"
 #include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_parse.h"
 
+#include "util/mesa-sha1.h"
 #include "util/u_math.h"
 #include "util/u_pointer.h"
 #include "util/u_string.h"
@@ -539,6 +541,29 @@ draw_llvm_destroy(struct draw_llvm *llvm)
 }
 
 
+/**
+ * Hash everything the generated code depends on: the shader tokens, the
+ * variant key and the vertex header size.
+ */
+static void
+draw_get_ir_cache_key(const struct tgsi_token *tokens,
+                      const void *key,
+                      size_t key_size,
+                      unsigned num_vertex_header_attribs,
+                      unsigned char ir_sha1_cache_key[20])
+{
+   struct mesa_sha1 ctx;
+
+   _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, key, key_size);
+   _mesa_sha1_update(&ctx, &num_vertex_header_attribs,
+                     sizeof(num_vertex_header_attribs));
+   _mesa_sha1_update(&ctx, tokens,
+                     tgsi_num_tokens(tokens) * sizeof(struct tgsi_token));
+   _mesa_sha1_final(&ctx, ir_sha1_cache_key);
+}
+
+
 /**
  * Create LLVM-generated code for a vertex shader.
  */
@@ -547,11 +572,15 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
                          unsigned num_inputs,
                          const struct draw_llvm_variant_key *key)
 {
+   struct draw_context *draw = llvm->draw;
    struct draw_llvm_variant *variant;
    struct llvm_vertex_shader *shader =
       llvm_vertex_shader(llvm->draw->vs.vertex_shader);
    LLVMTypeRef vertex_header;
    char module_name[64];
+   unsigned char ir_sha1_cache_key[20];
+   struct lp_cached_code cached = { 0 };
+   bool needs_caching = false;
 
    variant = MALLOC(sizeof *variant +
                     shader->variant_key_size -
@@ -565,7 +594,17 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
    util_snprintf(module_name, sizeof(module_name), "draw_llvm_vs_variant%u",
                  variant->shader->variants_cached);
 
-   variant->gallivm = gallivm_create(module_name, llvm->context);
+   if (draw->disk_cache_find_shader) {
+      draw_get_ir_cache_key(shader->base.state.tokens, key,
+                            shader->variant_key_size, num_inputs,
+                            ir_sha1_cache_key);
+      draw->disk_cache_find_shader(draw->disk_cache_cookie,
+                                   &cached, ir_sha1_cache_key);
+      if (!cached.data_size)
+         needs_caching = true;
+   }
+
+   variant->gallivm = gallivm_create(module_name, llvm->context, &cached);
 
    create_jit_types(variant);
 
@@ -587,7 +626,12 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
    variant->jit_func = (draw_jit_vert_func)
          gallivm_jit_function(variant->gallivm, variant->function);
 
+   if (needs_caching)
+      draw->disk_cache_insert_shader(draw->disk_cache_cookie,
+                                     &cached, ir_sha1_cache_key);
+
    gallivm_free_ir(variant->gallivm);
+   free(cached.data);
 
    variant->list_item_global.base = variant;
    variant->list_item_local.base = variant;
@@ -628,7 +672,12 @@ generate_vs(struct draw_llvm_variant *variant,
                      context_ptr,
                      NULL,
                      draw_sampler,
+                     NULL /*image*/,
+                     NULL /*ssbo_ptr*/,
+                     NULL /*ssbo_sizes_ptr*/,
+                     NULL /*shared_ptr*/,
                      &llvm->draw->vs.vertex_shader->info,
+                     NULL,
                      NULL);
 
    {
@@ -1529,7 +1578,6 @@ draw_llvm_generate(struct draw_llvm *llvm, struct draw_llvm_variant *variant)
    LLVMValueRef context_ptr;
    LLVMBasicBlockRef block;
    LLVMBuilderRef builder;
-   char func_name[64];
    struct lp_type vs_type;
    LLVMValueRef count, fetch_elts, start_or_maxelt;
    LLVMValueRef vertex_id_offset, start_instance;
@@ -1574,9 +1622,6 @@ draw_llvm_generate(struct draw_llvm *llvm, struct draw_llvm_variant *variant)
 
    memset(&system_values, 0, sizeof(system_values));
 
-   util_snprintf(func_name, sizeof(func_name), "draw_llvm_vs_variant%u",
-                 variant->shader->variants_cached);
-
    i = 0;
    arg_types[i++] = get_context_ptr_type(variant);       /* context */
    arg_types[i++] = get_vertex_header_ptr_type(variant); /* vertex_header */
@@ -1593,7 +1638,11 @@ draw_llvm_generate(struct draw_llvm *llvm, struct draw_llvm_variant *variant)
    func_type = LLVMFunctionType(LLVMInt8TypeInContext(context),
                                 arg_types, num_arg_types, 0);
 
-   variant_func = LLVMAddFunction(gallivm->module, func_name, func_type);
+   /* The name must not depend on the variant numbering, as it is how the
+    * function is looked up in objects from the disk cache.
+    */
+   variant_func = LLVMAddFunction(gallivm->module, "draw_llvm_vs_variant",
+                                  func_type);
    variant->function = variant_func;
 
    LLVMSetFunctionCallConv(variant_func, LLVMCCallConv);
@@ -1961,6 +2010,19 @@ draw_llvm_generate(struct draw_llvm *llvm, struct draw_llvm_variant *variant)
 }
 
 
+/**
+ * Is the view's texture stored in tiles, as flagged by the driver with
+ * draw_set_tiled_texture_flag()?
+ */
+static boolean
+draw_texture_is_tiled(const struct draw_context *draw,
+                      const struct pipe_sampler_view *view)
+{
+   return view && view->texture &&
+          (view->texture->flags & draw->tiled_texture_flag) != 0;
+}
+
+
 struct draw_llvm_variant_key *
 draw_llvm_make_variant_key(struct draw_llvm *llvm, char *store)
 {
@@ -2033,8 +2095,12 @@ draw_llvm_make_variant_key(struct draw_llvm *llvm, char *store)
                                       llvm->draw->samplers[PIPE_SHADER_VERTEX][i]);
    }
    for (i = 0 ; i < key->nr_sampler_views; i++) {
-      lp_sampler_static_texture_state(&draw_sampler[i].texture_state,
-                                      llvm->draw->sampler_views[PIPE_SHADER_VERTEX][i]);
+      const struct pipe_sampler_view *view =
+         llvm->draw->sampler_views[PIPE_SHADER_VERTEX][i];
+
+      lp_sampler_static_texture_state(&draw_sampler[i].texture_state, view);
+      draw_sampler[i].texture_state.tiled =
+         draw_texture_is_tiled(llvm->draw, view);
    }
 
    return key;
@@ -2241,7 +2307,6 @@ draw_gs_llvm_generate(struct draw_llvm *llvm,
    struct lp_build_sampler_soa *sampler = 0;
    struct lp_build_context bld;
    struct lp_bld_tgsi_system_values system_values;
-   char func_name[64];
    struct lp_type gs_type;
    unsigned i;
    struct draw_gs_llvm_iface gs_iface;
@@ -2254,9 +2319,6 @@ draw_gs_llvm_generate(struct draw_llvm *llvm,
 
    memset(&system_values, 0, sizeof(system_values));
 
-   util_snprintf(func_name, sizeof(func_name), "draw_llvm_gs_variant%u",
-                 variant->shader->variants_cached);
-
    assert(variant->vertex_header_ptr_type);
 
    arg_types[0] = get_gs_context_ptr_type(variant);    /* context */
@@ -2270,7 +2332,9 @@ draw_gs_llvm_generate(struct draw_llvm *llvm,
 
    func_type = LLVMFunctionType(int32_type, arg_types, ARRAY_SIZE(arg_types), 0);
 
-   variant_func = LLVMAddFunction(gallivm->module, func_name, func_type);
+   /* The name must not depend on the variant numbering, see above */
+   variant_func = LLVMAddFunction(gallivm->module, "draw_llvm_gs_variant",
+                                  func_type);
 
    variant->function = variant_func;
 
@@ -2355,8 +2419,13 @@ draw_gs_llvm_generate(struct draw_llvm *llvm,
                      context_ptr,
                      NULL,
                      sampler,
+                     NULL /*image*/,
+                     NULL /*ssbo_ptr*/,
+                     NULL /*ssbo_sizes_ptr*/,
+                     NULL /*shared_ptr*/,
                      &llvm->draw->gs.geometry_shader->info,
-                     (const struct lp_build_tgsi_gs_iface *)&gs_iface);
+                     (const struct lp_build_tgsi_gs_iface *)&gs_iface,
+                     NULL);
 
    sampler->destroy(sampler);
 
@@ -2373,11 +2442,15 @@ draw_gs_llvm_create_variant(struct draw_llvm *llvm,
                             unsigned num_outputs,
                             const struct draw_gs_llvm_variant_key *key)
 {
+   struct draw_context *draw = llvm->draw;
    struct draw_gs_llvm_variant *variant;
    struct llvm_geometry_shader *shader =
       llvm_geometry_shader(llvm->draw->gs.geometry_shader);
    LLVMTypeRef vertex_header;
    char module_name[64];
+   unsigned char ir_sha1_cache_key[20];
+   struct lp_cached_code cached = { 0 };
+   bool needs_caching = false;
 
    variant = MALLOC(sizeof *variant +
                     shader->variant_key_size -
@@ -2391,7 +2464,17 @@ draw_gs_llvm_create_variant(struct draw_llvm *llvm,
    util_snprintf(module_name, sizeof(module_name), "draw_llvm_gs_variant%u",
                  variant->shader->variants_cached);
 
-   variant->gallivm = gallivm_create(module_name, llvm->context);
+   if (draw->disk_cache_find_shader) {
+      draw_get_ir_cache_key(shader->base.state.tokens, key,
+                            shader->variant_key_size, num_outputs,
+                            ir_sha1_cache_key);
+      draw->disk_cache_find_shader(draw->disk_cache_cookie,
+                                   &cached, ir_sha1_cache_key);
+      if (!cached.data_size)
+         needs_caching = true;
+   }
+
+   variant->gallivm = gallivm_create(module_name, llvm->context, &cached);
 
    create_gs_jit_types(variant);
 
@@ -2408,7 +2491,12 @@ draw_gs_llvm_create_variant(struct draw_llvm *llvm,
    variant->jit_func = (draw_gs_jit_func)
          gallivm_jit_function(variant->gallivm, variant->function);
 
+   if (needs_caching)
+      draw->disk_cache_insert_shader(draw->disk_cache_cookie,
+                                     &cached, ir_sha1_cache_key);
+
    gallivm_free_ir(variant->gallivm);
+   free(cached.data);
 
    variant->list_item_global.base = variant;
    variant->list_item_local.base = variant;
@@ -2472,8 +2560,12 @@ draw_gs_llvm_make_variant_key(struct draw_llvm *llvm, char *store)
                                       llvm->draw->samplers[PIPE_SHADER_GEOMETRY][i]);
    }
    for (i = 0 ; i < key->nr_sampler_views; i++) {
-      lp_sampler_static_texture_state(&draw_sampler[i].texture_state,
-                                      llvm->draw->sampler_views[PIPE_SHADER_GEOMETRY][i]);
+      const struct pipe_sampler_view *view =
+         llvm->draw->sampler_views[PIPE_SHADER_GEOMETRY][i];
+
+      lp_sampler_static_texture_state(&draw_sampler[i].texture_state, view);
+      draw_sampler[i].texture_state.tiled =
+         draw_texture_is_tiled(llvm->draw, view);
    }
 
    return key;
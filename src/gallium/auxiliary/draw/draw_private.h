@@ -71,6 +71,7 @@ struct tgsi_buffer;
 struct draw_pt_front_end;
 struct draw_assembler;
 struct draw_llvm;
+struct lp_cached_code;
 
 
 /**
@@ -326,6 +327,15 @@ struct draw_context
 
    struct draw_llvm *llvm;
 
+   /** Optional driver hooks for caching the JIT'ed variants on disk */
+   void *disk_cache_cookie;
+   void (*disk_cache_find_shader)(void *cookie,
+                                  struct lp_cached_code *cache,
+                                  const unsigned char ir_sha1_cache_key[20]);
+   void (*disk_cache_insert_shader)(void *cookie,
+                                    struct lp_cached_code *cache,
+                                    const unsigned char ir_sha1_cache_key[20]);
+
    /** Texture sampler and sampler view state.
     * Note that we have arrays indexed by shader type.  At this time
     * we only handle vertex and geometry shaders in the draw module, but
@@ -336,6 +346,9 @@ struct draw_context
    const struct pipe_sampler_state *samplers[PIPE_SHADER_TYPES][PIPE_MAX_SAMPLERS];
    unsigned num_samplers[PIPE_SHADER_TYPES];
 
+   /** pipe_resource::flags bit of textures stored in tiles, or 0 */
+   unsigned tiled_texture_flag;
+
    struct pipe_query_data_pipeline_statistics statistics;
    boolean collect_statistics;
 
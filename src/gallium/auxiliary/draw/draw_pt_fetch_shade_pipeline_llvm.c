@@ -28,6 +28,7 @@
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_prim.h"
+#include "util/u_queue.h"
 #include "draw/draw_context.h"
 #include "draw/draw_gs.h"
 #include "draw/draw_vbuf.h"
@@ -40,6 +41,30 @@
 #include "gallivm/lp_bld_debug.h"
 
 
+/**
+ * Don't bother splitting vertex shading across threads for fewer
+ * vertices per thread than this.
+ */
+#define LLVM_VS_MIN_VERTICES_PER_JOB 512
+
+
+struct llvm_middle_end;
+
+/**
+ * A slice of the vertices of one fetch, shaded by a worker thread.
+ */
+struct llvm_vs_job {
+   struct llvm_middle_end *fpme;
+   struct vertex_header *verts;
+   unsigned count;
+   unsigned start_or_maxelt;
+   unsigned vid_base;
+   const unsigned *elts;
+   boolean clipped;
+   struct util_queue_fence fence;
+};
+
+
 struct llvm_middle_end {
    struct draw_pt_middle_end base;
    struct draw_context *draw;
@@ -57,6 +82,17 @@ struct llvm_middle_end {
 
    struct draw_llvm *llvm;
    struct draw_llvm_variant *current_variant;
+
+   /**
+    * Worker threads for vertex shading (DRAW_VS_THREADS).  The JIT'd
+    * shader only reads the jit context and the vertex buffers, so the
+    * vertices of a fetch can be split into slices shaded concurrently.
+    * Everything after the vertex shader stays on the calling thread,
+    * which keeps the primitive order (and thus the rendering) unchanged.
+    */
+   struct util_queue vs_queue;
+   unsigned num_vs_threads;
+   struct llvm_vs_job *vs_jobs;
 };
 
 
@@ -347,6 +383,123 @@ emit(struct pt_emit *emit,
 }
 
 
+static boolean
+llvm_pipeline_shade_slice(struct llvm_middle_end *fpme,
+                          struct vertex_header *verts,
+                          unsigned count,
+                          unsigned start_or_maxelt,
+                          unsigned vid_base,
+                          const unsigned *elts)
+{
+   struct draw_context *draw = fpme->draw;
+
+   return fpme->current_variant->jit_func(&fpme->llvm->jit_context,
+                                          verts,
+                                          draw->pt.user.vbuffer,
+                                          count,
+                                          start_or_maxelt,
+                                          fpme->vertex_size,
+                                          draw->pt.vertex_buffer,
+                                          draw->instance_id,
+                                          vid_base,
+                                          draw->start_instance,
+                                          elts);
+}
+
+
+static void
+llvm_vs_job_execute(void *data, int thread_index)
+{
+   struct llvm_vs_job *job = (struct llvm_vs_job *)data;
+   unsigned fpstate = util_fpstate_get();
+
+   /* Treat denorms like zeros, as draw_vbo() does on the calling thread. */
+   util_fpstate_set_denorms_to_zero(fpstate);
+
+   job->clipped = llvm_pipeline_shade_slice(job->fpme, job->verts,
+                                            job->count, job->start_or_maxelt,
+                                            job->vid_base, job->elts);
+
+   util_fpstate_set(fpstate);
+}
+
+
+/**
+ * Run the vertex shader on all fetched vertices, splitting them across
+ * the worker threads if there are enough of them.
+ * \return whether any vertex needs clipping
+ */
+static boolean
+llvm_pipeline_shade(struct llvm_middle_end *fpme,
+                    const struct draw_fetch_info *fetch_info,
+                    struct vertex_header *verts)
+{
+   struct draw_context *draw = fpme->draw;
+   const unsigned vector_length = lp_native_vector_width / 32;
+   unsigned start_or_maxelt, vid_base;
+   unsigned num_jobs, slice_size, first, i;
+   const unsigned *elts;
+   boolean clipped;
+
+   if (fetch_info->linear) {
+      start_or_maxelt = fetch_info->start;
+      vid_base = draw->start_index;
+      elts = NULL;
+   }
+   else {
+      start_or_maxelt = draw->pt.user.eltMax;
+      vid_base = draw->pt.user.eltBias;
+      elts = fetch_info->elts;
+   }
+
+   num_jobs = MIN2(fpme->num_vs_threads + 1,
+                   fetch_info->count / LLVM_VS_MIN_VERTICES_PER_JOB);
+   if (num_jobs <= 1) {
+      return llvm_pipeline_shade_slice(fpme, verts, fetch_info->count,
+                                       start_or_maxelt, vid_base, elts);
+   }
+
+   /* The shader writes whole vectors of vertices, so slices must start
+    * at a multiple of the vector length to not overwrite each other.
+    */
+   slice_size = align(DIV_ROUND_UP(fetch_info->count, num_jobs),
+                      vector_length);
+
+   for (i = 0, first = 0; first < fetch_info->count; i++) {
+      struct llvm_vs_job *job = &fpme->vs_jobs[i];
+
+      job->fpme = fpme;
+      job->verts = (struct vertex_header *)
+         ((char *)verts + first * fpme->vertex_size);
+      job->count = MIN2(slice_size, fetch_info->count - first);
+      job->start_or_maxelt = elts ? start_or_maxelt : start_or_maxelt + first;
+      job->vid_base = vid_base;
+      job->elts = elts ? elts + first : NULL;
+      first += job->count;
+
+      /* The calling thread shades the last slice itself. */
+      if (first < fetch_info->count) {
+         util_queue_add_job(&fpme->vs_queue, job, &job->fence,
+                            llvm_vs_job_execute, NULL);
+      }
+      else {
+         llvm_vs_job_execute(job, 0);
+      }
+   }
+   num_jobs = i;
+
+   clipped = FALSE;
+   for (i = 0; i < num_jobs; i++) {
+      struct llvm_vs_job *job = &fpme->vs_jobs[i];
+
+      util_queue_fence_wait(&job->fence);
+      clipped |= job->clipped;
+   }
+
+   return clipped;
+}
+
+
 static void
 llvm_pipeline_generic(struct draw_pt_middle_end *middle,
                       const struct draw_fetch_info *fetch_info,
@@ -365,8 +518,6 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
    boolean free_prim_info = FALSE;
    unsigned opt = fpme->opt;
    boolean clipped = 0;
-   unsigned start_or_maxelt, vid_base;
-   const unsigned *elts;
 
    assert(fetch_info->count > 0);
    llvm_vert_info.count = fetch_info->count;
@@ -387,27 +538,7 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
       draw->statistics.vs_invocations += fetch_info->count;
    }
 
-   if (fetch_info->linear) {
-      start_or_maxelt = fetch_info->start;
-      vid_base = draw->start_index;
-      elts = NULL;
-   }
-   else {
-      start_or_maxelt = draw->pt.user.eltMax;
-      vid_base = draw->pt.user.eltBias;
-      elts = fetch_info->elts;
-   }
-   clipped = fpme->current_variant->jit_func(&fpme->llvm->jit_context,
-                                             llvm_vert_info.verts,
-                                             draw->pt.user.vbuffer,
-                                             fetch_info->count,
-                                             start_or_maxelt,
-                                             fpme->vertex_size,
-                                             draw->pt.vertex_buffer,
-                                             draw->instance_id,
-                                             vid_base,
-                                             draw->start_instance,
-                                             elts);
+   clipped = llvm_pipeline_shade(fpme, fetch_info, llvm_vert_info.verts);
 
    /* Finished with fetch and vs:
     */
@@ -619,6 +750,17 @@ llvm_middle_end_destroy(struct draw_pt_middle_end *middle)
    if (fpme->post_vs)
       draw_pt_post_vs_destroy( fpme->post_vs );
 
+   if (util_queue_is_initialized(&fpme->vs_queue))
+      util_queue_destroy(&fpme->vs_queue);
+
+   if (fpme->vs_jobs) {
+      unsigned i;
+
+      for (i = 0; i < fpme->num_vs_threads + 1; i++)
+         util_queue_fence_destroy(&fpme->vs_jobs[i].fence);
+      FREE(fpme->vs_jobs);
+   }
+
    FREE(middle);
 }
 
@@ -667,6 +809,28 @@ draw_pt_fetch_pipeline_or_emit_llvm(struct draw_context *draw)
 
    fpme->current_variant = NULL;
 
+   fpme->num_vs_threads = debug_get_num_option("DRAW_VS_THREADS", 0);
+   if (fpme->num_vs_threads) {
+      unsigned i;
+
+      fpme->vs_jobs = CALLOC(fpme->num_vs_threads + 1, sizeof *fpme->vs_jobs);
+      if (!fpme->vs_jobs)
+         goto fail;
+
+      for (i = 0; i < fpme->num_vs_threads + 1; i++)
+         util_queue_fence_init(&fpme->vs_jobs[i].fence);
+
+      if (!util_queue_init(&fpme->vs_queue, "draw_vs", fpme->num_vs_threads,
+                           fpme->num_vs_threads, 0)) {
+         /* just shade on the calling thread */
+         for (i = 0; i < fpme->num_vs_threads + 1; i++)
+            util_queue_fence_destroy(&fpme->vs_jobs[i].fence);
+         FREE(fpme->vs_jobs);
+         fpme->vs_jobs = NULL;
+         fpme->num_vs_threads = 0;
+      }
+   }
+
    return &fpme->base;
 
  fail:
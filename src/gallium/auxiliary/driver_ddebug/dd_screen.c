@@ -263,6 +263,21 @@ dd_screen_resource_from_user_memory(struct pipe_screen *_screen,
    return res;
 }
 
+static struct pipe_resource *
+dd_screen_texture_from_user_memory(struct pipe_screen *_screen,
+                                   const struct pipe_resource *templ,
+                                   void *user_memory, int stride)
+{
+   struct pipe_screen *screen = dd_screen(_screen)->screen;
+   struct pipe_resource *res =
+      screen->texture_from_user_memory(screen, templ, user_memory, stride);
+
+   if (!res)
+      return NULL;
+   res->screen = _screen;
+   return res;
+}
+
 static struct pipe_resource *
 dd_screen_resource_from_memobj(struct pipe_screen *_screen,
                                const struct pipe_resource *templ,
@@ -543,6 +558,7 @@ ddebug_screen_create(struct pipe_screen *screen)
    dscreen->base.resource_from_handle = dd_screen_resource_from_handle;
    SCR_INIT(resource_from_memobj);
    SCR_INIT(resource_from_user_memory);
+   SCR_INIT(texture_from_user_memory);
    SCR_INIT(check_resource_capability);
    dscreen->base.resource_get_handle = dd_screen_resource_get_handle;
    SCR_INIT(resource_changed);
@@ -54,6 +54,12 @@ struct lp_build_context;
 
 #define LP_BUILD_FORMAT_CACHE_SIZE 128
 
+/*
+ * Whether s3tc textures use the block cache too.  Their JIT decoder is
+ * usually fast enough without it.
+ */
+#define LP_BUILD_FORMAT_CACHE_S3TC 0
+
 /*
  * Note: cache_data needs 16 byte alignment.
  */
@@ -180,6 +186,24 @@ lp_build_fetch_s3tc_rgba_aos(struct gallivm_state *gallivm,
                              LLVMValueRef cache);
 
 
+/*
+ * Block compressed formats decoded through the block cache
+ */
+
+boolean
+lp_build_format_needs_cache(const struct util_format_description *format_desc);
+
+LLVMValueRef
+lp_build_fetch_cached_texels(struct gallivm_state *gallivm,
+                             const struct util_format_description *format_desc,
+                             unsigned n,
+                             LLVMValueRef base_ptr,
+                             LLVMValueRef offset,
+                             LLVMValueRef i,
+                             LLVMValueRef j,
+                             LLVMValueRef cache);
+
+
 /*
  * special float formats
  */
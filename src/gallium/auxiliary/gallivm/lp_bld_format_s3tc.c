@@ -39,6 +39,7 @@
 #include "util/u_string.h"
 #include "util/u_cpu_detect.h"
 #include "util/u_debug.h"
+#include "util/u_pointer.h"
 
 #include "lp_bld_arit.h"
 #include "lp_bld_type.h"
@@ -1869,6 +1870,78 @@ s3tc_decode_block_dxt5(struct gallivm_state *gallivm,
 }
 
 
+/*
+ * decode one block of a format without a JIT decoder, by calling its
+ * util_format unpack function, into the layout the s3tc decoders use.
+ */
+static void
+fallback_decode_block(struct gallivm_state *gallivm,
+                      const struct util_format_description *format_desc,
+                      LLVMValueRef ptr_addr,
+                      LLVMValueRef *col)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef pi8t = LLVMPointerType(LLVMInt8TypeInContext(gallivm->context), 0);
+   LLVMTypeRef i32t = LLVMInt32TypeInContext(gallivm->context);
+   struct lp_type type32 = lp_type_uint_vec(32, 128);
+   LLVMValueRef function, tmp_ptr, ptr, indices[2], args[6], rows[4];
+   unsigned count;
+
+   assert(format_desc->block.width == 4);
+   assert(format_desc->block.height == 4);
+   assert(format_desc->unpack_rgba_8unorm);
+
+   {
+      /*
+       * Function to call looks like:
+       *   unpack(uint8_t *dst, unsigned dst_stride,
+       *          const uint8_t *src, unsigned src_stride,
+       *          unsigned width, unsigned height)
+       */
+      LLVMTypeRef ret_type;
+      LLVMTypeRef arg_types[6];
+
+      ret_type = LLVMVoidTypeInContext(gallivm->context);
+      arg_types[0] = pi8t;
+      arg_types[1] = i32t;
+      arg_types[2] = pi8t;
+      arg_types[3] = i32t;
+      arg_types[4] = i32t;
+      arg_types[5] = i32t;
+
+      function = lp_build_const_func_pointer(gallivm,
+                                             func_to_pointer((func_pointer) format_desc->unpack_rgba_8unorm),
+                                             ret_type,
+                                             arg_types, ARRAY_SIZE(arg_types),
+                                             format_desc->short_name);
+   }
+
+   tmp_ptr = lp_build_alloca(gallivm,
+                             LLVMArrayType(lp_build_vec_type(gallivm, type32), 4),
+                             "block");
+
+   args[0] = LLVMBuildBitCast(builder, tmp_ptr, pi8t, "");
+   args[1] = lp_build_const_int32(gallivm, 16);
+   args[2] = ptr_addr;
+   args[3] = lp_build_const_int32(gallivm, 0);
+   args[4] = lp_build_const_int32(gallivm, 4);
+   args[5] = lp_build_const_int32(gallivm, 4);
+   LLVMBuildCall(builder, function, args, ARRAY_SIZE(args), "");
+
+   /*
+    * The unpacked block has one row per vector, whereas the cache wants one
+    * column per vector (see s3tc_decode_block_dxt1).
+    */
+   indices[0] = lp_build_const_int32(gallivm, 0);
+   for (count = 0; count < 4; count++) {
+      indices[1] = lp_build_const_int32(gallivm, count);
+      ptr = LLVMBuildGEP(builder, tmp_ptr, indices, ARRAY_SIZE(indices), "");
+      rows[count] = LLVMBuildLoad(builder, ptr, "");
+   }
+   lp_build_transpose_aos(gallivm, type32, rows, col);
+}
+
+
 static void
 generate_update_cache_one_block(struct gallivm_state *gallivm,
                                 LLVMValueRef function,
@@ -1899,28 +1972,33 @@ generate_update_cache_one_block(struct gallivm_state *gallivm,
    gallivm->builder = LLVMCreateBuilderInContext(gallivm->context);
    LLVMPositionBuilderAtEnd(gallivm->builder, block);
 
-   lp_build_gather_s3tc_simple_scalar(gallivm, format_desc, &dxt_block,
-                                      ptr_addr);
-
-   switch (format_desc->format) {
-   case PIPE_FORMAT_DXT1_RGB:
-   case PIPE_FORMAT_DXT1_RGBA:
-   case PIPE_FORMAT_DXT1_SRGB:
-   case PIPE_FORMAT_DXT1_SRGBA:
-      s3tc_decode_block_dxt1(gallivm, format_desc->format, dxt_block, col);
-      break;
-   case PIPE_FORMAT_DXT3_RGBA:
-   case PIPE_FORMAT_DXT3_SRGBA:
-      s3tc_decode_block_dxt3(gallivm, format_desc->format, dxt_block, col);
-      break;
-   case PIPE_FORMAT_DXT5_RGBA:
-   case PIPE_FORMAT_DXT5_SRGBA:
-      s3tc_decode_block_dxt5(gallivm, format_desc->format, dxt_block, col);
-      break;
-   default:
-      assert(0);
-      s3tc_decode_block_dxt1(gallivm, format_desc->format, dxt_block, col);
-      break;
+   if (format_desc->layout != UTIL_FORMAT_LAYOUT_S3TC) {
+      fallback_decode_block(gallivm, format_desc, ptr_addr, col);
+   }
+   else {
+      lp_build_gather_s3tc_simple_scalar(gallivm, format_desc, &dxt_block,
+                                         ptr_addr);
+
+      switch (format_desc->format) {
+      case PIPE_FORMAT_DXT1_RGB:
+      case PIPE_FORMAT_DXT1_RGBA:
+      case PIPE_FORMAT_DXT1_SRGB:
+      case PIPE_FORMAT_DXT1_SRGBA:
+         s3tc_decode_block_dxt1(gallivm, format_desc->format, dxt_block, col);
+         break;
+      case PIPE_FORMAT_DXT3_RGBA:
+      case PIPE_FORMAT_DXT3_SRGBA:
+         s3tc_decode_block_dxt3(gallivm, format_desc->format, dxt_block, col);
+         break;
+      case PIPE_FORMAT_DXT5_RGBA:
+      case PIPE_FORMAT_DXT5_SRGBA:
+         s3tc_decode_block_dxt5(gallivm, format_desc->format, dxt_block, col);
+         break;
+      default:
+         assert(0);
+         s3tc_decode_block_dxt1(gallivm, format_desc->format, dxt_block, col);
+         break;
+      }
    }
 
    tag_value = LLVMBuildPtrToInt(gallivm->builder, ptr_addr,
@@ -2124,6 +2202,69 @@ compressed_fetch_cached(struct gallivm_state *gallivm,
 }
 
 
+/**
+ * Whether texel fetches from the format should go through the block cache.
+ *
+ * This is the case for the block compressed formats without a JIT decoder
+ * which fit in 8 bits (BPTC unorm, ETC1): those are otherwise decoded once
+ * per texel in C, which means decoding the whole block mode and endpoints
+ * for every texel.  sRGB variants are looked at through their linear format,
+ * like lp_build_fetch_rgba_soa() fetches them.
+ */
+boolean
+lp_build_format_needs_cache(const struct util_format_description *format_desc)
+{
+   const struct util_format_description *linear_desc;
+
+   if (format_desc->layout == UTIL_FORMAT_LAYOUT_S3TC) {
+      return LP_BUILD_FORMAT_CACHE_S3TC;
+   }
+
+   if (format_desc->layout != UTIL_FORMAT_LAYOUT_BPTC &&
+       format_desc->layout != UTIL_FORMAT_LAYOUT_ETC) {
+      return FALSE;
+   }
+
+   linear_desc = util_format_description(util_format_linear(format_desc->format));
+
+   return linear_desc->block.width == 4 &&
+          linear_desc->block.height == 4 &&
+          linear_desc->unpack_rgba_8unorm &&
+          util_format_fits_8unorm(linear_desc);
+}
+
+
+/**
+ * Fetch texels of a block compressed format through the block cache,
+ * decoding each block once with the util_format unpack function on a miss.
+ *
+ * @param n  number of pixels processed (1 or a multiple of 4)
+ * @param offset <n x i32> vector with the relative offsets of the blocks
+ * @param i  is a <n x i32> vector with the x subpixel coordinate (0..3)
+ * @param j  is a <n x i32> vector with the y subpixel coordinate (0..3)
+ * @return  a <4*n x i8> vector with the pixel RGBA values in AoS
+ */
+LLVMValueRef
+lp_build_fetch_cached_texels(struct gallivm_state *gallivm,
+                             const struct util_format_description *format_desc,
+                             unsigned n,
+                             LLVMValueRef base_ptr,
+                             LLVMValueRef offset,
+                             LLVMValueRef i,
+                             LLVMValueRef j,
+                             LLVMValueRef cache)
+{
+   assert(format_desc->layout != UTIL_FORMAT_LAYOUT_S3TC);
+   assert(format_desc->colorspace != UTIL_FORMAT_COLORSPACE_SRGB);
+   assert(lp_build_format_needs_cache(format_desc));
+   assert(cache);
+   assert((n == 1) || (n % 4 == 0));
+
+   return compressed_fetch_cached(gallivm, format_desc, n,
+                                  base_ptr, offset, i, j, cache);
+}
+
+
 static LLVMValueRef
 s3tc_dxt5_to_rgba_aos(struct gallivm_state *gallivm,
                       unsigned n,
@@ -39,6 +39,23 @@
 extern "C" {
 #endif
 
+/**
+ * Machine code for a whole module, as produced by MCJIT.
+ *
+ * If data_size is non-zero when the module is compiled, the object is loaded
+ * from data instead of running the optimization passes and the code
+ * generator; otherwise data is filled in with the freshly generated object,
+ * which the caller may store and must free().  dont_cache is set when the
+ * module references host addresses and can't be reused by another process.
+ */
+struct lp_cached_code
+{
+   void *data;
+   size_t data_size;
+   boolean dont_cache;
+};
+
+
 struct gallivm_state
 {
    char *module_name;
@@ -50,6 +67,8 @@ struct gallivm_state
    LLVMBuilderRef builder;
    LLVMMCJITMemoryManagerRef memorymgr;
    struct lp_generated_code *code;
+   struct lp_cached_code *cache;
+   void *objcache;
    unsigned compiled;
 };
 
@@ -59,7 +78,8 @@ lp_build_init(void);
 
 
 struct gallivm_state *
-gallivm_create(const char *name, LLVMContextRef context);
+gallivm_create(const char *name, LLVMContextRef context,
+               struct lp_cached_code *cache);
 
 void
 gallivm_destroy(struct gallivm_state *gallivm);
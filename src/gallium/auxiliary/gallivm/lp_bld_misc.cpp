@@ -65,6 +65,7 @@
 #include <llvm/ExecutionEngine/JITMemoryManager.h>
 #else
 #include <llvm/ExecutionEngine/SectionMemoryManager.h>
+#include <llvm/ExecutionEngine/ObjectCache.h>
 #endif
 #include <llvm/Support/CommandLine.h>
 #include <llvm/Support/Host.h>
@@ -97,6 +98,7 @@
 
 #include "lp_bld_misc.h"
 #include "lp_bld_debug.h"
+#include "lp_bld_init.h"
 
 namespace {
 
@@ -473,6 +475,40 @@ class ShaderMemoryManager : public DelegatingJITMemoryManager {
 };
 
 
+#if HAVE_LLVM >= 0x0306
+/**
+ * Object cache which hands MCJIT a previously generated object, or captures
+ * the freshly generated one so that the caller can store it somewhere.
+ */
+class LPObjectCache : public llvm::ObjectCache {
+private:
+   struct lp_cached_code *cache_out;
+
+public:
+   LPObjectCache(struct lp_cached_code *cache) : cache_out(cache) {}
+
+   virtual void notifyObjectCompiled(const llvm::Module *M,
+                                     llvm::MemoryBufferRef Obj) {
+      if (cache_out->data_size)
+         return;
+      cache_out->data = malloc(Obj.getBufferSize());
+      if (cache_out->data) {
+         memcpy(cache_out->data, Obj.getBufferStart(), Obj.getBufferSize());
+         cache_out->data_size = Obj.getBufferSize();
+      }
+   }
+
+   virtual std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *M) {
+      if (!cache_out->data_size)
+         return NULL;
+      return llvm::MemoryBuffer::getMemBuffer(
+         llvm::StringRef((const char *)cache_out->data, cache_out->data_size),
+         "", false);
+   }
+};
+#endif
+
+
 /**
  * Same as LLVMCreateJITCompilerForModule, but:
  * - allows using MCJIT and enabling AVX feature where available.
@@ -487,6 +523,8 @@ extern "C"
 LLVMBool
 lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
                                         lp_generated_code **OutCode,
+                                        struct lp_cached_code *cache_out,
+                                        void **OutObjCache,
                                         LLVMModuleRef M,
                                         LLVMMCJITMemoryManagerRef CMM,
                                         unsigned OptLevel,
@@ -739,6 +777,13 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
    JIT->RegisterJITEventListener(JEL);
 #endif
    if (JIT) {
+#if HAVE_LLVM >= 0x0306
+      if (cache_out && useMCJIT) {
+         LPObjectCache *objcache = new LPObjectCache(cache_out);
+         JIT->setObjectCache(objcache);
+         *OutObjCache = objcache;
+      }
+#endif
       *OutJIT = wrap(JIT);
       return 0;
    }
@@ -757,6 +802,15 @@ lp_free_generated_code(struct lp_generated_code *code)
    ShaderMemoryManager::freeGeneratedCode(code);
 }
 
+extern "C"
+void
+lp_free_objcache(void *objcache)
+{
+#if HAVE_LLVM >= 0x0306
+   delete reinterpret_cast<LPObjectCache *>(objcache);
+#endif
+}
+
 extern "C"
 LLVMMCJITMemoryManagerRef
 lp_get_default_memory_manager()
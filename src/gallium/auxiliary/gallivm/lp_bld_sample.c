@@ -2023,6 +2023,65 @@ lp_build_sample_partial_offset(struct lp_build_context *bld,
 }
 
 
+/**
+ * Compute the partial offset of coord in a tiled image, see
+ * lp_tiled_texel_offset().
+ *
+ * \param texel_size  size of a texel in bytes
+ * \param axis  0 for x, 1 for y
+ * \param stride  row stride, only used for y
+ */
+void
+lp_build_sample_tiled_partial_offset(struct lp_build_context *bld,
+                                     unsigned texel_size,
+                                     unsigned axis,
+                                     LLVMValueRef coord,
+                                     LLVMValueRef stride,
+                                     LLVMValueRef *out_offset)
+{
+   struct gallivm_state *gallivm = bld->gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef texel, block, index, offset;
+
+   assert(axis < 2);
+
+   texel = LLVMBuildAnd(builder, coord,
+                        lp_build_const_int_vec(gallivm, bld->type, 0x3), "");
+   block = LLVMBuildAnd(builder, coord,
+                        lp_build_const_int_vec(gallivm, bld->type, 0x3c), "");
+
+   if (axis == 0) {
+      LLVMValueRef tile;
+
+      block = LLVMBuildShl(builder, block,
+                           lp_build_const_int_vec(gallivm, bld->type, 2), "");
+      tile = LLVMBuildLShr(builder, coord,
+                           lp_build_const_int_vec(gallivm, bld->type, 6), "");
+      tile = LLVMBuildShl(builder, tile,
+                          lp_build_const_int_vec(gallivm, bld->type, 12), "");
+      index = LLVMBuildOr(builder, texel, block, "");
+      index = LLVMBuildOr(builder, index, tile, "");
+      offset = lp_build_mul_imm(bld, index, texel_size);
+   }
+   else {
+      LLVMValueRef tile_row;
+
+      texel = LLVMBuildShl(builder, texel,
+                           lp_build_const_int_vec(gallivm, bld->type, 2), "");
+      block = LLVMBuildShl(builder, block,
+                           lp_build_const_int_vec(gallivm, bld->type, 6), "");
+      index = LLVMBuildOr(builder, texel, block, "");
+      offset = lp_build_mul_imm(bld, index, texel_size);
+
+      tile_row = LLVMBuildLShr(builder, coord,
+                               lp_build_const_int_vec(gallivm, bld->type, 6), "");
+      offset = lp_build_add(bld, offset, lp_build_mul(bld, tile_row, stride));
+   }
+
+   *out_offset = offset;
+}
+
+
 /**
  * Compute the offset of a pixel block.
  *
@@ -2033,6 +2092,7 @@ lp_build_sample_partial_offset(struct lp_build_context *bld,
 void
 lp_build_sample_offset(struct lp_build_context *bld,
                        const struct util_format_description *format_desc,
+                       boolean tiled,
                        LLVMValueRef x,
                        LLVMValueRef y,
                        LLVMValueRef z,
@@ -2045,6 +2105,28 @@ lp_build_sample_offset(struct lp_build_context *bld,
    LLVMValueRef x_stride;
    LLVMValueRef offset;
 
+   if (tiled) {
+      const unsigned texel_size = format_desc->block.bits/8;
+
+      assert(format_desc->block.width == 1 && format_desc->block.height == 1);
+
+      lp_build_sample_tiled_partial_offset(bld, texel_size, 0,
+                                           x, NULL, &offset);
+      *out_i = bld->zero;
+      *out_j = bld->zero;
+      if (y && y_stride) {
+         LLVMValueRef y_offset;
+         lp_build_sample_tiled_partial_offset(bld, texel_size, 1,
+                                              y, y_stride, &y_offset);
+         offset = lp_build_add(bld, offset, y_offset);
+      }
+      if (z && z_stride) {
+         offset = lp_build_add(bld, offset, lp_build_mul(bld, z, z_stride));
+      }
+      *out_offset = offset;
+      return;
+   }
+
    x_stride = lp_build_const_vec(bld->gallivm, bld->type,
                                  format_desc->block.bits/8);
 
@@ -122,6 +122,81 @@ struct lp_sampler_size_query_params
    LLVMValueRef explicit_lod;
    LLVMValueRef *sizes_out;
 };
+
+enum lp_img_op {
+   LP_IMG_LOAD,
+   LP_IMG_STORE,
+   LP_IMG_ATOMIC,
+   LP_IMG_ATOMIC_CAS
+};
+
+/**
+ * Image (shader load/store) access parameters.
+ *
+ * Coordinates are integer texel coordinates, the data vectors are in the
+ * shader's float type and hold the raw bits for integer formats.
+ */
+struct lp_img_params
+{
+   struct lp_type type;
+   unsigned image_index;
+   enum lp_img_op img_op;
+   unsigned target;                /**< PIPE_TEXTURE_x / PIPE_BUFFER */
+   LLVMAtomicRMWBinOp op;          /**< for LP_IMG_ATOMIC */
+   LLVMValueRef context_ptr;
+   LLVMValueRef exec_mask;
+   const LLVMValueRef *coords;
+   LLVMValueRef indata[4];
+   LLVMValueRef indata2[4];        /**< compare value for LP_IMG_ATOMIC_CAS */
+   LLVMValueRef *outdata;
+};
+
+
+/**
+ * Tiled texture layout.
+ *
+ * Instead of row after row, the texels of each 2D image are stored in 4x4
+ * blocks, and the blocks row by row in 64x64 texel tiles, so that a bilinear
+ * footprint stays within a cache line or two and nearby rows within a page.
+ * The tiles of a row of tiles follow each other, and the row stride of a
+ * tiled image is the stride between rows of tiles.
+ *
+ * Drivers set lp_static_texture_state::tiled for such textures.  Only plain
+ * formats (1x1 blocks) and images at least 2D may be tiled.
+ */
+
+#define LP_TILED_BLOCK_SIZE 4
+#define LP_TILED_TILE_SIZE 64
+
+
+/** Texel index of x within a row of tiles */
+static inline unsigned
+lp_tiled_x_index(unsigned x)
+{
+   return (x & 0x3) | (x & 0x3c) << 2 | (x >> 6) << 12;
+}
+
+
+/** Texel index of y within a tile */
+static inline unsigned
+lp_tiled_y_index(unsigned y)
+{
+   return (y & 0x3) << 2 | (y & 0x3c) << 6;
+}
+
+
+/**
+ * Byte offset of texel (x, y) in a tiled image.
+ */
+static inline unsigned
+lp_tiled_texel_offset(unsigned x, unsigned y,
+                      unsigned texel_size, unsigned row_stride)
+{
+   return (lp_tiled_x_index(x) + lp_tiled_y_index(y)) * texel_size +
+          (y / LP_TILED_TILE_SIZE) * row_stride;
+}
+
+
 /**
  * Texture static state.
  *
@@ -143,6 +218,7 @@ struct lp_static_texture_state
    unsigned pot_height:1;
    unsigned pot_depth:1;
    unsigned level_zero_only:1;
+   unsigned tiled:1;         /**< tiled layout? set by the driver */
 };
 
 
@@ -590,9 +666,19 @@ lp_build_sample_partial_offset(struct lp_build_context *bld,
                                LLVMValueRef *out_i);
 
 
+void
+lp_build_sample_tiled_partial_offset(struct lp_build_context *bld,
+                                     unsigned texel_size,
+                                     unsigned axis,
+                                     LLVMValueRef coord,
+                                     LLVMValueRef stride,
+                                     LLVMValueRef *out_offset);
+
+
 void
 lp_build_sample_offset(struct lp_build_context *bld,
                        const struct util_format_description *format_desc,
+                       boolean tiled,
                        LLVMValueRef x,
                        LLVMValueRef y,
                        LLVMValueRef z,
@@ -626,6 +712,12 @@ lp_build_size_query_soa(struct gallivm_state *gallivm,
                         struct lp_sampler_dynamic_state *dynamic_state,
                         const struct lp_sampler_size_query_params *params);
 
+void
+lp_build_img_op_soa(const struct lp_static_texture_state *static_texture_state,
+                    struct lp_sampler_dynamic_state *dynamic_state,
+                    struct gallivm_state *gallivm,
+                    const struct lp_img_params *params);
+
 void
 lp_build_sample_nop(struct gallivm_state *gallivm, 
                     struct lp_type type,
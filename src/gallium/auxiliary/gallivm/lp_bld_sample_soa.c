@@ -139,6 +139,7 @@ lp_build_sample_texel_soa(struct lp_build_sample_context *bld,
    /* convert x,y,z coords to linear offset from start of texture, in bytes */
    lp_build_sample_offset(&bld->int_coord_bld,
                           bld->format_desc,
+                          bld->static_texture_state->tiled,
                           x, y, z, y_stride, z_stride,
                           &offset, &i, &j);
    if (mipoffsets) {
@@ -2673,6 +2674,7 @@ lp_build_fetch_texel(struct lp_build_sample_context *bld,
 
    lp_build_sample_offset(int_coord_bld,
                           bld->format_desc,
+                          bld->static_texture_state->tiled,
                           x, y, z, row_stride_vec, img_stride_vec,
                           &offset, &i, &j);
 
@@ -3023,7 +3025,8 @@ lp_build_sample_soa_code(struct gallivm_state *gallivm,
                                                 context_ptr, texture_index);
    /* Note that mip_offsets is an array[level] of offsets to texture images */
 
-   if (dynamic_state->cache_ptr && thread_data_ptr) {
+   if (dynamic_state->cache_ptr && thread_data_ptr &&
+       lp_build_format_needs_cache(bld.format_desc)) {
       bld.cache = dynamic_state->cache_ptr(dynamic_state, gallivm,
                                            thread_data_ptr, texture_index);
    }
@@ -3433,7 +3436,7 @@ lp_build_sample_gen_func(struct gallivm_state *gallivm,
    if (dynamic_state->cache_ptr) {
       const struct util_format_description *format_desc;
       format_desc = util_format_description(static_texture_state->format);
-      if (format_desc && format_desc->layout == UTIL_FORMAT_LAYOUT_S3TC) {
+      if (format_desc && lp_build_format_needs_cache(format_desc)) {
          need_cache = TRUE;
       }
    }
@@ -3548,7 +3551,7 @@ lp_build_sample_soa_func(struct gallivm_state *gallivm,
    if (dynamic_state->cache_ptr) {
       const struct util_format_description *format_desc;
       format_desc = util_format_description(static_texture_state->format);
-      if (format_desc && format_desc->layout == UTIL_FORMAT_LAYOUT_S3TC) {
+      if (format_desc && lp_build_format_needs_cache(format_desc)) {
          need_cache = TRUE;
       }
    }
@@ -3942,3 +3945,439 @@ lp_build_size_query_soa(struct gallivm_state *gallivm,
                                         num_levels);
    }
 }
+
+
+/**
+ * Convert a shader value to the raw bits of one image format channel.
+ * The result is an int32 vector with the bits in the low end.
+ */
+static LLVMValueRef
+lp_build_img_pack_chan(struct gallivm_state *gallivm,
+                       struct lp_type type,
+                       const struct util_format_channel_description *chan_desc,
+                       LLVMValueRef val)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context flt_bld, int_bld, uint_bld;
+   const unsigned width = chan_desc->size;
+   LLVMValueRef res;
+
+   lp_build_context_init(&flt_bld, gallivm, type);
+   lp_build_context_init(&int_bld, gallivm, lp_int_type(type));
+   lp_build_context_init(&uint_bld, gallivm, lp_uint_type(type));
+
+   switch (chan_desc->type) {
+   case UTIL_FORMAT_TYPE_FLOAT:
+      if (width == 16) {
+         res = lp_build_float_to_half(gallivm, val);
+         res = LLVMBuildZExt(builder, res, int_bld.vec_type, "");
+      }
+      else {
+         assert(width == 32);
+         res = LLVMBuildBitCast(builder, val, int_bld.vec_type, "");
+      }
+      break;
+
+   case UTIL_FORMAT_TYPE_UNSIGNED:
+      if (chan_desc->normalized) {
+         val = lp_build_clamp_zero_one_nanzero(&flt_bld, val);
+         res = lp_build_clamped_float_to_unsigned_norm(gallivm, type,
+                                                       width, val);
+      }
+      else {
+         res = LLVMBuildBitCast(builder, val, uint_bld.vec_type, "");
+         if (width < 32) {
+            res = lp_build_min(&uint_bld, res,
+                               lp_build_const_int_vec(gallivm, uint_bld.type,
+                                                      (1u << width) - 1));
+         }
+      }
+      res = LLVMBuildBitCast(builder, res, int_bld.vec_type, "");
+      break;
+
+   case UTIL_FORMAT_TYPE_SIGNED:
+      if (chan_desc->normalized) {
+         double scale = (double)((1 << (width - 1)) - 1);
+         val = lp_build_clamp(&flt_bld, val,
+                              lp_build_const_vec(gallivm, type, -1.0),
+                              flt_bld.one);
+         val = lp_build_mul(&flt_bld, val,
+                            lp_build_const_vec(gallivm, type, scale));
+         res = lp_build_iround(&flt_bld, val);
+      }
+      else {
+         res = LLVMBuildBitCast(builder, val, int_bld.vec_type, "");
+         if (width < 32) {
+            res = lp_build_clamp(&int_bld, res,
+                                 lp_build_const_int_vec(gallivm, int_bld.type,
+                                                        -(1 << (width - 1))),
+                                 lp_build_const_int_vec(gallivm, int_bld.type,
+                                                        (1 << (width - 1)) - 1));
+         }
+      }
+      if (width < 32) {
+         res = LLVMBuildAnd(builder, res,
+                            lp_build_const_int_vec(gallivm, int_bld.type,
+                                                   (1u << width) - 1), "");
+      }
+      break;
+
+   default:
+      res = int_bld.zero;
+      break;
+   }
+
+   return res;
+}
+
+
+/**
+ * Whether every channel of the format starts on a byte boundary and is
+ * 8, 16 or 32 bits wide, so that image stores can write the channels
+ * one at a time.
+ */
+static boolean
+lp_img_format_is_byte_aligned(const struct util_format_description *format_desc)
+{
+   unsigned chan;
+
+   for (chan = 0; chan < format_desc->nr_channels; chan++) {
+      const struct util_format_channel_description *chan_desc =
+         &format_desc->channel[chan];
+
+      if (chan_desc->type == UTIL_FORMAT_TYPE_VOID)
+         continue;
+      if (chan_desc->shift % 8 ||
+          (chan_desc->size != 8 && chan_desc->size != 16 &&
+           chan_desc->size != 32))
+         return FALSE;
+   }
+   return TRUE;
+}
+
+
+/**
+ * Emit an image load, store or atomic (shader images).
+ *
+ * Out of bounds and inactive elements are not written, out of bounds loads
+ * and atomics return zero.  Stores and atomics are done one element at a
+ * time, as other threads may access the same image concurrently.
+ */
+void
+lp_build_img_op_soa(const struct lp_static_texture_state *static_texture_state,
+                    struct lp_sampler_dynamic_state *dynamic_state,
+                    struct gallivm_state *gallivm,
+                    const struct lp_img_params *params)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   const struct util_format_description *format_desc;
+   const unsigned target = params->target;
+   const unsigned length = params->type.length;
+   struct lp_build_context int_bld, uint_bld;
+   LLVMValueRef context_ptr = params->context_ptr;
+   unsigned unit = params->image_index;
+   LLVMValueRef base_ptr, offset, mask, size;
+   int layer_coord;
+   unsigned chan, i;
+
+   lp_build_context_init(&int_bld, gallivm, lp_int_type(params->type));
+   lp_build_context_init(&uint_bld, gallivm, lp_uint_type(params->type));
+
+   if (static_texture_state->format == PIPE_FORMAT_NONE) {
+      /* Nothing bound, loads return zero and stores are dropped. */
+      if (params->img_op != LP_IMG_STORE) {
+         for (chan = 0; chan < 4; chan++) {
+            params->outdata[chan] = lp_build_zero(gallivm, params->type);
+         }
+      }
+      return;
+   }
+
+   format_desc = util_format_description(static_texture_state->format);
+
+   switch (target) {
+   case PIPE_TEXTURE_1D_ARRAY:
+      layer_coord = 1;
+      break;
+   case PIPE_TEXTURE_2D_ARRAY:
+   case PIPE_TEXTURE_CUBE:
+   case PIPE_TEXTURE_CUBE_ARRAY:
+   case PIPE_TEXTURE_3D:
+      layer_coord = 2;
+      break;
+   default:
+      layer_coord = -1;
+      break;
+   }
+
+   /*
+    * Compute the byte offset of the texel, and which elements are in
+    * bounds.  Coordinates are compared as unsigned so negative ones fail.
+    */
+   size = dynamic_state->width(dynamic_state, gallivm, context_ptr, unit);
+   size = lp_build_broadcast_scalar(&uint_bld, size);
+   mask = lp_build_cmp(&uint_bld, PIPE_FUNC_LESS, params->coords[0], size);
+   if (static_texture_state->tiled) {
+      lp_build_sample_tiled_partial_offset(&uint_bld,
+                                           format_desc->block.bits / 8, 0,
+                                           params->coords[0], NULL, &offset);
+   }
+   else {
+      offset = lp_build_mul_imm(&uint_bld, params->coords[0],
+                                format_desc->block.bits / 8);
+   }
+
+   if (texture_dims(target) >= 2) {
+      LLVMValueRef stride, y_offset;
+
+      size = dynamic_state->height(dynamic_state, gallivm, context_ptr, unit);
+      size = lp_build_broadcast_scalar(&uint_bld, size);
+      mask = LLVMBuildAnd(builder, mask,
+                          lp_build_cmp(&uint_bld, PIPE_FUNC_LESS,
+                                       params->coords[1], size), "");
+      stride = dynamic_state->row_stride(dynamic_state, gallivm,
+                                         context_ptr, unit);
+      stride = lp_build_broadcast_scalar(&uint_bld, stride);
+      if (static_texture_state->tiled) {
+         lp_build_sample_tiled_partial_offset(&uint_bld,
+                                              format_desc->block.bits / 8, 1,
+                                              params->coords[1], stride,
+                                              &y_offset);
+      }
+      else {
+         y_offset = lp_build_mul(&uint_bld, params->coords[1], stride);
+      }
+      offset = lp_build_add(&uint_bld, offset, y_offset);
+   }
+
+   if (layer_coord >= 0) {
+      LLVMValueRef stride;
+
+      size = dynamic_state->depth(dynamic_state, gallivm, context_ptr, unit);
+      size = lp_build_broadcast_scalar(&uint_bld, size);
+      mask = LLVMBuildAnd(builder, mask,
+                          lp_build_cmp(&uint_bld, PIPE_FUNC_LESS,
+                                       params->coords[layer_coord], size), "");
+      stride = dynamic_state->img_stride(dynamic_state, gallivm,
+                                         context_ptr, unit);
+      stride = lp_build_broadcast_scalar(&uint_bld, stride);
+      offset = lp_build_add(&uint_bld, offset,
+                            lp_build_mul(&uint_bld,
+                                         params->coords[layer_coord], stride));
+   }
+
+   if (params->exec_mask) {
+      mask = LLVMBuildAnd(builder, mask, params->exec_mask, "");
+   }
+
+   /* Keep disabled elements on the first texel, which always exists. */
+   offset = lp_build_select(&uint_bld, mask, offset, uint_bld.zero);
+
+   base_ptr = dynamic_state->base_ptr(dynamic_state, gallivm,
+                                      context_ptr, unit);
+
+   if (params->img_op == LP_IMG_LOAD) {
+      struct lp_type texel_type = params->type;
+
+      if (format_desc->colorspace == UTIL_FORMAT_COLORSPACE_RGB &&
+          format_desc->channel[0].pure_integer) {
+         if (format_desc->channel[0].type == UTIL_FORMAT_TYPE_SIGNED)
+            texel_type = lp_int_type(params->type);
+         else
+            texel_type = lp_uint_type(params->type);
+      }
+
+      lp_build_fetch_rgba_soa(gallivm, format_desc, texel_type, TRUE,
+                              base_ptr, offset,
+                              uint_bld.zero, uint_bld.zero,
+                              NULL, params->outdata);
+
+      for (chan = 0; chan < 4; chan++) {
+         LLVMValueRef texel =
+            LLVMBuildBitCast(builder, params->outdata[chan],
+                             int_bld.vec_type, "");
+         texel = lp_build_select(&int_bld, mask, texel, int_bld.zero);
+         params->outdata[chan] =
+            LLVMBuildBitCast(builder, texel,
+                             lp_build_vec_type(gallivm, params->type), "");
+      }
+   }
+   else if (params->img_op == LP_IMG_STORE) {
+      LLVMValueRef packed[4] = { NULL };
+      boolean per_chan = lp_img_format_is_byte_aligned(format_desc);
+
+      if (per_chan) {
+         for (chan = 0; chan < format_desc->nr_channels; chan++) {
+            if (format_desc->channel[chan].type == UTIL_FORMAT_TYPE_VOID)
+               continue;
+            for (i = 0; i < 4; i++) {
+               if (format_desc->swizzle[i] == chan)
+                  break;
+            }
+            if (i == 4)
+               continue;
+            packed[chan] = lp_build_img_pack_chan(gallivm, params->type,
+                                                  &format_desc->channel[chan],
+                                                  params->indata[i]);
+         }
+      }
+      else if (format_desc->format == PIPE_FORMAT_R11G11B10_FLOAT) {
+         LLVMValueRef rgb[3];
+         for (i = 0; i < 3; i++)
+            rgb[i] = params->indata[i];
+         packed[0] = lp_build_float_to_r11g11b10(gallivm, rgb);
+      }
+      else if (format_desc->layout == UTIL_FORMAT_LAYOUT_PLAIN &&
+               format_desc->block.bits <= 32) {
+         packed[0] = int_bld.zero;
+         for (chan = 0; chan < format_desc->nr_channels; chan++) {
+            LLVMValueRef bits;
+
+            if (format_desc->channel[chan].type == UTIL_FORMAT_TYPE_VOID)
+               continue;
+            for (i = 0; i < 4; i++) {
+               if (format_desc->swizzle[i] == chan)
+                  break;
+            }
+            if (i == 4)
+               continue;
+            bits = lp_build_img_pack_chan(gallivm, params->type,
+                                          &format_desc->channel[chan],
+                                          params->indata[i]);
+            if (format_desc->channel[chan].shift) {
+               bits = LLVMBuildShl(builder, bits,
+                                   lp_build_const_int_vec(gallivm, int_bld.type,
+                                                          format_desc->channel[chan].shift), "");
+            }
+            packed[0] = LLVMBuildOr(builder, packed[0], bits, "");
+         }
+      }
+      else {
+         debug_printf("%s: unsupported image store format %s\n",
+                      __FUNCTION__, format_desc->short_name);
+         return;
+      }
+
+      for (i = 0; i < length; i++) {
+         LLVMValueRef idx = lp_build_const_int32(gallivm, i);
+         LLVMValueRef cond, texel_ptr;
+         struct lp_build_if_state ifs;
+
+         cond = LLVMBuildExtractElement(builder, mask, idx, "");
+         cond = LLVMBuildICmp(builder, LLVMIntNE, cond,
+                              lp_build_const_int32(gallivm, 0), "");
+         lp_build_if(&ifs, gallivm, cond);
+
+         texel_ptr = LLVMBuildExtractElement(builder, offset, idx, "");
+         texel_ptr = LLVMBuildGEP(builder, base_ptr, &texel_ptr, 1, "");
+
+         if (per_chan) {
+            for (chan = 0; chan < format_desc->nr_channels; chan++) {
+               unsigned bits = format_desc->channel[chan].size;
+               LLVMTypeRef chan_type = LLVMIntTypeInContext(gallivm->context,
+                                                            bits);
+               LLVMValueRef chan_ptr, val;
+
+               if (!packed[chan])
+                  continue;
+
+               chan_ptr = lp_build_const_int32(gallivm,
+                                               format_desc->channel[chan].shift / 8);
+               chan_ptr = LLVMBuildGEP(builder, texel_ptr, &chan_ptr, 1, "");
+               chan_ptr = LLVMBuildBitCast(builder, chan_ptr,
+                                           LLVMPointerType(chan_type, 0), "");
+               val = LLVMBuildExtractElement(builder, packed[chan], idx, "");
+               if (bits < 32)
+                  val = LLVMBuildTrunc(builder, val, chan_type, "");
+               LLVMBuildStore(builder, val, chan_ptr);
+            }
+         }
+         else {
+            unsigned bits = format_desc->block.bits;
+            LLVMTypeRef texel_type = LLVMIntTypeInContext(gallivm->context,
+                                                          bits);
+            LLVMValueRef val;
+
+            texel_ptr = LLVMBuildBitCast(builder, texel_ptr,
+                                         LLVMPointerType(texel_type, 0), "");
+            val = LLVMBuildExtractElement(builder, packed[0], idx, "");
+            if (bits < 32)
+               val = LLVMBuildTrunc(builder, val, texel_type, "");
+            LLVMBuildStore(builder, val, texel_ptr);
+         }
+
+         lp_build_endif(&ifs);
+      }
+   }
+   else {
+      LLVMTypeRef i32t = LLVMInt32TypeInContext(gallivm->context);
+      LLVMValueRef data, cmp_data = NULL, res_ptr;
+
+      if (format_desc->block.bits != 32) {
+         debug_printf("%s: unsupported image atomic format %s\n",
+                      __FUNCTION__, format_desc->short_name);
+         for (chan = 0; chan < 4; chan++) {
+            params->outdata[chan] = lp_build_zero(gallivm, params->type);
+         }
+         return;
+      }
+
+      data = LLVMBuildBitCast(builder, params->indata[0], int_bld.vec_type, "");
+      if (params->img_op == LP_IMG_ATOMIC_CAS) {
+         cmp_data = LLVMBuildBitCast(builder, params->indata2[0],
+                                     int_bld.vec_type, "");
+      }
+
+      res_ptr = lp_build_alloca(gallivm, int_bld.vec_type, "atomic_res");
+
+      for (i = 0; i < length; i++) {
+         LLVMValueRef idx = lp_build_const_int32(gallivm, i);
+         LLVMValueRef cond, texel_ptr, val, old, res;
+         struct lp_build_if_state ifs;
+
+         cond = LLVMBuildExtractElement(builder, mask, idx, "");
+         cond = LLVMBuildICmp(builder, LLVMIntNE, cond,
+                              lp_build_const_int32(gallivm, 0), "");
+         lp_build_if(&ifs, gallivm, cond);
+
+         texel_ptr = LLVMBuildExtractElement(builder, offset, idx, "");
+         texel_ptr = LLVMBuildGEP(builder, base_ptr, &texel_ptr, 1, "");
+         texel_ptr = LLVMBuildBitCast(builder, texel_ptr,
+                                      LLVMPointerType(i32t, 0), "");
+         val = LLVMBuildExtractElement(builder, data, idx, "");
+
+         if (params->img_op == LP_IMG_ATOMIC_CAS) {
+#if HAVE_LLVM >= 0x0306
+            LLVMValueRef cmp = LLVMBuildExtractElement(builder, cmp_data,
+                                                       idx, "");
+            old = LLVMBuildAtomicCmpXchg(builder, texel_ptr, cmp, val,
+                                         LLVMAtomicOrderingSequentiallyConsistent,
+                                         LLVMAtomicOrderingSequentiallyConsistent,
+                                         FALSE);
+            old = LLVMBuildExtractValue(builder, old, 0, "");
+#else
+            assert(0);
+            old = lp_build_const_int32(gallivm, 0);
+#endif
+         }
+         else {
+            old = LLVMBuildAtomicRMW(builder, params->op, texel_ptr, val,
+                                     LLVMAtomicOrderingSequentiallyConsistent,
+                                     FALSE);
+         }
+
+         res = LLVMBuildLoad(builder, res_ptr, "");
+         res = LLVMBuildInsertElement(builder, res, old, idx, "");
+         LLVMBuildStore(builder, res, res_ptr);
+
+         lp_build_endif(&ifs);
+      }
+
+      params->outdata[0] =
+         LLVMBuildBitCast(builder, LLVMBuildLoad(builder, res_ptr, ""),
+                          lp_build_vec_type(gallivm, params->type), "");
+      for (chan = 1; chan < 4; chan++) {
+         params->outdata[chan] = lp_build_zero(gallivm, params->type);
+      }
+   }
+}
@@ -1670,6 +1670,7 @@ emit_fetch_system_value(
    LLVMBuilderRef builder = gallivm->builder;
    LLVMValueRef res;
    enum tgsi_opcode_type atype; // Actual type of the value
+   unsigned swizzle = swizzle_in & 0xffff;
 
    assert(!reg->Register.Indirect);
 
@@ -1704,6 +1705,36 @@ emit_fetch_system_value(
       atype = TGSI_TYPE_UNSIGNED;
       break;
 
+   case TGSI_SEMANTIC_THREAD_ID:
+      res = swizzle < 3 ? bld->system_values.thread_id[swizzle] :
+                          bld_base->uint_bld.zero;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_BLOCK_ID:
+      res = swizzle < 3 ?
+         lp_build_broadcast_scalar(&bld_base->uint_bld,
+                                   bld->system_values.block_id[swizzle]) :
+         bld_base->uint_bld.zero;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_GRID_SIZE:
+      res = swizzle < 3 ?
+         lp_build_broadcast_scalar(&bld_base->uint_bld,
+                                   bld->system_values.grid_size[swizzle]) :
+         bld_base->uint_bld.one;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
+   case TGSI_SEMANTIC_BLOCK_SIZE:
+      res = swizzle < 3 ?
+         lp_build_broadcast_scalar(&bld_base->uint_bld,
+                                   bld->system_values.block_size[swizzle]) :
+         bld_base->uint_bld.one;
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
    default:
       assert(!"unexpected semantic in emit_fetch_system_value");
       res = bld_base->base.zero;
@@ -2962,6 +2993,18 @@ lp_emit_declaration_soa(
    }
       break;
 
+   case TGSI_FILE_BUFFER:
+      /* Fetch the pointers once, for the same reasons as constants above. */
+      assert(last < LP_MAX_TGSI_SHADER_BUFFERS);
+      for (idx = first; idx <= last; ++idx) {
+         LLVMValueRef index = lp_build_const_int32(gallivm, idx);
+         bld->ssbos[idx] =
+            lp_build_array_get(gallivm, bld->ssbo_ptr, index);
+         bld->ssbo_sizes[idx] =
+            lp_build_array_get(gallivm, bld->ssbo_sizes_ptr, index);
+      }
+      break;
+
    default:
       /* don't need to declare other vars */
       break;
@@ -3824,6 +3867,474 @@ static void emit_epilogue(struct lp_build_tgsi_context * bld_base)
    }
 }
 
+/*
+ * Shader storage buffers, shared memory and images.
+ *
+ * Buffers and shared memory are addressed in bytes but accessed as dwords.
+ * Stores and atomics are done one element at a time with real control flow,
+ * as other threads may be accessing the same memory concurrently (a masked
+ * read-modify-write like emit_mask_scatter does would lose their writes).
+ */
+
+/**
+ * Return a float pointer to the buffer or the shared memory, and its size
+ * in dwords.
+ */
+static LLVMValueRef
+get_mem_ptr(struct lp_build_tgsi_soa_context *bld,
+            unsigned file,
+            unsigned index,
+            LLVMValueRef *num_dwords)
+{
+   struct gallivm_state *gallivm = bld->bld_base.base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef fptr_type =
+      LLVMPointerType(LLVMFloatTypeInContext(gallivm->context), 0);
+   LLVMValueRef ptr;
+
+   if (file == TGSI_FILE_MEMORY) {
+      unsigned shared_size = bld->cs_iface ? bld->cs_iface->shared_size : 0;
+
+      ptr = bld->shared_ptr;
+      *num_dwords = lp_build_const_int_vec(gallivm, bld->bld_base.uint_bld.type,
+                                           shared_size / 4);
+   }
+   else {
+      LLVMValueRef size;
+
+      assert(file == TGSI_FILE_BUFFER);
+      assert(index < LP_MAX_TGSI_SHADER_BUFFERS);
+      ptr = bld->ssbos[index];
+      size = LLVMBuildLShr(builder, bld->ssbo_sizes[index],
+                           lp_build_const_int32(gallivm, 2), "");
+      *num_dwords = lp_build_broadcast_scalar(&bld->bld_base.uint_bld, size);
+   }
+
+   return LLVMBuildBitCast(builder, ptr, fptr_type, "");
+}
+
+
+/**
+ * Mask of the elements which may access dword 'indexes' of the memory.
+ */
+static LLVMValueRef
+get_mem_mask(struct lp_build_tgsi_soa_context *bld,
+             LLVMValueRef indexes,
+             LLVMValueRef num_dwords)
+{
+   struct lp_build_context *uint_bld = &bld->bld_base.uint_bld;
+   LLVMValueRef mask = mask_vec(&bld->bld_base);
+
+   return LLVMBuildAnd(bld->bld_base.base.gallivm->builder, mask,
+                       lp_build_cmp(uint_bld, PIPE_FUNC_LESS,
+                                    indexes, num_dwords), "");
+}
+
+
+/**
+ * Store the active elements of 'values' at base_ptr[indexes].
+ */
+static void
+emit_mem_scatter(struct lp_build_tgsi_soa_context *bld,
+                 LLVMValueRef base_ptr,
+                 LLVMValueRef indexes,
+                 LLVMValueRef values,
+                 LLVMValueRef mask)
+{
+   struct gallivm_state *gallivm = bld->bld_base.base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   unsigned i;
+
+   values = LLVMBuildBitCast(builder, values, bld->bld_base.base.vec_type, "");
+
+   for (i = 0; i < bld->bld_base.base.type.length; i++) {
+      LLVMValueRef ii = lp_build_const_int32(gallivm, i);
+      LLVMValueRef index, scalar_ptr, cond;
+      struct lp_build_if_state ifs;
+
+      cond = LLVMBuildExtractElement(builder, mask, ii, "");
+      cond = LLVMBuildICmp(builder, LLVMIntNE, cond,
+                           lp_build_const_int32(gallivm, 0), "");
+      lp_build_if(&ifs, gallivm, cond);
+      index = LLVMBuildExtractElement(builder, indexes, ii, "");
+      scalar_ptr = LLVMBuildGEP(builder, base_ptr, &index, 1, "scatter_ptr");
+      LLVMBuildStore(builder,
+                     LLVMBuildExtractElement(builder, values, ii, ""),
+                     scalar_ptr);
+      lp_build_endif(&ifs);
+   }
+}
+
+
+static LLVMAtomicRMWBinOp
+tgsi_to_atomic_op(unsigned opcode)
+{
+   switch (opcode) {
+   case TGSI_OPCODE_ATOMUADD:
+      return LLVMAtomicRMWBinOpAdd;
+   case TGSI_OPCODE_ATOMXCHG:
+      return LLVMAtomicRMWBinOpXchg;
+   case TGSI_OPCODE_ATOMAND:
+      return LLVMAtomicRMWBinOpAnd;
+   case TGSI_OPCODE_ATOMOR:
+      return LLVMAtomicRMWBinOpOr;
+   case TGSI_OPCODE_ATOMXOR:
+      return LLVMAtomicRMWBinOpXor;
+   case TGSI_OPCODE_ATOMUMIN:
+      return LLVMAtomicRMWBinOpUMin;
+   case TGSI_OPCODE_ATOMUMAX:
+      return LLVMAtomicRMWBinOpUMax;
+   case TGSI_OPCODE_ATOMIMIN:
+      return LLVMAtomicRMWBinOpMin;
+   case TGSI_OPCODE_ATOMIMAX:
+      return LLVMAtomicRMWBinOpMax;
+   default:
+      assert(0);
+      return LLVMAtomicRMWBinOpAdd;
+   }
+}
+
+
+/**
+ * Do the atomic 'opcode' on base_ptr[indexes] for the active elements,
+ * returning the previous values (zero for inactive elements).
+ */
+static LLVMValueRef
+emit_mem_atomic(struct lp_build_tgsi_soa_context *bld,
+                unsigned opcode,
+                LLVMValueRef base_ptr,
+                LLVMValueRef indexes,
+                LLVMValueRef data,
+                LLVMValueRef cmp_data,
+                LLVMValueRef mask)
+{
+   struct gallivm_state *gallivm = bld->bld_base.base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context *uint_bld = &bld->bld_base.uint_bld;
+   LLVMTypeRef i32t = LLVMInt32TypeInContext(gallivm->context);
+   LLVMValueRef res_ptr;
+   unsigned i;
+
+   base_ptr = LLVMBuildBitCast(builder, base_ptr, LLVMPointerType(i32t, 0), "");
+   data = LLVMBuildBitCast(builder, data, uint_bld->vec_type, "");
+   if (cmp_data)
+      cmp_data = LLVMBuildBitCast(builder, cmp_data, uint_bld->vec_type, "");
+
+   res_ptr = lp_build_alloca(gallivm, uint_bld->vec_type, "atomic_res");
+
+   for (i = 0; i < uint_bld->type.length; i++) {
+      LLVMValueRef ii = lp_build_const_int32(gallivm, i);
+      LLVMValueRef index, scalar_ptr, cond, val, old, res;
+      struct lp_build_if_state ifs;
+
+      cond = LLVMBuildExtractElement(builder, mask, ii, "");
+      cond = LLVMBuildICmp(builder, LLVMIntNE, cond,
+                           lp_build_const_int32(gallivm, 0), "");
+      lp_build_if(&ifs, gallivm, cond);
+
+      index = LLVMBuildExtractElement(builder, indexes, ii, "");
+      scalar_ptr = LLVMBuildGEP(builder, base_ptr, &index, 1, "atomic_ptr");
+      val = LLVMBuildExtractElement(builder, data, ii, "");
+
+      if (opcode == TGSI_OPCODE_ATOMCAS) {
+#if HAVE_LLVM >= 0x0306
+         LLVMValueRef cmp = LLVMBuildExtractElement(builder, cmp_data, ii, "");
+         old = LLVMBuildAtomicCmpXchg(builder, scalar_ptr, cmp, val,
+                                      LLVMAtomicOrderingSequentiallyConsistent,
+                                      LLVMAtomicOrderingSequentiallyConsistent,
+                                      FALSE);
+         old = LLVMBuildExtractValue(builder, old, 0, "");
+#else
+         assert(0);
+         old = lp_build_const_int32(gallivm, 0);
+#endif
+      }
+      else {
+         old = LLVMBuildAtomicRMW(builder, tgsi_to_atomic_op(opcode),
+                                  scalar_ptr, val,
+                                  LLVMAtomicOrderingSequentiallyConsistent,
+                                  FALSE);
+      }
+
+      res = LLVMBuildLoad(builder, res_ptr, "");
+      res = LLVMBuildInsertElement(builder, res, old, ii, "");
+      LLVMBuildStore(builder, res, res_ptr);
+
+      lp_build_endif(&ifs);
+   }
+
+   return LLVMBuildBitCast(builder, LLVMBuildLoad(builder, res_ptr, ""),
+                           bld->bld_base.base.vec_type, "");
+}
+
+
+/**
+ * Emit an image LOAD, STORE or atomic through the image generator.
+ */
+static void
+emit_image_op(struct lp_build_tgsi_soa_context *bld,
+              const struct tgsi_full_instruction *inst,
+              enum lp_img_op img_op,
+              unsigned image_index,
+              unsigned coord_src,
+              LLVMValueRef *outdata)
+{
+   struct lp_build_tgsi_context *bld_base = &bld->bld_base;
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_img_params params;
+   LLVMValueRef coords[3];
+   unsigned chan;
+
+   if (!bld->image) {
+      _debug_printf("warning: found image instruction but no image generator supplied\n");
+      if (outdata) {
+         for (chan = 0; chan < 4; chan++)
+            outdata[chan] = bld_base->base.undef;
+      }
+      return;
+   }
+
+   for (chan = 0; chan < 3; chan++) {
+      coords[chan] = lp_build_emit_fetch(bld_base, inst, coord_src, chan);
+      coords[chan] = LLVMBuildBitCast(builder, coords[chan],
+                                      bld_base->uint_bld.vec_type, "");
+   }
+
+   memset(&params, 0, sizeof params);
+   params.type = bld_base->base.type;
+   params.image_index = image_index;
+   params.img_op = img_op;
+   params.target = tgsi_to_pipe_tex_target(inst->Memory.Texture);
+   params.context_ptr = bld->context_ptr;
+   params.exec_mask = mask_vec(bld_base);
+   params.coords = coords;
+   params.outdata = outdata;
+
+   if (img_op == LP_IMG_STORE) {
+      for (chan = 0; chan < 4; chan++)
+         params.indata[chan] = lp_build_emit_fetch(bld_base, inst, 1, chan);
+   }
+   else if (img_op == LP_IMG_ATOMIC_CAS) {
+      params.indata2[0] = lp_build_emit_fetch(bld_base, inst, 2, 0);
+      params.indata[0] = lp_build_emit_fetch(bld_base, inst, 3, 0);
+   }
+   else if (img_op == LP_IMG_ATOMIC) {
+      params.op = tgsi_to_atomic_op(inst->Instruction.Opcode);
+      params.indata[0] = lp_build_emit_fetch(bld_base, inst, 2, 0);
+   }
+
+   bld->image->emit_op(bld->image, gallivm, &params);
+}
+
+
+static void
+load_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   const struct tgsi_full_src_register *res = &inst->Src[0];
+   struct lp_build_context *uint_bld = &bld_base->uint_bld;
+   LLVMBuilderRef builder = bld_base->base.gallivm->builder;
+   LLVMValueRef base_ptr, index, num_dwords, mask;
+   unsigned chan;
+
+   if (res->Register.File == TGSI_FILE_IMAGE) {
+      LLVMValueRef texel[4];
+
+      emit_image_op(bld, inst, LP_IMG_LOAD, res->Register.Index, 1, texel);
+      TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+         emit_data->output[chan] = texel[chan];
+      }
+      return;
+   }
+
+   index = lp_build_emit_fetch(bld_base, inst, 1, 0);
+   index = LLVMBuildBitCast(builder, index, uint_bld->vec_type, "");
+   index = lp_build_shr_imm(uint_bld, index, 2);
+
+   base_ptr = get_mem_ptr(bld, res->Register.File, res->Register.Index,
+                          &num_dwords);
+
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      LLVMValueRef chan_index = lp_build_add(uint_bld, index,
+                                 lp_build_const_int_vec(bld_base->base.gallivm,
+                                                        uint_bld->type, chan));
+
+      mask = get_mem_mask(bld, chan_index, num_dwords);
+      emit_data->output[chan] =
+         build_gather(bld_base, base_ptr, chan_index,
+                      lp_build_not(uint_bld, mask), NULL);
+   }
+}
+
+
+static void
+store_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   const struct tgsi_full_dst_register *res = &inst->Dst[0];
+   struct lp_build_context *uint_bld = &bld_base->uint_bld;
+   LLVMBuilderRef builder = bld_base->base.gallivm->builder;
+   LLVMValueRef base_ptr, index, num_dwords;
+   unsigned chan;
+
+   if (res->Register.File == TGSI_FILE_IMAGE) {
+      emit_image_op(bld, inst, LP_IMG_STORE, res->Register.Index, 0, NULL);
+      return;
+   }
+
+   index = lp_build_emit_fetch(bld_base, inst, 0, 0);
+   index = LLVMBuildBitCast(builder, index, uint_bld->vec_type, "");
+   index = lp_build_shr_imm(uint_bld, index, 2);
+
+   base_ptr = get_mem_ptr(bld, res->Register.File, res->Register.Index,
+                          &num_dwords);
+
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      LLVMValueRef chan_index = lp_build_add(uint_bld, index,
+                                 lp_build_const_int_vec(bld_base->base.gallivm,
+                                                        uint_bld->type, chan));
+      LLVMValueRef value = lp_build_emit_fetch(bld_base, inst, 1, chan);
+
+      emit_mem_scatter(bld, base_ptr, chan_index, value,
+                       get_mem_mask(bld, chan_index, num_dwords));
+   }
+}
+
+
+static void
+atomic_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   const struct tgsi_full_src_register *res = &inst->Src[0];
+   const unsigned opcode = inst->Instruction.Opcode;
+   struct lp_build_context *uint_bld = &bld_base->uint_bld;
+   LLVMBuilderRef builder = bld_base->base.gallivm->builder;
+   LLVMValueRef base_ptr, index, num_dwords, data, cmp_data = NULL, old;
+   unsigned chan;
+
+   if (res->Register.File == TGSI_FILE_IMAGE) {
+      LLVMValueRef texel[4];
+
+      emit_image_op(bld, inst,
+                    opcode == TGSI_OPCODE_ATOMCAS ? LP_IMG_ATOMIC_CAS :
+                                                    LP_IMG_ATOMIC,
+                    res->Register.Index, 1, texel);
+      TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+         emit_data->output[chan] = texel[chan];
+      }
+      return;
+   }
+
+   index = lp_build_emit_fetch(bld_base, inst, 1, 0);
+   index = LLVMBuildBitCast(builder, index, uint_bld->vec_type, "");
+   index = lp_build_shr_imm(uint_bld, index, 2);
+
+   if (opcode == TGSI_OPCODE_ATOMCAS) {
+      cmp_data = lp_build_emit_fetch(bld_base, inst, 2, 0);
+      data = lp_build_emit_fetch(bld_base, inst, 3, 0);
+   }
+   else {
+      data = lp_build_emit_fetch(bld_base, inst, 2, 0);
+   }
+
+   base_ptr = get_mem_ptr(bld, res->Register.File, res->Register.Index,
+                          &num_dwords);
+
+   old = emit_mem_atomic(bld, opcode, base_ptr, index, data, cmp_data,
+                         get_mem_mask(bld, index, num_dwords));
+
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      emit_data->output[chan] = old;
+   }
+}
+
+
+static void
+resq_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   const struct tgsi_full_src_register *res = &inst->Src[0];
+   LLVMBuilderRef builder = bld_base->base.gallivm->builder;
+   LLVMValueRef sizes[4];
+   unsigned chan;
+
+   if (res->Register.File == TGSI_FILE_BUFFER) {
+      assert(res->Register.Index < LP_MAX_TGSI_SHADER_BUFFERS);
+      sizes[0] = lp_build_broadcast_scalar(&bld_base->uint_bld,
+                                           bld->ssbo_sizes[res->Register.Index]);
+      for (chan = 1; chan < 4; chan++)
+         sizes[chan] = bld_base->uint_bld.zero;
+   }
+   else if (res->Register.File == TGSI_FILE_IMAGE && bld->image) {
+      struct lp_sampler_size_query_params params;
+
+      memset(&params, 0, sizeof params);
+      params.int_type = bld_base->int_bld.type;
+      params.texture_unit = res->Register.Index;
+      params.target = tgsi_to_pipe_tex_target(inst->Memory.Texture);
+      params.context_ptr = bld->context_ptr;
+      params.is_sviewinfo = FALSE;
+      params.lod_property = LP_SAMPLER_LOD_SCALAR;
+      params.explicit_lod = NULL;
+      params.sizes_out = sizes;
+      for (chan = 0; chan < 4; chan++)
+         sizes[chan] = bld_base->int_bld.zero;
+
+      bld->image->emit_size_query(bld->image, bld_base->base.gallivm, &params);
+   }
+   else {
+      for (chan = 0; chan < 4; chan++)
+         sizes[chan] = bld_base->uint_bld.zero;
+   }
+
+   TGSI_FOR_EACH_DST0_ENABLED_CHANNEL(inst, chan) {
+      emit_data->output[chan] =
+         LLVMBuildBitCast(builder, sizes[chan], bld_base->base.vec_type, "");
+   }
+}
+
+
+static void
+barrier_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+
+   if (bld->cs_iface && bld->cs_iface->emit_barrier) {
+      bld->cs_iface->emit_barrier(bld->cs_iface, bld_base);
+   }
+}
+
+
+static void
+membar_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   LLVMBuildFence(bld_base->base.gallivm->builder,
+                  LLVMAtomicOrderingSequentiallyConsistent, FALSE, "");
+}
+
 void
 lp_build_tgsi_soa(struct gallivm_state *gallivm,
                   const struct tgsi_token *tokens,
@@ -3837,8 +4348,13 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                   LLVMValueRef context_ptr,
                   LLVMValueRef thread_data_ptr,
                   const struct lp_build_sampler_soa *sampler,
+                  const struct lp_build_image_soa *image,
+                  LLVMValueRef ssbo_ptr,
+                  LLVMValueRef ssbo_sizes_ptr,
+                  LLVMValueRef shared_ptr,
                   const struct tgsi_shader_info *info,
-                  const struct lp_build_tgsi_gs_iface *gs_iface)
+                  const struct lp_build_tgsi_gs_iface *gs_iface,
+                  const struct lp_build_tgsi_cs_iface *cs_iface)
 {
    struct lp_build_tgsi_soa_context bld;
 
@@ -3880,6 +4396,11 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
    bld.consts_ptr = consts_ptr;
    bld.const_sizes_ptr = const_sizes_ptr;
    bld.sampler = sampler;
+   bld.image = image;
+   bld.ssbo_ptr = ssbo_ptr;
+   bld.ssbo_sizes_ptr = ssbo_sizes_ptr;
+   bld.shared_ptr = shared_ptr;
+   bld.cs_iface = cs_iface;
    bld.bld_base.info = info;
    bld.indirect_files = info->indirect_files;
    bld.context_ptr = context_ptr;
@@ -3967,6 +4488,22 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
    bld.bld_base.op_actions[TGSI_OPCODE_GATHER4].emit = gather4_emit;
    bld.bld_base.op_actions[TGSI_OPCODE_SVIEWINFO].emit = sviewinfo_emit;
    bld.bld_base.op_actions[TGSI_OPCODE_LOD].emit = lod_emit;
+   /* shader storage buffers, shared memory and images */
+   bld.bld_base.op_actions[TGSI_OPCODE_LOAD].emit = load_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_STORE].emit = store_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_RESQ].emit = resq_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_ATOMUADD].emit = atomic_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_ATOMXCHG].emit = atomic_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_ATOMCAS].emit = atomic_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_ATOMAND].emit = atomic_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_ATOMOR].emit = atomic_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_ATOMXOR].emit = atomic_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_ATOMUMIN].emit = atomic_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_ATOMUMAX].emit = atomic_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_ATOMIMIN].emit = atomic_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_ATOMIMAX].emit = atomic_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_MEMBAR].emit = membar_emit;
+   bld.bld_base.op_actions[TGSI_OPCODE_BARRIER].emit = barrier_emit;
 
 
    if (gs_iface) {
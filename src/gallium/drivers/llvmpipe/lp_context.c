@@ -38,14 +38,19 @@
 #include "util/u_memory.h"
 #include "util/simple_list.h"
 #include "util/u_upload_mgr.h"
+#include "util/u_threaded_context.h"
 #include "lp_clear.h"
 #include "lp_context.h"
+#include "lp_debug.h"
+#include "lp_fence.h"
 #include "lp_flush.h"
 #include "lp_perf.h"
 #include "lp_state.h"
 #include "lp_surface.h"
 #include "lp_query.h"
 #include "lp_setup.h"
+#include "lp_screen.h"
+#include "lp_texture.h"
 
 /* This is only safe if there's just one concurrent context */
 #ifdef PIPE_SUBSYSTEM_EMBEDDED
@@ -57,7 +62,11 @@ static void llvmpipe_destroy( struct pipe_context *pipe )
    struct llvmpipe_context *llvmpipe = llvmpipe_context( pipe );
    uint i, j;
 
-   lp_print_counters();
+   if (LP_DEBUG & DEBUG_COUNTERS) {
+      struct lp_counters counters;
+      llvmpipe_get_counters(llvmpipe, &counters);
+      lp_print_counters(&counters);
+   }
 
    if (llvmpipe->blitter) {
       util_blitter_destroy(llvmpipe->blitter);
@@ -89,6 +98,19 @@ static void llvmpipe_destroy( struct pipe_context *pipe )
       pipe_sampler_view_reference(&llvmpipe->sampler_views[PIPE_SHADER_GEOMETRY][i], NULL);
    }
 
+   for (i = 0; i < ARRAY_SIZE(llvmpipe->sampler_views[0]); i++) {
+      pipe_sampler_view_reference(&llvmpipe->sampler_views[PIPE_SHADER_COMPUTE][i], NULL);
+   }
+
+   for (i = 0; i < ARRAY_SIZE(llvmpipe->ssbos); i++) {
+      for (j = 0; j < ARRAY_SIZE(llvmpipe->ssbos[i]); j++) {
+         pipe_resource_reference(&llvmpipe->ssbos[i][j].buffer, NULL);
+      }
+      for (j = 0; j < ARRAY_SIZE(llvmpipe->images[i]); j++) {
+         pipe_resource_reference(&llvmpipe->images[i][j].resource, NULL);
+      }
+   }
+
    for (i = 0; i < ARRAY_SIZE(llvmpipe->constants); i++) {
       for (j = 0; j < ARRAY_SIZE(llvmpipe->constants[i]); j++) {
          pipe_resource_reference(&llvmpipe->constants[i][j].buffer, NULL);
@@ -101,6 +123,8 @@ static void llvmpipe_destroy( struct pipe_context *pipe )
 
    lp_delete_setup_variants(llvmpipe);
 
+   llvmpipe_cleanup_cs(llvmpipe);
+
 #ifndef USE_GLOBAL_LLVM_CONTEXT
    LLVMContextDispose(llvmpipe->context);
 #endif
@@ -114,10 +138,28 @@ do_flush( struct pipe_context *pipe,
           struct pipe_fence_handle **fence,
           unsigned flags)
 {
+   if (fence && (flags & TC_FLUSH_ASYNC)) {
+      /* The threaded context already returned the fence, fill it in */
+      struct lp_fence *f = (struct lp_fence *) *fence;
+
+      llvmpipe_flush(pipe, (struct pipe_fence_handle **) &f->flushed,
+                     __FUNCTION__);
+      util_queue_fence_signal(&f->ready);
+      return;
+   }
+
    llvmpipe_flush(pipe, fence, __FUNCTION__);
 }
 
 
+static struct pipe_fence_handle *
+llvmpipe_create_fence(struct pipe_context *pipe,
+                      struct tc_unflushed_batch_token *token)
+{
+   return (struct pipe_fence_handle *) lp_fence_create_unflushed(token);
+}
+
+
 static void
 llvmpipe_render_condition(struct pipe_context *pipe,
                           struct pipe_query *query,
@@ -131,6 +173,26 @@ llvmpipe_render_condition(struct pipe_context *pipe,
    llvmpipe->render_cond_cond = condition;
 }
 
+static void
+lp_draw_disk_cache_find_shader(void *cookie,
+                               struct lp_cached_code *cache,
+                               const unsigned char ir_sha1_cache_key[20])
+{
+   struct llvmpipe_screen *screen = cookie;
+   lp_disk_cache_find_shader(screen, cache, ir_sha1_cache_key);
+}
+
+
+static void
+lp_draw_disk_cache_insert_shader(void *cookie,
+                                 struct lp_cached_code *cache,
+                                 const unsigned char ir_sha1_cache_key[20])
+{
+   struct llvmpipe_screen *screen = cookie;
+   lp_disk_cache_insert_shader(screen, cache, ir_sha1_cache_key);
+}
+
+
 struct pipe_context *
 llvmpipe_create_context(struct pipe_screen *screen, void *priv,
                         unsigned flags)
@@ -147,6 +209,8 @@ llvmpipe_create_context(struct pipe_screen *screen, void *priv,
 
    make_empty_list(&llvmpipe->fs_variants_list);
 
+   make_empty_list(&llvmpipe->cs_variants_list);
+
    make_empty_list(&llvmpipe->setup_variants_list);
 
 
@@ -161,6 +225,8 @@ llvmpipe_create_context(struct pipe_screen *screen, void *priv,
 
    llvmpipe->pipe.render_condition = llvmpipe_render_condition;
 
+   llvmpipe->max_compile_threads = ~0u;
+
    llvmpipe_init_blend_funcs(llvmpipe);
    llvmpipe_init_clip_funcs(llvmpipe);
    llvmpipe_init_draw_funcs(llvmpipe);
@@ -171,6 +237,7 @@ llvmpipe_create_context(struct pipe_screen *screen, void *priv,
    llvmpipe_init_fs_funcs(llvmpipe);
    llvmpipe_init_vs_funcs(llvmpipe);
    llvmpipe_init_gs_funcs(llvmpipe);
+   llvmpipe_init_cs_funcs(llvmpipe);
    llvmpipe_init_rasterizer_funcs(llvmpipe);
    llvmpipe_init_context_resource_funcs( &llvmpipe->pipe );
    llvmpipe_init_surface_functions(llvmpipe);
@@ -192,6 +259,13 @@ llvmpipe_create_context(struct pipe_screen *screen, void *priv,
    if (!llvmpipe->draw)
       goto fail;
 
+   if (llvmpipe_screen(screen)->disk_shader_cache) {
+      draw_set_disk_cache_callbacks(llvmpipe->draw,
+                                    llvmpipe_screen(screen),
+                                    lp_draw_disk_cache_find_shader,
+                                    lp_draw_disk_cache_insert_shader);
+   }
+
    /* FIXME: devise alternative to draw_texture_samplers */
 
    llvmpipe->setup = lp_setup_create( &llvmpipe->pipe,
@@ -225,7 +299,8 @@ llvmpipe_create_context(struct pipe_screen *screen, void *priv,
    draw_wide_point_threshold(llvmpipe->draw, 10000.0);
    draw_wide_line_threshold(llvmpipe->draw, 10000.0);
 
-   lp_reset_counters();
+   /* vertex/geometry shaders sample our tiled textures too */
+   draw_set_tiled_texture_flag(llvmpipe->draw, LP_RESOURCE_FLAG_TILED);
 
    /* If llvmpipe_set_scissor_states() is never called, we still need to
     * make sure that derived scissor state is computed.
@@ -233,6 +308,16 @@ llvmpipe_create_context(struct pipe_screen *screen, void *priv,
     */
    llvmpipe->dirty |= LP_NEW_SCISSOR;
 
+   if ((flags & PIPE_CONTEXT_PREFER_THREADED) &&
+       !(flags & PIPE_CONTEXT_COMPUTE_ONLY) &&
+       llvmpipe_screen(screen)->use_tc) {
+      return threaded_context_create(&llvmpipe->pipe,
+                                     &llvmpipe_screen(screen)->pool_transfers,
+                                     llvmpipe_replace_buffer_storage,
+                                     llvmpipe_create_fence,
+                                     NULL);
+   }
+
    return &llvmpipe->pipe;
 
  fail:
@@ -0,0 +1,379 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * Fiber pool and round-robin scheduler for compute shader barriers.
+ *
+ * Pools are per rasterizer thread, so none of this is thread safe.  Fiber
+ * stacks are allocated on first use and kept for the following dispatches,
+ * unless these need larger ones.  Stacks have a guard page below them, so
+ * that an overflow faults instead of overwriting other memory.
+ */
+
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "lp_cs_fiber.h"
+
+#if LP_CS_HAVE_FIBERS
+
+#if defined(PIPE_OS_WINDOWS)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
+
+struct lp_cs_fiber
+{
+   struct lp_cs_fiber_pool *pool;
+   unsigned index;
+   boolean done;
+   size_t stack_size;
+#if defined(PIPE_OS_WINDOWS)
+   LPVOID handle;
+#else
+   ucontext_t context;
+   void *stack;         /**< mapping, starting with the guard page */
+   size_t guard_size;
+#endif
+};
+
+
+struct lp_cs_fiber_pool
+{
+   struct lp_cs_fiber *fibers;
+   unsigned num_fibers;
+
+   /* The job being run by lp_cs_fiber_run() */
+   lp_cs_fiber_func func;
+   void *data;
+
+#if defined(PIPE_OS_WINDOWS)
+   LPVOID scheduler;
+#else
+   ucontext_t scheduler;
+#endif
+};
+
+
+static void
+fiber_body(struct lp_cs_fiber *fiber)
+{
+   struct lp_cs_fiber_pool *pool = fiber->pool;
+
+   pool->func(pool->data, fiber->index, fiber);
+   fiber->done = TRUE;
+}
+
+
+#if defined(PIPE_OS_WINDOWS)
+
+static VOID CALLBACK
+fiber_entry(LPVOID param)
+{
+   struct lp_cs_fiber *fiber = (struct lp_cs_fiber *)param;
+
+   /* Windows fibers must never return, they get reused for the next job. */
+   while (1) {
+      fiber_body(fiber);
+      SwitchToFiber(fiber->pool->scheduler);
+   }
+}
+
+
+/**
+ * Fiber stacks are reserved by the system with a guard page.
+ */
+static boolean
+fiber_init(struct lp_cs_fiber *fiber, size_t stack_size)
+{
+   if (fiber->handle && fiber->stack_size < stack_size) {
+      DeleteFiber(fiber->handle);
+      fiber->handle = NULL;
+   }
+
+   if (!fiber->handle) {
+      fiber->handle = CreateFiber(stack_size, fiber_entry, fiber);
+      if (!fiber->handle)
+         return FALSE;
+      fiber->stack_size = stack_size;
+   }
+   return TRUE;
+}
+
+
+static void
+fiber_fini(struct lp_cs_fiber *fiber)
+{
+   if (fiber->handle)
+      DeleteFiber(fiber->handle);
+   fiber->handle = NULL;
+}
+
+
+static void
+fiber_switch_to(struct lp_cs_fiber *fiber)
+{
+   SwitchToFiber(fiber->handle);
+}
+
+
+void
+lp_cs_barrier(void *data)
+{
+   struct lp_cs_fiber *fiber = (struct lp_cs_fiber *)data;
+
+   SwitchToFiber(fiber->pool->scheduler);
+}
+
+#else
+
+/**
+ * makecontext() only passes int arguments, so split the pointer.
+ */
+static void
+fiber_entry(int lo, int hi)
+{
+   uintptr_t ptr = (uintptr_t)(unsigned)lo;
+
+   if (sizeof(uintptr_t) > sizeof(unsigned))
+      ptr |= (uintptr_t)(unsigned)hi << 16 << 16;
+
+   fiber_body((struct lp_cs_fiber *)ptr);
+   /* returning resumes uc_link, i.e. the scheduler */
+}
+
+
+static void
+fiber_fini(struct lp_cs_fiber *fiber)
+{
+   if (fiber->stack)
+      munmap(fiber->stack, fiber->guard_size + fiber->stack_size);
+   fiber->stack = NULL;
+}
+
+
+/**
+ * Map the stack with an inaccessible page below it, stacks grow down.
+ */
+static boolean
+fiber_alloc_stack(struct lp_cs_fiber *fiber, size_t stack_size)
+{
+   size_t page_size = sysconf(_SC_PAGESIZE);
+   int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+   void *stack;
+
+#ifdef MAP_STACK
+   flags |= MAP_STACK;
+#endif
+
+   stack_size = ALIGN_POT(stack_size, page_size);
+   stack = mmap(NULL, page_size + stack_size, PROT_READ | PROT_WRITE,
+                flags, -1, 0);
+   if (stack == MAP_FAILED)
+      return FALSE;
+
+   if (mprotect(stack, page_size, PROT_NONE) != 0) {
+      munmap(stack, page_size + stack_size);
+      return FALSE;
+   }
+
+   fiber->stack = stack;
+   fiber->guard_size = page_size;
+   fiber->stack_size = stack_size;
+   return TRUE;
+}
+
+
+static boolean
+fiber_init(struct lp_cs_fiber *fiber, size_t stack_size)
+{
+   uintptr_t ptr = (uintptr_t)fiber;
+
+   if (fiber->stack && fiber->stack_size < stack_size)
+      fiber_fini(fiber);
+
+   if (!fiber->stack && !fiber_alloc_stack(fiber, stack_size))
+      return FALSE;
+
+   if (getcontext(&fiber->context) != 0)
+      return FALSE;
+
+   fiber->context.uc_stack.ss_sp = (char *)fiber->stack + fiber->guard_size;
+   fiber->context.uc_stack.ss_size = fiber->stack_size;
+   fiber->context.uc_link = &fiber->pool->scheduler;
+   makecontext(&fiber->context, (void (*)(void))fiber_entry, 2,
+               (int)(unsigned)ptr, (int)(unsigned)(ptr >> 16 >> 16));
+   return TRUE;
+}
+
+
+static void
+fiber_switch_to(struct lp_cs_fiber *fiber)
+{
+   swapcontext(&fiber->pool->scheduler, &fiber->context);
+}
+
+
+void
+lp_cs_barrier(void *data)
+{
+   struct lp_cs_fiber *fiber = (struct lp_cs_fiber *)data;
+
+   swapcontext(&fiber->context, &fiber->pool->scheduler);
+}
+
+#endif
+
+
+struct lp_cs_fiber_pool *
+lp_cs_fiber_pool_create(void)
+{
+   return CALLOC_STRUCT(lp_cs_fiber_pool);
+}
+
+
+void
+lp_cs_fiber_pool_destroy(struct lp_cs_fiber_pool *pool)
+{
+   unsigned i;
+
+   if (!pool)
+      return;
+
+   for (i = 0; i < pool->num_fibers; i++)
+      fiber_fini(&pool->fibers[i]);
+   FREE(pool->fibers);
+   FREE(pool);
+}
+
+
+/**
+ * Run func(data, i, fiber) for i in [0, count) on separate fibers with
+ * stacks of at least stack_size bytes, switching between them at every
+ * lp_cs_barrier() call.
+ * Returns FALSE if the fibers could not be allocated.
+ */
+boolean
+lp_cs_fiber_run(struct lp_cs_fiber_pool *pool, unsigned count,
+                size_t stack_size, lp_cs_fiber_func func, void *data)
+{
+   unsigned remaining = count;
+   unsigned i;
+#if defined(PIPE_OS_WINDOWS)
+   BOOL is_fiber;
+#endif
+
+   if (count > pool->num_fibers) {
+      /* Windows fibers point back to their struct, so start afresh */
+      for (i = 0; i < pool->num_fibers; i++)
+         fiber_fini(&pool->fibers[i]);
+      FREE(pool->fibers);
+
+      pool->fibers = CALLOC(count, sizeof *pool->fibers);
+      if (!pool->fibers) {
+         pool->num_fibers = 0;
+         return FALSE;
+      }
+      pool->num_fibers = count;
+   }
+
+   pool->func = func;
+   pool->data = data;
+
+   for (i = 0; i < count; i++) {
+      struct lp_cs_fiber *fiber = &pool->fibers[i];
+
+      fiber->pool = pool;
+      fiber->index = i;
+      fiber->done = FALSE;
+      if (!fiber_init(fiber, MAX2(stack_size, LP_CS_FIBER_STACK_SIZE)))
+         return FALSE;
+   }
+
+#if defined(PIPE_OS_WINDOWS)
+   /* The application thread may already be a fiber when not threading */
+   is_fiber = IsThreadAFiber();
+   pool->scheduler = is_fiber ? GetCurrentFiber() : ConvertThreadToFiber(NULL);
+   if (!pool->scheduler)
+      return FALSE;
+#endif
+
+   while (remaining) {
+      for (i = 0; i < count; i++) {
+         struct lp_cs_fiber *fiber = &pool->fibers[i];
+
+         if (fiber->done)
+            continue;
+
+         fiber_switch_to(fiber);
+         if (fiber->done)
+            remaining--;
+      }
+   }
+
+#if defined(PIPE_OS_WINDOWS)
+   if (!is_fiber)
+      ConvertFiberToThread();
+#endif
+
+   return TRUE;
+}
+
+#else /* !LP_CS_HAVE_FIBERS */
+
+struct lp_cs_fiber_pool *
+lp_cs_fiber_pool_create(void)
+{
+   return NULL;
+}
+
+
+void
+lp_cs_fiber_pool_destroy(struct lp_cs_fiber_pool *pool)
+{
+}
+
+
+boolean
+lp_cs_fiber_run(struct lp_cs_fiber_pool *pool, unsigned count,
+                size_t stack_size, lp_cs_fiber_func func, void *data)
+{
+   return FALSE;
+}
+
+
+void
+lp_cs_barrier(void *fiber)
+{
+   assert(0);
+}
+
+#endif /* LP_CS_HAVE_FIBERS */
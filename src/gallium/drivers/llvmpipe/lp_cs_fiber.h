@@ -0,0 +1,83 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * Cooperative fibers used to implement compute shader barriers.
+ *
+ * Each SIMD vector of invocations of a workgroup runs on its own fiber.
+ * When the shader hits a barrier it yields back to the scheduler, which
+ * resumes the fibers round-robin, so that every vector reaches the barrier
+ * before any of them proceeds past it.
+ */
+
+#ifndef LP_CS_FIBER_H
+#define LP_CS_FIBER_H
+
+#include "pipe/p_config.h"
+#include "pipe/p_compiler.h"
+
+
+#if defined(PIPE_OS_WINDOWS) || \
+    (defined(PIPE_OS_LINUX) && !defined(PIPE_OS_ANDROID)) || \
+    defined(PIPE_OS_BSD)
+#define LP_CS_HAVE_FIBERS 1
+#else
+#define LP_CS_HAVE_FIBERS 0
+#endif
+
+
+/** Minimum stack size of each fiber, in bytes */
+#define LP_CS_FIBER_STACK_SIZE (64 * 1024)
+
+
+struct lp_cs_fiber_pool;
+
+
+/**
+ * Body of a fiber.
+ * \param index  index of the fiber, 0..count-1
+ * \param fiber  handle to pass to lp_cs_barrier()
+ */
+typedef void (*lp_cs_fiber_func)(void *data, unsigned index, void *fiber);
+
+
+struct lp_cs_fiber_pool *
+lp_cs_fiber_pool_create(void);
+
+void
+lp_cs_fiber_pool_destroy(struct lp_cs_fiber_pool *pool);
+
+boolean
+lp_cs_fiber_run(struct lp_cs_fiber_pool *pool, unsigned count,
+                size_t stack_size, lp_cs_fiber_func func, void *data);
+
+void
+lp_cs_barrier(void *fiber);
+
+
+#endif /* LP_CS_FIBER_H */
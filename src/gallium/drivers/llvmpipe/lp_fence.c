@@ -28,6 +28,7 @@
 
 #include "pipe/p_screen.h"
 #include "util/u_memory.h"
+#include "util/u_threaded_context.h"
 #include "lp_debug.h"
 #include "lp_fence.h"
 
@@ -54,6 +55,7 @@ lp_fence_create(unsigned rank)
 
    (void) mtx_init(&fence->mutex, mtx_plain);
    cnd_init(&fence->signalled);
+   util_queue_fence_init(&fence->ready);
 
    fence->id = fence_id++;
    fence->rank = rank;
@@ -65,6 +67,25 @@ lp_fence_create(unsigned rank)
 }
 
 
+/**
+ * Create a fence for a flush which the threaded context hasn't passed to
+ * the driver yet.  The flush resolves it to the fence of the scene.
+ */
+struct lp_fence *
+lp_fence_create_unflushed(struct tc_unflushed_batch_token *token)
+{
+   struct lp_fence *fence = lp_fence_create(0);
+
+   if (!fence)
+      return NULL;
+
+   util_queue_fence_reset(&fence->ready);
+   tc_unflushed_batch_token_reference(&fence->tc_token, token);
+
+   return fence;
+}
+
+
 /** Destroy a fence.  Called when refcount hits zero. */
 void
 lp_fence_destroy(struct lp_fence *fence)
@@ -72,6 +93,9 @@ lp_fence_destroy(struct lp_fence *fence)
    if (LP_DEBUG & DEBUG_FENCE)
       debug_printf("%s %d\n", __FUNCTION__, fence->id);
 
+   lp_fence_reference(&fence->flushed, NULL);
+   tc_unflushed_batch_token_reference(&fence->tc_token, NULL);
+   util_queue_fence_destroy(&fence->ready);
    mtx_destroy(&fence->mutex);
    cnd_destroy(&fence->signalled);
    FREE(fence);
@@ -104,10 +128,23 @@ lp_fence_signal(struct lp_fence *fence)
    mtx_unlock(&fence->mutex);
 }
 
+/**
+ * Check whether all the rendering threads signalled the fence.
+ *
+ * The counter is read under the mutex: once it reaches the rank, the caller
+ * may drop the last reference and destroy the fence, which must not happen
+ * while the last signalling thread still holds the mutex.
+ */
 boolean
 lp_fence_signalled(struct lp_fence *f)
 {
-   return f->count == f->rank;
+   boolean signalled;
+
+   mtx_lock(&f->mutex);
+   signalled = f->count == f->rank;
+   mtx_unlock(&f->mutex);
+
+   return signalled;
 }
 
 void
@@ -33,9 +33,11 @@
 #include "os/os_thread.h"
 #include "pipe/p_state.h"
 #include "util/u_inlines.h"
+#include "util/u_queue.h"
 
 
 struct pipe_screen;
+struct tc_unflushed_batch_token;
 
 
 struct lp_fence
@@ -49,12 +51,23 @@ struct lp_fence
    boolean issued;
    unsigned rank;
    unsigned count;
+
+   /* Fences returned by deferred flushes of the threaded context only get
+    * the fence of the flushed scene once the flush runs in the driver
+    * thread, which signals 'ready'.
+    */
+   struct tc_unflushed_batch_token *tc_token;
+   struct util_queue_fence ready;
+   struct lp_fence *flushed;
 };
 
 
 struct lp_fence *
 lp_fence_create(unsigned rank);
 
+struct lp_fence *
+lp_fence_create_unflushed(struct tc_unflushed_batch_token *token);
+
 
 void
 lp_fence_signal(struct lp_fence *fence);
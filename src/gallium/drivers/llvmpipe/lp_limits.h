@@ -61,7 +61,12 @@
 #define LP_MAX_WIDTH  (1 << (LP_MAX_TEXTURE_LEVELS - 1))
 
 
-#define LP_MAX_THREADS 16
+/**
+ * Max number of rasterizer thread groups.  Threads sharing a L3 cache form
+ * a group, and each group preferably works on its own band of tiles.
+ * There is no limit on the number of threads themselves.
+ */
+#define LP_MAX_THREAD_GROUPS 32
 
 
 /**
@@ -91,4 +96,9 @@
  */
 #define LP_MAX_SETUP_VARIANTS 64
 
+/**
+ * Max number of threads compiling fragment shaders in the background.
+ */
+#define LP_MAX_COMPILE_THREADS 4
+
 #endif /* LP_LIMITS_H */
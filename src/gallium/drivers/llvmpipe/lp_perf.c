@@ -25,31 +25,42 @@
  *
  **************************************************************************/
 
+#include <inttypes.h>
+
 #include "util/u_debug.h"
 #include "lp_debug.h"
 #include "lp_perf.h"
 
 
 
-struct lp_counters lp_count;
-
-
+/**
+ * Add all the counters of counters to sum.
+ */
 void
-lp_reset_counters(void)
+lp_counters_add(struct lp_counters *sum, const struct lp_counters *counters)
 {
-   memset(&lp_count, 0, sizeof(lp_count));
+   uint64_t *dst = (uint64_t *) sum;
+   const uint64_t *src = (const uint64_t *) counters;
+   unsigned i;
+
+   STATIC_ASSERT(sizeof *counters % sizeof *src == 0);
+
+   for (i = 0; i < sizeof *counters / sizeof *src; i++) {
+      dst[i] += src[i];
+   }
 }
 
 
 void
-lp_print_counters(void)
+lp_print_counters(const struct lp_counters *counters)
 {
    if (LP_DEBUG & DEBUG_COUNTERS) {
-      unsigned total_64, total_16, total_4;
+      const struct lp_counters lp_count = *counters;
+      uint64_t total_64, total_16, total_4;
       float p1, p2, p3, p4, p5, p6;
 
-      debug_printf("llvmpipe: nr_triangles:                 %9u\n", lp_count.nr_tris);
-      debug_printf("llvmpipe: nr_culled_triangles:          %9u\n", lp_count.nr_culled_tris);
+      debug_printf("llvmpipe: nr_triangles:                 %9" PRIu64 "\n", lp_count.nr_tris);
+      debug_printf("llvmpipe: nr_culled_triangles:          %9" PRIu64 "\n", lp_count.nr_culled_tris);
 
       total_64 = (lp_count.nr_empty_64 + 
                   lp_count.nr_fully_covered_64 +
@@ -61,14 +72,14 @@ lp_print_counters(void)
       p5 = 100.0 * (float) lp_count.nr_shade_opaque_64 / (float) total_64;
       p6 = 100.0 * (float) lp_count.nr_shade_64 / (float) total_64;
 
-      debug_printf("llvmpipe: nr_64x64:                     %9u\n", total_64);
-      debug_printf("llvmpipe:   nr_fully_covered_64x64:     %9u (%3.0f%% of %u)\n", lp_count.nr_fully_covered_64, p2, total_64);
-      debug_printf("llvmpipe:     nr_shade_opaque_64x64:    %9u (%3.0f%% of %u)\n", lp_count.nr_shade_opaque_64, p5, total_64);
-      debug_printf("llvmpipe:        nr_pure_shade_opaque:  %9u (%3.0f%% of %u)\n", lp_count.nr_pure_shade_opaque_64, 0.0, lp_count.nr_shade_opaque_64);
-      debug_printf("llvmpipe:     nr_shade_64x64:           %9u (%3.0f%% of %u)\n", lp_count.nr_shade_64, p6, total_64);
-      debug_printf("llvmpipe:        nr_pure_shade:         %9u (%3.0f%% of %u)\n", lp_count.nr_pure_shade_64, 0.0, lp_count.nr_shade_64);
-      debug_printf("llvmpipe:   nr_partially_covered_64x64: %9u (%3.0f%% of %u)\n", lp_count.nr_partially_covered_64, p3, total_64);
-      debug_printf("llvmpipe:   nr_empty_64x64:             %9u (%3.0f%% of %u)\n", lp_count.nr_empty_64, p1, total_64);
+      debug_printf("llvmpipe: nr_64x64:                     %9" PRIu64 "\n", total_64);
+      debug_printf("llvmpipe:   nr_fully_covered_64x64:     %9" PRIu64 " (%3.0f%% of %" PRIu64 ")\n", lp_count.nr_fully_covered_64, p2, total_64);
+      debug_printf("llvmpipe:     nr_shade_opaque_64x64:    %9" PRIu64 " (%3.0f%% of %" PRIu64 ")\n", lp_count.nr_shade_opaque_64, p5, total_64);
+      debug_printf("llvmpipe:        nr_pure_shade_opaque:  %9" PRIu64 " (%3.0f%% of %" PRIu64 ")\n", lp_count.nr_pure_shade_opaque_64, 0.0, lp_count.nr_shade_opaque_64);
+      debug_printf("llvmpipe:     nr_shade_64x64:           %9" PRIu64 " (%3.0f%% of %" PRIu64 ")\n", lp_count.nr_shade_64, p6, total_64);
+      debug_printf("llvmpipe:        nr_pure_shade:         %9" PRIu64 " (%3.0f%% of %" PRIu64 ")\n", lp_count.nr_pure_shade_64, 0.0, lp_count.nr_shade_64);
+      debug_printf("llvmpipe:   nr_partially_covered_64x64: %9" PRIu64 " (%3.0f%% of %" PRIu64 ")\n", lp_count.nr_partially_covered_64, p3, total_64);
+      debug_printf("llvmpipe:   nr_empty_64x64:             %9" PRIu64 " (%3.0f%% of %" PRIu64 ")\n", lp_count.nr_empty_64, p1, total_64);
 
       total_16 = (lp_count.nr_empty_16 + 
                   lp_count.nr_fully_covered_16 +
@@ -78,10 +89,10 @@ lp_print_counters(void)
       p2 = 100.0 * (float) lp_count.nr_fully_covered_16 / (float) total_16;
       p3 = 100.0 * (float) lp_count.nr_partially_covered_16 / (float) total_16;
 
-      debug_printf("llvmpipe: nr_16x16:                     %9u\n", total_16);
-      debug_printf("llvmpipe:   nr_fully_covered_16x16:     %9u (%3.0f%% of %u)\n", lp_count.nr_fully_covered_16, p2, total_16);
-      debug_printf("llvmpipe:   nr_partially_covered_16x16: %9u (%3.0f%% of %u)\n", lp_count.nr_partially_covered_16, p3, total_16);
-      debug_printf("llvmpipe:   nr_empty_16x16:             %9u (%3.0f%% of %u)\n", lp_count.nr_empty_16, p1, total_16);
+      debug_printf("llvmpipe: nr_16x16:                     %9" PRIu64 "\n", total_16);
+      debug_printf("llvmpipe:   nr_fully_covered_16x16:     %9" PRIu64 " (%3.0f%% of %" PRIu64 ")\n", lp_count.nr_fully_covered_16, p2, total_16);
+      debug_printf("llvmpipe:   nr_partially_covered_16x16: %9" PRIu64 " (%3.0f%% of %" PRIu64 ")\n", lp_count.nr_partially_covered_16, p3, total_16);
+      debug_printf("llvmpipe:   nr_empty_16x16:             %9" PRIu64 " (%3.0f%% of %" PRIu64 ")\n", lp_count.nr_empty_16, p1, total_16);
 
       total_4 = (lp_count.nr_empty_4 +
                  lp_count.nr_fully_covered_4 +
@@ -92,19 +103,26 @@ lp_print_counters(void)
       p3 = 100.0 * (float) lp_count.nr_partially_covered_4 / (float) total_4;
       p4 = 100.0 * (float) lp_count.nr_non_empty_4 / (float) total_4;
 
-      debug_printf("llvmpipe: nr_tri_4x4:                   %9u\n", total_4);
-      debug_printf("llvmpipe:   nr_fully_covered_4x4:       %9u (%3.0f%% of %u)\n", lp_count.nr_fully_covered_4, p2, total_4);
-      debug_printf("llvmpipe:   nr_partially_covered_4x4:   %9u (%3.0f%% of %u)\n", lp_count.nr_partially_covered_4, p3, total_4);
-      debug_printf("llvmpipe:   nr_empty_4x4:               %9u (%3.0f%% of %u)\n", lp_count.nr_empty_4, p1, total_4);
-      debug_printf("llvmpipe:   nr_non_empty_4x4:           %9u (%3.0f%% of %u)\n", lp_count.nr_non_empty_4, p4, total_4);
+      debug_printf("llvmpipe: nr_tri_4x4:                   %9" PRIu64 "\n", total_4);
+      debug_printf("llvmpipe:   nr_fully_covered_4x4:       %9" PRIu64 " (%3.0f%% of %" PRIu64 ")\n", lp_count.nr_fully_covered_4, p2, total_4);
+      debug_printf("llvmpipe:   nr_partially_covered_4x4:   %9" PRIu64 " (%3.0f%% of %" PRIu64 ")\n", lp_count.nr_partially_covered_4, p3, total_4);
+      debug_printf("llvmpipe:   nr_empty_4x4:               %9" PRIu64 " (%3.0f%% of %" PRIu64 ")\n", lp_count.nr_empty_4, p1, total_4);
+      debug_printf("llvmpipe:   nr_non_empty_4x4:           %9" PRIu64 " (%3.0f%% of %" PRIu64 ")\n", lp_count.nr_non_empty_4, p4, total_4);
+
+      debug_printf("llvmpipe: nr_shaded_4x4:                %9" PRIu64 "\n", lp_count.nr_shaded_4);
 
-      debug_printf("llvmpipe: nr_color_tile_clear:          %9u\n", lp_count.nr_color_tile_clear);
-      debug_printf("llvmpipe: nr_color_tile_load:           %9u\n", lp_count.nr_color_tile_load);
-      debug_printf("llvmpipe: nr_color_tile_store:          %9u\n", lp_count.nr_color_tile_store);
+      debug_printf("llvmpipe: nr_color_tile_clear:          %9" PRIu64 "\n", lp_count.nr_color_tile_clear);
+      debug_printf("llvmpipe: nr_color_tile_load:           %9" PRIu64 "\n", lp_count.nr_color_tile_load);
+      debug_printf("llvmpipe: nr_color_tile_store:          %9" PRIu64 "\n", lp_count.nr_color_tile_store);
 
-      debug_printf("llvmpipe: nr_llvm_compiles:             %u\n", lp_count.nr_llvm_compiles);
+      debug_printf("llvmpipe: nr_llvm_compiles:             %" PRIu64 "\n", lp_count.nr_llvm_compiles);
       debug_printf("llvmpipe: total LLVM compile time:      %.2f sec\n", lp_count.llvm_compile_time / 1000000.0);
       debug_printf("llvmpipe: average LLVM compile time:    %.2f sec\n", lp_count.llvm_compile_time / 1000000.0 / lp_count.nr_llvm_compiles);
+      debug_printf("llvmpipe: nr_disk_cache_hits:          %" PRIu64 "\n", lp_count.nr_disk_cache_hits);
+      debug_printf("llvmpipe: nr_disk_cache_misses:         %" PRIu64 "\n", lp_count.nr_disk_cache_misses);
 
+      debug_printf("llvmpipe: scene memory:                 %.2f MB\n", lp_count.scene_bytes / (1024.0 * 1024.0));
+      debug_printf("llvmpipe: binner time:                  %.2f sec\n", lp_count.binner_time / 1e9);
+      debug_printf("llvmpipe: rasterizer time:              %.2f sec\n", lp_count.rast_time / 1e9);
    }
 }
@@ -37,55 +37,61 @@
 
 /**
  * Various counters
+ *
+ * There is one set per context, for what gets binned and compiled there,
+ * one per rasterizer task, for what gets rasterized, and one per screen,
+ * for what is shared between contexts.  Each of the former is only ever
+ * written by one thread, so counting needs no atomics; they are summed
+ * with lp_counters_add() when queried.
+ *
+ * All members are uint64_t, see lp_counters_add().
  */
 struct lp_counters
 {
-   unsigned nr_tris;
-   unsigned nr_culled_tris;
-   unsigned nr_empty_64;
-   unsigned nr_fully_covered_64;
-   unsigned nr_partially_covered_64;
-   unsigned nr_pure_shade_opaque_64;
-   unsigned nr_pure_shade_64;
-   unsigned nr_shade_64;
-   unsigned nr_shade_opaque_64;
-   unsigned nr_empty_16;
-   unsigned nr_fully_covered_16;
-   unsigned nr_partially_covered_16;
-   unsigned nr_empty_4;
-   unsigned nr_fully_covered_4;
-   unsigned nr_partially_covered_4;
-   unsigned nr_non_empty_4;
-   unsigned nr_llvm_compiles;
-   int64_t llvm_compile_time;  /**< total, in microseconds */
-
-   unsigned nr_color_tile_clear;
-   unsigned nr_color_tile_load;
-   unsigned nr_color_tile_store;
+   uint64_t nr_tris;
+   uint64_t nr_culled_tris;
+   uint64_t nr_empty_64;
+   uint64_t nr_fully_covered_64;
+   uint64_t nr_partially_covered_64;
+   uint64_t nr_pure_shade_opaque_64;
+   uint64_t nr_pure_shade_64;
+   uint64_t nr_shade_64;
+   uint64_t nr_shade_opaque_64;
+   uint64_t nr_empty_16;
+   uint64_t nr_fully_covered_16;
+   uint64_t nr_partially_covered_16;
+   uint64_t nr_empty_4;
+   uint64_t nr_fully_covered_4;
+   uint64_t nr_partially_covered_4;
+   uint64_t nr_non_empty_4;
+   uint64_t nr_shaded_4;       /**< 4x4 blocks the fragment shader ran on */
+   uint64_t nr_llvm_compiles;
+   uint64_t llvm_compile_time;  /**< total, in microseconds */
+   uint64_t nr_disk_cache_hits;
+   uint64_t nr_disk_cache_misses;
+
+   uint64_t nr_color_tile_clear;
+   uint64_t nr_color_tile_load;
+   uint64_t nr_color_tile_store;
+
+   uint64_t scene_bytes;       /**< size of the scenes rasterized */
+   uint64_t binner_time;       /**< draw and binning, in nanoseconds */
+   uint64_t rast_time;         /**< summed over threads, in nanoseconds */
 };
 
 
-extern struct lp_counters lp_count;
-
-
-/** Increment the named counter (only for debug builds) */
-#ifdef DEBUG
-#define LP_COUNT(counter) lp_count.counter++
-#define LP_COUNT_ADD(counter, incr)  lp_count.counter += (incr)
-#define LP_COUNT_GET(counter) (lp_count.counter)
-#else
-#define LP_COUNT(counter)
-#define LP_COUNT_ADD(counter, incr) (void)(incr)
-#define LP_COUNT_GET(counter) 0
-#endif
+/** Increment the named counter of a struct lp_counters */
+#define LP_COUNT(counters, counter) ((counters)->counter++)
+#define LP_COUNT_ADD(counters, counter, incr) ((counters)->counter += (incr))
+#define LP_COUNT_GET(counters, counter) ((counters)->counter)
 
 
 extern void
-lp_reset_counters(void);
+lp_counters_add(struct lp_counters *sum, const struct lp_counters *counters);
 
 
 extern void
-lp_print_counters(void);
+lp_print_counters(const struct lp_counters *counters);
 
 
 #endif /* LP_PERF_H */
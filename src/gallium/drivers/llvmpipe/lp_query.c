@@ -37,6 +37,7 @@
 #include "lp_context.h"
 #include "lp_flush.h"
 #include "lp_fence.h"
+#include "lp_perf.h"
 #include "lp_query.h"
 #include "lp_screen.h"
 #include "lp_state.h"
@@ -48,19 +49,134 @@ static struct llvmpipe_query *llvmpipe_query( struct pipe_query *p )
    return (struct llvmpipe_query *)p;
 }
 
+
+/**
+ * Description of the driver specific queries, indexed by
+ * type - PIPE_QUERY_DRIVER_SPECIFIC.
+ */
+static const struct lp_driver_query {
+   const char *name;
+   enum pipe_driver_query_type type;
+   unsigned offset;       /**< of the counter in struct lp_counters */
+   unsigned multiplier;
+   unsigned divisor;
+   boolean rasterizer;    /**< counted by the rasterizer threads */
+} lp_driver_queries[LP_QUERY_LAST - PIPE_QUERY_DRIVER_SPECIFIC] = {
+#define QUERY(type, name, qtype, counter, mul, div, rast) \
+   [type - PIPE_QUERY_DRIVER_SPECIFIC] = \
+      { name, qtype, offsetof(struct lp_counters, counter), mul, div, rast }
+   QUERY(LP_QUERY_TRIANGLES, "triangles-binned",
+         PIPE_DRIVER_QUERY_TYPE_UINT64, nr_tris, 1, 1, FALSE),
+   QUERY(LP_QUERY_CULLED_TRIANGLES, "triangles-culled",
+         PIPE_DRIVER_QUERY_TYPE_UINT64, nr_culled_tris, 1, 1, FALSE),
+   QUERY(LP_QUERY_FULLY_COVERED_TILES, "tiles-fully-covered",
+         PIPE_DRIVER_QUERY_TYPE_UINT64, nr_fully_covered_64, 1, 1, FALSE),
+   QUERY(LP_QUERY_PARTIALLY_COVERED_TILES, "tiles-partially-covered",
+         PIPE_DRIVER_QUERY_TYPE_UINT64, nr_partially_covered_64, 1, 1, FALSE),
+   /* like ps_invocations, counts whole 4x4 blocks */
+   QUERY(LP_QUERY_FS_INVOCATIONS, "fs-invocations",
+         PIPE_DRIVER_QUERY_TYPE_UINT64, nr_shaded_4,
+         LP_RASTER_BLOCK_SIZE * LP_RASTER_BLOCK_SIZE, 1, TRUE),
+   QUERY(LP_QUERY_SCENE_MEMORY, "scene-memory",
+         PIPE_DRIVER_QUERY_TYPE_BYTES, scene_bytes, 1, 1, FALSE),
+   QUERY(LP_QUERY_BINNER_TIME, "binner-time",
+         PIPE_DRIVER_QUERY_TYPE_MICROSECONDS, binner_time, 1, 1000, FALSE),
+   QUERY(LP_QUERY_RASTERIZER_TIME, "rasterizer-time",
+         PIPE_DRIVER_QUERY_TYPE_MICROSECONDS, rast_time, 1, 1000, TRUE),
+   QUERY(LP_QUERY_SHADER_COMPILES, "shader-compiles",
+         PIPE_DRIVER_QUERY_TYPE_UINT64, nr_llvm_compiles, 1, 1, FALSE),
+   QUERY(LP_QUERY_JIT_TIME, "jit-time",
+         PIPE_DRIVER_QUERY_TYPE_MICROSECONDS, llvm_compile_time, 1, 1, FALSE),
+#undef QUERY
+};
+
+
+static const struct lp_driver_query *
+lp_driver_query(unsigned type)
+{
+   if (type < PIPE_QUERY_DRIVER_SPECIFIC || type >= LP_QUERY_LAST)
+      return NULL;
+
+   return &lp_driver_queries[type - PIPE_QUERY_DRIVER_SPECIFIC];
+}
+
+
+/**
+ * Sum the counters of the context, the screen and the rasterizer threads.
+ * The rasterizer is shared with the other contexts of the screen, so its
+ * counters include their work too.
+ */
+void
+llvmpipe_get_counters(struct llvmpipe_context *lp, struct lp_counters *sum)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
+
+   memset(sum, 0, sizeof *sum);
+   lp_counters_add(sum, &lp->counters);
+   lp_counters_add(sum, &screen->counters);
+   lp_rast_add_counters(screen->rast, sum);
+}
+
+
+/**
+ * Read the counter of a driver specific query from counters.
+ */
+uint64_t
+llvmpipe_query_counter(const struct llvmpipe_query *pq,
+                       const struct lp_counters *counters)
+{
+   const struct lp_driver_query *query = lp_driver_query(pq->type);
+
+   return *(const uint64_t *)((const char *)counters + query->offset);
+}
+
+
+/**
+ * Read the counter of a driver specific query now.  Rasterizer counters
+ * are only up to date once the scenes binned so far have been rasterized,
+ * so those are read by the rasterizer instead, at the scene boundaries.
+ */
+static void
+read_driver_counter(struct llvmpipe_context *lp,
+                    struct llvmpipe_query *pq,
+                    boolean end)
+{
+   struct lp_counters counters;
+
+   if (lp_driver_query(pq->type)->rasterizer) {
+      lp_setup_sample_counters(lp->setup, pq, end);
+      return;
+   }
+
+   llvmpipe_get_counters(lp, &counters);
+
+   if (end)
+      pq->end[0] = llvmpipe_query_counter(pq, &counters);
+   else
+      pq->start[0] = llvmpipe_query_counter(pq, &counters);
+}
+
 static struct pipe_query *
 llvmpipe_create_query(struct pipe_context *pipe, 
                       unsigned type,
                       unsigned index)
 {
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
    struct llvmpipe_query *pq;
 
-   assert(type < PIPE_QUERY_TYPES);
+   assert(type < PIPE_QUERY_TYPES || lp_driver_query(type));
 
    pq = CALLOC_STRUCT( llvmpipe_query );
 
    if (pq) {
       pq->type = type;
+      pq->num_threads = MAX2(1, screen->num_threads);
+      pq->start = CALLOC(2 * pq->num_threads, sizeof *pq->start);
+      if (!pq->start) {
+         FREE(pq);
+         return NULL;
+      }
+      pq->end = pq->start + pq->num_threads;
    }
 
    return (struct pipe_query *) pq;
@@ -85,6 +201,7 @@ llvmpipe_destroy_query(struct pipe_context *pipe, struct pipe_query *q)
       lp_fence_reference(&pq->fence, NULL);
    }
 
+   FREE(pq->start);
    FREE(pq);
 }
 
@@ -95,9 +212,9 @@ llvmpipe_get_query_result(struct pipe_context *pipe,
                           boolean wait,
                           union pipe_query_result *vresult)
 {
-   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
-   unsigned num_threads = MAX2(1, screen->num_threads);
    struct llvmpipe_query *pq = llvmpipe_query(q);
+   const struct lp_driver_query *query = lp_driver_query(pq->type);
+   unsigned num_threads = pq->num_threads;
    uint64_t *result = (uint64_t *)vresult;
    int i;
 
@@ -114,6 +231,13 @@ llvmpipe_get_query_result(struct pipe_context *pipe,
       }
    }
 
+   if (query) {
+      /* only the rasterizer counters have a fence to wait for */
+      *result = (pq->end[0] - pq->start[0]) * query->multiplier /
+                query->divisor;
+      return TRUE;
+   }
+
    /* Sum the results from each of the threads:
     */
    *result = 0;
@@ -201,8 +325,15 @@ llvmpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
    }
 
 
-   memset(pq->start, 0, sizeof(pq->start));
-   memset(pq->end, 0, sizeof(pq->end));
+   memset(pq->start, 0, pq->num_threads * sizeof(*pq->start));
+   memset(pq->end, 0, pq->num_threads * sizeof(*pq->end));
+
+   /* Driver specific queries aren't binned. */
+   if (lp_driver_query(pq->type)) {
+      read_driver_counter(llvmpipe, pq, FALSE);
+      return true;
+   }
+
    lp_setup_begin_query(llvmpipe->setup, pq);
 
    switch (pq->type) {
@@ -249,6 +380,11 @@ llvmpipe_end_query(struct pipe_context *pipe, struct pipe_query *q)
    struct llvmpipe_context *llvmpipe = llvmpipe_context( pipe );
    struct llvmpipe_query *pq = llvmpipe_query(q);
 
+   if (lp_driver_query(pq->type)) {
+      read_driver_counter(llvmpipe, pq, TRUE);
+      return true;
+   }
+
    lp_setup_end_query(llvmpipe->setup, pq);
 
    switch (pq->type) {
@@ -328,6 +464,49 @@ llvmpipe_check_render_cond(struct llvmpipe_context *lp)
       return TRUE;
 }
 
+int
+llvmpipe_get_driver_query_info(struct pipe_screen *screen,
+                               unsigned index,
+                               struct pipe_driver_query_info *info)
+{
+   const struct lp_driver_query *query;
+
+   if (!info)
+      return ARRAY_SIZE(lp_driver_queries);
+
+   if (index >= ARRAY_SIZE(lp_driver_queries))
+      return 0;
+
+   query = &lp_driver_queries[index];
+   info->name = query->name;
+   info->query_type = PIPE_QUERY_DRIVER_SPECIFIC + index;
+   info->max_value.u64 = 0;
+   info->type = query->type;
+   info->result_type = PIPE_DRIVER_QUERY_RESULT_TYPE_AVERAGE;
+   info->group_id = 0;
+   info->flags = 0;
+   return 1;
+}
+
+
+int
+llvmpipe_get_driver_query_group_info(struct pipe_screen *screen,
+                                     unsigned index,
+                                     struct pipe_driver_query_group_info *info)
+{
+   if (!info)
+      return 1;
+
+   if (index > 0)
+      return 0;
+
+   info->name = "llvmpipe";
+   info->max_active_queries = ARRAY_SIZE(lp_driver_queries);
+   info->num_queries = ARRAY_SIZE(lp_driver_queries);
+   return 1;
+}
+
+
 static void
 llvmpipe_set_active_query_state(struct pipe_context *pipe, boolean enable)
 {
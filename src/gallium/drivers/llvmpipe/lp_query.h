@@ -35,15 +35,42 @@
 
 #include <limits.h>
 #include "os/os_thread.h"
+#include "util/u_threaded_context.h"
+#include "pipe/p_defines.h"
 #include "lp_limits.h"
 
 
 struct llvmpipe_context;
+struct lp_counters;
+struct pipe_screen;
+struct pipe_driver_query_info;
+struct pipe_driver_query_group_info;
+
+
+/**
+ * Driver specific queries, reading the performance counters of lp_perf.h.
+ * They are listed by llvmpipe_get_driver_query_info().
+ */
+enum lp_query_type {
+   LP_QUERY_TRIANGLES = PIPE_QUERY_DRIVER_SPECIFIC,
+   LP_QUERY_CULLED_TRIANGLES,
+   LP_QUERY_FULLY_COVERED_TILES,
+   LP_QUERY_PARTIALLY_COVERED_TILES,
+   LP_QUERY_FS_INVOCATIONS,
+   LP_QUERY_SCENE_MEMORY,
+   LP_QUERY_BINNER_TIME,
+   LP_QUERY_RASTERIZER_TIME,
+   LP_QUERY_SHADER_COMPILES,
+   LP_QUERY_JIT_TIME,
+   LP_QUERY_LAST
+};
 
 
 struct llvmpipe_query {
-   uint64_t start[LP_MAX_THREADS];  /* start count value for each thread */
-   uint64_t end[LP_MAX_THREADS];    /* end count value for each thread */
+   struct threaded_query b;         /* must be first */
+   uint64_t *start;                 /* start count value for each thread */
+   uint64_t *end;                   /* end count value for each thread */
+   unsigned num_threads;            /* size of the start/end arrays */
    struct lp_fence *fence;          /* fence from last scene this was binned in */
    unsigned type;                   /* PIPE_QUERY_* */
    unsigned num_primitives_generated;
@@ -57,4 +84,21 @@ extern void llvmpipe_init_query_funcs(struct llvmpipe_context * );
 
 extern boolean llvmpipe_check_render_cond(struct llvmpipe_context *);
 
+extern void
+llvmpipe_get_counters(struct llvmpipe_context *lp, struct lp_counters *sum);
+
+extern uint64_t
+llvmpipe_query_counter(const struct llvmpipe_query *pq,
+                       const struct lp_counters *counters);
+
+extern int
+llvmpipe_get_driver_query_info(struct pipe_screen *screen,
+                               unsigned index,
+                               struct pipe_driver_query_info *info);
+
+extern int
+llvmpipe_get_driver_query_group_info(struct pipe_screen *screen,
+                                     unsigned index,
+                                     struct pipe_driver_query_group_info *info);
+
 #endif /* LP_QUERY_H */
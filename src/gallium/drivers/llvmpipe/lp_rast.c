@@ -33,6 +33,7 @@
 #include "util/u_pack_color.h"
 #include "util/u_string.h"
 #include "util/u_thread.h"
+#include "util/u_cpu_detect.h"
 
 #include "util/os_time.h"
 
@@ -61,6 +62,39 @@ const struct lp_rasterizer_task *jit_task = NULL;
  * Begin rasterizing a scene.
  * Called once per scene by one thread.
  */
+/**
+ * Read the counters of the driver queries which sample them at the
+ * beginning or at the end of the scene.  Only called while no task is
+ * rasterizing, so that the counters of all the tasks are stable.
+ */
+static void
+lp_rast_sample_counters( struct lp_rasterizer *rast,
+                         struct lp_scene *scene,
+                         boolean end )
+{
+   struct lp_counters counters;
+   unsigned i;
+
+   if (!scene->num_counter_queries)
+      return;
+
+   memset(&counters, 0, sizeof counters);
+   lp_rast_add_counters(rast, &counters);
+
+   for (i = 0; i < scene->num_counter_queries; i++) {
+      struct llvmpipe_query *pq = scene->counter_queries[i].query;
+
+      if (scene->counter_queries[i].end != end)
+         continue;
+
+      if (end)
+         pq->end[0] = llvmpipe_query_counter(pq, &counters);
+      else
+         pq->start[0] = llvmpipe_query_counter(pq, &counters);
+   }
+}
+
+
 static void
 lp_rast_begin( struct lp_rasterizer *rast,
                struct lp_scene *scene )
@@ -70,19 +104,37 @@ lp_rast_begin( struct lp_rasterizer *rast,
    LP_DBG(DEBUG_RAST, "%s\n", __FUNCTION__);
 
    lp_scene_begin_rasterization( scene );
-   lp_scene_bin_iter_begin( scene );
+   lp_scene_bin_iter_begin( scene, rast->num_groups );
+
+   lp_rast_sample_counters( rast, scene, FALSE );
 }
 
 
 static void
 lp_rast_end( struct lp_rasterizer *rast )
 {
+   lp_rast_sample_counters( rast, rast->curr_scene, TRUE );
+
    lp_scene_end_rasterization( rast->curr_scene );
 
    rast->curr_scene = NULL;
 }
 
 
+/**
+ * Tell the setup module that this thread is done with the scene.
+ * The scene must not be touched by the thread after this, as setup may
+ * immediately recycle it for binning.
+ */
+static void
+lp_rast_signal_scene( struct lp_scene *scene )
+{
+   if (scene->fence) {
+      lp_fence_signal(scene->fence);
+   }
+}
+
+
 /**
  * Beginning rasterization of a tile.
  * \param x  window X position of the tile, in pixels
@@ -110,9 +162,15 @@ lp_rast_tile_begin(struct lp_rasterizer_task *task,
    task->thread_data.ps_invocations = 0;
 
    for (i = 0; i < task->scene->fb.nr_cbufs; i++) {
-      if (task->scene->fb.cbufs[i]) {
+      if (task->scene->fb.cbufs[i] && scene->cbufs[i].tiled_stride) {
+         task->color_tiles[i] = scene->cbufs[i].map +
+                                lp_tiled_texel_offset(task->x, task->y,
+                                                      scene->cbufs[i].format_bytes,
+                                                      scene->cbufs[i].tiled_stride);
+      }
+      else if (task->scene->fb.cbufs[i]) {
          task->color_tiles[i] = scene->cbufs[i].map +
-                                scene->cbufs[i].stride * task->y +
+                                scene->cbufs[i].stride * (int) task->y +
                                 scene->cbufs[i].format_bytes * task->x;
       }
    }
@@ -124,6 +182,42 @@ lp_rast_tile_begin(struct lp_rasterizer_task *task,
 }
 
 
+/**
+ * Clear the current tile of a tiled color buffer, in all bound layers.
+ */
+static void
+lp_rast_clear_tiled_color(struct lp_rasterizer_task *task,
+                          unsigned cbuf,
+                          union util_color *uc)
+{
+   const struct lp_scene *scene = task->scene;
+   const enum pipe_format format = scene->fb.cbufs[cbuf]->format;
+   const unsigned format_bytes = scene->cbufs[cbuf].format_bytes;
+   unsigned layer, x, y;
+
+   for (layer = 0; layer <= scene->fb_max_layer; layer++) {
+      uint8_t *tile = task->color_tiles[cbuf] +
+                      layer * scene->cbufs[cbuf].layer_stride;
+
+      /* A whole tile is contiguous. */
+      if (task->width == TILE_SIZE && task->height == TILE_SIZE) {
+         util_fill_box(tile, format, 0, 0, 0, 0, 0,
+                       TILE_SIZE * TILE_SIZE, 1, 1, uc);
+         continue;
+      }
+
+      for (y = 0; y < task->height; y++) {
+         for (x = 0; x < task->width; x += LP_TILED_BLOCK_SIZE) {
+            util_fill_box(tile + lp_tiled_texel_offset(x, y, format_bytes, 0),
+                          format, 0, 0, 0, 0, 0,
+                          MIN2(LP_TILED_BLOCK_SIZE, task->width - x), 1, 1,
+                          uc);
+         }
+      }
+   }
+}
+
+
 /**
  * Clear the rasterizer's current color tile.
  * This is a bin command called during bin processing.
@@ -153,20 +247,42 @@ lp_rast_clear_color(struct lp_rasterizer_task *task,
           __FUNCTION__, format, uc.ui[0], uc.ui[1], uc.ui[2], uc.ui[3]);
 
 
-   util_fill_box(scene->cbufs[cbuf].map,
-                 format,
-                 scene->cbufs[cbuf].stride,
-                 scene->cbufs[cbuf].layer_stride,
-                 task->x,
-                 task->y,
-                 0,
-                 task->width,
-                 task->height,
-                 scene->fb_max_layer + 1,
-                 &uc);
+   if (scene->cbufs[cbuf].tiled_stride) {
+      lp_rast_clear_tiled_color(task, cbuf, &uc);
+   }
+   else if (scene->cbufs[cbuf].stride < 0) {
+      /* Bottom-up user memory: fill the same rows from the lowest one up. */
+      const int stride = scene->cbufs[cbuf].stride;
+
+      util_fill_box(scene->cbufs[cbuf].map +
+                    (int) (task->y + task->height - 1) * stride,
+                    format,
+                    -stride,
+                    scene->cbufs[cbuf].layer_stride,
+                    task->x,
+                    0,
+                    0,
+                    task->width,
+                    task->height,
+                    scene->fb_max_layer + 1,
+                    &uc);
+   }
+   else {
+      util_fill_box(scene->cbufs[cbuf].map,
+                    format,
+                    scene->cbufs[cbuf].stride,
+                    scene->cbufs[cbuf].layer_stride,
+                    task->x,
+                    task->y,
+                    0,
+                    task->width,
+                    task->height,
+                    scene->fb_max_layer + 1,
+                    &uc);
+   }
 
    /* this will increase for each rb which probably doesn't mean much */
-   LP_COUNT(nr_color_tile_clear);
+   LP_COUNT(&task->counters, nr_color_tile_clear);
 }
 
 
@@ -363,6 +479,7 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
                                             stride,
                                             depth_stride);
          END_JIT_CALL();
+         LP_COUNT(&task->counters, nr_shaded_4);
       }
    }
 }
@@ -464,6 +581,7 @@ lp_rast_shade_quads_mask(struct lp_rasterizer_task *task,
                                             stride,
                                             depth_stride);
       END_JIT_CALL();
+      LP_COUNT(&task->counters, nr_shaded_4);
    }
 }
 
@@ -633,9 +751,9 @@ rasterize_bin(struct lp_rasterizer_task *task,
     */
    if (bin->head->count == 1) {
       if (bin->head->cmd[0] == LP_RAST_OP_SHADE_TILE_OPAQUE)
-         LP_COUNT(nr_pure_shade_opaque_64);
+         LP_COUNT(&task->counters, nr_pure_shade_opaque_64);
       else if (bin->head->cmd[0] == LP_RAST_OP_SHADE_TILE)
-         LP_COUNT(nr_pure_shade_64);
+         LP_COUNT(&task->counters, nr_pure_shade_64);
    }
 }
 
@@ -659,21 +777,28 @@ is_empty_bin( const struct cmd_bin *bin )
  * Called per thread.
  */
 static void
-rasterize_scene(struct lp_rasterizer_task *task,
-                struct lp_scene *scene)
+clear_texture_cache(struct lp_rasterizer_task *task)
 {
-   task->scene = scene;
-
-   /* Clear the cache tags. This should not always be necessary but
-      simpler for now. */
-#if LP_USE_TEXTURE_CACHE
+   /* Clear the cache tags, as the textures may have been freed or written
+      since. This should not always be necessary but simpler for now. */
    memset(task->thread_data.cache->cache_tags, 0,
           sizeof(task->thread_data.cache->cache_tags));
 #if LP_BUILD_FORMAT_CACHE_DEBUG
    task->thread_data.cache->cache_access_total = 0;
    task->thread_data.cache->cache_access_miss = 0;
 #endif
-#endif
+}
+
+
+static void
+rasterize_scene(struct lp_rasterizer_task *task,
+                struct lp_scene *scene)
+{
+   int64_t t0 = os_time_get_nano();
+
+   task->scene = scene;
+
+   clear_texture_cache(task);
 
    if (!task->rast->no_rast) {
       /* loop over scene bins, rasterize each */
@@ -682,7 +807,7 @@ rasterize_scene(struct lp_rasterizer_task *task,
          int i, j;
 
          assert(scene);
-         while ((bin = lp_scene_bin_iter_next(scene, &i, &j))) {
+         while ((bin = lp_scene_bin_iter_next(scene, task->group, &i, &j))) {
             if (!is_empty_bin( bin ))
                rasterize_bin(task, bin, i, j);
          }
@@ -704,11 +829,9 @@ rasterize_scene(struct lp_rasterizer_task *task,
    }
 #endif
 
-   if (scene->fence) {
-      lp_fence_signal(scene->fence);
-   }
-
    task->scene = NULL;
+
+   LP_COUNT_ADD(&task->counters, rast_time, os_time_get_nano() - t0);
 }
 
 
@@ -736,14 +859,18 @@ lp_rast_queue_scene( struct lp_rasterizer *rast,
 
       lp_rast_end( rast );
 
-      util_fpstate_set(fpstate);
+      lp_rast_signal_scene( scene );
 
-      rast->curr_scene = NULL;
+      util_fpstate_set(fpstate);
    }
    else {
       /* threaded rendering! */
       unsigned i;
 
+      mtx_lock(&rast->idle_mutex);
+      rast->scenes_in_flight++;
+      mtx_unlock(&rast->idle_mutex);
+
       lp_scene_enqueue( rast->full_scenes, scene );
 
       /* signal the threads that there's work to do */
@@ -756,20 +883,45 @@ lp_rast_queue_scene( struct lp_rasterizer *rast,
 }
 
 
+/**
+ * Run func on every rasterizer thread and wait for all of them to return.
+ * Any scenes queued earlier are rasterized first.  The caller must hold
+ * the screen's rast_mutex so no new scene gets queued meanwhile.
+ */
 void
-lp_rast_finish( struct lp_rasterizer *rast )
+lp_rast_run_on_threads( struct lp_rasterizer *rast,
+                        lp_rast_thread_func func,
+                        void *data )
 {
+   unsigned i;
+
    if (rast->num_threads == 0) {
-      /* nothing to do */
+      unsigned fpstate = util_fpstate_get();
+
+      util_fpstate_set_denorms_to_zero(fpstate);
+      clear_texture_cache(&rast->tasks[0]);
+      func(data, 0, &rast->tasks[0].thread_data);
+      util_fpstate_set(fpstate);
+      return;
    }
-   else {
-      int i;
 
-      /* wait for work to complete */
-      for (i = 0; i < rast->num_threads; i++) {
-         pipe_semaphore_wait(&rast->tasks[i].work_done);
-      }
+   mtx_lock(&rast->idle_mutex);
+   while (rast->scenes_in_flight)
+      cnd_wait(&rast->idle_cond, &rast->idle_mutex);
+   mtx_unlock(&rast->idle_mutex);
+
+   rast->thread_func = func;
+   rast->thread_func_data = data;
+
+   for (i = 0; i < rast->num_threads; i++) {
+      pipe_semaphore_signal(&rast->tasks[i].work_ready);
+   }
+   for (i = 0; i < rast->num_threads; i++) {
+      pipe_semaphore_wait(&rast->tasks[i].work_done);
    }
+
+   rast->thread_func = NULL;
+   rast->thread_func_data = NULL;
 }
 
 
@@ -778,7 +930,7 @@ lp_rast_finish( struct lp_rasterizer *rast )
  * It's a simple loop:
  *   1. wait for work
  *   2. do work
- *   3. signal that we're done
+ *   3. signal the scene's fence that we're done
  */
 static int
 thread_function(void *init_data)
@@ -799,6 +951,8 @@ thread_function(void *init_data)
    util_fpstate_set_denorms_to_zero(fpstate);
 
    while (1) {
+      struct lp_scene *scene;
+
       /* wait for work */
       if (debug)
          debug_printf("thread %d waiting for work\n", task->thread_index);
@@ -807,6 +961,14 @@ thread_function(void *init_data)
       if (rast->exit_flag)
          break;
 
+      if (rast->thread_func) {
+         clear_texture_cache(task);
+         rast->thread_func(rast->thread_func_data, task->thread_index,
+                           &task->thread_data);
+         pipe_semaphore_signal(&task->work_done);
+         continue;
+      }
+
       if (task->thread_index == 0) {
          /* thread[0]:
           *  - get next scene to rasterize
@@ -825,23 +987,30 @@ thread_function(void *init_data)
       if (debug)
          debug_printf("thread %d doing work\n", task->thread_index);
 
-      rasterize_scene(task,
-                      rast->curr_scene);
+      scene = rast->curr_scene;
+      rasterize_scene(task, scene);
       
       /* wait for all threads to finish with this scene */
       util_barrier_wait( &rast->barrier );
 
-      /* XXX: shouldn't be necessary:
+      /* thread[0]:
+       *  - unmap the framebuffer surfaces before the scene's fence can
+       *    complete, setup reuses the scene as soon as it does
        */
       if (task->thread_index == 0) {
          lp_rast_end( rast );
+
+         mtx_lock(&rast->idle_mutex);
+         if (--rast->scenes_in_flight == 0)
+            cnd_broadcast(&rast->idle_cond);
+         mtx_unlock(&rast->idle_mutex);
       }
 
       /* signal done with work */
       if (debug)
          debug_printf("thread %d done working\n", task->thread_index);
 
-      pipe_semaphore_signal(&task->work_done);
+      lp_rast_signal_scene( scene );
    }
 
 #ifdef _WIN32
@@ -866,10 +1035,36 @@ create_rast_threads(struct lp_rasterizer *rast)
       pipe_semaphore_init(&rast->tasks[i].work_done, 0);
       rast->threads[i] = u_thread_create(thread_function,
                                             (void *) &rast->tasks[i]);
+
+      if (rast->num_groups > 1) {
+         util_pin_thread_to_L3(rast->threads[i], rast->tasks[i].group,
+                               util_cpu_caps.cores_per_L3);
+      }
    }
 }
 
 
+/**
+ * Decide how many thread groups to use, see lp_rasterizer::num_groups.
+ */
+static unsigned
+choose_num_groups(unsigned num_threads)
+{
+   unsigned num_L3_caches;
+
+   if (num_threads <= 1 || !util_cpu_caps.cores_per_L3)
+      return 1;
+
+   num_L3_caches = DIV_ROUND_UP(util_cpu_caps.nr_cpus,
+                                util_cpu_caps.cores_per_L3);
+   if (num_L3_caches <= 1 ||
+       !debug_get_bool_option("LP_PIN_THREADS", TRUE))
+      return 1;
+
+   return MIN3(num_L3_caches, num_threads, LP_MAX_THREAD_GROUPS);
+}
+
+
 
 /**
  * Create new lp_rasterizer.  If num_threads is zero, don't create any
@@ -892,10 +1087,25 @@ lp_rast_create( unsigned num_threads )
       goto no_full_scenes;
    }
 
+   rast->tasks = CALLOC(MAX2(1, num_threads), sizeof *rast->tasks);
+   if (!rast->tasks) {
+      goto no_tasks;
+   }
+
+   if (num_threads > 0) {
+      rast->threads = CALLOC(num_threads, sizeof *rast->threads);
+      if (!rast->threads) {
+         goto no_threads;
+      }
+   }
+
+   rast->num_groups = choose_num_groups(num_threads);
+
    for (i = 0; i < MAX2(1, num_threads); i++) {
       struct lp_rasterizer_task *task = &rast->tasks[i];
       task->rast = rast;
       task->thread_index = i;
+      task->group = i % rast->num_groups;
       task->thread_data.cache = align_malloc(sizeof(struct lp_build_format_cache),
                                              16);
       if (!task->thread_data.cache) {
@@ -914,17 +1124,24 @@ lp_rast_create( unsigned num_threads )
       util_barrier_init( &rast->barrier, rast->num_threads );
    }
 
+   (void) mtx_init(&rast->idle_mutex, mtx_plain);
+   cnd_init(&rast->idle_cond);
+
    memset(lp_dummy_tile, 0, sizeof lp_dummy_tile);
 
    return rast;
 
 no_thread_data_cache:
-   for (i = 0; i < MAX2(1, rast->num_threads); i++) {
+   for (i = 0; i < MAX2(1, num_threads); i++) {
       if (rast->tasks[i].thread_data.cache) {
          align_free(rast->tasks[i].thread_data.cache);
       }
    }
 
+   FREE(rast->threads);
+no_threads:
+   FREE(rast->tasks);
+no_tasks:
    lp_scene_queue_destroy(rast->full_scenes);
 no_full_scenes:
    FREE(rast);
@@ -933,6 +1150,24 @@ no_rast:
 }
 
 
+/**
+ * Add the counters of all rasterizer tasks to sum.
+ *
+ * The tasks may still be running, so only the scenes the caller waited
+ * for are guaranteed to be accounted for.
+ */
+void
+lp_rast_add_counters( const struct lp_rasterizer *rast,
+                      struct lp_counters *sum )
+{
+   unsigned i;
+
+   for (i = 0; i < MAX2(1, rast->num_threads); i++) {
+      lp_counters_add(sum, &rast->tasks[i].counters);
+   }
+}
+
+
 /* Shutdown:
  */
 void lp_rast_destroy( struct lp_rasterizer *rast )
@@ -973,8 +1208,13 @@ void lp_rast_destroy( struct lp_rasterizer *rast )
       util_barrier_destroy( &rast->barrier );
    }
 
+   cnd_destroy(&rast->idle_cond);
+   mtx_destroy(&rast->idle_mutex);
+
    lp_scene_queue_destroy(rast->full_scenes);
 
+   FREE(rast->threads);
+   FREE(rast->tasks);
    FREE(rast);
 }
 
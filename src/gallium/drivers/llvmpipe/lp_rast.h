@@ -45,6 +45,7 @@
 struct lp_rasterizer;
 struct lp_scene;
 struct lp_fence;
+struct lp_counters;
 struct cmd_bin;
 
 #define FIXED_TYPE_WIDTH 64
@@ -167,7 +168,21 @@ lp_rast_queue_scene( struct lp_rasterizer *rast,
                      struct lp_scene *scene );
 
 void
-lp_rast_finish( struct lp_rasterizer *rast );
+lp_rast_add_counters( const struct lp_rasterizer *rast,
+                      struct lp_counters *sum );
+
+
+/**
+ * Function run on every rasterizer thread by lp_rast_run_on_threads().
+ */
+typedef void (*lp_rast_thread_func)(void *data,
+                                    unsigned thread_index,
+                                    struct lp_jit_thread_data *thread_data);
+
+void
+lp_rast_run_on_threads( struct lp_rasterizer *rast,
+                        lp_rast_thread_func func,
+                        void *data );
 
 
 union lp_rast_cmd_arg {
@@ -37,6 +37,7 @@
 #include "lp_state.h"
 #include "lp_texture.h"
 #include "lp_limits.h"
+#include "lp_perf.h"
 
 
 #define TILE_VECTOR_HEIGHT 4
@@ -97,9 +98,15 @@ struct lp_rasterizer_task
    /** "my" index */
    unsigned thread_index;
 
+   /** thread group (L3 cache) this thread runs on, see lp_rasterizer */
+   unsigned group;
+
    /** Non-interpolated passthru state and occlude counter for visible pixels */
    struct lp_jit_thread_data thread_data;
 
+   /** Rasterization counters, only ever written by this task's thread */
+   struct lp_counters counters;
+
    pipe_semaphore work_ready;
    pipe_semaphore work_done;
 };
@@ -122,13 +129,33 @@ struct lp_rasterizer
    struct lp_scene *curr_scene;
 
    /** A task object for each rasterization thread */
-   struct lp_rasterizer_task tasks[LP_MAX_THREADS];
+   struct lp_rasterizer_task *tasks;
 
    unsigned num_threads;
-   thrd_t threads[LP_MAX_THREADS];
+   thrd_t *threads;
+
+   /**
+    * Number of thread groups.  When the CPU has several L3 caches, the
+    * threads are pinned round-robin to them, and the scene's tiles are
+    * split into one band per group.
+    */
+   unsigned num_groups;
 
    /** For synchronizing the rasterization threads */
    util_barrier barrier;
+
+   /**
+    * Number of queued scenes not yet fully rasterized, protected by
+    * idle_mutex.  lp_rast_run_on_threads() waits for this to drop to zero
+    * so that the threads' work_ready semaphores are not ambiguous.
+    */
+   unsigned scenes_in_flight;
+   mtx_t idle_mutex;
+   cnd_t idle_cond;
+
+   /** Job for lp_rast_run_on_threads(), NULL when rasterizing scenes */
+   lp_rast_thread_func thread_func;
+   void *thread_func_data;
 };
 
 
@@ -148,7 +175,8 @@ lp_rast_get_color_block_pointer(struct lp_rasterizer_task *task,
                                 unsigned buf, unsigned x, unsigned y,
                                 unsigned layer)
 {
-   unsigned px, py, pixel_offset;
+   unsigned px, py;
+   int pixel_offset;
    uint8_t *color;
 
    assert(x < task->scene->tiles_x * TILE_SIZE);
@@ -167,8 +195,15 @@ lp_rast_get_color_block_pointer(struct lp_rasterizer_task *task,
    px = x % TILE_SIZE;
    py = y % TILE_SIZE;
 
-   pixel_offset = px * task->scene->cbufs[buf].format_bytes +
-                  py * task->scene->cbufs[buf].stride;
+   if (task->scene->cbufs[buf].tiled_stride) {
+      pixel_offset = lp_tiled_texel_offset(px, py,
+                                           task->scene->cbufs[buf].format_bytes,
+                                           0);
+   }
+   else {
+      pixel_offset = px * task->scene->cbufs[buf].format_bytes +
+                     (int) py * task->scene->cbufs[buf].stride;
+   }
    color = task->color_tiles[buf] + pixel_offset;
 
    if (layer) {
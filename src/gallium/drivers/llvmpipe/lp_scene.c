@@ -34,6 +34,7 @@
 #include "lp_scene.h"
 #include "lp_fence.h"
 #include "lp_debug.h"
+#include "lp_texture.h"
 
 
 #define RESOURCE_REF_SZ 32
@@ -175,6 +176,19 @@ lp_scene_begin_rasterization(struct lp_scene *scene)
                                                      cbuf->u.tex.first_layer,
                                                      LP_TEX_USAGE_READ_WRITE);
          scene->cbufs[i].format_bytes = util_format_get_blocksize(cbuf->format);
+         scene->cbufs[i].tiled_stride = 0;
+
+         /* The shader writes the 4x4 blocks of tiled textures, whose rows
+          * follow each other.
+          */
+         if (llvmpipe_resource_is_tiled(cbuf->texture)) {
+            STATIC_ASSERT(TILE_SIZE == LP_TILED_TILE_SIZE);
+            assert(scene->cbufs[i].format_bytes ==
+                   util_format_get_blocksize(cbuf->texture->format));
+            scene->cbufs[i].tiled_stride = scene->cbufs[i].stride;
+            scene->cbufs[i].stride = LP_TILED_BLOCK_SIZE *
+                                     scene->cbufs[i].format_bytes;
+         }
       }
       else {
          struct llvmpipe_resource *lpr = llvmpipe_resource(cbuf->texture);
@@ -184,6 +198,7 @@ lp_scene_begin_rasterization(struct lp_scene *scene)
          scene->cbufs[i].map = lpr->data;
          scene->cbufs[i].map += cbuf->u.buf.first_element * pixstride;
          scene->cbufs[i].format_bytes = util_format_get_blocksize(cbuf->format);
+         scene->cbufs[i].tiled_stride = 0;
       }
    }
 
@@ -204,12 +219,13 @@ lp_scene_begin_rasterization(struct lp_scene *scene)
 
 
 /**
- * Free all the temporary data in a scene.
+ * Unmap the framebuffer surfaces mapped by lp_scene_begin_rasterization().
+ * Called by the rasterizer once all threads are done with the scene.
  */
 void
 lp_scene_end_rasterization(struct lp_scene *scene )
 {
-   int i, j;
+   int i;
 
    /* Unmap color buffers */
    for (i = 0; i < scene->fb.nr_cbufs; i++) {
@@ -232,6 +248,21 @@ lp_scene_end_rasterization(struct lp_scene *scene )
                               zsbuf->u.tex.first_layer);
       scene->zsbuf.map = NULL;
    }
+}
+
+
+/**
+ * Free all the temporary data in a scene.
+ * Called by the setup module before reusing a scene which the rasterizer
+ * has finished with, so that setup never waits for the rasterizer just to
+ * release the scene's resources.
+ */
+void
+lp_scene_reset(struct lp_scene *scene)
+{
+   int i, j;
+
+   assert(!scene->zsbuf.map);
 
    /* Reset all command lists:
     */
@@ -294,6 +325,7 @@ lp_scene_end_rasterization(struct lp_scene *scene )
    scene->resources = NULL;
    scene->scene_size = 0;
    scene->resource_reference_size = 0;
+   scene->num_counter_queries = 0;
 
    scene->alloc_failed = FALSE;
 
@@ -429,36 +461,51 @@ lp_scene_add_resource_reference(struct lp_scene *scene,
 
 /**
  * Does this scene have a reference to the given resource?
+ * \return bitmask of LP_REFERENCED_FOR_READ/WRITE
  */
-boolean
+unsigned
 lp_scene_is_resource_referenced(const struct lp_scene *scene,
                                 const struct pipe_resource *resource)
 {
    const struct resource_ref *ref;
    int i;
 
+   /* check the render targets this scene draws into */
+   for (i = 0; i < scene->fb.nr_cbufs; i++) {
+      if (scene->fb.cbufs[i] && scene->fb.cbufs[i]->texture == resource)
+         return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
+   }
+   if (scene->fb.zsbuf && scene->fb.zsbuf->texture == resource) {
+      return LP_REFERENCED_FOR_READ | LP_REFERENCED_FOR_WRITE;
+   }
+
    for (ref = scene->resources; ref; ref = ref->next) {
       for (i = 0; i < ref->count; i++)
          if (ref->resource[i] == resource)
-            return TRUE;
+            return LP_REFERENCED_FOR_READ;
    }
 
-   return FALSE;
+   return LP_UNREFERENCED;
 }
 
 
 
 
-/** advance curr_x,y to the next bin */
+/** advance curr_x,y of the given band to the next bin */
 static boolean
-next_bin(struct lp_scene *scene)
+next_bin(struct lp_scene *scene, unsigned band)
 {
-   scene->curr_x++;
-   if (scene->curr_x >= scene->tiles_x) {
-      scene->curr_x = 0;
-      scene->curr_y++;
+   if (scene->band[band].curr_y >= scene->band[band].y_end) {
+      /* no more bins */
+      return FALSE;
+   }
+
+   scene->band[band].curr_x++;
+   if (scene->band[band].curr_x >= scene->tiles_x) {
+      scene->band[band].curr_x = 0;
+      scene->band[band].curr_y++;
    }
-   if (scene->curr_y >= scene->tiles_y) {
+   if (scene->band[band].curr_y >= scene->band[band].y_end) {
       /* no more bins */
       return FALSE;
    }
@@ -466,41 +513,55 @@ next_bin(struct lp_scene *scene)
 }
 
 
+/**
+ * Split the scene's tile rows into num_bands contiguous bands, so that
+ * each group of rasterizer threads keeps working on the same part of
+ * the framebuffer (and thus the same memory) from scene to scene.
+ */
 void
-lp_scene_bin_iter_begin( struct lp_scene *scene )
+lp_scene_bin_iter_begin( struct lp_scene *scene, unsigned num_bands )
 {
-   scene->curr_x = scene->curr_y = -1;
+   unsigned i;
+
+   num_bands = CLAMP(num_bands, 1, LP_MAX_THREAD_GROUPS);
+
+   scene->num_bands = num_bands;
+   for (i = 0; i < num_bands; i++) {
+      scene->band[i].curr_x = -1;
+      scene->band[i].curr_y = scene->tiles_y * i / num_bands;
+      scene->band[i].y_end = scene->tiles_y * (i + 1) / num_bands;
+   }
 }
 
 
 /**
  * Return pointer to next bin to be rendered.
- * The lp_scene::curr_x and ::curr_y fields will be advanced.
+ * The curr_x and curr_y fields of the band will be advanced.
  * Multiple rendering threads will call this function to get a chunk
- * of work (a bin) to work on.
+ * of work (a bin) to work on.  Bins of the thread's own band are handed
+ * out first; once it is exhausted the thread helps with the other bands.
  */
 struct cmd_bin *
-lp_scene_bin_iter_next( struct lp_scene *scene , int *x, int *y)
+lp_scene_bin_iter_next( struct lp_scene *scene, unsigned band,
+                        int *x, int *y)
 {
    struct cmd_bin *bin = NULL;
+   unsigned i;
 
    mtx_lock(&scene->mutex);
 
-   if (scene->curr_x < 0) {
-      /* first bin */
-      scene->curr_x = 0;
-      scene->curr_y = 0;
-   }
-   else if (!next_bin(scene)) {
-      /* no more bins left */
-      goto end;
-   }
+   for (i = 0; i < scene->num_bands; i++) {
+      unsigned b = (band + i) % scene->num_bands;
 
-   bin = lp_scene_get_bin(scene, scene->curr_x, scene->curr_y);
-   *x = scene->curr_x;
-   *y = scene->curr_y;
+      if (next_bin(scene, b)) {
+         bin = lp_scene_get_bin(scene, scene->band[b].curr_x,
+                                scene->band[b].curr_y);
+         *x = scene->band[b].curr_x;
+         *y = scene->band[b].curr_y;
+         break;
+      }
+   }
 
-end:
    /*printf("return bin %p at %d, %d\n", (void *) bin, *bin_x, *bin_y);*/
    mtx_unlock(&scene->mutex);
    return bin;
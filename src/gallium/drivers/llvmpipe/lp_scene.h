@@ -122,8 +122,8 @@ struct resource_ref;
  * Per-bin data goes into the 'tile' bins.
  * Shared data goes into the 'data' buffer.
  *
- * When there are multiple threads, will want to double-buffer between
- * scenes:
+ * Each setup context owns several scenes, so that new geometry can be
+ * binned into one scene while earlier ones are being rasterized.
  */
 struct lp_scene {
    struct pipe_context *pipe;
@@ -135,14 +135,24 @@ struct lp_scene {
    /* If queries were either active or there were begin/end query commands */
    boolean had_queries;
 
+   /* Driver queries reading the rasterizer counters when the scene starts
+    * (begin) or finishes (end) being rasterized.
+    */
+   struct {
+      struct llvmpipe_query *query;
+      boolean end;
+   } counter_queries[LP_MAX_ACTIVE_BINNED_QUERIES];
+   unsigned num_counter_queries;
+
    /* Framebuffer mappings - valid only between begin_rasterization()
     * and end_rasterization().
     */
    struct {
       uint8_t *map;
-      unsigned stride;
+      int stride;               /**< row stride as seen by the shader */
       unsigned layer_stride;
       unsigned format_bytes;
+      unsigned tiled_stride;    /**< stride between rows of tiles, or 0 */
    } zsbuf, cbufs[PIPE_MAX_COLOR_BUFS];
 
    /* The amount of layers in the fb (minimum of all attachments) */
@@ -172,7 +182,12 @@ struct lp_scene {
     */
    unsigned tiles_x, tiles_y;
 
-   int curr_x, curr_y;  /**< for iterating over bins */
+   /** for iterating over bins, one band of tile rows per thread group */
+   struct {
+      int curr_x, curr_y;
+      int y_end;
+   } band[LP_MAX_THREAD_GROUPS];
+   unsigned num_bands;
    mtx_t mutex;
 
    struct cmd_bin tile[TILES_X][TILES_Y];
@@ -198,8 +213,8 @@ boolean lp_scene_add_resource_reference(struct lp_scene *scene,
                                         struct pipe_resource *resource,
                                         boolean initializing_scene);
 
-boolean lp_scene_is_resource_referenced(const struct lp_scene *scene,
-                                        const struct pipe_resource *resource );
+unsigned lp_scene_is_resource_referenced(const struct lp_scene *scene,
+                                         const struct pipe_resource *resource );
 
 
 /**
@@ -378,10 +393,11 @@ lp_scene_get_num_bins( const struct lp_scene *scene )
 
 
 void
-lp_scene_bin_iter_begin( struct lp_scene *scene );
+lp_scene_bin_iter_begin( struct lp_scene *scene, unsigned num_bands );
 
 struct cmd_bin *
-lp_scene_bin_iter_next( struct lp_scene *scene, int *x, int *y );
+lp_scene_bin_iter_next( struct lp_scene *scene, unsigned band,
+                        int *x, int *y );
 
 
 
@@ -403,6 +419,9 @@ lp_scene_begin_rasterization(struct lp_scene *scene);
 void
 lp_scene_end_rasterization(struct lp_scene *scene);
 
+void
+lp_scene_reset(struct lp_scene *scene);
+
 
 
 
@@ -32,11 +32,16 @@
 #include "util/u_format.h"
 #include "util/u_screen.h"
 #include "util/u_string.h"
+#include "util/u_atomic.h"
 #include "util/u_format_s3tc.h"
+#include "util/disk_cache.h"
+#include "util/mesa-sha1.h"
 #include "pipe/p_defines.h"
 #include "pipe/p_screen.h"
 #include "draw/draw_context.h"
 #include "gallivm/lp_bld_type.h"
+#include "gallivm/lp_bld_debug.h"
+#include "gallivm/lp_bld_init.h"
 
 #include "util/os_misc.h"
 #include "util/os_time.h"
@@ -49,6 +54,10 @@
 #include "lp_public.h"
 #include "lp_limits.h"
 #include "lp_rast.h"
+#include "lp_cs_fiber.h"
+#include "lp_perf.h"
+#include "lp_query.h"
+#include "lp_state_fs.h"
 
 #include "state_tracker/sw_winsys.h"
 
@@ -82,6 +91,7 @@ static const struct debug_named_value lp_perf_flags[] = {
    { "no_blend",       PERF_NO_BLEND, NULL },
    { "no_depth",       PERF_NO_DEPTH, NULL },
    { "no_alphatest",   PERF_NO_ALPHATEST, NULL },
+   { "tiled_tex",      PERF_TILED_TEX, NULL },
    DEBUG_NAMED_VALUE_END
 };
 
@@ -214,9 +224,14 @@ llvmpipe_get_param(struct pipe_screen *screen, enum pipe_cap param)
    case PIPE_CAP_QUADS_FOLLOW_PROVOKING_VERTEX_CONVENTION:
       return 0;
    case PIPE_CAP_COMPUTE:
+#if HAVE_LLVM >= 0x0306
+      return LP_CS_HAVE_FIBERS;
+#else
       return 0;
+#endif
    case PIPE_CAP_USER_VERTEX_BUFFERS:
-      return 1;
+      /* The threaded context can't pass them through */
+      return !llvmpipe_screen(screen)->use_tc;
    case PIPE_CAP_VERTEX_BUFFER_OFFSET_4BYTE_ALIGNED_ONLY:
    case PIPE_CAP_VERTEX_BUFFER_STRIDE_4BYTE_ALIGNED_ONLY:
    case PIPE_CAP_VERTEX_ELEMENT_SRC_OFFSET_4BYTE_ALIGNED_ONLY:
@@ -324,7 +339,6 @@ llvmpipe_get_param(struct pipe_screen *screen, enum pipe_cap param)
    case PIPE_CAP_MULTI_DRAW_INDIRECT_PARAMS:
    case PIPE_CAP_TGSI_FS_POSITION_IS_SYSVAL:
    case PIPE_CAP_TGSI_FS_FACE_IS_INTEGER_SYSVAL:
-   case PIPE_CAP_SHADER_BUFFER_OFFSET_ALIGNMENT:
    case PIPE_CAP_INVALIDATE_BUFFER:
    case PIPE_CAP_GENERATE_MIPMAP:
    case PIPE_CAP_STRING_MARKER:
@@ -381,6 +395,8 @@ llvmpipe_get_param(struct pipe_screen *screen, enum pipe_cap param)
       return 32;
    case PIPE_CAP_MAX_SHADER_BUFFER_SIZE:
       return 1 << 27;
+   case PIPE_CAP_SHADER_BUFFER_OFFSET_ALIGNMENT:
+      return 4;
 
    default:
       return u_pipe_screen_get_param_defaults(screen, param);
@@ -395,7 +411,16 @@ llvmpipe_get_shader_param(struct pipe_screen *screen,
    switch(shader)
    {
    case PIPE_SHADER_FRAGMENT:
+      return gallivm_get_shader_param(param);
+   case PIPE_SHADER_COMPUTE:
+      if (!llvmpipe_get_param(screen, PIPE_CAP_COMPUTE))
+         return 0;
       switch (param) {
+      case PIPE_SHADER_CAP_MAX_SHADER_BUFFERS:
+         /* Only wired up for compute shaders so far, gallivm reports 0. */
+         return LP_MAX_TGSI_SHADER_BUFFERS;
+      case PIPE_SHADER_CAP_MAX_SHADER_IMAGES:
+         return LP_MAX_TGSI_SHADER_IMAGES;
       default:
          return gallivm_get_shader_param(param);
       }
@@ -424,6 +449,59 @@ llvmpipe_get_shader_param(struct pipe_screen *screen,
    }
 }
 
+static int
+llvmpipe_get_compute_param(struct pipe_screen *_screen,
+                           enum pipe_shader_ir ir_type,
+                           enum pipe_compute_cap param,
+                           void *ret)
+{
+   switch (param) {
+   case PIPE_COMPUTE_CAP_IR_TARGET:
+      return 0;
+   case PIPE_COMPUTE_CAP_MAX_GRID_SIZE:
+      if (ret) {
+         uint64_t *grid_size = ret;
+         grid_size[0] = 65535;
+         grid_size[1] = 65535;
+         grid_size[2] = 65535;
+      }
+      return 3 * sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_BLOCK_SIZE:
+      if (ret) {
+         uint64_t *block_size = ret;
+         block_size[0] = 1024;
+         block_size[1] = 1024;
+         block_size[2] = 1024;
+      }
+      return 3 * sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_THREADS_PER_BLOCK:
+      if (ret) {
+         uint64_t *max_threads_per_block = ret;
+         *max_threads_per_block = 1024;
+      }
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_LOCAL_SIZE:
+      if (ret) {
+         uint64_t *max_local_size = ret;
+         *max_local_size = 32768;
+      }
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_GRID_DIMENSION:
+   case PIPE_COMPUTE_CAP_MAX_GLOBAL_SIZE:
+   case PIPE_COMPUTE_CAP_MAX_PRIVATE_SIZE:
+   case PIPE_COMPUTE_CAP_MAX_INPUT_SIZE:
+   case PIPE_COMPUTE_CAP_MAX_MEM_ALLOC_SIZE:
+   case PIPE_COMPUTE_CAP_MAX_CLOCK_FREQUENCY:
+   case PIPE_COMPUTE_CAP_MAX_COMPUTE_UNITS:
+   case PIPE_COMPUTE_CAP_IMAGES_SUPPORTED:
+   case PIPE_COMPUTE_CAP_SUBGROUP_SIZE:
+   case PIPE_COMPUTE_CAP_ADDRESS_BITS:
+   case PIPE_COMPUTE_CAP_MAX_VARIABLE_THREADS_PER_BLOCK:
+      break;
+   }
+   return 0;
+}
+
 static float
 llvmpipe_get_paramf(struct pipe_screen *screen, enum pipe_capf param)
 {
@@ -592,12 +670,18 @@ llvmpipe_destroy_screen( struct pipe_screen *_screen )
    if (screen->rast)
       lp_rast_destroy(screen->rast);
 
+   if (util_queue_is_initialized(&screen->compile_queue))
+      util_queue_destroy(&screen->compile_queue);
+
    lp_jit_screen_cleanup(screen);
 
+   disk_cache_destroy(screen->disk_shader_cache);
+
    if(winsys->destroy)
       winsys->destroy(winsys);
 
    mtx_destroy(&screen->rast_mutex);
+   slab_destroy_parent(&screen->pool_transfers);
 
    FREE(screen);
 }
@@ -605,6 +689,110 @@ llvmpipe_destroy_screen( struct pipe_screen *_screen )
 
 
 
+static struct disk_cache *
+llvmpipe_get_disk_shader_cache(struct pipe_screen *_screen)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
+
+   return screen->disk_shader_cache;
+}
+
+
+/**
+ * Create the on-disk cache.  The generated code depends on the Mesa and LLVM
+ * builds, on the host CPU and on the LP_PERF and GALLIVM_PERF options, so
+ * all of these go into the cache id.
+ */
+static void
+lp_disk_cache_create(struct llvmpipe_screen *screen)
+{
+#ifdef HAVE_DLFCN_H
+   struct mesa_sha1 ctx;
+   struct util_cpu_caps cpu_caps = util_cpu_caps;
+   unsigned char sha1[20];
+   char cache_id[20 * 2 + 1];
+
+   /* Disassembly dumps are only produced when actually compiling */
+   if (gallivm_debug & GALLIVM_DEBUG_ASM)
+      return;
+
+   _mesa_sha1_init(&ctx);
+
+   if (!disk_cache_get_function_identifier(lp_disk_cache_create, &ctx) ||
+       !disk_cache_get_function_identifier(LLVMLinkInMCJIT, &ctx))
+      return;
+
+   /* Ignore the fields which don't affect code generation */
+   cpu_caps.nr_cpus = 0;
+   cpu_caps.cores_per_L3 = 0;
+   _mesa_sha1_update(&ctx, &cpu_caps, sizeof cpu_caps);
+   _mesa_sha1_update(&ctx, &lp_native_vector_width,
+                     sizeof lp_native_vector_width);
+
+   /* Some of these aren't part of the variant keys, e.g. PERF_NO_TEX.  The
+    * LP_DEBUG and GALLIVM_DEBUG flags only dump the code, and gallivm_perf
+    * is hashed by disk_cache_create().
+    */
+   _mesa_sha1_update(&ctx, &LP_PERF, sizeof LP_PERF);
+
+   _mesa_sha1_final(&ctx, sha1);
+   disk_cache_format_hex_id(cache_id, sha1, 20 * 2);
+
+   screen->disk_shader_cache = disk_cache_create("llvmpipe", cache_id,
+                                                 gallivm_perf);
+#endif
+}
+
+
+/**
+ * Look up the object code for a variant.  On a hit, cache->data is filled
+ * in and the caller must free() it.
+ */
+void
+lp_disk_cache_find_shader(struct llvmpipe_screen *screen,
+                          struct lp_cached_code *cache,
+                          const unsigned char ir_sha1_cache_key[20])
+{
+   unsigned char sha1[CACHE_KEY_SIZE];
+
+   if (!screen->disk_shader_cache)
+      return;
+
+   disk_cache_compute_key(screen->disk_shader_cache, ir_sha1_cache_key,
+                          20, sha1);
+
+   cache->data = disk_cache_get(screen->disk_shader_cache, sha1,
+                                &cache->data_size);
+   if (cache->data) {
+      p_atomic_inc(&screen->counters.nr_disk_cache_hits);
+   }
+   else {
+      cache->data_size = 0;
+      p_atomic_inc(&screen->counters.nr_disk_cache_misses);
+   }
+}
+
+
+/**
+ * Store freshly generated object code for a variant.
+ */
+void
+lp_disk_cache_insert_shader(struct llvmpipe_screen *screen,
+                            struct lp_cached_code *cache,
+                            const unsigned char ir_sha1_cache_key[20])
+{
+   unsigned char sha1[CACHE_KEY_SIZE];
+
+   if (!screen->disk_shader_cache || !cache->data_size || cache->dont_cache)
+      return;
+
+   disk_cache_compute_key(screen->disk_shader_cache, ir_sha1_cache_key,
+                          20, sha1);
+   disk_cache_put(screen->disk_shader_cache, sha1, cache->data,
+                  cache->data_size, NULL);
+}
+
+
 /**
  * Fence reference counting.
  */
@@ -631,6 +819,26 @@ llvmpipe_fence_finish(struct pipe_screen *screen,
 {
    struct lp_fence *f = (struct lp_fence *) fence_handle;
 
+   if (!util_queue_fence_is_signalled(&f->ready)) {
+      /* A deferred flush of the threaded context, make sure it gets to the
+       * driver thread if we're in the thread of the context which made it.
+       */
+      if (ctx)
+         threaded_context_flush(ctx, f->tc_token, timeout == 0);
+
+      if (!timeout)
+         return FALSE;
+
+      util_queue_fence_wait(&f->ready);
+   }
+
+   if (f->tc_token) {
+      /* No scene was flushed */
+      if (!f->flushed)
+         return TRUE;
+      f = f->flushed;
+   }
+
    if (!timeout)
       return lp_fence_signalled(f);
 
@@ -644,6 +852,20 @@ llvmpipe_get_timestamp(struct pipe_screen *_screen)
    return os_time_get_nano();
 }
 
+
+static boolean
+llvmpipe_is_parallel_shader_compilation_finished(struct pipe_screen *screen,
+                                                 void *shader,
+                                                 enum pipe_shader_type shader_type)
+{
+   /* Only fragment shaders are compiled in the background */
+   if (shader_type == PIPE_SHADER_FRAGMENT) {
+      struct lp_fragment_shader *fs = shader;
+      return util_queue_fence_is_signalled(&fs->precompile_fence);
+   }
+   return TRUE;
+}
+
 /**
  * Create a new pipe_screen object
  * Note: we're not presently subclassing pipe_screen (no llvmpipe_screen).
@@ -680,6 +902,7 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->base.get_param = llvmpipe_get_param;
    screen->base.get_shader_param = llvmpipe_get_shader_param;
    screen->base.get_paramf = llvmpipe_get_paramf;
+   screen->base.get_compute_param = llvmpipe_get_compute_param;
    screen->base.is_format_supported = llvmpipe_is_format_supported;
 
    screen->base.context_create = llvmpipe_create_context;
@@ -688,6 +911,12 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->base.fence_finish = llvmpipe_fence_finish;
 
    screen->base.get_timestamp = llvmpipe_get_timestamp;
+   screen->base.get_driver_query_info = llvmpipe_get_driver_query_info;
+   screen->base.get_driver_query_group_info =
+      llvmpipe_get_driver_query_group_info;
+   screen->base.get_disk_shader_cache = llvmpipe_get_disk_shader_cache;
+   screen->base.is_parallel_shader_compilation_finished =
+      llvmpipe_is_parallel_shader_compilation_finished;
 
    llvmpipe_init_screen_resource_funcs(&screen->base);
 
@@ -696,7 +925,6 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->num_threads = 0;
 #endif
    screen->num_threads = debug_get_num_option("LP_NUM_THREADS", screen->num_threads);
-   screen->num_threads = MIN2(screen->num_threads, LP_MAX_THREADS);
 
    screen->rast = lp_rast_create(screen->num_threads);
    if (!screen->rast) {
@@ -706,5 +934,26 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    }
    (void) mtx_init(&screen->rast_mutex, mtx_plain);
 
+   /* The threaded context is on by default for drivers supporting it, but
+    * llvmpipe already bins and rasterizes in other threads, so only use it
+    * on request.
+    */
+   screen->use_tc = debug_get_bool_option("GALLIUM_THREAD", FALSE);
+   slab_create_parent(&screen->pool_transfers,
+                      sizeof(struct llvmpipe_transfer), 16);
+
+   lp_disk_cache_create(screen);
+
+   /* Compile fragment shaders in the background while the application links
+    * its other programs.  The threaded context creates shaders in the
+    * application thread, where the bound state can't be read to guess the
+    * variant key, and the embedded build shares one LLVM context.
+    */
+   if (screen->num_threads && !screen->use_tc) {
+      util_queue_init(&screen->compile_queue, "lpcompile", 64,
+                      MIN2(screen->num_threads, LP_MAX_COMPILE_THREADS),
+                      UTIL_QUEUE_INIT_RESIZE_IF_FULL);
+   }
+
    return &screen->base;
 }
@@ -37,10 +37,15 @@
 #include "pipe/p_screen.h"
 #include "pipe/p_defines.h"
 #include "os/os_thread.h"
+#include "util/slab.h"
+#include "util/u_queue.h"
 #include "gallivm/lp_bld.h"
+#include "lp_perf.h"
 
 
 struct sw_winsys;
+struct disk_cache;
+struct lp_cached_code;
 
 
 struct llvmpipe_screen
@@ -57,6 +62,19 @@ struct llvmpipe_screen
 
    struct lp_rasterizer *rast;
    mtx_t rast_mutex;
+
+   /** Wrap contexts in a threaded context when the state tracker asks */
+   boolean use_tc;
+   struct slab_parent_pool pool_transfers;
+
+   /** On-disk cache of JIT'ed variant objects, may be NULL */
+   struct disk_cache *disk_shader_cache;
+
+   /** Disk cache counters, shared by all contexts, updated atomically */
+   struct lp_counters counters;
+
+   /** Background fragment shader compiles, if there are threads for them */
+   struct util_queue compile_queue;
 };
 
 
@@ -68,6 +86,15 @@ llvmpipe_screen( struct pipe_screen *pipe )
    return (struct llvmpipe_screen *)pipe;
 }
 
+void
+lp_disk_cache_find_shader(struct llvmpipe_screen *screen,
+                          struct lp_cached_code *cache,
+                          const unsigned char ir_sha1_cache_key[20]);
+
+void
+lp_disk_cache_insert_shader(struct llvmpipe_screen *screen,
+                            struct lp_cached_code *cache,
+                            const unsigned char ir_sha1_cache_key[20]);
 
 
 #endif /* LP_SCREEN_H */
@@ -29,6 +29,7 @@
 
 #include "pipe/p_compiler.h"
 #include "lp_jit.h"
+#include "lp_rast.h"
 
 struct draw_context;
 struct vertex_info;
@@ -125,6 +126,10 @@ lp_setup_set_viewports(struct lp_setup_context *setup,
                        unsigned num_viewports,
                        const struct pipe_viewport_state *viewports);
 
+void
+lp_setup_fill_jit_texture(struct lp_jit_texture *jit_tex,
+                          const struct pipe_sampler_view *view);
+
 void
 lp_setup_set_fragment_sampler_views(struct lp_setup_context *setup,
                                     unsigned num,
@@ -159,6 +164,16 @@ void
 lp_setup_end_query(struct lp_setup_context *setup,
                    struct llvmpipe_query *pq);
 
+void
+lp_setup_sample_counters(struct lp_setup_context *setup,
+                         struct llvmpipe_query *pq,
+                         boolean end);
+
+void
+lp_setup_run_on_threads(struct lp_setup_context *setup,
+                        lp_rast_thread_func func,
+                        void *data);
+
 static inline unsigned
 lp_clamp_viewport_idx(int idx)
 {
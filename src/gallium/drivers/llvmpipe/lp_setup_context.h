@@ -54,9 +54,11 @@
 struct lp_setup_variant;
 
 
-/** Max number of scenes */
-/* XXX: make multiple scenes per context work, see lp_setup_rasterize_scene */
-#define MAX_SCENES 1
+/**
+ * Max number of scenes per context.  Scenes are created on demand, so that
+ * binning of a new scene can proceed while earlier ones are rasterized.
+ */
+#define MAX_SCENES 4
 
 
 
@@ -74,6 +76,7 @@ struct lp_setup_context
    struct vbuf_render base;
 
    struct pipe_context *pipe;
+   struct lp_counters *counters;   /**< the llvmpipe_context's */
    struct vertex_info *vertex_info;
    uint prim;
    uint vertex_size;
@@ -87,7 +90,7 @@ struct lp_setup_context
     */
    struct draw_stage *vbuf;
    unsigned num_threads;
-   unsigned scene_idx;
+   unsigned num_scenes;
    struct lp_scene *scenes[MAX_SCENES];  /**< all the scenes */
    struct lp_scene *scene;               /**< current scene being built */
 
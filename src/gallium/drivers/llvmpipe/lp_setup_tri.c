@@ -218,7 +218,7 @@ lp_setup_whole_tile(struct lp_setup_context *setup,
 {
    struct lp_scene *scene = setup->scene;
 
-   LP_COUNT(nr_fully_covered_64);
+   LP_COUNT(setup->counters, nr_fully_covered_64);
 
    /* if variant is opaque and scissor doesn't effect the tile */
    if (inputs->opaque) {
@@ -241,13 +241,13 @@ lp_setup_whole_tile(struct lp_setup_context *setup,
          lp_scene_bin_reset( scene, tx, ty );
       }
 
-      LP_COUNT(nr_shade_opaque_64);
+      LP_COUNT(setup->counters, nr_shade_opaque_64);
       return lp_scene_bin_cmd_with_state( scene, tx, ty,
                                           setup->fs.stored,
                                           LP_RAST_OP_SHADE_TILE_OPAQUE,
                                           lp_rast_arg_inputs(inputs) );
    } else {
-      LP_COUNT(nr_shade_64);
+      LP_COUNT(setup->counters, nr_shade_64);
       return lp_scene_bin_cmd_with_state( scene, tx, ty,
                                           setup->fs.stored, 
                                           LP_RAST_OP_SHADE_TILE,
@@ -324,13 +324,13 @@ do_triangle_ccw(struct lp_setup_context *setup,
    if (bbox.x1 < bbox.x0 ||
        bbox.y1 < bbox.y0) {
       if (0) debug_printf("empty bounding box\n");
-      LP_COUNT(nr_culled_tris);
+      LP_COUNT(setup->counters, nr_culled_tris);
       return TRUE;
    }
 
    if (!u_rect_test_intersection(&setup->draw_regions[viewport_index], &bbox)) {
       if (0) debug_printf("offscreen\n");
-      LP_COUNT(nr_culled_tris);
+      LP_COUNT(setup->counters, nr_culled_tris);
       return TRUE;
    }
 
@@ -371,7 +371,7 @@ do_triangle_ccw(struct lp_setup_context *setup,
    tri->v[2][1] = v2[0][1];
 #endif
 
-   LP_COUNT(nr_tris);
+   LP_COUNT(setup->counters, nr_tris);
 
    /* Setup parameter interpolants:
     */
@@ -925,7 +925,7 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
                /* do nothing */
                if (in)
                   break;  /* exiting triangle, all done with this row */
-               LP_COUNT(nr_empty_64);
+               LP_COUNT(setup->counters, nr_empty_64);
             }
             else if (partial) {
                /* Not trivially accepted by at least one plane -
@@ -942,11 +942,11 @@ lp_setup_bin_triangle(struct lp_setup_context *setup,
                                                  lp_rast_arg_triangle(tri, partial) ))
                   goto fail;
 
-               LP_COUNT(nr_partially_covered_64);
+               LP_COUNT(setup->counters, nr_partially_covered_64);
             }
             else {
                /* triangle covers the whole tile- shade whole tile */
-               LP_COUNT(nr_fully_covered_64);
+               LP_COUNT(setup->counters, nr_fully_covered_64);
                in = TRUE;
                if (!lp_setup_whole_tile(setup, &tri->inputs, x, y))
                   goto fail;
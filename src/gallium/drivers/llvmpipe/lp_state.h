@@ -120,6 +120,9 @@ llvmpipe_init_vs_funcs(struct llvmpipe_context *llvmpipe);
 void
 llvmpipe_init_gs_funcs(struct llvmpipe_context *llvmpipe);
 
+void
+llvmpipe_init_cs_funcs(struct llvmpipe_context *llvmpipe);
+
 void
 llvmpipe_init_rasterizer_funcs(struct llvmpipe_context *llvmpipe);
 
@@ -0,0 +1,1071 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE COPYRIGHT HOLDERS, AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Compute shader state and dispatch.
+ *
+ * The compute shader is JIT compiled into a function which runs one SIMD
+ * vector worth of invocations of a block.  Blocks are handed out to the
+ * rasterizer threads through an atomic counter.  Shaders with barriers run
+ * each vector of a block on its own fiber, see lp_cs_fiber.c.
+ */
+
+#include "pipe/p_defines.h"
+#include "util/u_atomic.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_pointer.h"
+#include "util/u_format.h"
+#include "util/u_string.h"
+#include "util/simple_list.h"
+#include "util/os_time.h"
+#include "util/mesa-sha1.h"
+#include "pipe/p_shader_tokens.h"
+#include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_parse.h"
+#include "gallivm/lp_bld_type.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_logic.h"
+#include "gallivm/lp_bld_tgsi.h"
+#include "gallivm/lp_bld_flow.h"
+#include "gallivm/lp_bld_debug.h"
+#include "gallivm/lp_bld_intr.h"
+#include "state_tracker/sw_winsys.h"
+
+#include "lp_context.h"
+#include "lp_cs_fiber.h"
+#include "lp_debug.h"
+#include "lp_flush.h"
+#include "lp_perf.h"
+#include "lp_screen.h"
+#include "lp_setup.h"
+#include "lp_state.h"
+#include "lp_state_cs.h"
+#include "lp_tex_sample.h"
+#include "lp_texture.h"
+
+
+/** counter for compute shader numbers (for debugging) */
+static unsigned cs_no = 0;
+
+
+/**
+ * Barrier interface handed to the TGSI translator.
+ */
+struct lp_cs_barrier_iface
+{
+   struct lp_build_tgsi_cs_iface base;
+
+   LLVMValueRef fiber_ptr;
+};
+
+
+/**
+ * Emit a call to lp_cs_barrier(), which yields to the fiber scheduler.
+ */
+static void
+cs_emit_barrier(const struct lp_build_tgsi_cs_iface *base,
+                struct lp_build_tgsi_context *bld_base)
+{
+   const struct lp_cs_barrier_iface *iface =
+      (const struct lp_cs_barrier_iface *)base;
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMTypeRef arg_types[1];
+   LLVMValueRef function;
+   LLVMValueRef args[1];
+
+   arg_types[0] = LLVMPointerType(LLVMInt8TypeInContext(gallivm->context), 0);
+
+   function = lp_build_const_func_pointer(gallivm,
+                                          func_to_pointer((func_pointer)lp_cs_barrier),
+                                          LLVMVoidTypeInContext(gallivm->context),
+                                          arg_types, ARRAY_SIZE(arg_types),
+                                          "lp_cs_barrier");
+
+   args[0] = iface->fiber_ptr;
+   LLVMBuildCall(gallivm->builder, function, args, ARRAY_SIZE(args), "");
+}
+
+
+/**
+ * Generate the function which runs one vector of invocations of a block.
+ */
+static void
+generate_compute(struct llvmpipe_context *lp,
+                 struct lp_compute_shader *shader,
+                 struct lp_compute_shader_variant *variant)
+{
+   struct gallivm_state *gallivm = variant->gallivm;
+   const struct lp_compute_shader_variant_key *key = &variant->key;
+   struct lp_type cs_type;
+   struct lp_build_context uint_bld;
+   LLVMTypeRef arg_types[11];
+   LLVMTypeRef func_type;
+   LLVMTypeRef int32_type = LLVMInt32TypeInContext(gallivm->context);
+   LLVMTypeRef int8_ptr_type =
+      LLVMPointerType(LLVMInt8TypeInContext(gallivm->context), 0);
+   LLVMValueRef function;
+   LLVMValueRef context_ptr;
+   LLVMValueRef block_id[3];
+   LLVMValueRef grid_size[3];
+   LLVMValueRef first_invocation;
+   LLVMValueRef shared_ptr;
+   LLVMValueRef thread_data_ptr;
+   LLVMValueRef fiber_ptr;
+   LLVMValueRef lanes[LP_MAX_VECTOR_LENGTH];
+   LLVMValueRef invocation;
+   LLVMValueRef tmp;
+   LLVMValueRef outputs[PIPE_MAX_SHADER_OUTPUTS][TGSI_NUM_CHANNELS];
+   LLVMBasicBlockRef block;
+   LLVMBuilderRef builder;
+   struct lp_build_sampler_soa *sampler;
+   struct lp_build_image_soa *image;
+   struct lp_bld_tgsi_system_values system_values;
+   struct lp_cs_barrier_iface barrier;
+   struct lp_build_mask_context mask;
+   unsigned block_size = shader->block_size[0] *
+                         shader->block_size[1] *
+                         shader->block_size[2];
+   unsigned i;
+
+   memset(&cs_type, 0, sizeof cs_type);
+   cs_type.floating = TRUE;      /* floating point values */
+   cs_type.sign = TRUE;          /* values are signed */
+   cs_type.norm = FALSE;         /* values are not limited to [0,1] or [-1,1] */
+   cs_type.width = 32;           /* 32-bit float */
+   cs_type.length = MIN2(lp_native_vector_width / 32, 16); /* n*4 elements per vector */
+
+   /*
+    * Generate the function prototype. Any change here must be reflected in
+    * lp_jit.h's lp_jit_cs_func function pointer type, and vice-versa.
+    */
+
+   arg_types[0] = variant->jit_cs_context_ptr_type;    /* context */
+   arg_types[1] = int32_type;                          /* block_id_x */
+   arg_types[2] = int32_type;                          /* block_id_y */
+   arg_types[3] = int32_type;                          /* block_id_z */
+   arg_types[4] = int32_type;                          /* grid_size_x */
+   arg_types[5] = int32_type;                          /* grid_size_y */
+   arg_types[6] = int32_type;                          /* grid_size_z */
+   arg_types[7] = int32_type;                          /* first_invocation */
+   arg_types[8] = int8_ptr_type;                       /* shared_mem */
+   arg_types[9] = variant->jit_thread_data_ptr_type;   /* per thread data */
+   arg_types[10] = int8_ptr_type;                      /* fiber */
+
+   func_type = LLVMFunctionType(LLVMVoidTypeInContext(gallivm->context),
+                                arg_types, ARRAY_SIZE(arg_types), 0);
+
+   /* The name must not depend on the shader/variant numbering, as it is
+    * how the function is looked up in objects from the disk cache.
+    */
+   function = LLVMAddFunction(gallivm->module, "cs_variant", func_type);
+   LLVMSetFunctionCallConv(function, LLVMCCallConv);
+
+   variant->function = function;
+
+   context_ptr = LLVMGetParam(function, 0);
+   for (i = 0; i < 3; i++) {
+      block_id[i] = LLVMGetParam(function, 1 + i);
+      grid_size[i] = LLVMGetParam(function, 4 + i);
+   }
+   first_invocation = LLVMGetParam(function, 7);
+   shared_ptr = LLVMGetParam(function, 8);
+   thread_data_ptr = LLVMGetParam(function, 9);
+   fiber_ptr = LLVMGetParam(function, 10);
+
+   lp_build_name(context_ptr, "context");
+   lp_build_name(block_id[0], "block_id_x");
+   lp_build_name(block_id[1], "block_id_y");
+   lp_build_name(block_id[2], "block_id_z");
+   lp_build_name(grid_size[0], "grid_size_x");
+   lp_build_name(grid_size[1], "grid_size_y");
+   lp_build_name(grid_size[2], "grid_size_z");
+   lp_build_name(first_invocation, "first_invocation");
+   lp_build_name(shared_ptr, "shared_mem");
+   lp_build_name(thread_data_ptr, "thread_data");
+   lp_build_name(fiber_ptr, "fiber");
+
+   /*
+    * Function body
+    */
+
+   block = LLVMAppendBasicBlockInContext(gallivm->context, function, "entry");
+   builder = gallivm->builder;
+   assert(builder);
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   lp_build_context_init(&uint_bld, gallivm, lp_uint_type(cs_type));
+
+   /* Linear index of each invocation within the block */
+   for (i = 0; i < cs_type.length; i++)
+      lanes[i] = lp_build_const_int32(gallivm, i);
+   invocation = lp_build_broadcast_scalar(&uint_bld, first_invocation);
+   invocation = LLVMBuildAdd(builder, invocation,
+                             LLVMConstVector(lanes, cs_type.length),
+                             "invocation");
+
+   memset(&system_values, 0, sizeof system_values);
+
+   tmp = lp_build_const_int_vec(gallivm, uint_bld.type,
+                                shader->block_size[0]);
+   system_values.thread_id[0] = LLVMBuildURem(builder, invocation, tmp, "");
+   tmp = LLVMBuildUDiv(builder, invocation, tmp, "");
+   system_values.thread_id[1] =
+      LLVMBuildURem(builder, tmp,
+                    lp_build_const_int_vec(gallivm, uint_bld.type,
+                                           shader->block_size[1]), "");
+   system_values.thread_id[2] =
+      LLVMBuildUDiv(builder, invocation,
+                    lp_build_const_int_vec(gallivm, uint_bld.type,
+                                           shader->block_size[0] *
+                                           shader->block_size[1]), "");
+
+   for (i = 0; i < 3; i++) {
+      system_values.block_id[i] = block_id[i];
+      system_values.grid_size[i] = grid_size[i];
+      system_values.block_size[i] =
+         lp_build_const_int32(gallivm, shader->block_size[i]);
+   }
+
+   /* The last vector of the block may be partially outside of it */
+   lp_build_mask_begin(&mask, gallivm, cs_type,
+                       lp_build_cmp(&uint_bld, PIPE_FUNC_LESS, invocation,
+                                    lp_build_const_int_vec(gallivm,
+                                                           uint_bld.type,
+                                                           block_size)));
+
+   /* code generated texture sampling and image access */
+   sampler = lp_llvm_cs_sampler_soa_create(key->state);
+   image = lp_llvm_image_soa_create(key->image_state);
+
+   memset(&barrier, 0, sizeof barrier);
+   barrier.base.shared_size = shader->req_local_mem;
+   barrier.base.emit_barrier = cs_emit_barrier;
+   barrier.fiber_ptr = fiber_ptr;
+
+   memset(outputs, 0, sizeof outputs);
+
+   lp_build_tgsi_soa(gallivm, shader->base.tokens, cs_type, &mask,
+                     lp_jit_cs_context_constants(gallivm, context_ptr),
+                     lp_jit_cs_context_num_constants(gallivm, context_ptr),
+                     &system_values,
+                     NULL, outputs,
+                     context_ptr, thread_data_ptr,
+                     sampler, image,
+                     lp_jit_cs_context_ssbos(gallivm, context_ptr),
+                     lp_jit_cs_context_num_ssbos(gallivm, context_ptr),
+                     shared_ptr,
+                     &shader->info.base, NULL, &barrier.base);
+
+   lp_build_mask_end(&mask);
+
+   sampler->destroy(sampler);
+   image->destroy(image);
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, function);
+}
+
+
+/**
+ * Hash the shader tokens, the shared memory size and the variant key, which
+ * together fully determine the generated code.
+ */
+static void
+lp_cs_get_ir_cache_key(const struct lp_compute_shader_variant *variant,
+                       unsigned char ir_cache_key[20])
+{
+   const struct lp_compute_shader *shader = variant->shader;
+   struct mesa_sha1 ctx;
+
+   _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, &variant->key, shader->variant_key_size);
+   _mesa_sha1_update(&ctx, shader->base.tokens,
+                     tgsi_num_tokens(shader->base.tokens) *
+                     sizeof(struct tgsi_token));
+   _mesa_sha1_update(&ctx, &shader->req_local_mem,
+                     sizeof shader->req_local_mem);
+   _mesa_sha1_final(&ctx, ir_cache_key);
+}
+
+
+/**
+ * Generate a new compute shader variant from the shader code and
+ * the static sampler/image state indicated by the key.
+ */
+static struct lp_compute_shader_variant *
+generate_variant(struct llvmpipe_context *lp,
+                 struct lp_compute_shader *shader,
+                 const struct lp_compute_shader_variant_key *key)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
+   struct lp_compute_shader_variant *variant;
+   char module_name[64];
+   unsigned char ir_sha1_cache_key[20];
+   struct lp_cached_code cached = { 0 };
+   bool needs_caching = false;
+
+   variant = CALLOC_STRUCT(lp_compute_shader_variant);
+   if (!variant)
+      return NULL;
+
+   variant->shader = shader;
+   memcpy(&variant->key, key, shader->variant_key_size);
+
+   if (screen->disk_shader_cache) {
+      lp_cs_get_ir_cache_key(variant, ir_sha1_cache_key);
+      lp_disk_cache_find_shader(screen, &cached, ir_sha1_cache_key);
+      if (!cached.data_size)
+         needs_caching = true;
+   }
+
+   util_snprintf(module_name, sizeof(module_name), "cs%u_variant%u",
+                 shader->no, shader->variants_created);
+
+   variant->gallivm = gallivm_create(module_name, lp->context, &cached);
+   if (!variant->gallivm) {
+      free(cached.data);
+      FREE(variant);
+      return NULL;
+   }
+
+   variant->list_item_global.base = variant;
+   variant->list_item_local.base = variant;
+   variant->no = shader->variants_created++;
+
+   lp_jit_init_cs_types(variant);
+
+   generate_compute(lp, shader, variant);
+
+   gallivm_compile_module(variant->gallivm);
+
+   variant->nr_instrs += lp_build_count_ir_module(variant->gallivm->module);
+
+   variant->jit_function = (lp_jit_cs_func)
+      gallivm_jit_function(variant->gallivm, variant->function);
+
+   if (needs_caching) {
+      lp_disk_cache_insert_shader(screen, &cached, ir_sha1_cache_key);
+   }
+
+   gallivm_free_ir(variant->gallivm);
+   free(cached.data);
+
+   return variant;
+}
+
+
+static void
+remove_cs_variant(struct llvmpipe_context *lp,
+                  struct lp_compute_shader_variant *variant)
+{
+   gallivm_destroy(variant->gallivm);
+
+   /* remove from shader's list */
+   remove_from_list(&variant->list_item_local);
+   variant->shader->variants_cached--;
+
+   /* remove from context's list */
+   remove_from_list(&variant->list_item_global);
+   lp->nr_cs_variants--;
+   lp->nr_cs_instrs -= variant->nr_instrs;
+
+   FREE(variant);
+}
+
+
+static void
+make_variant_key(struct llvmpipe_context *lp,
+                 struct lp_compute_shader *shader,
+                 struct lp_compute_shader_variant_key *key)
+{
+   const struct tgsi_shader_info *info = &shader->info.base;
+   unsigned i;
+
+   memset(key, 0, shader->variant_key_size);
+
+   key->nr_samplers = info->file_max[TGSI_FILE_SAMPLER] + 1;
+   for (i = 0; i < key->nr_samplers; ++i) {
+      if (info->file_mask[TGSI_FILE_SAMPLER] & (1 << i)) {
+         lp_sampler_static_sampler_state(&key->state[i].sampler_state,
+                                         lp->samplers[PIPE_SHADER_COMPUTE][i]);
+      }
+   }
+
+   if (info->file_max[TGSI_FILE_SAMPLER_VIEW] != -1) {
+      key->nr_sampler_views = info->file_max[TGSI_FILE_SAMPLER_VIEW] + 1;
+      for (i = 0; i < key->nr_sampler_views; ++i) {
+         if (info->file_mask[TGSI_FILE_SAMPLER_VIEW] & (1u << (i & 31))) {
+            llvmpipe_sampler_static_texture_state(&key->state[i].texture_state,
+                                                  lp->sampler_views[PIPE_SHADER_COMPUTE][i]);
+         }
+      }
+   }
+   else {
+      key->nr_sampler_views = key->nr_samplers;
+      for (i = 0; i < key->nr_sampler_views; ++i) {
+         if (info->file_mask[TGSI_FILE_SAMPLER] & (1 << i)) {
+            llvmpipe_sampler_static_texture_state(&key->state[i].texture_state,
+                                                  lp->sampler_views[PIPE_SHADER_COMPUTE][i]);
+         }
+      }
+   }
+
+   key->nr_images = info->file_max[TGSI_FILE_IMAGE] + 1;
+   for (i = 0; i < key->nr_images; ++i) {
+      const struct pipe_image_view *view = &lp->images[PIPE_SHADER_COMPUTE][i];
+      struct lp_static_texture_state *state = &key->image_state[i].image_state;
+      const struct pipe_resource *res = view->resource;
+
+      if (!res)
+         continue;
+
+      state->format = view->format;
+      state->swizzle_r = PIPE_SWIZZLE_X;
+      state->swizzle_g = PIPE_SWIZZLE_Y;
+      state->swizzle_b = PIPE_SWIZZLE_Z;
+      state->swizzle_a = PIPE_SWIZZLE_W;
+      state->target = res->target;
+      state->pot_width = util_is_power_of_two_or_zero(res->width0);
+      state->pot_height = util_is_power_of_two_or_zero(res->height0);
+      state->pot_depth = util_is_power_of_two_or_zero(res->depth0);
+      state->level_zero_only = TRUE;
+      state->tiled = llvmpipe_resource_is_tiled(res);
+   }
+}
+
+
+/**
+ * Find or generate the variant of the bound compute shader matching the
+ * current sampler and image state.
+ */
+static struct lp_compute_shader_variant *
+update_cs_variant(struct llvmpipe_context *lp)
+{
+   struct lp_compute_shader *shader = lp->cs;
+   struct lp_compute_shader_variant_key key;
+   struct lp_compute_shader_variant *variant = NULL;
+   struct lp_cs_variant_list_item *li;
+
+   make_variant_key(lp, shader, &key);
+
+   /* Search the variants for one which matches the key */
+   li = first_elem(&shader->variants);
+   while (!at_end(&shader->variants, li)) {
+      if (memcmp(&li->base->key, &key, shader->variant_key_size) == 0) {
+         variant = li->base;
+         break;
+      }
+      li = next_elem(li);
+   }
+
+   if (variant) {
+      move_to_head(&lp->cs_variants_list, &variant->list_item_global);
+   }
+   else {
+      int64_t t0, t1;
+
+      /*
+       * Evict the least recently used variants when we have too many.
+       * Nothing is in flight here since compute dispatch is synchronous.
+       */
+      while (lp->nr_cs_variants >= LP_MAX_SHADER_VARIANTS ||
+             lp->nr_cs_instrs >= LP_MAX_SHADER_INSTRUCTIONS) {
+         if (is_empty_list(&lp->cs_variants_list))
+            break;
+         remove_cs_variant(lp, last_elem(&lp->cs_variants_list)->base);
+      }
+
+      t0 = os_time_get();
+      variant = generate_variant(lp, shader, &key);
+      t1 = os_time_get();
+      LP_COUNT_ADD(&lp->counters, llvm_compile_time, t1 - t0);
+      LP_COUNT_ADD(&lp->counters, nr_llvm_compiles, 1);
+
+      if (variant) {
+         insert_at_head(&shader->variants, &variant->list_item_local);
+         insert_at_head(&lp->cs_variants_list, &variant->list_item_global);
+         lp->nr_cs_variants++;
+         lp->nr_cs_instrs += variant->nr_instrs;
+         shader->variants_cached++;
+      }
+   }
+
+   return variant;
+}
+
+
+static void *
+llvmpipe_create_compute_state(struct pipe_context *pipe,
+                              const struct pipe_compute_state *templ)
+{
+   struct lp_compute_shader *shader;
+   const struct tgsi_token *tokens;
+   int nr_samplers, nr_sampler_views;
+   unsigned i;
+
+   if (templ->ir_type != PIPE_SHADER_IR_TGSI)
+      return NULL;
+
+   tokens = templ->prog;
+
+   shader = CALLOC_STRUCT(lp_compute_shader);
+   if (!shader)
+      return NULL;
+
+   shader->no = cs_no++;
+   make_empty_list(&shader->variants);
+
+   shader->base.tokens = tgsi_dup_tokens(tokens);
+   if (!shader->base.tokens) {
+      FREE(shader);
+      return NULL;
+   }
+
+   lp_build_tgsi_info(shader->base.tokens, &shader->info);
+
+   for (i = 0; i < 3; i++) {
+      shader->block_size[i] = MAX2(1, shader->info.base.properties[
+                                      TGSI_PROPERTY_CS_FIXED_BLOCK_WIDTH + i]);
+   }
+   shader->req_local_mem = templ->req_local_mem;
+
+   nr_samplers = shader->info.base.file_max[TGSI_FILE_SAMPLER] + 1;
+   nr_sampler_views = shader->info.base.file_max[TGSI_FILE_SAMPLER_VIEW] + 1;
+
+   shader->variant_key_size = Offset(struct lp_compute_shader_variant_key,
+                                     state[MAX2(nr_samplers, nr_sampler_views)]);
+
+   if (LP_DEBUG & DEBUG_TGSI) {
+      debug_printf("llvmpipe: Create compute shader #%u %p:\n",
+                   shader->no, (void *) shader);
+      tgsi_dump(shader->base.tokens, 0);
+   }
+
+   return shader;
+}
+
+
+static void
+llvmpipe_bind_compute_state(struct pipe_context *pipe, void *cs)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+
+   llvmpipe->cs = (struct lp_compute_shader *) cs;
+}
+
+
+static void
+llvmpipe_delete_compute_state(struct pipe_context *pipe, void *cs)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   struct lp_compute_shader *shader = cs;
+   struct lp_cs_variant_list_item *li;
+
+   assert(cs != llvmpipe->cs);
+
+   /* Delete all the variants */
+   li = first_elem(&shader->variants);
+   while (!at_end(&shader->variants, li)) {
+      struct lp_cs_variant_list_item *next = next_elem(li);
+      remove_cs_variant(llvmpipe, li->base);
+      li = next;
+   }
+
+   assert(shader->variants_cached == 0);
+   FREE((void *) shader->base.tokens);
+   FREE(shader);
+}
+
+
+static void
+llvmpipe_set_shader_buffers(struct pipe_context *pipe,
+                            enum pipe_shader_type shader,
+                            unsigned start_slot, unsigned count,
+                            const struct pipe_shader_buffer *buffers)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   unsigned i;
+
+   assert(shader < PIPE_SHADER_TYPES);
+   assert(start_slot + count <= ARRAY_SIZE(llvmpipe->ssbos[shader]));
+
+   for (i = 0; i < count; i++) {
+      struct pipe_shader_buffer *dst = &llvmpipe->ssbos[shader][start_slot + i];
+
+      if (buffers && buffers[i].buffer) {
+         pipe_resource_reference(&dst->buffer, buffers[i].buffer);
+         dst->buffer_offset = buffers[i].buffer_offset;
+         dst->buffer_size = buffers[i].buffer_size;
+      }
+      else {
+         pipe_resource_reference(&dst->buffer, NULL);
+         memset(dst, 0, sizeof *dst);
+      }
+   }
+}
+
+
+static void
+llvmpipe_set_shader_images(struct pipe_context *pipe,
+                           enum pipe_shader_type shader,
+                           unsigned start_slot, unsigned count,
+                           const struct pipe_image_view *images)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   unsigned i;
+
+   assert(shader < PIPE_SHADER_TYPES);
+   assert(start_slot + count <= ARRAY_SIZE(llvmpipe->images[shader]));
+
+   for (i = 0; i < count; i++) {
+      struct pipe_image_view *dst = &llvmpipe->images[shader][start_slot + i];
+
+      if (images && images[i].resource) {
+         pipe_resource_reference(&dst->resource, images[i].resource);
+         *dst = images[i];
+      }
+      else {
+         pipe_resource_reference(&dst->resource, NULL);
+         memset(dst, 0, sizeof *dst);
+      }
+   }
+}
+
+
+/**
+ * Fill in the jit image for the given image view.
+ */
+static void
+fill_jit_image(struct lp_jit_image *jit_image,
+               const struct pipe_image_view *view)
+{
+   struct pipe_resource *res = view->resource;
+   struct llvmpipe_resource *lp_res = llvmpipe_resource(res);
+
+   if (!llvmpipe_resource_is_texture(res)) {
+      jit_image->base = (uint8_t *)lp_res->data + view->u.buf.offset;
+      jit_image->width = view->u.buf.size / util_format_get_blocksize(view->format);
+      jit_image->height = 1;
+      jit_image->depth = 1;
+      jit_image->row_stride = 0;
+      jit_image->img_stride = 0;
+   }
+   else {
+      unsigned level = view->u.tex.level;
+      uint8_t *base;
+
+      if (lp_res->dt) {
+         /* display target, single level and layer */
+         struct llvmpipe_screen *screen = llvmpipe_screen(res->screen);
+         struct sw_winsys *winsys = screen->winsys;
+         base = winsys->displaytarget_map(winsys, lp_res->dt,
+                                          PIPE_TRANSFER_READ_WRITE);
+      }
+      else {
+         base = (uint8_t *)lp_res->tex_data + lp_res->mip_offsets[level];
+      }
+
+      jit_image->width = u_minify(res->width0, level);
+      jit_image->height = u_minify(res->height0, level);
+      jit_image->row_stride = lp_res->row_stride[level];
+      jit_image->img_stride = lp_res->img_stride[level];
+
+      if (res->target == PIPE_TEXTURE_3D) {
+         jit_image->depth = u_minify(res->depth0, level);
+      }
+      else if (res->target == PIPE_TEXTURE_1D_ARRAY ||
+               res->target == PIPE_TEXTURE_2D_ARRAY ||
+               res->target == PIPE_TEXTURE_CUBE ||
+               res->target == PIPE_TEXTURE_CUBE_ARRAY) {
+         jit_image->depth = view->u.tex.last_layer - view->u.tex.first_layer + 1;
+         base += view->u.tex.first_layer * lp_res->img_stride[level];
+      }
+      else {
+         jit_image->depth = 1;
+      }
+
+      jit_image->base = base;
+   }
+}
+
+
+/**
+ * Unmap the display targets mapped by fill_jit_image().
+ */
+static void
+unmap_jit_images(struct llvmpipe_context *lp, unsigned nr_images)
+{
+   unsigned i;
+
+   for (i = 0; i < nr_images; i++) {
+      struct pipe_resource *res = lp->images[PIPE_SHADER_COMPUTE][i].resource;
+
+      if (res && llvmpipe_resource(res)->dt) {
+         struct sw_winsys *winsys = llvmpipe_screen(res->screen)->winsys;
+         winsys->displaytarget_unmap(winsys, llvmpipe_resource(res)->dt);
+      }
+   }
+}
+
+
+/**
+ * Fill in the compute shader jit context from the current state.
+ * Unbound constant and shader buffers point to a dummy buffer of size 0
+ * so that the shader's bounds checks turn all accesses into no-ops.
+ */
+static void
+update_cs_jit_context(struct llvmpipe_context *lp,
+                      const struct lp_compute_shader_variant_key *key,
+                      struct lp_jit_cs_context *jit)
+{
+   static const uint32_t fake_buf[4];
+   unsigned i;
+
+   for (i = 0; i < LP_MAX_TGSI_CONST_BUFFERS; i++) {
+      const struct pipe_constant_buffer *cb = &lp->constants[PIPE_SHADER_COMPUTE][i];
+      const ubyte *data = NULL;
+
+      if (cb->buffer)
+         data = (const ubyte *)llvmpipe_resource_data(cb->buffer);
+      else if (cb->user_buffer)
+         data = (const ubyte *)cb->user_buffer;
+
+      if (data) {
+         jit->constants[i] = (const float *)(data + cb->buffer_offset);
+         jit->num_constants[i] = cb->buffer_size / (sizeof(float) * 4);
+      }
+      else {
+         jit->constants[i] = (const float *)fake_buf;
+         jit->num_constants[i] = 0;
+      }
+   }
+
+   for (i = 0; i < LP_MAX_TGSI_SHADER_BUFFERS; i++) {
+      const struct pipe_shader_buffer *sb = &lp->ssbos[PIPE_SHADER_COMPUTE][i];
+
+      if (sb->buffer) {
+         jit->ssbos[i] = (const uint32_t *)
+            ((const ubyte *)llvmpipe_resource_data(sb->buffer) + sb->buffer_offset);
+         jit->num_ssbos[i] = sb->buffer_size;
+      }
+      else {
+         jit->ssbos[i] = fake_buf;
+         jit->num_ssbos[i] = 0;
+      }
+   }
+
+   for (i = 0; i < key->nr_sampler_views; i++) {
+      const struct pipe_sampler_view *view =
+         lp->sampler_views[PIPE_SHADER_COMPUTE][i];
+
+      if (view)
+         lp_setup_fill_jit_texture(&jit->textures[i], view);
+   }
+
+   for (i = 0; i < key->nr_samplers; i++) {
+      const struct pipe_sampler_state *sampler =
+         lp->samplers[PIPE_SHADER_COMPUTE][i];
+
+      if (sampler) {
+         struct lp_jit_sampler *jit_sam = &jit->samplers[i];
+
+         jit_sam->min_lod = sampler->min_lod;
+         jit_sam->max_lod = sampler->max_lod;
+         jit_sam->lod_bias = sampler->lod_bias;
+         COPY_4V(jit_sam->border_color, sampler->border_color.f);
+      }
+   }
+
+   for (i = 0; i < key->nr_images; i++) {
+      const struct pipe_image_view *view = &lp->images[PIPE_SHADER_COMPUTE][i];
+
+      if (view->resource)
+         fill_jit_image(&jit->images[i], view);
+   }
+}
+
+
+/**
+ * A compute grid being run by the rasterizer threads.
+ */
+struct lp_cs_job
+{
+   const struct lp_compute_shader_variant *variant;
+   const struct lp_jit_cs_context *jit_context;
+   struct lp_cs_thread_state *threads;
+
+   uint32_t grid_size[3];
+   uint64_t num_blocks;
+   unsigned num_vectors;     /**< SIMD vectors per block */
+   unsigned vector_length;
+   boolean use_fibers;
+   size_t fiber_stack_size;
+
+   /** next block to run, shared by all the threads */
+   uint64_t next_block;
+};
+
+
+/**
+ * A block being run by one thread.
+ */
+struct lp_cs_block
+{
+   const struct lp_cs_job *job;
+   uint32_t block_id[3];
+   void *shared_mem;
+   struct lp_jit_thread_data *thread_data;
+};
+
+
+static void
+cs_run_vector(void *data, unsigned index, void *fiber)
+{
+   const struct lp_cs_block *block = (const struct lp_cs_block *)data;
+   const struct lp_cs_job *job = block->job;
+
+   job->variant->jit_function(job->jit_context,
+                              block->block_id[0],
+                              block->block_id[1],
+                              block->block_id[2],
+                              job->grid_size[0],
+                              job->grid_size[1],
+                              job->grid_size[2],
+                              index * job->vector_length,
+                              block->shared_mem,
+                              block->thread_data,
+                              fiber);
+}
+
+
+static void
+cs_run_thread(void *data, unsigned thread_index,
+              struct lp_jit_thread_data *thread_data)
+{
+   struct lp_cs_job *job = (struct lp_cs_job *)data;
+   struct lp_cs_thread_state *state = &job->threads[thread_index];
+   struct lp_cs_block block;
+   uint64_t b;
+
+   block.job = job;
+   block.shared_mem = state->shared_mem;
+   block.thread_data = thread_data;
+
+   while ((b = p_atomic_inc_return(&job->next_block) - 1) < job->num_blocks) {
+      unsigned i;
+
+      block.block_id[0] = b % job->grid_size[0];
+      block.block_id[1] = (b / job->grid_size[0]) % job->grid_size[1];
+      block.block_id[2] = b / ((uint64_t)job->grid_size[0] * job->grid_size[1]);
+
+      if (job->use_fibers) {
+         if (!lp_cs_fiber_run(state->fibers, job->num_vectors,
+                              job->fiber_stack_size, cs_run_vector, &block)) {
+            debug_printf("llvmpipe: out of memory for compute fibers\n");
+            return;
+         }
+      }
+      else {
+         for (i = 0; i < job->num_vectors; i++)
+            cs_run_vector(&block, i, NULL);
+      }
+   }
+}
+
+
+/**
+ * Stack size needed by the shader when run on a fiber.
+ *
+ * The registers are allocas, which all end up on the stack when addressed
+ * indirectly or spilled.  Reserve twice their size on top of the minimum,
+ * which covers the rest of the frame and the functions called.
+ */
+static size_t
+cs_fiber_stack_size(const struct lp_compute_shader *shader,
+                    unsigned vector_length)
+{
+   static const unsigned files[] = {
+      TGSI_FILE_TEMPORARY,
+      TGSI_FILE_IMMEDIATE,
+      TGSI_FILE_INPUT,
+      TGSI_FILE_OUTPUT,
+      TGSI_FILE_ADDRESS,
+   };
+   size_t num_regs = 0;
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(files); i++)
+      num_regs += shader->info.base.file_max[files[i]] + 1;
+
+   return LP_CS_FIBER_STACK_SIZE +
+          2 * num_regs * TGSI_NUM_CHANNELS * vector_length * sizeof(float);
+}
+
+
+/**
+ * Make sure every thread has the shared memory and fibers needed to run
+ * the current shader.
+ */
+static boolean
+prepare_cs_threads(struct llvmpipe_context *lp, boolean use_fibers)
+{
+   struct lp_compute_shader *shader = lp->cs;
+   unsigned num_threads = MAX2(1, llvmpipe_screen(lp->pipe.screen)->num_threads);
+   unsigned i;
+
+   if (!lp->cs_threads) {
+      lp->cs_threads = CALLOC(num_threads, sizeof *lp->cs_threads);
+      if (!lp->cs_threads)
+         return FALSE;
+      lp->num_cs_threads = num_threads;
+   }
+
+   for (i = 0; i < lp->num_cs_threads; i++) {
+      struct lp_cs_thread_state *state = &lp->cs_threads[i];
+
+      if (state->shared_mem_size < shader->req_local_mem) {
+         align_free(state->shared_mem);
+         state->shared_mem = align_malloc(shader->req_local_mem, 16);
+         if (!state->shared_mem) {
+            state->shared_mem_size = 0;
+            return FALSE;
+         }
+         state->shared_mem_size = shader->req_local_mem;
+      }
+
+      if (use_fibers && !state->fibers) {
+         state->fibers = lp_cs_fiber_pool_create();
+         if (!state->fibers)
+            return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+
+static void
+llvmpipe_launch_grid(struct pipe_context *pipe,
+                     const struct pipe_grid_info *info)
+{
+   struct llvmpipe_context *lp = llvmpipe_context(pipe);
+   struct lp_compute_shader *shader = lp->cs;
+   struct lp_compute_shader_variant *variant;
+   struct lp_jit_cs_context jit_context;
+   struct lp_cs_job job;
+   unsigned block_size;
+
+   if (!shader)
+      return;
+
+   /*
+    * Compute reads and writes resources directly, so the rendering so far
+    * must land first.  Queue the scene being binned, the rasterizer threads
+    * finish the queued scenes before running the dispatch.
+    *
+    * The dispatch itself is synchronous: the rasterizer threads run the
+    * blocks, so rendering and compute don't overlap, and the results are
+    * visible to whatever comes next.
+    */
+   llvmpipe_flush(pipe, NULL, __FUNCTION__);
+
+   memset(&job, 0, sizeof job);
+
+   if (info->indirect) {
+      const uint32_t *params = (const uint32_t *)
+         ((const ubyte *)llvmpipe_resource_data(info->indirect) +
+          info->indirect_offset);
+      memcpy(job.grid_size, params, sizeof job.grid_size);
+   }
+   else {
+      memcpy(job.grid_size, info->grid, sizeof job.grid_size);
+   }
+
+   job.num_blocks = (uint64_t)job.grid_size[0] * job.grid_size[1] *
+                    job.grid_size[2];
+   if (!job.num_blocks)
+      return;
+
+   variant = update_cs_variant(lp);
+   if (!variant)
+      return;
+
+   job.use_fibers = shader->info.base.opcode_count[TGSI_OPCODE_BARRIER] > 0;
+
+   if (!prepare_cs_threads(lp, job.use_fibers))
+      return;
+
+   memset(&jit_context, 0, sizeof jit_context);
+   update_cs_jit_context(lp, &variant->key, &jit_context);
+
+   block_size = shader->block_size[0] * shader->block_size[1] *
+                shader->block_size[2];
+
+   job.variant = variant;
+   job.jit_context = &jit_context;
+   job.threads = lp->cs_threads;
+   job.vector_length = MIN2(lp_native_vector_width / 32, 16);
+   job.num_vectors = DIV_ROUND_UP(block_size, job.vector_length);
+   if (job.use_fibers)
+      job.fiber_stack_size = cs_fiber_stack_size(shader, job.vector_length);
+
+   lp_setup_run_on_threads(lp->setup, cs_run_thread, &job);
+
+   unmap_jit_images(lp, variant->key.nr_images);
+}
+
+
+void
+llvmpipe_cleanup_cs(struct llvmpipe_context *lp)
+{
+   unsigned i;
+
+   for (i = 0; i < lp->num_cs_threads; i++) {
+      lp_cs_fiber_pool_destroy(lp->cs_threads[i].fibers);
+      align_free(lp->cs_threads[i].shared_mem);
+   }
+   FREE(lp->cs_threads);
+   lp->cs_threads = NULL;
+   lp->num_cs_threads = 0;
+}
+
+
+void
+llvmpipe_init_cs_funcs(struct llvmpipe_context *llvmpipe)
+{
+   llvmpipe->pipe.create_compute_state = llvmpipe_create_compute_state;
+   llvmpipe->pipe.bind_compute_state = llvmpipe_bind_compute_state;
+   llvmpipe->pipe.delete_compute_state = llvmpipe_delete_compute_state;
+   llvmpipe->pipe.set_shader_buffers = llvmpipe_set_shader_buffers;
+   llvmpipe->pipe.set_shader_images = llvmpipe_set_shader_images;
+   llvmpipe->pipe.launch_grid = llvmpipe_launch_grid;
+}
@@ -68,6 +68,7 @@
 #include "util/simple_list.h"
 #include "util/u_dual_blend.h"
 #include "util/os_time.h"
+#include "util/mesa-sha1.h"
 #include "pipe/p_shader_tokens.h"
 #include "draw/draw_context.h"
 #include "tgsi/tgsi_dump.h"
@@ -96,9 +97,11 @@
 #include "lp_context.h"
 #include "lp_debug.h"
 #include "lp_perf.h"
+#include "lp_screen.h"
 #include "lp_setup.h"
 #include "lp_state.h"
 #include "lp_tex_sample.h"
+#include "lp_texture.h"
 #include "lp_flush.h"
 #include "lp_state_fs.h"
 #include "lp_rast.h"
@@ -479,7 +482,8 @@ generate_fs_loop(struct gallivm_state *gallivm,
                      consts_ptr, num_consts_ptr, &system_values,
                      interp->inputs,
                      outputs, context_ptr, thread_data_ptr,
-                     sampler, &shader->info.base, NULL);
+                     sampler, NULL, NULL, NULL, NULL,
+                     &shader->info.base, NULL, NULL);
 
    /* Alpha test */
    if (key->alpha.enabled) {
@@ -2397,8 +2401,7 @@ generate_unswizzled_blend(struct gallivm_state *gallivm,
  * 2x2 pixels.
  */
 static void
-generate_fragment(struct llvmpipe_context *lp,
-                  struct lp_fragment_shader *shader,
+generate_fragment(struct lp_fragment_shader *shader,
                   struct lp_fragment_shader_variant *variant,
                   unsigned partial_mask)
 {
@@ -2486,8 +2489,11 @@ generate_fragment(struct llvmpipe_context *lp,
 
    blend_vec_type = lp_build_vec_type(gallivm, blend_type);
 
-   util_snprintf(func_name, sizeof(func_name), "fs%u_variant%u_%s",
-                 shader->no, variant->no, partial_mask ? "partial" : "whole");
+   /* The name must not depend on the shader/variant numbering, as it is
+    * how the function is looked up in objects from the disk cache.
+    */
+   util_snprintf(func_name, sizeof(func_name), "fs_variant_%s",
+                 partial_mask ? "partial" : "whole");
 
    arg_types[0] = variant->jit_context_ptr_type;       /* context */
    arg_types[1] = int32_type;                          /* x */
@@ -2807,12 +2813,36 @@ lp_debug_fs_variant(const struct lp_fragment_shader_variant *variant)
 }
 
 
+/**
+ * Hash the shader tokens and the variant key, which together fully
+ * determine the generated code.
+ */
+static void
+lp_fs_get_ir_cache_key(const struct lp_fragment_shader_variant *variant,
+                       unsigned char ir_cache_key[20])
+{
+   const struct lp_fragment_shader *shader = variant->shader;
+   struct mesa_sha1 ctx;
+
+   _mesa_sha1_init(&ctx);
+   _mesa_sha1_update(&ctx, &variant->key, shader->variant_key_size);
+   _mesa_sha1_update(&ctx, shader->base.tokens,
+                     tgsi_num_tokens(shader->base.tokens) *
+                     sizeof(struct tgsi_token));
+   _mesa_sha1_final(&ctx, ir_cache_key);
+}
+
+
 /**
  * Generate a new fragment shader variant from the shader code and
  * other state indicated by the key.
+ *
+ * This doesn't touch the context, so that it can run in the screen's
+ * compile queue, with an LLVM context of its own.
  */
 static struct lp_fragment_shader_variant *
-generate_variant(struct llvmpipe_context *lp,
+generate_variant(struct llvmpipe_screen *screen,
+                 LLVMContextRef context,
                  struct lp_fragment_shader *shader,
                  const struct lp_fragment_shader_variant_key *key)
 {
@@ -2820,27 +2850,38 @@ generate_variant(struct llvmpipe_context *lp,
    const struct util_format_description *cbuf0_format_desc = NULL;
    boolean fullcolormask;
    char module_name[64];
+   unsigned char ir_sha1_cache_key[20];
+   struct lp_cached_code cached = { 0 };
+   bool needs_caching = false;
 
    variant = CALLOC_STRUCT(lp_fragment_shader_variant);
    if (!variant)
       return NULL;
 
+   variant->shader = shader;
+   memcpy(&variant->key, key, shader->variant_key_size);
+
+   if (screen->disk_shader_cache) {
+      lp_fs_get_ir_cache_key(variant, ir_sha1_cache_key);
+      lp_disk_cache_find_shader(screen, &cached, ir_sha1_cache_key);
+      if (!cached.data_size)
+         needs_caching = true;
+   }
+
    util_snprintf(module_name, sizeof(module_name), "fs%u_variant%u",
                  shader->no, shader->variants_created);
 
-   variant->gallivm = gallivm_create(module_name, lp->context);
+   variant->gallivm = gallivm_create(module_name, context, &cached);
    if (!variant->gallivm) {
+      free(cached.data);
       FREE(variant);
       return NULL;
    }
 
-   variant->shader = shader;
    variant->list_item_global.base = variant;
    variant->list_item_local.base = variant;
    variant->no = shader->variants_created++;
 
-   memcpy(&variant->key, key, shader->variant_key_size);
-
    /*
     * Determine whether we are touching all channels in the color buffer.
     */
@@ -2869,12 +2910,12 @@ generate_variant(struct llvmpipe_context *lp,
    lp_jit_init_types(variant);
    
    if (variant->jit_function[RAST_EDGE_TEST] == NULL)
-      generate_fragment(lp, shader, variant, RAST_EDGE_TEST);
+      generate_fragment(shader, variant, RAST_EDGE_TEST);
 
    if (variant->jit_function[RAST_WHOLE] == NULL) {
       if (variant->opaque) {
          /* Specialized shader, which doesn't need to read the color buffer. */
-         generate_fragment(lp, shader, variant, RAST_WHOLE);
+         generate_fragment(shader, variant, RAST_WHOLE);
       }
    }
 
@@ -2900,12 +2941,130 @@ generate_variant(struct llvmpipe_context *lp,
       variant->jit_function[RAST_WHOLE] = variant->jit_function[RAST_EDGE_TEST];
    }
 
+   if (needs_caching) {
+      lp_disk_cache_insert_shader(screen, &cached, ir_sha1_cache_key);
+   }
+
    gallivm_free_ir(variant->gallivm);
+   free(cached.data);
 
    return variant;
 }
 
 
+/**
+ * A fragment shader variant compiled in the background.
+ */
+struct lp_fs_precompile
+{
+   struct llvmpipe_screen *screen;
+   struct lp_fragment_shader *shader;
+   struct lp_fragment_shader_variant *variant;
+   int64_t compile_time;
+
+   /* Must be last, only shader->variant_key_size bytes are allocated */
+   struct lp_fragment_shader_variant_key key;
+};
+
+
+static void
+make_variant_key(struct llvmpipe_context *lp,
+                 struct lp_fragment_shader *shader,
+                 struct lp_fragment_shader_variant_key *key);
+
+
+static void
+lp_fs_precompile_execute(void *data, int thread_index)
+{
+   struct lp_fs_precompile *job = data;
+   LLVMContextRef context = LLVMContextCreate();
+   int64_t t0;
+
+   if (!context)
+      return;
+
+   t0 = os_time_get();
+   job->variant = generate_variant(job->screen, context, job->shader,
+                                   &job->key);
+   job->compile_time = os_time_get() - t0;
+
+   if (job->variant)
+      job->variant->context = context;
+   else
+      LLVMContextDispose(context);
+}
+
+
+/**
+ * Start compiling the variant for the currently bound state in the
+ * background, as that's most likely the state the shader will first be drawn
+ * with.  llvmpipe_update_fs() adopts the variant or cancels the compile.
+ */
+static void
+lp_fs_precompile(struct llvmpipe_context *lp,
+                 struct lp_fragment_shader *shader)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
+   struct lp_fs_precompile *job;
+
+   if (!util_queue_is_initialized(&screen->compile_queue) ||
+       !lp->max_compile_threads ||
+       !lp->blend || !lp->depth_stencil || !lp->rasterizer)
+      return;
+
+   job = CALLOC(1, Offset(struct lp_fs_precompile, key) +
+                   shader->variant_key_size);
+   if (!job)
+      return;
+
+   job->screen = screen;
+   job->shader = shader;
+   make_variant_key(lp, shader, &job->key);
+
+   shader->precompile = job;
+   util_queue_add_job_with_priority(&screen->compile_queue, job,
+                                    &shader->precompile_fence,
+                                    lp_fs_precompile_execute, NULL,
+                                    UTIL_QUEUE_PRIORITY_HIGH);
+}
+
+
+/**
+ * Wait for the background compile of the shader, or cancel it if it didn't
+ * start yet and its key doesn't match the given one, and put the resulting
+ * variant in the lists.
+ */
+static void
+lp_fs_finish_precompile(struct llvmpipe_context *lp,
+                        struct lp_fragment_shader *shader,
+                        const struct lp_fragment_shader_variant_key *key)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
+   struct lp_fs_precompile *job = shader->precompile;
+   struct lp_fragment_shader_variant *variant;
+
+   if (!key || memcmp(&job->key, key, shader->variant_key_size) != 0)
+      util_queue_drop_job(&screen->compile_queue, &shader->precompile_fence);
+   else
+      util_queue_fence_wait(&shader->precompile_fence);
+
+   variant = job->variant;
+   if (variant) {
+      insert_at_head(&shader->variants, &variant->list_item_local);
+      insert_at_head(&lp->fs_variants_list, &variant->list_item_global);
+      lp->nr_fs_variants++;
+      lp->nr_fs_instrs += variant->nr_instrs;
+      shader->variants_cached++;
+
+      LP_COUNT_ADD(&lp->counters, llvm_compile_time, job->compile_time);
+      LP_COUNT_ADD(&lp->counters, nr_llvm_compiles, 2);
+   }
+
+   shader->precompile = NULL;
+   FREE(job);
+}
+
+
 static void *
 llvmpipe_create_fs_state(struct pipe_context *pipe,
                          const struct pipe_shader_state *templ)
@@ -2922,6 +3081,7 @@ llvmpipe_create_fs_state(struct pipe_context *pipe,
 
    shader->no = fs_no++;
    make_empty_list(&shader->variants);
+   util_queue_fence_init(&shader->precompile_fence);
 
    /* get/save the summary info for this shader */
    lp_build_tgsi_info(templ->tokens, &shader->info);
@@ -2998,6 +3158,8 @@ llvmpipe_create_fs_state(struct pipe_context *pipe,
       debug_printf("\n");
    }
 
+   lp_fs_precompile(llvmpipe, shader);
+
    return shader;
 }
 
@@ -3037,6 +3199,8 @@ llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
    }
 
    gallivm_destroy(variant->gallivm);
+   if (variant->context)
+      LLVMContextDispose(variant->context);
 
    /* remove from shader's list */
    remove_from_list(&variant->list_item_local);
@@ -3067,6 +3231,9 @@ llvmpipe_delete_fs_state(struct pipe_context *pipe, void *fs)
     */
    llvmpipe_finish(pipe, __FUNCTION__);
 
+   if (shader->precompile)
+      lp_fs_finish_precompile(llvmpipe, shader, NULL);
+
    /* Delete all the variants */
    li = first_elem(&shader->variants);
    while(!at_end(&shader->variants, li)) {
@@ -3079,6 +3246,7 @@ llvmpipe_delete_fs_state(struct pipe_context *pipe, void *fs)
    draw_delete_fragment_shader(llvmpipe->draw, shader->draw_data);
 
    assert(shader->variants_cached == 0);
+   util_queue_fence_destroy(&shader->precompile_fence);
    FREE((void *) shader->base.tokens);
    FREE(shader);
 }
@@ -3128,7 +3296,7 @@ llvmpipe_set_constant_buffer(struct pipe_context *pipe,
       draw_set_mapped_constant_buffer(llvmpipe->draw, shader,
                                       index, data, size);
    }
-   else {
+   else if (shader == PIPE_SHADER_FRAGMENT) {
       llvmpipe->dirty |= LP_NEW_FS_CONSTANTS;
    }
 
@@ -3341,8 +3509,8 @@ make_variant_key(struct llvmpipe_context *lp,
           * used views may be included in the shader key.
           */
          if(shader->info.base.file_mask[TGSI_FILE_SAMPLER_VIEW] & (1u << (i & 31))) {
-            lp_sampler_static_texture_state(&key->state[i].texture_state,
-                                            lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
+            llvmpipe_sampler_static_texture_state(&key->state[i].texture_state,
+                                                  lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
          }
       }
    }
@@ -3350,8 +3518,8 @@ make_variant_key(struct llvmpipe_context *lp,
       key->nr_sampler_views = key->nr_samplers;
       for(i = 0; i < key->nr_sampler_views; ++i) {
          if(shader->info.base.file_mask[TGSI_FILE_SAMPLER] & (1 << i)) {
-            lp_sampler_static_texture_state(&key->state[i].texture_state,
-                                            lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
+            llvmpipe_sampler_static_texture_state(&key->state[i].texture_state,
+                                                  lp->sampler_views[PIPE_SHADER_FRAGMENT][i]);
          }
       }
    }
@@ -3373,6 +3541,9 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
 
    make_variant_key(lp, shader, &key);
 
+   if (shader->precompile)
+      lp_fs_finish_precompile(lp, shader, &key);
+
    /* Search the variants for one which matches the key */
    li = first_elem(&shader->variants);
    while(!at_end(&shader->variants, li)) {
@@ -3448,11 +3619,12 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
        * Generate the new variant.
        */
       t0 = os_time_get();
-      variant = generate_variant(lp, shader, &key);
+      variant = generate_variant(llvmpipe_screen(lp->pipe.screen),
+                                 lp->context, shader, &key);
       t1 = os_time_get();
       dt = t1 - t0;
-      LP_COUNT_ADD(llvm_compile_time, dt);
-      LP_COUNT_ADD(nr_llvm_compiles, 2);  /* emit vs. omit in/out test */
+      LP_COUNT_ADD(&lp->counters, llvm_compile_time, dt);
+      LP_COUNT_ADD(&lp->counters, nr_llvm_compiles, 2);  /* emit vs. omit in/out test */
 
       /* Put the new variant into the list */
       if (variant) {
@@ -3472,6 +3644,19 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
 
 
 
+static void
+llvmpipe_set_max_shader_compiler_threads(struct pipe_context *pipe,
+                                         unsigned max_threads)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+
+   /* The queue is shared by all contexts and doesn't resize, this only turns
+    * background compiles on/off for this context.
+    */
+   llvmpipe->max_compile_threads = max_threads;
+}
+
+
 void
 llvmpipe_init_fs_funcs(struct llvmpipe_context *llvmpipe)
 {
@@ -3480,6 +3665,9 @@ llvmpipe_init_fs_funcs(struct llvmpipe_context *llvmpipe)
    llvmpipe->pipe.delete_fs_state = llvmpipe_delete_fs_state;
 
    llvmpipe->pipe.set_constant_buffer = llvmpipe_set_constant_buffer;
+
+   llvmpipe->pipe.set_max_shader_compiler_threads =
+      llvmpipe_set_max_shader_compiler_threads;
 }
 
 
@@ -32,6 +32,7 @@
 
 #include "pipe/p_compiler.h"
 #include "pipe/p_state.h"
+#include "util/u_queue.h"
 #include "tgsi/tgsi_scan.h" /* for tgsi_shader_info */
 #include "gallivm/lp_bld_sample.h" /* for struct lp_sampler_static_state */
 #include "gallivm/lp_bld_tgsi.h" /* for lp_tgsi_info */
@@ -40,6 +41,7 @@
 
 struct tgsi_token;
 struct lp_fragment_shader;
+struct lp_fs_precompile;
 
 
 /** Indexes into jit_function[] array */
@@ -101,6 +103,9 @@ struct lp_fragment_shader_variant
 
    struct gallivm_state *gallivm;
 
+   /** LLVM context owned by the variant, if it was compiled in the background */
+   LLVMContextRef context;
+
    LLVMTypeRef jit_context_ptr_type;
    LLVMTypeRef jit_thread_data_ptr_type;
    LLVMTypeRef jit_linear_context_ptr_type;
@@ -139,6 +144,11 @@ struct lp_fragment_shader
 
    /** Fragment shader input interpolation info */
    struct lp_shader_input inputs[PIPE_MAX_SHADER_INPUTS];
+
+   /** Signalled once the variant compiled at creation time is ready */
+   struct util_queue_fence precompile_fence;
+   /** That variant, until llvmpipe_update_fs() adopts it */
+   struct lp_fs_precompile *precompile;
 };
 
 
@@ -29,6 +29,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <float.h>
+#include <math.h>
 
 #include "util/u_memory.h"
 #include "util/u_pointer.h"
@@ -36,11 +37,19 @@
 #include "util/u_format.h"
 #include "util/u_format_tests.h"
 #include "util/u_format_s3tc.h"
+#include "util/os_time.h"
 
 #include "gallivm/lp_bld.h"
+#include "gallivm/lp_bld_arit.h"
+#include "gallivm/lp_bld_bitarit.h"
+#include "gallivm/lp_bld_const.h"
 #include "gallivm/lp_bld_debug.h"
+#include "gallivm/lp_bld_flow.h"
 #include "gallivm/lp_bld_format.h"
+#include "gallivm/lp_bld_gather.h"
 #include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_sample.h"
+#include "gallivm/lp_bld_swizzle.h"
 
 #include "lp_test.h"
 
@@ -150,7 +159,7 @@ test_format_float(unsigned verbose, FILE *fp,
    unsigned i, j, k, l;
 
    context = LLVMContextCreate();
-   gallivm = gallivm_create("test_module_float", context);
+   gallivm = gallivm_create("test_module_float", context, NULL);
 
    fetch = add_fetch_rgba_test(gallivm, verbose, desc,
                                lp_float32_vec4_type(), use_cache);
@@ -251,7 +260,7 @@ test_format_unorm8(unsigned verbose, FILE *fp,
    unsigned i, j, k, l;
 
    context = LLVMContextCreate();
-   gallivm = gallivm_create("test_module_unorm8", context);
+   gallivm = gallivm_create("test_module_unorm8", context, NULL);
 
    fetch = add_fetch_rgba_test(gallivm, verbose, desc,
                                lp_unorm8_vec4_type(), use_cache);
@@ -334,6 +343,442 @@ test_format_unorm8(unsigned verbose, FILE *fp,
 }
 
 
+typedef void
+(*footprint_ptr_t)(const uint8_t *texture, uint32_t row_stride,
+                   const uint32_t *x, const uint32_t *y,
+                   uint32_t count, uint32_t *sums);
+
+
+/**
+ * Build a function summing the 2x2 texel footprints at count coordinates
+ * of a RGBA8 texture, like bilinear sampling fetches them, for the linear
+ * or the tiled layout.
+ */
+static LLVMValueRef
+add_footprint_test(struct gallivm_state *gallivm, boolean tiled)
+{
+   LLVMContextRef context = gallivm->context;
+   LLVMBuilderRef builder = gallivm->builder;
+   const struct util_format_description *desc =
+      util_format_description(PIPE_FORMAT_R8G8B8A8_UNORM);
+   struct lp_type type = lp_type_uint_vec(32, 128);
+   LLVMTypeRef int32_type = LLVMInt32TypeInContext(context);
+   LLVMTypeRef vec_ptr_type = LLVMPointerType(lp_build_vec_type(gallivm, type), 0);
+   struct lp_build_context bld;
+   struct lp_build_loop_state loop;
+   LLVMTypeRef args[6];
+   LLVMValueRef func, texture, row_stride, x_ptr, y_ptr, count, sums_ptr;
+   LLVMValueRef x[2], y[2], sum, ptr, store;
+   LLVMValueRef offset, i, j;
+   LLVMBasicBlockRef block;
+   unsigned dx, dy;
+
+   args[0] = LLVMPointerType(LLVMInt8TypeInContext(context), 0);
+   args[1] = int32_type;
+   args[2] = LLVMPointerType(int32_type, 0);
+   args[3] = LLVMPointerType(int32_type, 0);
+   args[4] = int32_type;
+   args[5] = LLVMPointerType(int32_type, 0);
+
+   func = LLVMAddFunction(gallivm->module,
+                          tiled ? "footprint_tiled" : "footprint_linear",
+                          LLVMFunctionType(LLVMVoidTypeInContext(context),
+                                           args, ARRAY_SIZE(args), 0));
+   LLVMSetFunctionCallConv(func, LLVMCCallConv);
+   texture = LLVMGetParam(func, 0);
+   row_stride = LLVMGetParam(func, 1);
+   x_ptr = LLVMGetParam(func, 2);
+   y_ptr = LLVMGetParam(func, 3);
+   count = LLVMGetParam(func, 4);
+   sums_ptr = LLVMGetParam(func, 5);
+
+   block = LLVMAppendBasicBlockInContext(context, func, "entry");
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   lp_build_context_init(&bld, gallivm, type);
+   row_stride = lp_build_broadcast_scalar(&bld, row_stride);
+
+   lp_build_loop_begin(&loop, gallivm, lp_build_const_int32(gallivm, 0));
+
+   ptr = LLVMBuildGEP(builder, x_ptr, &loop.counter, 1, "");
+   x[0] = LLVMBuildLoad(builder, LLVMBuildBitCast(builder, ptr, vec_ptr_type, ""), "");
+   LLVMSetAlignment(x[0], 4);
+   ptr = LLVMBuildGEP(builder, y_ptr, &loop.counter, 1, "");
+   y[0] = LLVMBuildLoad(builder, LLVMBuildBitCast(builder, ptr, vec_ptr_type, ""), "");
+   LLVMSetAlignment(y[0], 4);
+   x[1] = lp_build_add(&bld, x[0], bld.one);
+   y[1] = lp_build_add(&bld, y[0], bld.one);
+
+   sum = bld.zero;
+   for (dy = 0; dy < 2; dy++) {
+      for (dx = 0; dx < 2; dx++) {
+         lp_build_sample_offset(&bld, desc, tiled, x[dx], y[dy], NULL,
+                                row_stride, NULL, &offset, &i, &j);
+         sum = lp_build_add(&bld, sum,
+                            lp_build_gather(gallivm, type.length, 32, type,
+                                            TRUE, texture, offset, FALSE));
+      }
+   }
+
+   ptr = LLVMBuildGEP(builder, sums_ptr, &loop.counter, 1, "");
+   store = LLVMBuildStore(builder, sum,
+                          LLVMBuildBitCast(builder, ptr, vec_ptr_type, ""));
+   LLVMSetAlignment(store, 4);
+
+   lp_build_loop_end_cond(&loop, count,
+                          lp_build_const_int32(gallivm, type.length),
+                          LLVMIntUGE);
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, func);
+
+   return func;
+}
+
+
+/**
+ * Texel coordinates of a size x size square, in the order llvmpipe
+ * rasterizes it (4x4 blocks in 64x64 tiles), textured with a
+ * tex_size x tex_size texture rotated by angle degrees.
+ */
+static void
+footprint_coords(unsigned tex_size, unsigned size, double angle,
+                 uint32_t *xs, uint32_t *ys)
+{
+   const double c = cos(angle * M_PI / 180.0), s = sin(angle * M_PI / 180.0);
+   unsigned tx, ty, bx, by, px, py, n = 0;
+
+   for (ty = 0; ty < size; ty += 64) {
+      for (tx = 0; tx < size; tx += 64) {
+         for (by = ty; by < ty + 64; by += 4) {
+            for (bx = tx; bx < tx + 64; bx += 4) {
+               for (py = by; py < by + 4; py++) {
+                  for (px = bx; px < bx + 4; px++) {
+                     double u = c * ((double) px - size / 2) -
+                                s * ((double) py - size / 2) + tex_size / 2;
+                     double v = s * ((double) px - size / 2) +
+                                c * ((double) py - size / 2) + tex_size / 2;
+
+                     xs[n] = CLAMP((int) u, 0, (int) tex_size - 2);
+                     ys[n] = CLAMP((int) v, 0, (int) tex_size - 2);
+                     n++;
+                  }
+               }
+            }
+         }
+      }
+   }
+}
+
+
+/**
+ * Fetch bilinear footprints from a linear and a tiled texture holding the
+ * same texels and check the results match.  If bench, also time it with a
+ * texture larger than the caches.
+ */
+PIPE_ALIGN_STACK
+static boolean
+test_tiled_footprints(unsigned verbose, boolean bench)
+{
+   static const double angles[] = { 0.0, 30.0, 90.0 };
+   const unsigned tex_size = bench ? 2048 : 256;
+   const unsigned size = bench ? 1024 : 128;
+   const unsigned count = size * size;
+   const unsigned linear_stride = tex_size * 4;
+   const unsigned tiled_stride = tex_size * LP_TILED_TILE_SIZE * 4;
+   LLVMContextRef context;
+   struct gallivm_state *gallivm;
+   LLVMValueRef funcs[2];
+   footprint_ptr_t func_ptrs[2];
+   uint8_t *textures[2];
+   uint32_t *xs, *ys, *sums[2];
+   boolean success = TRUE;
+   unsigned a, x, y, t;
+
+   context = LLVMContextCreate();
+   gallivm = gallivm_create("test_module_footprint", context, NULL);
+
+   funcs[0] = add_footprint_test(gallivm, FALSE);
+   funcs[1] = add_footprint_test(gallivm, TRUE);
+
+   gallivm_compile_module(gallivm);
+
+   func_ptrs[0] = (footprint_ptr_t) gallivm_jit_function(gallivm, funcs[0]);
+   func_ptrs[1] = (footprint_ptr_t) gallivm_jit_function(gallivm, funcs[1]);
+
+   gallivm_free_ir(gallivm);
+
+   textures[0] = align_malloc(linear_stride * tex_size, 64);
+   textures[1] = align_malloc(tiled_stride * (tex_size / LP_TILED_TILE_SIZE), 64);
+   xs = align_malloc(count * sizeof *xs, 16);
+   ys = align_malloc(count * sizeof *ys, 16);
+   sums[0] = align_malloc(count * sizeof *sums[0], 16);
+   sums[1] = align_malloc(count * sizeof *sums[1], 16);
+
+   for (y = 0; y < tex_size; y++) {
+      for (x = 0; x < tex_size; x++) {
+         uint32_t texel = x * 2654435761u + y * 40503u;
+
+         *(uint32_t *) (textures[0] + y * linear_stride + x * 4) = texel;
+         *(uint32_t *) (textures[1] +
+                        lp_tiled_texel_offset(x, y, 4, tiled_stride)) = texel;
+      }
+   }
+
+   for (a = 0; a < ARRAY_SIZE(angles); a++) {
+      footprint_coords(tex_size, size, angles[a], xs, ys);
+
+      for (t = 0; t < 2; t++) {
+         const unsigned stride = t ? tiled_stride : linear_stride;
+         const unsigned iterations = bench ? 20 : 1;
+         int64_t start = os_time_get_nano();
+         unsigned n;
+
+         for (n = 0; n < iterations; n++) {
+            func_ptrs[t](textures[t], stride, xs, ys, count, sums[t]);
+         }
+
+         if (bench) {
+            double secs = (os_time_get_nano() - start) / 1e9;
+            printf("%ux%u RGBA8 texture rotated %3.0f degrees, %-6s: "
+                   "%8.1f Mtexels/s\n",
+                   tex_size, tex_size, angles[a], t ? "tiled" : "linear",
+                   4.0 * count * iterations / secs / 1e6);
+         }
+      }
+
+      if (memcmp(sums[0], sums[1], count * sizeof *sums[0]) != 0) {
+         printf("FAILED: tiled footprints at %.0f degrees don't match\n",
+                angles[a]);
+         success = FALSE;
+      }
+      else if (verbose) {
+         printf("Tiled footprints at %.0f degrees match\n", angles[a]);
+      }
+   }
+
+   align_free(sums[1]);
+   align_free(sums[0]);
+   align_free(ys);
+   align_free(xs);
+   align_free(textures[1]);
+   align_free(textures[0]);
+
+   gallivm_destroy(gallivm);
+   LLVMContextDispose(context);
+
+   return success;
+}
+
+
+typedef void
+(*compressed_fetch_ptr_t)(const uint8_t *texture, uint32_t block_row_stride,
+                          const uint32_t *x, const uint32_t *y,
+                          uint32_t count, uint32_t *texels,
+                          struct lp_build_format_cache *cache);
+
+
+/**
+ * Build a function fetching the RGBA8 texels at count coordinates of a
+ * block compressed texture, with or without the block cache.
+ */
+static LLVMValueRef
+add_compressed_fetch_test(struct gallivm_state *gallivm,
+                          const struct util_format_description *desc,
+                          boolean use_cache)
+{
+   char name[256];
+   LLVMContextRef context = gallivm->context;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_type type = lp_type_uint_vec(32, 128);
+   LLVMTypeRef int32_type = LLVMInt32TypeInContext(context);
+   LLVMTypeRef vec_ptr_type = LLVMPointerType(lp_build_vec_type(gallivm, type), 0);
+   struct lp_build_context bld;
+   struct lp_build_loop_state loop;
+   LLVMTypeRef args[7];
+   LLVMValueRef func, texture, block_row_stride, x_ptr, y_ptr, count;
+   LLVMValueRef texels_ptr, cache = NULL;
+   LLVMValueRef x, y, offset, i, j, rgba, ptr, store;
+   LLVMBasicBlockRef block;
+
+   util_snprintf(name, sizeof name, "fetch_%s_%s", desc->short_name,
+                 use_cache ? "cached" : "uncached");
+
+   args[0] = LLVMPointerType(LLVMInt8TypeInContext(context), 0);
+   args[1] = int32_type;
+   args[2] = LLVMPointerType(int32_type, 0);
+   args[3] = LLVMPointerType(int32_type, 0);
+   args[4] = int32_type;
+   args[5] = LLVMPointerType(int32_type, 0);
+   args[6] = LLVMPointerType(lp_build_format_cache_type(gallivm), 0);
+
+   func = LLVMAddFunction(gallivm->module, name,
+                          LLVMFunctionType(LLVMVoidTypeInContext(context),
+                                           args, ARRAY_SIZE(args), 0));
+   LLVMSetFunctionCallConv(func, LLVMCCallConv);
+   texture = LLVMGetParam(func, 0);
+   block_row_stride = LLVMGetParam(func, 1);
+   x_ptr = LLVMGetParam(func, 2);
+   y_ptr = LLVMGetParam(func, 3);
+   count = LLVMGetParam(func, 4);
+   texels_ptr = LLVMGetParam(func, 5);
+   if (use_cache) {
+      cache = LLVMGetParam(func, 6);
+   }
+
+   block = LLVMAppendBasicBlockInContext(context, func, "entry");
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   lp_build_context_init(&bld, gallivm, type);
+   block_row_stride = lp_build_broadcast_scalar(&bld, block_row_stride);
+
+   lp_build_loop_begin(&loop, gallivm, lp_build_const_int32(gallivm, 0));
+
+   ptr = LLVMBuildGEP(builder, x_ptr, &loop.counter, 1, "");
+   x = LLVMBuildLoad(builder, LLVMBuildBitCast(builder, ptr, vec_ptr_type, ""), "");
+   LLVMSetAlignment(x, 4);
+   ptr = LLVMBuildGEP(builder, y_ptr, &loop.counter, 1, "");
+   y = LLVMBuildLoad(builder, LLVMBuildBitCast(builder, ptr, vec_ptr_type, ""), "");
+   LLVMSetAlignment(y, 4);
+
+   offset = lp_build_add(&bld,
+                         lp_build_mul(&bld, lp_build_shr_imm(&bld, y, 2),
+                                      block_row_stride),
+                         lp_build_mul_imm(&bld, lp_build_shr_imm(&bld, x, 2),
+                                          desc->block.bits / 8));
+   i = lp_build_and(&bld, x, lp_build_const_int_vec(gallivm, type, 3));
+   j = lp_build_and(&bld, y, lp_build_const_int_vec(gallivm, type, 3));
+
+   rgba = lp_build_fetch_rgba_aos(gallivm, desc, lp_unorm8_vec4_type(),
+                                  TRUE, texture, offset, i, j, cache);
+   rgba = LLVMBuildBitCast(builder, rgba, bld.vec_type, "");
+
+   ptr = LLVMBuildGEP(builder, texels_ptr, &loop.counter, 1, "");
+   store = LLVMBuildStore(builder, rgba,
+                          LLVMBuildBitCast(builder, ptr, vec_ptr_type, ""));
+   LLVMSetAlignment(store, 4);
+
+   lp_build_loop_end_cond(&loop, count,
+                          lp_build_const_int32(gallivm, type.length),
+                          LLVMIntUGE);
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, func);
+
+   return func;
+}
+
+
+/**
+ * Fetch texels from block compressed textures with and without the block
+ * cache, and check both match for the formats which sample through it.
+ * If bench, also time them, with s3tc for reference.
+ */
+PIPE_ALIGN_STACK
+static boolean
+test_compressed_fetches(unsigned verbose, boolean bench)
+{
+   static const enum pipe_format formats[] = {
+      PIPE_FORMAT_DXT1_RGBA,
+      PIPE_FORMAT_ETC1_RGB8,
+      PIPE_FORMAT_BPTC_RGBA_UNORM,
+   };
+   static const double angles[] = { 0.0, 30.0 };
+   const unsigned tex_size = bench ? 2048 : 256;
+   const unsigned size = bench ? 1024 : 128;
+   const unsigned count = size * size;
+   struct lp_build_format_cache *cache;
+   uint8_t *texture;
+   uint32_t *xs, *ys, *texels[2];
+   boolean success = TRUE;
+   unsigned f, a, c, n;
+
+   cache = align_malloc(sizeof *cache, 16);
+   /* Large enough for 16 bytes per 4x4 block. */
+   texture = align_malloc(tex_size * tex_size, 16);
+   xs = align_malloc(count * sizeof *xs, 16);
+   ys = align_malloc(count * sizeof *ys, 16);
+   texels[0] = align_malloc(count * sizeof *texels[0], 16);
+   texels[1] = align_malloc(count * sizeof *texels[1], 16);
+
+   srand(42);
+   for (n = 0; n < tex_size * tex_size; n++) {
+      texture[n] = rand();
+   }
+
+   for (f = 0; f < ARRAY_SIZE(formats); f++) {
+      const struct util_format_description *desc =
+         util_format_description(formats[f]);
+      const unsigned block_row_stride = tex_size / 4 * desc->block.bits / 8;
+      LLVMContextRef context;
+      struct gallivm_state *gallivm;
+      LLVMValueRef funcs[2];
+      compressed_fetch_ptr_t func_ptrs[2];
+
+      context = LLVMContextCreate();
+      gallivm = gallivm_create("test_module_compressed", context, NULL);
+
+      funcs[0] = add_compressed_fetch_test(gallivm, desc, FALSE);
+      funcs[1] = add_compressed_fetch_test(gallivm, desc, TRUE);
+
+      gallivm_compile_module(gallivm);
+
+      func_ptrs[0] = (compressed_fetch_ptr_t) gallivm_jit_function(gallivm, funcs[0]);
+      func_ptrs[1] = (compressed_fetch_ptr_t) gallivm_jit_function(gallivm, funcs[1]);
+
+      gallivm_free_ir(gallivm);
+
+      for (a = 0; a < ARRAY_SIZE(angles); a++) {
+         footprint_coords(tex_size, size, angles[a], xs, ys);
+
+         for (c = 0; c < 2; c++) {
+            const unsigned iterations = bench ? 10 : 1;
+            int64_t start = os_time_get_nano();
+
+            for (n = 0; n < iterations; n++) {
+               memset(cache->cache_tags, 0, sizeof cache->cache_tags);
+               func_ptrs[c](texture, block_row_stride, xs, ys, count,
+                            texels[c], cache);
+            }
+
+            if (bench) {
+               double secs = (os_time_get_nano() - start) / 1e9;
+               printf("%-24s rotated %3.0f degrees, %-8s: %8.1f Mtexels/s\n",
+                      desc->short_name, angles[a], c ? "cached" : "uncached",
+                      (double) count * iterations / secs / 1e6);
+            }
+         }
+
+         if (!lp_build_format_needs_cache(desc)) {
+            continue;
+         }
+
+         if (memcmp(texels[0], texels[1], count * sizeof *texels[0]) != 0) {
+            printf("FAILED: cached %s texels at %.0f degrees don't match\n",
+                   desc->short_name, angles[a]);
+            success = FALSE;
+         }
+         else if (verbose) {
+            printf("Cached %s texels at %.0f degrees match\n",
+                   desc->short_name, angles[a]);
+         }
+      }
+
+      gallivm_destroy(gallivm);
+      LLVMContextDispose(context);
+   }
+
+   align_free(texels[1]);
+   align_free(texels[0]);
+   align_free(ys);
+   align_free(xs);
+   align_free(texture);
+   align_free(cache);
+
+   return success;
+}
 
 
 static boolean
@@ -407,6 +852,14 @@ test_all(unsigned verbose, FILE *fp)
    }
    align_free(cache_ptr);
 
+   if (!test_tiled_footprints(verbose, FALSE)) {
+      success = FALSE;
+   }
+
+   if (!test_compressed_fetches(verbose, FALSE)) {
+      success = FALSE;
+   }
+
    return success;
 }
 
@@ -419,9 +872,22 @@ test_some(unsigned verbose, FILE *fp,
 }
 
 
+/**
+ * Benchmark texel fetches from linear and tiled textures, and from block
+ * compressed textures with and without the block cache.
+ */
 boolean
 test_single(unsigned verbose, FILE *fp)
 {
-   printf("no test_single()");
-   return TRUE;
+   boolean success = TRUE;
+
+   if (!test_tiled_footprints(verbose, TRUE)) {
+      success = FALSE;
+   }
+
+   if (!test_compressed_fetches(verbose, TRUE)) {
+      success = FALSE;
+   }
+
+   return success;
 }
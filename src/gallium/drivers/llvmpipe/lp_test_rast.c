@@ -0,0 +1,353 @@
+/**************************************************************************
+ *
+ * Copyright 2026 agent
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/**
+ * @file
+ * Rasterizer scaling benchmark.
+ *
+ * Renders blended full screen quads with a varying number of rasterizer
+ * threads (LP_NUM_THREADS) and reports the fill rate for each.
+ */
+
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "pipe/p_state.h"
+#include "state_tracker/sw_winsys.h"
+#include "cso_cache/cso_context.h"
+#include "util/os_time.h"
+#include "util/u_cpu_detect.h"
+#include "util/u_draw_quad.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_simple_shaders.h"
+#include "util/u_string.h"
+
+#include "lp_public.h"
+#include "lp_test.h"
+
+
+#define WIDTH 1024
+#define HEIGHT 1024
+#define QUADS_PER_FRAME 8
+#define NUM_FRAMES 16
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "threads\t"
+           "frames\t"
+           "seconds\t"
+           "mpixels_per_sec\t"
+           "speedup\n");
+
+   fflush(fp);
+}
+
+
+/*
+ * The screen needs no display targets, so a winsys which doesn't support
+ * any is all we need.
+ */
+static boolean
+null_is_displaytarget_format_supported(struct sw_winsys *ws,
+                                       unsigned tex_usage,
+                                       enum pipe_format format)
+{
+   return FALSE;
+}
+
+
+static struct sw_winsys null_winsys = {
+   .is_displaytarget_format_supported = null_is_displaytarget_format_supported,
+};
+
+
+static void
+set_num_threads(unsigned num_threads)
+{
+   char value[16];
+
+   util_snprintf(value, sizeof value, "%u", num_threads);
+#ifdef PIPE_OS_WINDOWS
+   _putenv_s("LP_NUM_THREADS", value);
+#else
+   setenv("LP_NUM_THREADS", value, 1);
+#endif
+}
+
+
+static void
+finish(struct pipe_context *pipe)
+{
+   struct pipe_screen *screen = pipe->screen;
+   struct pipe_fence_handle *fence = NULL;
+
+   pipe->flush(pipe, &fence, 0);
+   if (fence) {
+      screen->fence_finish(screen, NULL, fence, PIPE_TIMEOUT_INFINITE);
+      screen->fence_reference(screen, &fence, NULL);
+   }
+}
+
+
+static void
+draw_frame(struct pipe_context *pipe, struct cso_context *cso,
+           float (*vertices)[2][4])
+{
+   union pipe_color_union clear_color = { .f = { 0.0f, 0.0f, 0.0f, 1.0f } };
+   unsigned i;
+
+   pipe->clear(pipe, PIPE_CLEAR_COLOR, &clear_color, 0.0, 0);
+
+   for (i = 0; i < QUADS_PER_FRAME; i++) {
+      util_draw_user_vertex_buffer(cso, vertices, PIPE_PRIM_TRIANGLE_STRIP,
+                                   4, 2);
+   }
+
+   pipe->flush(pipe, NULL, 0);
+}
+
+
+/**
+ * Render NUM_FRAMES frames with the given number of threads.
+ * \return the elapsed time in seconds, or a negative value on failure.
+ */
+static double
+time_frames(unsigned num_threads)
+{
+   static float vertices[4][2][4] = {
+      { { -1.0f, -1.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 0.0f, 0.25f } },
+      { {  1.0f, -1.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f, 0.25f } },
+      { { -1.0f,  1.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 1.0f, 0.25f } },
+      { {  1.0f,  1.0f, 0.0f, 1.0f }, { 1.0f, 1.0f, 1.0f, 0.25f } },
+   };
+   const enum tgsi_semantic semantic_names[] =
+      { TGSI_SEMANTIC_POSITION, TGSI_SEMANTIC_COLOR };
+   const uint semantic_indexes[] = { 0, 0 };
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+   struct cso_context *cso;
+   struct pipe_resource templ, *target;
+   struct pipe_surface surf_templ, *surf;
+   struct pipe_framebuffer_state fb;
+   struct pipe_blend_state blend;
+   struct pipe_depth_stencil_alpha_state dsa;
+   struct pipe_rasterizer_state rast;
+   struct pipe_viewport_state viewport;
+   struct pipe_vertex_element velem[2];
+   void *vs, *fs;
+   int64_t start, end;
+   unsigned i;
+
+   set_num_threads(num_threads);
+
+   screen = llvmpipe_create_screen(&null_winsys);
+   if (!screen)
+      return -1.0;
+
+   pipe = screen->context_create(screen, NULL, 0);
+   cso = cso_create_context(pipe, 0);
+
+   memset(&templ, 0, sizeof templ);
+   templ.target = PIPE_TEXTURE_2D;
+   templ.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+   templ.width0 = WIDTH;
+   templ.height0 = HEIGHT;
+   templ.depth0 = 1;
+   templ.array_size = 1;
+   templ.bind = PIPE_BIND_RENDER_TARGET;
+   target = screen->resource_create(screen, &templ);
+
+   memset(&surf_templ, 0, sizeof surf_templ);
+   surf_templ.format = templ.format;
+   surf = pipe->create_surface(pipe, target, &surf_templ);
+
+   memset(&fb, 0, sizeof fb);
+   fb.width = WIDTH;
+   fb.height = HEIGHT;
+   fb.nr_cbufs = 1;
+   fb.cbufs[0] = surf;
+
+   memset(&blend, 0, sizeof blend);
+   blend.rt[0].blend_enable = 1;
+   blend.rt[0].rgb_func = PIPE_BLEND_ADD;
+   blend.rt[0].rgb_src_factor = PIPE_BLENDFACTOR_SRC_ALPHA;
+   blend.rt[0].rgb_dst_factor = PIPE_BLENDFACTOR_INV_SRC_ALPHA;
+   blend.rt[0].alpha_func = PIPE_BLEND_ADD;
+   blend.rt[0].alpha_src_factor = PIPE_BLENDFACTOR_ONE;
+   blend.rt[0].alpha_dst_factor = PIPE_BLENDFACTOR_ZERO;
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+
+   memset(&dsa, 0, sizeof dsa);
+
+   memset(&rast, 0, sizeof rast);
+   rast.cull_face = PIPE_FACE_NONE;
+   rast.half_pixel_center = 1;
+   rast.bottom_edge_rule = 1;
+   rast.depth_clip_near = 1;
+   rast.depth_clip_far = 1;
+
+   viewport.scale[0] = WIDTH / 2.0f;
+   viewport.scale[1] = HEIGHT / 2.0f;
+   viewport.scale[2] = 0.5f;
+   viewport.translate[0] = WIDTH / 2.0f;
+   viewport.translate[1] = HEIGHT / 2.0f;
+   viewport.translate[2] = 0.5f;
+
+   memset(velem, 0, sizeof velem);
+   velem[0].src_offset = 0;
+   velem[0].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   velem[1].src_offset = 4 * sizeof(float);
+   velem[1].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+
+   vs = util_make_vertex_passthrough_shader(pipe, 2, semantic_names,
+                                            semantic_indexes, FALSE);
+   fs = util_make_fragment_passthrough_shader(pipe, TGSI_SEMANTIC_COLOR,
+                                              TGSI_INTERPOLATE_PERSPECTIVE,
+                                              TRUE);
+
+   cso_set_framebuffer(cso, &fb);
+   cso_set_blend(cso, &blend);
+   cso_set_depth_stencil_alpha(cso, &dsa);
+   cso_set_rasterizer(cso, &rast);
+   cso_set_viewport(cso, &viewport);
+   cso_set_vertex_shader_handle(cso, vs);
+   cso_set_fragment_shader_handle(cso, fs);
+   cso_set_vertex_elements(cso, 2, velem);
+
+   /* Warm up: compile the shader variants outside the timed section. */
+   draw_frame(pipe, cso, vertices);
+   finish(pipe);
+
+   start = os_time_get_nano();
+   for (i = 0; i < NUM_FRAMES; i++) {
+      draw_frame(pipe, cso, vertices);
+   }
+   finish(pipe);
+   end = os_time_get_nano();
+
+   cso_destroy_context(cso);
+   pipe->delete_vs_state(pipe, vs);
+   pipe->delete_fs_state(pipe, fs);
+   pipe_surface_reference(&surf, NULL);
+   pipe_resource_reference(&target, NULL);
+   pipe->destroy(pipe);
+   screen->destroy(screen);
+
+   return (end - start) * 1e-9;
+}
+
+
+static boolean
+test_threads(unsigned verbose, FILE *fp, unsigned num_threads,
+             double *base_seconds)
+{
+   double seconds, mpixels, speedup;
+
+   seconds = time_frames(num_threads);
+   if (seconds < 0.0) {
+      fprintf(stderr, "failed to create llvmpipe screen\n");
+      return FALSE;
+   }
+
+   mpixels = (double)WIDTH * HEIGHT * QUADS_PER_FRAME * NUM_FRAMES * 1e-6;
+   if (*base_seconds == 0.0)
+      *base_seconds = seconds;
+   speedup = seconds > 0.0 ? *base_seconds / seconds : 0.0;
+
+   if (verbose >= 1) {
+      printf("%3u threads: %8.3f s  %10.1f Mpixels/s  %5.2fx\n",
+             num_threads, seconds, mpixels / seconds, speedup);
+      fflush(stdout);
+   }
+
+   if (fp) {
+      fprintf(fp, "%u\t%u\t%f\t%f\t%f\n",
+              num_threads, NUM_FRAMES, seconds, mpixels / seconds, speedup);
+      fflush(fp);
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Test all thread counts from one up to the number of CPUs.
+ */
+boolean
+test_all(unsigned verbose, FILE *fp)
+{
+   unsigned max_threads = MAX2(1, util_cpu_caps.nr_cpus);
+   double base_seconds = 0.0;
+   unsigned num_threads;
+
+   for (num_threads = 1; num_threads <= max_threads; num_threads++) {
+      if (!test_threads(verbose, fp, num_threads, &base_seconds))
+         return FALSE;
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Test power of two thread counts, and the number of CPUs.
+ */
+boolean
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   unsigned max_threads = MAX2(1, util_cpu_caps.nr_cpus);
+   double base_seconds = 0.0;
+   unsigned num_threads;
+
+   for (num_threads = 1; num_threads < max_threads; num_threads *= 2) {
+      if (!test_threads(verbose, fp, num_threads, &base_seconds))
+         return FALSE;
+   }
+
+   return test_threads(verbose, fp, max_threads, &base_seconds);
+}
+
+
+boolean
+test_single(unsigned verbose, FILE *fp)
+{
+   double base_seconds = 0.0;
+
+   return test_threads(verbose, fp, MAX2(1, util_cpu_caps.nr_cpus),
+                       &base_seconds);
+}
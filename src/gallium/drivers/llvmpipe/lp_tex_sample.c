@@ -50,6 +50,7 @@
 #include "lp_jit.h"
 #include "lp_tex_sample.h"
 #include "lp_state_fs.h"
+#include "lp_state_cs.h"
 #include "lp_debug.h"
 
 
@@ -65,6 +66,10 @@ struct llvmpipe_sampler_dynamic_state
    struct lp_sampler_dynamic_state base;
 
    const struct lp_sampler_static_state *static_state;
+
+   /** Index of the textures/samplers arrays in the jit context struct */
+   unsigned textures_index;
+   unsigned samplers_index;
 };
 
 
@@ -96,6 +101,8 @@ lp_llvm_texture_member(const struct lp_sampler_dynamic_state *base,
                        const char *member_name,
                        boolean emit_load)
 {
+   const struct llvmpipe_sampler_dynamic_state *state =
+      (const struct llvmpipe_sampler_dynamic_state *)base;
    LLVMBuilderRef builder = gallivm->builder;
    LLVMValueRef indices[4];
    LLVMValueRef ptr;
@@ -106,7 +113,7 @@ lp_llvm_texture_member(const struct lp_sampler_dynamic_state *base,
    /* context[0] */
    indices[0] = lp_build_const_int32(gallivm, 0);
    /* context[0].textures */
-   indices[1] = lp_build_const_int32(gallivm, LP_JIT_CTX_TEXTURES);
+   indices[1] = lp_build_const_int32(gallivm, state->textures_index);
    /* context[0].textures[unit] */
    indices[2] = lp_build_const_int32(gallivm, texture_unit);
    /* context[0].textures[unit].member */
@@ -174,6 +181,8 @@ lp_llvm_sampler_member(const struct lp_sampler_dynamic_state *base,
                        const char *member_name,
                        boolean emit_load)
 {
+   const struct llvmpipe_sampler_dynamic_state *state =
+      (const struct llvmpipe_sampler_dynamic_state *)base;
    LLVMBuilderRef builder = gallivm->builder;
    LLVMValueRef indices[4];
    LLVMValueRef ptr;
@@ -184,7 +193,7 @@ lp_llvm_sampler_member(const struct lp_sampler_dynamic_state *base,
    /* context[0] */
    indices[0] = lp_build_const_int32(gallivm, 0);
    /* context[0].samplers */
-   indices[1] = lp_build_const_int32(gallivm, LP_JIT_CTX_SAMPLERS);
+   indices[1] = lp_build_const_int32(gallivm, state->samplers_index);
    /* context[0].samplers[unit] */
    indices[2] = lp_build_const_int32(gallivm, sampler_unit);
    /* context[0].samplers[unit].member */
@@ -221,7 +230,6 @@ LP_LLVM_SAMPLER_MEMBER(lod_bias,   LP_JIT_SAMPLER_LOD_BIAS, TRUE)
 LP_LLVM_SAMPLER_MEMBER(border_color, LP_JIT_SAMPLER_BORDER_COLOR, FALSE)
 
 
-#if LP_USE_TEXTURE_CACHE
 static LLVMValueRef
 lp_llvm_texture_cache_ptr(const struct lp_sampler_dynamic_state *base,
                           struct gallivm_state *gallivm,
@@ -233,7 +241,6 @@ lp_llvm_texture_cache_ptr(const struct lp_sampler_dynamic_state *base,
 
    return lp_jit_thread_data_cache(gallivm, thread_data_ptr);
 }
-#endif
 
 
 static void
@@ -289,8 +296,10 @@ lp_llvm_sampler_soa_emit_size_query(const struct lp_build_sampler_soa *base,
 }
 
 
-struct lp_build_sampler_soa *
-lp_llvm_sampler_soa_create(const struct lp_sampler_static_state *static_state)
+static struct lp_build_sampler_soa *
+lp_llvm_sampler_soa_create_common(const struct lp_sampler_static_state *static_state,
+                                  unsigned textures_index,
+                                  unsigned samplers_index)
 {
    struct lp_llvm_sampler_soa *sampler;
 
@@ -315,12 +324,175 @@ lp_llvm_sampler_soa_create(const struct lp_sampler_static_state *static_state)
    sampler->dynamic_state.base.lod_bias = lp_llvm_sampler_lod_bias;
    sampler->dynamic_state.base.border_color = lp_llvm_sampler_border_color;
 
-#if LP_USE_TEXTURE_CACHE
    sampler->dynamic_state.base.cache_ptr = lp_llvm_texture_cache_ptr;
-#endif
 
    sampler->dynamic_state.static_state = static_state;
+   sampler->dynamic_state.textures_index = textures_index;
+   sampler->dynamic_state.samplers_index = samplers_index;
 
    return &sampler->base;
 }
 
+
+struct lp_build_sampler_soa *
+lp_llvm_sampler_soa_create(const struct lp_sampler_static_state *static_state)
+{
+   return lp_llvm_sampler_soa_create_common(static_state,
+                                            LP_JIT_CTX_TEXTURES,
+                                            LP_JIT_CTX_SAMPLERS);
+}
+
+
+struct lp_build_sampler_soa *
+lp_llvm_cs_sampler_soa_create(const struct lp_sampler_static_state *static_state)
+{
+   return lp_llvm_sampler_soa_create_common(static_state,
+                                            LP_JIT_CS_CTX_TEXTURES,
+                                            LP_JIT_CS_CTX_SAMPLERS);
+}
+
+
+/**
+ * Fetch the specified member of the lp_jit_image structure.
+ */
+static LLVMValueRef
+lp_llvm_image_member(const struct lp_sampler_dynamic_state *base,
+                     struct gallivm_state *gallivm,
+                     LLVMValueRef context_ptr,
+                     unsigned image_unit,
+                     unsigned member_index,
+                     const char *member_name)
+{
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef indices[4];
+   LLVMValueRef ptr;
+   LLVMValueRef res;
+
+   assert(image_unit < LP_MAX_TGSI_SHADER_IMAGES);
+
+   /* context[0] */
+   indices[0] = lp_build_const_int32(gallivm, 0);
+   /* context[0].images */
+   indices[1] = lp_build_const_int32(gallivm, LP_JIT_CS_CTX_IMAGES);
+   /* context[0].images[unit] */
+   indices[2] = lp_build_const_int32(gallivm, image_unit);
+   /* context[0].images[unit].member */
+   indices[3] = lp_build_const_int32(gallivm, member_index);
+
+   ptr = LLVMBuildGEP(builder, context_ptr, indices, ARRAY_SIZE(indices), "");
+   res = LLVMBuildLoad(builder, ptr, "");
+
+   lp_build_name(res, "context.image%u.%s", image_unit, member_name);
+
+   return res;
+}
+
+
+#define LP_LLVM_IMAGE_MEMBER(_name, _index)  \
+   static LLVMValueRef \
+   lp_llvm_image_##_name( const struct lp_sampler_dynamic_state *base, \
+                          struct gallivm_state *gallivm, \
+                          LLVMValueRef context_ptr, \
+                          unsigned image_unit) \
+   { \
+      return lp_llvm_image_member(base, gallivm, context_ptr, \
+                                  image_unit, _index, #_name); \
+   }
+
+
+LP_LLVM_IMAGE_MEMBER(width,      LP_JIT_IMAGE_WIDTH)
+LP_LLVM_IMAGE_MEMBER(height,     LP_JIT_IMAGE_HEIGHT)
+LP_LLVM_IMAGE_MEMBER(depth,      LP_JIT_IMAGE_DEPTH)
+LP_LLVM_IMAGE_MEMBER(base_ptr,   LP_JIT_IMAGE_BASE)
+LP_LLVM_IMAGE_MEMBER(row_stride, LP_JIT_IMAGE_ROW_STRIDE)
+LP_LLVM_IMAGE_MEMBER(img_stride, LP_JIT_IMAGE_IMG_STRIDE)
+
+
+/**
+ * Images have no mipmaps: the bound level is baked into the jit image.
+ */
+static LLVMValueRef
+lp_llvm_image_level_zero(const struct lp_sampler_dynamic_state *base,
+                         struct gallivm_state *gallivm,
+                         LLVMValueRef context_ptr,
+                         unsigned image_unit)
+{
+   return lp_build_const_int32(gallivm, 0);
+}
+
+
+/**
+ * This is the bridge between our images and the TGSI translator.
+ */
+struct lp_llvm_image_soa
+{
+   struct lp_build_image_soa base;
+
+   struct lp_sampler_dynamic_state dynamic_state;
+
+   const struct lp_image_static_state *static_state;
+};
+
+
+static void
+lp_llvm_image_soa_destroy(struct lp_build_image_soa *image)
+{
+   FREE(image);
+}
+
+
+static void
+lp_llvm_image_soa_emit_op(const struct lp_build_image_soa *base,
+                          struct gallivm_state *gallivm,
+                          const struct lp_img_params *params)
+{
+   struct lp_llvm_image_soa *image = (struct lp_llvm_image_soa *)base;
+
+   assert(params->image_index < LP_MAX_TGSI_SHADER_IMAGES);
+
+   lp_build_img_op_soa(&image->static_state[params->image_index].image_state,
+                       &image->dynamic_state, gallivm, params);
+}
+
+
+static void
+lp_llvm_image_soa_emit_size_query(const struct lp_build_image_soa *base,
+                                  struct gallivm_state *gallivm,
+                                  const struct lp_sampler_size_query_params *params)
+{
+   struct lp_llvm_image_soa *image = (struct lp_llvm_image_soa *)base;
+
+   assert(params->texture_unit < LP_MAX_TGSI_SHADER_IMAGES);
+
+   lp_build_size_query_soa(gallivm,
+                           &image->static_state[params->texture_unit].image_state,
+                           &image->dynamic_state,
+                           params);
+}
+
+
+struct lp_build_image_soa *
+lp_llvm_image_soa_create(const struct lp_image_static_state *static_state)
+{
+   struct lp_llvm_image_soa *image;
+
+   image = CALLOC_STRUCT(lp_llvm_image_soa);
+   if (!image)
+      return NULL;
+
+   image->base.destroy = lp_llvm_image_soa_destroy;
+   image->base.emit_op = lp_llvm_image_soa_emit_op;
+   image->base.emit_size_query = lp_llvm_image_soa_emit_size_query;
+   image->dynamic_state.width = lp_llvm_image_width;
+   image->dynamic_state.height = lp_llvm_image_height;
+   image->dynamic_state.depth = lp_llvm_image_depth;
+   image->dynamic_state.first_level = lp_llvm_image_level_zero;
+   image->dynamic_state.last_level = lp_llvm_image_level_zero;
+   image->dynamic_state.base_ptr = lp_llvm_image_base_ptr;
+   image->dynamic_state.row_stride = lp_llvm_image_row_stride;
+   image->dynamic_state.img_stride = lp_llvm_image_img_stride;
+
+   image->static_state = static_state;
+
+   return &image->base;
+}
@@ -43,7 +43,10 @@
 #include "util/simple_list.h"
 #include "util/u_transfer.h"
 
+#include "draw/draw_context.h"
+
 #include "lp_context.h"
+#include "lp_debug.h"
 #include "lp_flush.h"
 #include "lp_screen.h"
 #include "lp_texture.h"
@@ -69,7 +72,7 @@ llvmpipe_texture_layout(struct llvmpipe_screen *screen,
                         struct llvmpipe_resource *lpr,
                         boolean allocate)
 {
-   struct pipe_resource *pt = &lpr->base;
+   struct pipe_resource *pt = &lpr->base.b;
    unsigned level;
    unsigned width = pt->width0;
    unsigned height = pt->height0;
@@ -104,9 +107,11 @@ llvmpipe_texture_layout(struct llvmpipe_screen *screen,
        */
       if (util_format_is_compressed(pt->format))
          align_x = align_y = 1;
+      else if (llvmpipe_resource_is_tiled(pt))
+         align_x = align_y = LP_TILED_TILE_SIZE;
       else {
          align_x = LP_RASTER_BLOCK_SIZE;
-         if (llvmpipe_resource_is_1d(&lpr->base))
+         if (llvmpipe_resource_is_1d(&lpr->base.b))
             align_y = 1;
          else
             align_y = LP_RASTER_BLOCK_SIZE;
@@ -120,6 +125,11 @@ llvmpipe_texture_layout(struct llvmpipe_screen *screen,
 
       if (util_format_is_compressed(pt->format))
          lpr->row_stride[level] = nblocksx * block_size;
+      else if (llvmpipe_resource_is_tiled(pt)) {
+         /* The row stride is the stride between rows of tiles */
+         lpr->row_stride[level] = nblocksx * block_size * LP_TILED_TILE_SIZE;
+         nblocksy /= LP_TILED_TILE_SIZE;
+      }
       else
          lpr->row_stride[level] = align(nblocksx * block_size, util_cpu_caps.cacheline);
 
@@ -132,16 +142,16 @@ llvmpipe_texture_layout(struct llvmpipe_screen *screen,
       lpr->img_stride[level] = lpr->row_stride[level] * nblocksy;
 
       /* Number of 3D image slices, cube faces or texture array layers */
-      if (lpr->base.target == PIPE_TEXTURE_CUBE) {
+      if (lpr->base.b.target == PIPE_TEXTURE_CUBE) {
          assert(layers == 6);
       }
 
-      if (lpr->base.target == PIPE_TEXTURE_3D)
+      if (lpr->base.b.target == PIPE_TEXTURE_3D)
          num_slices = depth;
-      else if (lpr->base.target == PIPE_TEXTURE_1D_ARRAY ||
-               lpr->base.target == PIPE_TEXTURE_2D_ARRAY ||
-               lpr->base.target == PIPE_TEXTURE_CUBE ||
-               lpr->base.target == PIPE_TEXTURE_CUBE_ARRAY)
+      else if (lpr->base.b.target == PIPE_TEXTURE_1D_ARRAY ||
+               lpr->base.b.target == PIPE_TEXTURE_2D_ARRAY ||
+               lpr->base.b.target == PIPE_TEXTURE_CUBE ||
+               lpr->base.b.target == PIPE_TEXTURE_CUBE_ARRAY)
          num_slices = layers;
       else
          num_slices = 1;
@@ -183,6 +193,44 @@ fail:
 }
 
 
+/**
+ * Decide whether a texture is stored in tiles (see LP_RESOURCE_FLAG_TILED),
+ * which makes sampling more cache friendly but transfers slower.
+ */
+static void
+llvmpipe_choose_texture_tiling(struct pipe_resource *pt)
+{
+   const struct util_format_description *desc =
+      util_format_description(pt->format);
+
+   pt->flags &= ~LP_RESOURCE_FLAG_TILED;
+
+   if (!(LP_PERF & PERF_TILED_TEX))
+      return;
+
+   /* Shared and displayed textures must stay linear, and depth/stencil
+    * buffers are only read with the linear layout by the fragment shader.
+    */
+   if (pt->bind & (PIPE_BIND_DISPLAY_TARGET |
+                   PIPE_BIND_SCANOUT |
+                   PIPE_BIND_SHARED |
+                   PIPE_BIND_LINEAR |
+                   PIPE_BIND_DEPTH_STENCIL))
+      return;
+
+   if (llvmpipe_resource_is_1d(pt) ||
+       desc->block.width != 1 || desc->block.height != 1 ||
+       desc->colorspace == UTIL_FORMAT_COLORSPACE_ZS)
+      return;
+
+   /* Small textures fit in the caches anyway, and would mostly be padding. */
+   if (pt->width0 < LP_TILED_TILE_SIZE || pt->height0 < LP_TILED_TILE_SIZE)
+      return;
+
+   pt->flags |= LP_RESOURCE_FLAG_TILED;
+}
+
+
 /**
  * Check the size of the texture specified by 'res'.
  * \return TRUE if OK, FALSE if too large.
@@ -193,7 +241,9 @@ llvmpipe_can_create_resource(struct pipe_screen *screen,
 {
    struct llvmpipe_resource lpr;
    memset(&lpr, 0, sizeof(lpr));
-   lpr.base = *res;
+   lpr.base.b = *res;
+   if (llvmpipe_resource_is_texture(res))
+      llvmpipe_choose_texture_tiling(&lpr.base.b);
    return llvmpipe_texture_layout(llvmpipe_screen(screen), &lpr, false);
 }
 
@@ -208,20 +258,23 @@ llvmpipe_displaytarget_layout(struct llvmpipe_screen *screen,
    /* Round up the surface size to a multiple of the tile size to
     * avoid tile clipping.
     */
-   const unsigned width = MAX2(1, align(lpr->base.width0, TILE_SIZE));
-   const unsigned height = MAX2(1, align(lpr->base.height0, TILE_SIZE));
+   const unsigned width = MAX2(1, align(lpr->base.b.width0, TILE_SIZE));
+   const unsigned height = MAX2(1, align(lpr->base.b.height0, TILE_SIZE));
+   unsigned stride;
 
    lpr->dt = winsys->displaytarget_create(winsys,
-                                          lpr->base.bind,
-                                          lpr->base.format,
+                                          lpr->base.b.bind,
+                                          lpr->base.b.format,
                                           width, height,
                                           64,
                                           map_front_private,
-                                          &lpr->row_stride[0] );
+                                          &stride );
 
    if (lpr->dt == NULL)
       return FALSE;
 
+   lpr->row_stride[0] = stride;
+
    if (!map_front_private) {
       void *map = winsys->displaytarget_map(winsys, lpr->dt,
                                             PIPE_TRANSFER_WRITE);
@@ -246,14 +299,15 @@ llvmpipe_resource_create_front(struct pipe_screen *_screen,
    if (!lpr)
       return NULL;
 
-   lpr->base = *templat;
-   pipe_reference_init(&lpr->base.reference, 1);
-   lpr->base.screen = &screen->base;
+   lpr->base.b = *templat;
+   pipe_reference_init(&lpr->base.b.reference, 1);
+   lpr->base.b.screen = &screen->base;
+   lpr->base.b.flags &= ~LP_RESOURCE_FLAG_TILED;
 
-   /* assert(lpr->base.bind); */
+   /* assert(lpr->base.b.bind); */
 
-   if (llvmpipe_resource_is_texture(&lpr->base)) {
-      if (lpr->base.bind & (PIPE_BIND_DISPLAY_TARGET |
+   if (llvmpipe_resource_is_texture(&lpr->base.b)) {
+      if (lpr->base.b.bind & (PIPE_BIND_DISPLAY_TARGET |
                             PIPE_BIND_SCANOUT |
                             PIPE_BIND_SHARED)) {
          /* displayable surface */
@@ -262,6 +316,7 @@ llvmpipe_resource_create_front(struct pipe_screen *_screen,
       }
       else {
          /* texture map */
+         llvmpipe_choose_texture_tiling(&lpr->base.b);
          if (!llvmpipe_texture_layout(screen, lpr, true))
             goto fail;
       }
@@ -291,13 +346,15 @@ llvmpipe_resource_create_front(struct pipe_screen *_screen,
       memset(lpr->data, 0, bytes);
    }
 
+   threaded_resource_init(&lpr->base.b);
+
    lpr->id = id_counter++;
 
 #ifdef DEBUG
    insert_at_tail(&resource_list, lpr);
 #endif
 
-   return &lpr->base;
+   return &lpr->base.b;
 
  fail:
    FREE(lpr);
@@ -327,7 +384,7 @@ llvmpipe_resource_destroy(struct pipe_screen *pscreen,
    }
    else if (llvmpipe_resource_is_texture(pt)) {
       /* free linear image data */
-      if (lpr->tex_data) {
+      if (lpr->tex_data && !lpr->userBuffer) {
          align_free(lpr->tex_data);
          lpr->tex_data = NULL;
       }
@@ -342,6 +399,7 @@ llvmpipe_resource_destroy(struct pipe_screen *pscreen,
       remove_from_list(lpr);
 #endif
 
+   threaded_resource_deinit(pt);
    FREE(lpr);
 }
 
@@ -442,6 +500,7 @@ llvmpipe_resource_from_handle(struct pipe_screen *screen,
 {
    struct sw_winsys *winsys = llvmpipe_screen(screen)->winsys;
    struct llvmpipe_resource *lpr;
+   unsigned stride;
 
    /* XXX Seems like from_handled depth textures doesn't work that well */
 
@@ -450,26 +509,31 @@ llvmpipe_resource_from_handle(struct pipe_screen *screen,
       goto no_lpr;
    }
 
-   lpr->base = *template;
-   pipe_reference_init(&lpr->base.reference, 1);
-   lpr->base.screen = screen;
+   lpr->base.b = *template;
+   pipe_reference_init(&lpr->base.b.reference, 1);
+   lpr->base.b.screen = screen;
+   lpr->base.b.flags &= ~LP_RESOURCE_FLAG_TILED;
 
    /*
     * Looks like unaligned displaytargets work just fine,
     * at least sampler/render ones.
     */
 #if 0
-   assert(lpr->base.width0 == width);
-   assert(lpr->base.height0 == height);
+   assert(lpr->base.b.width0 == width);
+   assert(lpr->base.b.height0 == height);
 #endif
 
    lpr->dt = winsys->displaytarget_from_handle(winsys,
                                                template,
                                                whandle,
-                                               &lpr->row_stride[0]);
+                                               &stride);
    if (!lpr->dt) {
       goto no_dt;
    }
+   lpr->row_stride[0] = stride;
+
+   threaded_resource_init(&lpr->base.b);
+   lpr->base.is_shared = true;
 
    lpr->id = id_counter++;
 
@@ -477,7 +541,7 @@ llvmpipe_resource_from_handle(struct pipe_screen *screen,
    insert_at_tail(&resource_list, lpr);
 #endif
 
-   return &lpr->base;
+   return &lpr->base.b;
 
 no_dt:
    FREE(lpr);
@@ -504,6 +568,114 @@ llvmpipe_resource_get_handle(struct pipe_screen *screen,
 }
 
 
+/**
+ * Flag the fragment shader constants as dirty if the resource is bound as
+ * one of them, as they're copied into the scene.
+ */
+static void
+llvmpipe_dirty_fs_constants(struct llvmpipe_context *llvmpipe,
+                            struct pipe_resource *resource)
+{
+   unsigned i;
+
+   if (!(resource->bind & PIPE_BIND_CONSTANT_BUFFER))
+      return;
+
+   for (i = 0; i < ARRAY_SIZE(llvmpipe->constants[PIPE_SHADER_FRAGMENT]); ++i) {
+      if (resource == llvmpipe->constants[PIPE_SHADER_FRAGMENT][i].buffer) {
+         llvmpipe->dirty |= LP_NEW_FS_CONSTANTS;
+         break;
+      }
+   }
+}
+
+
+/**
+ * Copy a box of a tiled texture level from or to a linear buffer.
+ */
+static void
+llvmpipe_copy_tiled_box(struct llvmpipe_resource *lpr,
+                        unsigned level,
+                        const struct pipe_box *box,
+                        uint8_t *linear,
+                        unsigned stride,
+                        unsigned layer_stride,
+                        boolean to_tiled)
+{
+   const unsigned texel_size = util_format_get_blocksize(lpr->base.b.format);
+   int x, y, z;
+
+   for (z = 0; z < box->depth; z++) {
+      uint8_t *image = llvmpipe_get_texture_image_address(lpr, box->z + z,
+                                                          level);
+
+      for (y = 0; y < box->height; y++) {
+         uint8_t *row = linear + z * layer_stride + y * stride;
+
+         /* Texels are contiguous up to the end of a row of a 4x4 block. */
+         for (x = 0; x < box->width; ) {
+            const unsigned tx = box->x + x;
+            const unsigned n = MIN2(LP_TILED_BLOCK_SIZE -
+                                    tx % LP_TILED_BLOCK_SIZE,
+                                    box->width - x);
+            uint8_t *texel = image +
+               lp_tiled_texel_offset(tx, box->y + y, texel_size,
+                                     lpr->row_stride[level]);
+
+            if (to_tiled)
+               memcpy(texel, row + x * texel_size, n * texel_size);
+            else
+               memcpy(row + x * texel_size, texel, n * texel_size);
+
+            x += n;
+         }
+      }
+   }
+}
+
+
+/**
+ * Copy a box of a texture level which can't be mapped directly, because it
+ * is tiled or stored bottom-up, from or to the linear staging buffer of a
+ * transfer.
+ */
+static void
+llvmpipe_copy_staging_box(struct llvmpipe_resource *lpr,
+                          unsigned level,
+                          const struct pipe_box *box,
+                          uint8_t *linear,
+                          unsigned stride,
+                          unsigned layer_stride,
+                          boolean to_texture)
+{
+   const unsigned texel_size = util_format_get_blocksize(lpr->base.b.format);
+   uint8_t *image;
+   int y;
+
+   if (llvmpipe_resource_is_tiled(&lpr->base.b)) {
+      llvmpipe_copy_tiled_box(lpr, level, box, linear, stride, layer_stride,
+                              to_texture);
+      return;
+   }
+
+   /* Bottom-up user memory only has one uncompressed 2D image. */
+   assert(lpr->row_stride[level] < 0);
+   assert(box->z == 0 && box->depth == 1);
+
+   image = llvmpipe_get_texture_image_address(lpr, 0, level) +
+           box->x * texel_size;
+
+   for (y = 0; y < box->height; y++) {
+      uint8_t *row = image + (box->y + y) * lpr->row_stride[level];
+
+      if (to_texture)
+         memcpy(row, linear + y * stride, box->width * texel_size);
+      else
+         memcpy(linear + y * stride, row, box->width * texel_size);
+   }
+}
+
+
 static void *
 llvmpipe_transfer_map( struct pipe_context *pipe,
                        struct pipe_resource *resource,
@@ -525,6 +697,11 @@ llvmpipe_transfer_map( struct pipe_context *pipe,
    assert(resource);
    assert(level <= resource->last_level);
 
+   /* Tiled and bottom-up textures are only mapped through a linear copy. */
+   if ((llvmpipe_resource_is_tiled(resource) || lpr->row_stride[level] < 0) &&
+       (usage & PIPE_TRANSFER_MAP_DIRECTLY))
+      return NULL;
+
    /*
     * Transfers, like other pipe operations, must happen in order, so flush the
     * context if necessary.
@@ -546,23 +723,20 @@ llvmpipe_transfer_map( struct pipe_context *pipe,
       }
    }
 
-   /* Check if we're mapping a current constant buffer */
+   /* Check if we're mapping a current constant buffer.  The threaded
+    * context does unsynchronized buffer mappings in the application thread,
+    * where the context mustn't be touched, those are checked at unmap time.
+    */
    if ((usage & PIPE_TRANSFER_WRITE) &&
-       (resource->bind & PIPE_BIND_CONSTANT_BUFFER)) {
-      unsigned i;
-      for (i = 0; i < ARRAY_SIZE(llvmpipe->constants[PIPE_SHADER_FRAGMENT]); ++i) {
-         if (resource == llvmpipe->constants[PIPE_SHADER_FRAGMENT][i].buffer) {
-            /* constants may have changed */
-            llvmpipe->dirty |= LP_NEW_FS_CONSTANTS;
-            break;
-         }
-      }
+       !(usage & TC_TRANSFER_MAP_THREADED_UNSYNC)) {
+      /* constants may have changed */
+      llvmpipe_dirty_fs_constants(llvmpipe, resource);
    }
 
    lpt = CALLOC_STRUCT(llvmpipe_transfer);
    if (!lpt)
       return NULL;
-   pt = &lpt->base;
+   pt = &lpt->base.b;
    pipe_resource_reference(&pt->resource, resource);
    pt->box = *box;
    pt->level = level;
@@ -581,7 +755,7 @@ llvmpipe_transfer_map( struct pipe_context *pipe,
           transfer->usage);
    */
 
-   if (usage == PIPE_TRANSFER_READ) {
+   if (!(usage & PIPE_TRANSFER_WRITE)) {
       tex_usage = LP_TEX_USAGE_READ;
       mode = "read";
    }
@@ -594,7 +768,7 @@ llvmpipe_transfer_map( struct pipe_context *pipe,
       printf("transfer map tex %u  mode %s\n", lpr->id, mode);
    }
 
-   format = lpr->base.format;
+   format = lpr->base.b.format;
 
    map = llvmpipe_resource_map(resource,
                                level,
@@ -608,7 +782,27 @@ llvmpipe_transfer_map( struct pipe_context *pipe,
    if (usage & PIPE_TRANSFER_WRITE) {
       /* Do something to notify sharing contexts of a texture change.
        */
-      screen->timestamp++;
+      p_atomic_inc(&screen->timestamp);
+   }
+
+   if (llvmpipe_resource_is_tiled(resource) || lpr->row_stride[level] < 0) {
+      pt->stride = box->width * util_format_get_blocksize(format);
+      pt->layer_stride = pt->stride * box->height;
+
+      lpt->staging = MALLOC(pt->layer_stride * box->depth);
+      if (!lpt->staging) {
+         pipe_resource_reference(&pt->resource, NULL);
+         FREE(lpt);
+         *transfer = NULL;
+         return NULL;
+      }
+
+      if (!(usage & (PIPE_TRANSFER_DISCARD_RANGE |
+                     PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE)))
+         llvmpipe_copy_staging_box(lpr, level, box, lpt->staging,
+                                   pt->stride, pt->layer_stride, FALSE);
+
+      return lpt->staging;
    }
 
    map +=
@@ -623,15 +817,29 @@ static void
 llvmpipe_transfer_unmap(struct pipe_context *pipe,
                         struct pipe_transfer *transfer)
 {
+   struct llvmpipe_transfer *lpt = llvmpipe_transfer(transfer);
+
    assert(transfer->resource);
 
+   if (lpt->staging) {
+      if (transfer->usage & PIPE_TRANSFER_WRITE)
+         llvmpipe_copy_staging_box(llvmpipe_resource(transfer->resource),
+                                   transfer->level, &transfer->box,
+                                   lpt->staging, transfer->stride,
+                                   transfer->layer_stride, TRUE);
+      FREE(lpt->staging);
+   }
+
    llvmpipe_resource_unmap(transfer->resource,
                            transfer->level,
                            transfer->box.z);
 
-   /* Effectively do the texture_update work here - if texture images
-    * needed post-processing to put them into hardware layout, this is
-    * where it would happen.  For llvmpipe, nothing to do.
+   if ((transfer->usage & PIPE_TRANSFER_WRITE) &&
+       (transfer->usage & TC_TRANSFER_MAP_THREADED_UNSYNC))
+      llvmpipe_dirty_fs_constants(llvmpipe_context(pipe), transfer->resource);
+
+   /* Staged textures were written back to their layout above, nothing
+    * else needs post-processing.
     */
    assert (transfer->resource);
    pipe_resource_reference(&transfer->resource, NULL);
@@ -653,6 +861,62 @@ llvmpipe_is_resource_referenced( struct pipe_context *pipe,
 }
 
 
+/**
+ * Called by the threaded context to give a buffer it invalidated the
+ * storage of a freshly allocated one, which gets the old storage and is
+ * destroyed afterwards.
+ */
+void
+llvmpipe_replace_buffer_storage(struct pipe_context *pipe,
+                                struct pipe_resource *dst,
+                                struct pipe_resource *src)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   struct llvmpipe_resource *lp_dst = llvmpipe_resource(dst);
+   struct llvmpipe_resource *lp_src = llvmpipe_resource(src);
+   void *old_data = lp_dst->data;
+   unsigned sh, i;
+
+   assert(dst->target == PIPE_BUFFER && src->target == PIPE_BUFFER);
+   assert(!lp_dst->userBuffer && !lp_src->userBuffer);
+
+   /* Scenes in flight may still read the old storage through texture
+    * buffers, so wait for them before it goes away with src.
+    */
+   llvmpipe_flush_resource(pipe, dst, 0,
+                           FALSE, /* read_only */
+                           TRUE, /* cpu_access */
+                           FALSE, /* do_not_block */
+                           __FUNCTION__);
+
+   lp_dst->data = lp_src->data;
+   lp_src->data = old_data;
+
+   /* The draw module was given pointers to the vertex and geometry shader
+    * constants, everything else is looked up at draw or validation time.
+    */
+   for (sh = PIPE_SHADER_VERTEX; sh <= PIPE_SHADER_GEOMETRY; sh++) {
+      if (sh == PIPE_SHADER_FRAGMENT)
+         continue;
+
+      for (i = 0; i < ARRAY_SIZE(llvmpipe->constants[sh]); ++i) {
+         const struct pipe_constant_buffer *cb = &llvmpipe->constants[sh][i];
+
+         if (cb->buffer == dst)
+            draw_set_mapped_constant_buffer(llvmpipe->draw, sh, i,
+                                            (ubyte *) lp_dst->data +
+                                            cb->buffer_offset,
+                                            cb->buffer_size);
+      }
+   }
+
+   llvmpipe_dirty_fs_constants(llvmpipe, dst);
+
+   if (dst->bind & PIPE_BIND_SAMPLER_VIEW)
+      llvmpipe->dirty |= LP_NEW_SAMPLER_VIEW;
+}
+
+
 /**
  * Returns the largest possible alignment for a format in llvmpipe
  */
@@ -698,20 +962,83 @@ llvmpipe_user_buffer_create(struct pipe_screen *screen,
    if (!buffer)
       return NULL;
 
-   pipe_reference_init(&buffer->base.reference, 1);
-   buffer->base.screen = screen;
-   buffer->base.format = PIPE_FORMAT_R8_UNORM; /* ?? */
-   buffer->base.bind = bind_flags;
-   buffer->base.usage = PIPE_USAGE_IMMUTABLE;
-   buffer->base.flags = 0;
-   buffer->base.width0 = bytes;
-   buffer->base.height0 = 1;
-   buffer->base.depth0 = 1;
-   buffer->base.array_size = 1;
+   pipe_reference_init(&buffer->base.b.reference, 1);
+   buffer->base.b.screen = screen;
+   buffer->base.b.format = PIPE_FORMAT_R8_UNORM; /* ?? */
+   buffer->base.b.bind = bind_flags;
+   buffer->base.b.usage = PIPE_USAGE_IMMUTABLE;
+   buffer->base.b.flags = 0;
+   buffer->base.b.width0 = bytes;
+   buffer->base.b.height0 = 1;
+   buffer->base.b.depth0 = 1;
+   buffer->base.b.array_size = 1;
    buffer->userBuffer = TRUE;
    buffer->data = ptr;
 
-   return &buffer->base;
+   threaded_resource_init(&buffer->base.b);
+   buffer->base.is_user_ptr = true;
+   util_range_add(&buffer->base.valid_buffer_range, 0, bytes);
+
+   return &buffer->base.b;
+}
+
+
+/**
+ * Create a 2D texture which renders directly into the user's memory.
+ * The rasterizer reads and writes whole 4x4 blocks of rows which it assumes
+ * to be 16-byte aligned, so only memory laid out like our own textures is
+ * accepted, and NULL is returned for anything else.
+ */
+static struct pipe_resource *
+llvmpipe_texture_from_user_memory(struct pipe_screen *_screen,
+                                  const struct pipe_resource *templat,
+                                  void *user_memory,
+                                  int stride)
+{
+   struct llvmpipe_screen *screen = llvmpipe_screen(_screen);
+   const unsigned abs_stride = stride < 0 ? -stride : stride;
+   struct llvmpipe_resource *lpr;
+
+   if ((templat->target != PIPE_TEXTURE_2D &&
+        templat->target != PIPE_TEXTURE_RECT) ||
+       templat->last_level != 0 ||
+       templat->depth0 != 1 ||
+       templat->array_size != 1 ||
+       templat->nr_samples > 1 ||
+       util_format_is_compressed(templat->format) ||
+       templat->width0 % LP_RASTER_BLOCK_SIZE != 0 ||
+       templat->height0 % LP_RASTER_BLOCK_SIZE != 0 ||
+       abs_stride < templat->width0 *
+                    util_format_get_blocksize(templat->format) ||
+       abs_stride % 16 != 0 ||
+       (uintptr_t) user_memory % 16 != 0 ||
+       (uint64_t) abs_stride * templat->height0 > LP_MAX_TEXTURE_SIZE)
+      return NULL;
+
+   lpr = CALLOC_STRUCT(llvmpipe_resource);
+   if (!lpr)
+      return NULL;
+
+   lpr->base.b = *templat;
+   pipe_reference_init(&lpr->base.b.reference, 1);
+   lpr->base.b.screen = &screen->base;
+   lpr->base.b.flags &= ~LP_RESOURCE_FLAG_TILED;
+
+   lpr->row_stride[0] = stride;
+   lpr->img_stride[0] = abs_stride * templat->height0;
+   lpr->tex_data = user_memory;
+   lpr->userBuffer = TRUE;
+
+   threaded_resource_init(&lpr->base.b);
+   lpr->base.is_user_ptr = true;
+
+   lpr->id = id_counter++;
+
+#ifdef DEBUG
+   insert_at_tail(&resource_list, lpr);
+#endif
+
+   return &lpr->base.b;
 }
 
 
@@ -736,7 +1063,7 @@ llvmpipe_get_texture_image_address(struct llvmpipe_resource *lpr,
 {
    unsigned offset;
 
-   assert(llvmpipe_resource_is_texture(&lpr->base));
+   assert(llvmpipe_resource_is_texture(&lpr->base.b));
 
    offset = lpr->mip_offsets[level];
 
@@ -776,11 +1103,11 @@ llvmpipe_print_resources(void)
 
    debug_printf("LLVMPIPE: current resources:\n");
    foreach(lpr, &resource_list) {
-      unsigned size = llvmpipe_resource_size(&lpr->base);
+      unsigned size = llvmpipe_resource_size(&lpr->base.b);
       debug_printf("resource %u at %p, size %ux%ux%u: %u bytes, refcount %u\n",
                    lpr->id, (void *) lpr,
-                   lpr->base.width0, lpr->base.height0, lpr->base.depth0,
-                   size, lpr->base.reference.count);
+                   lpr->base.b.width0, lpr->base.b.height0, lpr->base.b.depth0,
+                   size, lpr->base.b.reference.count);
       total += size;
       n++;
    }
@@ -809,6 +1136,7 @@ llvmpipe_init_screen_resource_funcs(struct pipe_screen *screen)
    screen->resource_destroy = llvmpipe_resource_destroy;
    screen->resource_from_handle = llvmpipe_resource_from_handle;
    screen->resource_get_handle = llvmpipe_resource_get_handle;
+   screen->texture_from_user_memory = llvmpipe_texture_from_user_memory;
    screen->can_create_resource = llvmpipe_can_create_resource;
 }
 
@@ -31,9 +31,17 @@
 
 #include "pipe/p_state.h"
 #include "util/u_debug.h"
+#include "util/u_threaded_context.h"
+#include "gallivm/lp_bld_sample.h"
 #include "lp_limits.h"
 
 
+/**
+ * Texture stored in tiles, see lp_tiled_texel_offset().
+ */
+#define LP_RESOURCE_FLAG_TILED  (PIPE_RESOURCE_FLAG_DRV_PRIV << 0)
+
+
 enum lp_texture_usage
 {
    LP_TEX_USAGE_READ = 100,
@@ -55,13 +63,17 @@ struct sw_displaytarget;
  * Textures are stored differently than other types of objects such as
  * vertex buffers and const buffers.
  * The latter are simple malloc'd blocks of memory.
+ * The threaded context requires the threaded_resource to come first.
  */
 struct llvmpipe_resource
 {
-   struct pipe_resource base;
+   struct threaded_resource base;
 
-   /** Row stride in bytes */
-   unsigned row_stride[LP_MAX_TEXTURE_LEVELS];
+   /**
+    * Row stride in bytes.  Negative for user memory holding an image stored
+    * bottom-up, whose tex_data points at the top row.
+    */
+   int row_stride[LP_MAX_TEXTURE_LEVELS];
    /** Image stride (for cube maps, array or 3D textures) in bytes */
    unsigned img_stride[LP_MAX_TEXTURE_LEVELS];
    /** Offset to start of mipmap level, in bytes */
@@ -76,7 +88,8 @@ struct llvmpipe_resource
    struct sw_displaytarget *dt;
 
    /**
-    * Malloc'ed data for regular textures, or a mapping to dt above.
+    * Malloc'ed data for regular textures, a mapping to dt above, or the
+    * user's memory for userBuffer textures.
     */
    void *tex_data;
 
@@ -99,9 +112,12 @@ struct llvmpipe_resource
 
 struct llvmpipe_transfer
 {
-   struct pipe_transfer base;
+   struct threaded_transfer base;
 
    unsigned long offset;
+
+   /** Linear copy of the box, for tiled and bottom-up textures */
+   void *staging;
 };
 
 
@@ -175,6 +191,29 @@ llvmpipe_resource_is_1d(const struct pipe_resource *resource)
 }
 
 
+/**
+ * Is the texture stored in tiles?  See LP_RESOURCE_FLAG_TILED.
+ */
+static inline boolean
+llvmpipe_resource_is_tiled(const struct pipe_resource *resource)
+{
+   return (resource->flags & LP_RESOURCE_FLAG_TILED) != 0;
+}
+
+
+/**
+ * lp_sampler_static_texture_state() plus the llvmpipe texture layout.
+ */
+static inline void
+llvmpipe_sampler_static_texture_state(struct lp_static_texture_state *state,
+                                      const struct pipe_sampler_view *view)
+{
+   lp_sampler_static_texture_state(state, view);
+   state->tiled = view && view->texture &&
+                  llvmpipe_resource_is_tiled(view->texture);
+}
+
+
 static inline unsigned
 llvmpipe_layer_stride(struct pipe_resource *resource,
                       unsigned level)
@@ -185,7 +224,7 @@ llvmpipe_layer_stride(struct pipe_resource *resource,
 }
 
 
-static inline unsigned
+static inline int
 llvmpipe_resource_stride(struct pipe_resource *resource,
                          unsigned level)
 {
@@ -236,4 +275,9 @@ llvmpipe_is_resource_referenced( struct pipe_context *pipe,
 unsigned
 llvmpipe_get_format_alignment(enum pipe_format format);
 
+void
+llvmpipe_replace_buffer_storage(struct pipe_context *pipe,
+                                struct pipe_resource *dst,
+                                struct pipe_resource *src);
+
 #endif /* LP_TEXTURE_H */
@@ -792,7 +792,8 @@ static void si_test_gds_memory_management(struct si_context *sctx,
 	exit(0);
 }
 
-static void si_disk_cache_create(struct si_screen *sscreen)
+static void si_disk_cache_create(struct si_screen *sscreen,
+				 const struct pipe_screen_config *config)
 {
 	/* Don't use the cache if shader dumping is enabled. */
 	if (sscreen->debug_flags & DBG_ALL_SHADERS)
@@ -831,6 +832,11 @@ static void si_disk_cache_create(struct si_screen *sscreen)
 		disk_cache_create(sscreen->info.name,
 				  cache_id,
 				  shader_debug_flags);
+
+	if (sscreen->disk_shader_cache)
+		disk_cache_set_codec(sscreen->disk_shader_cache,
+				     driQueryOptionstr(config->options,
+						       "disk_cache_codec"));
 }
 
 struct pipe_screen *radeonsi_screen_create(struct radeon_winsys *ws,
@@ -901,7 +907,7 @@ struct pipe_screen *radeonsi_screen_create(struct radeon_winsys *ws,
 		return NULL;
 	}
 
-	si_disk_cache_create(sscreen);
+	si_disk_cache_create(sscreen, config);
 
 	/* Determine the number of shader compiler threads. */
 	hw_threads = sysconf(_SC_NPROCESSORS_ONLN);
@@ -1935,9 +1935,10 @@ current_not_ready:
 	    !is_pure_monolithic &&
 	    thread_index < 0) {
 		/* Compile it asynchronously. */
-		util_queue_add_job(&sscreen->shader_compiler_queue_low_priority,
-				   shader, &shader->ready,
-				   si_build_shader_variant_low_priority, NULL);
+		util_queue_add_job_with_priority(&sscreen->shader_compiler_queue_low_priority,
+						 shader, &shader->ready,
+						 si_build_shader_variant_low_priority,
+						 NULL, UTIL_QUEUE_PRIORITY_LOW);
 
 		/* Add only after the ready fence was reset, to guard against a
 		 * race with si_bind_XX_shader. */
@@ -2171,8 +2172,9 @@ void si_schedule_initial_compile(struct si_context *sctx, unsigned processor,
 		compiler_ctx_state->debug = async_debug.base;
 	}
 
-	util_queue_add_job(&sctx->screen->shader_compiler_queue, job,
-			   ready_fence, execute, NULL);
+	util_queue_add_job_with_priority(&sctx->screen->shader_compiler_queue,
+					 job, ready_fence, execute, NULL,
+					 UTIL_QUEUE_PRIORITY_HIGH);
 
 	if (wait) {
 		util_queue_fence_wait(ready_fence);
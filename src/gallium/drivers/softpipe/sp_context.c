@@ -38,6 +38,7 @@
 #include "util/u_pstipple.h"
 #include "util/u_inlines.h"
 #include "util/u_upload_mgr.h"
+#include "util/u_threaded_context.h"
 #include "tgsi/tgsi_exec.h"
 #include "sp_buffer.h"
 #include "sp_clear.h"
@@ -356,6 +357,18 @@ softpipe_create_context(struct pipe_screen *screen,
    softpipe->pstipple.sampler = util_pstipple_create_sampler(&softpipe->pipe);
 #endif
 
+   /* Softpipe fences are always signalled, so flushes returning a fence
+    * can't be deferred and the threaded context gets no create_fence.
+    */
+   if ((flags & PIPE_CONTEXT_PREFER_THREADED) &&
+       !(flags & PIPE_CONTEXT_COMPUTE_ONLY) &&
+       sp_screen->use_tc) {
+      return threaded_context_create(&softpipe->pipe,
+                                     &sp_screen->pool_transfers,
+                                     softpipe_replace_buffer_storage,
+                                     NULL, NULL);
+   }
+
    return &softpipe->pipe;
 
  fail:
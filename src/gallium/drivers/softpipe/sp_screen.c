@@ -47,6 +47,8 @@
 #include "sp_public.h"
 
 DEBUG_GET_ONCE_BOOL_OPTION(use_llvm, "SOFTPIPE_USE_LLVM", FALSE)
+/* Unlike for hardware drivers, the threaded context is opt-in */
+DEBUG_GET_ONCE_BOOL_OPTION(use_tc, "GALLIUM_THREAD", FALSE)
 
 static const char *
 softpipe_get_vendor(struct pipe_screen *screen)
@@ -163,6 +165,8 @@ softpipe_get_param(struct pipe_screen *screen, enum pipe_cap param)
    case PIPE_CAP_COMPUTE:
       return 1;
    case PIPE_CAP_USER_VERTEX_BUFFERS:
+      /* The threaded context can't pass them through */
+      return !softpipe_screen(screen)->use_tc;
    case PIPE_CAP_STREAM_OUTPUT_PAUSE_RESUME:
    case PIPE_CAP_STREAM_OUTPUT_INTERLEAVE_BUFFERS:
    case PIPE_CAP_TGSI_VS_LAYER_VIEWPORT:
@@ -500,6 +504,7 @@ softpipe_destroy_screen( struct pipe_screen *screen )
    if(winsys->destroy)
       winsys->destroy(winsys);
 
+   slab_destroy_parent(&sp_screen->pool_transfers);
    FREE(screen);
 }
 
@@ -609,6 +614,9 @@ softpipe_create_screen(struct sw_winsys *winsys)
    screen->base.flush_frontbuffer = softpipe_flush_frontbuffer;
    screen->base.get_compute_param = softpipe_get_compute_param;
    screen->use_llvm = debug_get_option_use_llvm();
+   screen->use_tc = debug_get_option_use_tc();
+   slab_create_parent(&screen->pool_transfers,
+                      sizeof(struct softpipe_transfer), 16);
 
    softpipe_init_screen_texture_funcs(&screen->base);
    softpipe_init_screen_fence_funcs(&screen->base);
@@ -33,6 +33,7 @@
 
 #include "pipe/p_screen.h"
 #include "pipe/p_defines.h"
+#include "util/slab.h"
 
 
 struct sw_winsys;
@@ -47,6 +48,10 @@ struct softpipe_screen {
     */
    unsigned timestamp;
    boolean use_llvm;
+
+   /** Wrap contexts in a threaded context when the state tracker asks */
+   boolean use_tc;
+   struct slab_parent_pool pool_transfers;
 };
 
 static inline struct softpipe_screen *
@@ -214,7 +214,7 @@ struct BuilderSWR : public Builder {
       : Builder(pJitMgr)
    {
       pJitMgr->SetupNewModule();
-      gallivm = gallivm_create(pName, wrap(&JM()->mContext));
+      gallivm = gallivm_create(pName, wrap(&JM()->mContext), NULL);
       pJitMgr->mpCurrentModule = unwrap(gallivm->module);
    }
 
@@ -689,8 +689,13 @@ BuilderSWR::CompileGS(struct swr_context *ctx, swr_jit_gs_key &key)
                      wrap(hPrivateData), // (sampler context)
                      NULL, // thread data
                      sampler,
+                     NULL, // image
+                     NULL, // ssbos
+                     NULL, // ssbo sizes
+                     NULL, // shared memory
                      &gs->info.base,
-                     &gs_iface.base);
+                     &gs_iface.base,
+                     NULL); // compute shader iface
 
    lp_build_mask_end(&mask);
 
@@ -840,8 +845,13 @@ BuilderSWR::CompileVS(struct swr_context *ctx, swr_jit_vs_key &key)
                      wrap(hPrivateData), // (sampler context)
                      NULL, // thread data
                      sampler, // sampler
+                     NULL, // image
+                     NULL, // ssbos
+                     NULL, // ssbo sizes
+                     NULL, // shared memory
                      &swr_vs->info.base,
-                     NULL); // geometry shader face
+                     NULL, // geometry shader face
+                     NULL); // compute shader iface
 
    sampler->destroy(sampler);
 
@@ -1330,8 +1340,13 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_fs_key &key)
                      wrap(hPrivateData),
                      NULL, // thread data
                      sampler, // sampler
+                     NULL, // image
+                     NULL, // ssbos
+                     NULL, // ssbo sizes
+                     NULL, // shared memory
                      &swr_fs->info.base,
-                     NULL); // geometry shader face
+                     NULL, // geometry shader face
+                     NULL); // compute shader iface
 
    sampler->destroy(sampler);
 
@@ -934,6 +934,14 @@ struct pipe_context {
    void (*set_context_param)(struct pipe_context *ctx,
                              enum pipe_context_param param,
                              unsigned value);
+
+   /**
+    * Set the maximum number of threads the driver may use to compile the
+    * shaders of this context in the background.  0 means that shaders must
+    * be compiled when they are created.
+    */
+   void (*set_max_shader_compiler_threads)(struct pipe_context *ctx,
+                                           unsigned max_threads);
 };
 
 
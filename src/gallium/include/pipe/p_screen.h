@@ -222,6 +222,19 @@ struct pipe_screen {
                                                        const struct pipe_resource *t,
                                                        void *user_memory);
 
+   /**
+    * Create a single-level 2D texture stored in user memory, with rows
+    * \p stride bytes apart.  A negative stride means the image is stored
+    * bottom-up, \p user_memory then pointing at its top row.  The memory
+    * isn't copied, rendering goes directly into it.
+    *
+    * Optional, and drivers may return NULL for layouts they can't use.
+    */
+   struct pipe_resource * (*texture_from_user_memory)(struct pipe_screen *,
+                                                      const struct pipe_resource *t,
+                                                      void *user_memory,
+                                                      int stride);
+
    /**
     * Unlike pipe_resource::bind, which describes what state trackers want,
     * resources can have much greater capabilities in practice, often implied
@@ -442,6 +455,17 @@ struct pipe_screen {
     * \param uuid    pointer to a memory region of PIPE_UUID_SIZE bytes
     */
    void (*get_device_uuid)(struct pipe_screen *screen, char *uuid);
+
+   /**
+    * Return whether the background compilation of a shader CSO is finished,
+    * i.e. whether binding and drawing with it won't wait for the compiler.
+    *
+    * \param shader       shader CSO returned by create_*_state
+    * \param shader_type  PIPE_SHADER_* the shader was created for
+    */
+   boolean (*is_parallel_shader_compilation_finished)(struct pipe_screen *screen,
+                                                      void *shader,
+                                                      enum pipe_shader_type shader_type);
 };
 
 
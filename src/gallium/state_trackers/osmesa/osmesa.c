@@ -31,16 +31,15 @@
  * Otherwise we use softpipe.  The GALLIUM_DRIVER environment variable
  * may be set to "softpipe" or "llvmpipe" to override.
  *
- * With softpipe we could render directly into the user's buffer by using a
- * display target resource.  However, softpipe doesn't support "upside-down"
- * rendering which would be needed for the OSMESA_Y_UP=TRUE case.
+ * Drivers implementing pipe_screen::texture_from_user_memory (llvmpipe) can
+ * render directly into the user's buffer, the "upside-down" OSMESA_Y_UP=TRUE
+ * case using a negative row stride.  They only accept buffers laid out like
+ * their own textures though (for llvmpipe, a width and height multiple of 4
+ * pixels, with 16-byte aligned rows).
  *
- * With llvmpipe we could only render directly into the user's buffer when its
- * width and height is a multiple of the tile size (64 pixels).
- *
- * Because of these constraints we always render into ordinary resources then
- * copy the results to the user's buffer in the flush_front() function which
- * is called when the app calls glFlush/Finish.
+ * Otherwise, as with softpipe, we render into ordinary resources then copy
+ * the results to the user's buffer in the flush_front() function which is
+ * called when the app calls glFlush/Finish.
  *
  * In general, the OSMesa interface is pretty ugly and not a good match
  * for Gallium.  But we're interested in doing the best we can to preserve
@@ -88,6 +87,14 @@ struct osmesa_buffer
 
    void *map;
 
+   /**
+    * The user's buffer and row stride the color buffer renders directly
+    * into, or NULL and 0 if it's an ordinary resource copied to map in
+    * flush_front().
+    */
+   void *color_map;
+   int color_stride;
+
    struct osmesa_buffer *next;  /**< next in linked list */
 };
 
@@ -300,9 +307,47 @@ stfbi_to_osbuffer(struct st_framebuffer_iface *stfbi)
 }
 
 
+/**
+ * Return the row stride of the user's buffer in bytes, negative if it is
+ * stored bottom-up.
+ */
+static int
+osmesa_user_stride(const struct osmesa_context *osmesa,
+                   const struct osmesa_buffer *osbuffer)
+{
+   const unsigned bpp =
+      util_format_get_blocksize(osbuffer->visual.color_format);
+   int stride;
+
+   if (osmesa->user_row_length)
+      stride = bpp * osmesa->user_row_length;
+   else
+      stride = bpp * osbuffer->width;
+
+   return osmesa->y_up ? -stride : stride;
+}
+
+
+/**
+ * Have the color buffer validated again if it renders into user memory
+ * which isn't the current buffer, as laid out by the current pixel store
+ * state, anymore.
+ */
+static void
+osmesa_check_color_map(const struct osmesa_context *osmesa,
+                       struct osmesa_buffer *osbuffer)
+{
+   if (osbuffer->color_map &&
+       (osbuffer->color_map != osbuffer->map ||
+        osbuffer->color_stride != osmesa_user_stride(osmesa, osbuffer)))
+      p_atomic_inc(&osbuffer->stfb->stamp);
+}
+
+
 /**
  * Called via glFlush/glFinish.  This is where we copy the contents
- * of the driver's color buffer into the user-specified buffer.
+ * of the driver's color buffer into the user-specified buffer, unless the
+ * driver renders into it directly.
  */
 static boolean
 osmesa_st_framebuffer_flush_front(struct st_context_iface *stctx,
@@ -317,7 +362,7 @@ osmesa_st_framebuffer_flush_front(struct st_context_iface *stctx,
    struct pipe_box box;
    void *map;
    ubyte *src, *dst;
-   unsigned y, bytes, bpp;
+   unsigned y, bytes;
    int dst_stride;
 
    if (osmesa->pp) {
@@ -342,6 +387,22 @@ osmesa_st_framebuffer_flush_front(struct st_context_iface *stctx,
       pp_run(osmesa->pp, res, res, zsbuf);
    }
 
+   dst_stride = osmesa_user_stride(osmesa, osbuffer);
+
+   if (osbuffer->color_map == osbuffer->map &&
+       osbuffer->color_stride == dst_stride) {
+      /* Rendered directly into the user's buffer, just wait for it. */
+      struct pipe_screen *screen = get_st_manager()->screen;
+      struct pipe_fence_handle *fence = NULL;
+
+      pipe->flush(pipe, &fence, 0);
+      if (fence) {
+         screen->fence_finish(screen, NULL, fence, PIPE_TIMEOUT_INFINITE);
+         screen->fence_reference(screen, &fence, NULL);
+      }
+      return TRUE;
+   }
+
    u_box_2d(0, 0, res->width0, res->height0, &box);
 
    map = pipe->transfer_map(pipe, res, 0, PIPE_TRANSFER_READ, &box,
@@ -350,19 +411,14 @@ osmesa_st_framebuffer_flush_front(struct st_context_iface *stctx,
    /*
     * Copy the color buffer from the resource to the user's buffer.
     */
-   bpp = util_format_get_blocksize(osbuffer->visual.color_format);
    src = map;
    dst = osbuffer->map;
-   if (osmesa->user_row_length)
-      dst_stride = bpp * osmesa->user_row_length;
-   else
-      dst_stride = bpp * osbuffer->width;
-   bytes = bpp * res->width0;
+   bytes = util_format_get_blocksize(osbuffer->visual.color_format) *
+           res->width0;
 
-   if (osmesa->y_up) {
+   if (dst_stride < 0) {
       /* need to flip image upside down */
-      dst = dst + (res->height0 - 1) * dst_stride;
-      dst_stride = -dst_stride;
+      dst -= (int) (res->height0 - 1) * dst_stride;
    }
 
    for (y = 0; y < res->height0; y++) {
@@ -391,6 +447,7 @@ osmesa_st_framebuffer_validate(struct st_context_iface *stctx,
    struct pipe_screen *screen = get_st_manager()->screen;
    enum st_attachment_type i;
    struct osmesa_buffer *osbuffer = stfbi_to_osbuffer(stfbi);
+   OSMesaContext osmesa = (OSMesaContext) stctx->st_manager_private;
    struct pipe_resource templat;
 
    memset(&templat, 0, sizeof(templat));
@@ -434,8 +491,30 @@ osmesa_st_framebuffer_validate(struct st_context_iface *stctx,
       templat.format = format;
       templat.bind = bind;
       pipe_resource_reference(&out[i], NULL);
-      out[i] = osbuffer->textures[statts[i]] =
-         screen->resource_create(screen, &templat);
+
+      /* Try to render directly into the user's buffer. */
+      if (statts[i] == ST_ATTACHMENT_FRONT_LEFT) {
+         const int stride = osmesa_user_stride(osmesa, osbuffer);
+         ubyte *top = osbuffer->map;
+
+         if (stride < 0)
+            top -= (int) (osbuffer->height - 1) * stride;
+
+         osbuffer->color_map = NULL;
+         osbuffer->color_stride = 0;
+
+         if (screen->texture_from_user_memory)
+            out[i] = screen->texture_from_user_memory(screen, &templat,
+                                                      top, stride);
+         if (out[i]) {
+            osbuffer->color_map = osbuffer->map;
+            osbuffer->color_stride = stride;
+         }
+      }
+
+      if (!out[i])
+         out[i] = screen->resource_create(screen, &templat);
+      osbuffer->textures[statts[i]] = out[i];
    }
 
    return TRUE;
@@ -788,6 +867,7 @@ OSMesaMakeCurrent(OSMesaContext osmesa, void *buffer, GLenum type,
    osbuffer->width = width;
    osbuffer->height = height;
    osbuffer->map = buffer;
+   osmesa_check_color_map(osmesa, osbuffer);
 
    /* XXX unused for now */
    (void) osmesa_destroy_buffer;
@@ -851,6 +931,9 @@ OSMesaPixelStore(GLint pname, GLint value)
       fprintf(stderr, "Invalid pname in OSMesaPixelStore()\n");
       return;
    }
+
+   if (osmesa->current_buffer)
+      osmesa_check_color_map(osmesa, osmesa->current_buffer);
 }
 
 
@@ -0,0 +1,318 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Measures draw-call throughput with and without the threaded context.
+ *
+ * Every frame rewrites the vertex buffer with a full discard, issues many
+ * tiny draws and flushes, waiting for the fence of the previous frame, the
+ * way applications usually do.
+ *
+ * Usage: draw-overhead [draws per frame] [frames]
+ *
+ * Software drivers only use the threaded context with GALLIUM_THREAD=true,
+ * which this sets unless it's already set.
+ */
+
+#define WIDTH 256
+#define HEIGHT 256
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* pipe_*_state structs */
+#include "pipe/p_state.h"
+/* pipe_context */
+#include "pipe/p_context.h"
+/* pipe_screen */
+#include "pipe/p_screen.h"
+/* PIPE_* */
+#include "pipe/p_defines.h"
+/* TGSI_SEMANTIC_{POSITION|GENERIC} */
+#include "pipe/p_shader_tokens.h"
+/* pipe_buffer_* helpers */
+#include "util/u_inlines.h"
+
+/* constant state object helper */
+#include "cso_cache/cso_context.h"
+
+/* util_draw_arrays */
+#include "util/u_draw.h"
+/* FREE & CALLOC_STRUCT */
+#include "util/u_memory.h"
+/* util_make_[fragment|vertex]_passthrough_shader */
+#include "util/u_simple_shaders.h"
+/* os_time_get_nano */
+#include "util/os_time.h"
+/* to get a hardware pipe driver */
+#include "pipe-loader/pipe_loader.h"
+
+struct program
+{
+	struct pipe_loader_device *dev;
+	struct pipe_screen *screen;
+	struct pipe_context *pipe;
+	struct cso_context *cso;
+
+	struct pipe_blend_state blend;
+	struct pipe_depth_stencil_alpha_state depthstencil;
+	struct pipe_rasterizer_state rasterizer;
+	struct pipe_viewport_state viewport;
+	struct pipe_framebuffer_state framebuffer;
+	struct pipe_vertex_element velem[2];
+
+	void *vs;
+	void *fs;
+
+	union pipe_color_union clear_color;
+
+	unsigned num_draws;
+	struct pipe_resource *vbuf;
+	struct pipe_resource *target;
+};
+
+static void init_prog(struct program *p, unsigned flags)
+{
+	struct pipe_surface surf_tmpl;
+
+	/* create the pipe driver context and cso context */
+	p->pipe = p->screen->context_create(p->screen, NULL, flags);
+	p->cso = cso_create_context(p->pipe, 0);
+
+	p->clear_color.f[3] = 1.0;
+
+	/* one triangle per draw, rewritten every frame */
+	p->vbuf = pipe_buffer_create(p->screen, PIPE_BIND_VERTEX_BUFFER,
+				     PIPE_USAGE_STREAM,
+				     p->num_draws * 3 * 2 * 4 * sizeof(float));
+
+	/* render target texture */
+	{
+		struct pipe_resource tmplt;
+		memset(&tmplt, 0, sizeof(tmplt));
+		tmplt.target = PIPE_TEXTURE_2D;
+		tmplt.format = PIPE_FORMAT_B8G8R8A8_UNORM; /* All drivers support this */
+		tmplt.width0 = WIDTH;
+		tmplt.height0 = HEIGHT;
+		tmplt.depth0 = 1;
+		tmplt.array_size = 1;
+		tmplt.last_level = 0;
+		tmplt.bind = PIPE_BIND_RENDER_TARGET;
+
+		p->target = p->screen->resource_create(p->screen, &tmplt);
+	}
+
+	/* disabled blending/masking */
+	memset(&p->blend, 0, sizeof(p->blend));
+	p->blend.rt[0].colormask = PIPE_MASK_RGBA;
+
+	/* no-op depth/stencil/alpha */
+	memset(&p->depthstencil, 0, sizeof(p->depthstencil));
+
+	/* rasterizer */
+	memset(&p->rasterizer, 0, sizeof(p->rasterizer));
+	p->rasterizer.cull_face = PIPE_FACE_NONE;
+	p->rasterizer.half_pixel_center = 1;
+	p->rasterizer.bottom_edge_rule = 1;
+	p->rasterizer.depth_clip_near = 1;
+	p->rasterizer.depth_clip_far = 1;
+
+	surf_tmpl.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+	surf_tmpl.u.tex.level = 0;
+	surf_tmpl.u.tex.first_layer = 0;
+	surf_tmpl.u.tex.last_layer = 0;
+	/* drawing destination */
+	memset(&p->framebuffer, 0, sizeof(p->framebuffer));
+	p->framebuffer.width = WIDTH;
+	p->framebuffer.height = HEIGHT;
+	p->framebuffer.nr_cbufs = 1;
+	p->framebuffer.cbufs[0] = p->pipe->create_surface(p->pipe, p->target, &surf_tmpl);
+
+	/* viewport, depth isn't really needed */
+	memset(&p->viewport, 0, sizeof(p->viewport));
+	p->viewport.scale[0] = WIDTH / 2.0f;
+	p->viewport.scale[1] = HEIGHT / 2.0f;
+	p->viewport.scale[2] = 0.5f;
+	p->viewport.translate[0] = WIDTH / 2.0f;
+	p->viewport.translate[1] = HEIGHT / 2.0f;
+	p->viewport.translate[2] = 0.5f;
+
+	/* vertex elements state */
+	memset(p->velem, 0, sizeof(p->velem));
+	p->velem[0].src_offset = 0 * 4 * sizeof(float); /* offset 0, first element */
+	p->velem[0].instance_divisor = 0;
+	p->velem[0].vertex_buffer_index = 0;
+	p->velem[0].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+
+	p->velem[1].src_offset = 1 * 4 * sizeof(float); /* offset 16, second element */
+	p->velem[1].instance_divisor = 0;
+	p->velem[1].vertex_buffer_index = 0;
+	p->velem[1].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+
+	/* vertex shader */
+	{
+		const enum tgsi_semantic semantic_names[] =
+			{ TGSI_SEMANTIC_POSITION, TGSI_SEMANTIC_COLOR };
+		const uint semantic_indexes[] = { 0, 0 };
+		p->vs = util_make_vertex_passthrough_shader(p->pipe, 2, semantic_names, semantic_indexes, FALSE);
+	}
+
+	/* fragment shader */
+	p->fs = util_make_fragment_passthrough_shader(p->pipe,
+                    TGSI_SEMANTIC_COLOR, TGSI_INTERPOLATE_PERSPECTIVE, TRUE);
+}
+
+static void close_prog(struct program *p)
+{
+	cso_destroy_context(p->cso);
+
+	p->pipe->delete_vs_state(p->pipe, p->vs);
+	p->pipe->delete_fs_state(p->pipe, p->fs);
+
+	pipe_surface_reference(&p->framebuffer.cbufs[0], NULL);
+	pipe_resource_reference(&p->target, NULL);
+	pipe_resource_reference(&p->vbuf, NULL);
+
+	p->pipe->destroy(p->pipe);
+}
+
+static void write_vertices(struct program *p, unsigned frame)
+{
+	struct pipe_transfer *transfer;
+	float (*v)[2][4];
+
+	v = pipe_buffer_map(p->pipe, p->vbuf,
+			    PIPE_TRANSFER_WRITE |
+			    PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE,
+			    &transfer);
+	if (!v)
+		return;
+
+	/* a small triangle somewhere on the screen for each draw */
+	for (unsigned i = 0; i < p->num_draws * 3; i++) {
+		float x = ((i / 3 + frame) % 64) / 32.0f - 1.0f;
+		float y = ((i / 3) / 64 % 64) / 32.0f - 1.0f;
+
+		v[i][0][0] = x + (i % 3 == 1 ? 0.03f : 0.0f);
+		v[i][0][1] = y + (i % 3 == 2 ? 0.03f : 0.0f);
+		v[i][0][2] = 0.0f;
+		v[i][0][3] = 1.0f;
+
+		v[i][1][0] = (i % 3) == 0;
+		v[i][1][1] = (i % 3) == 1;
+		v[i][1][2] = (i % 3) == 2;
+		v[i][1][3] = 1.0f;
+	}
+
+	pipe_buffer_unmap(p->pipe, transfer);
+}
+
+static double run(struct program *p, unsigned flags, unsigned frames)
+{
+	struct pipe_fence_handle *fence = NULL, *prev_fence = NULL;
+	struct pipe_vertex_buffer vbuf;
+	int64_t start;
+
+	init_prog(p, flags);
+
+	memset(&vbuf, 0, sizeof(vbuf));
+	vbuf.stride = 2 * 4 * sizeof(float);
+	vbuf.buffer.resource = p->vbuf;
+
+	cso_set_framebuffer(p->cso, &p->framebuffer);
+	cso_set_blend(p->cso, &p->blend);
+	cso_set_depth_stencil_alpha(p->cso, &p->depthstencil);
+	cso_set_rasterizer(p->cso, &p->rasterizer);
+	cso_set_viewport(p->cso, &p->viewport);
+	cso_set_fragment_shader_handle(p->cso, p->fs);
+	cso_set_vertex_shader_handle(p->cso, p->vs);
+	cso_set_vertex_elements(p->cso, 2, p->velem);
+	cso_set_vertex_buffers(p->cso, 0, 1, &vbuf);
+
+	start = os_time_get_nano();
+
+	for (unsigned f = 0; f < frames; f++) {
+		write_vertices(p, f);
+
+		p->pipe->clear(p->pipe, PIPE_CLEAR_COLOR, &p->clear_color, 0, 0);
+
+		for (unsigned i = 0; i < p->num_draws; i++)
+			util_draw_arrays(p->pipe, PIPE_PRIM_TRIANGLES, i * 3, 3);
+
+		/* keep one frame in flight */
+		p->pipe->flush(p->pipe, &fence, PIPE_FLUSH_ASYNC);
+		if (prev_fence) {
+			p->screen->fence_finish(p->screen, p->pipe, prev_fence,
+						PIPE_TIMEOUT_INFINITE);
+			p->screen->fence_reference(p->screen, &prev_fence, NULL);
+		}
+		prev_fence = fence;
+		fence = NULL;
+	}
+
+	if (prev_fence) {
+		p->screen->fence_finish(p->screen, p->pipe, prev_fence,
+					PIPE_TIMEOUT_INFINITE);
+		p->screen->fence_reference(p->screen, &prev_fence, NULL);
+	}
+
+	double secs = (os_time_get_nano() - start) / 1e9;
+
+	close_prog(p);
+
+	return (double)frames * p->num_draws / secs;
+}
+
+int main(int argc, char** argv)
+{
+	struct program *p = CALLOC_STRUCT(program);
+	unsigned frames;
+	int ret;
+
+	p->num_draws = argc > 1 ? atoi(argv[1]) : 2000;
+	frames = argc > 2 ? atoi(argv[2]) : 100;
+	if (!p->num_draws || !frames)
+		return 1;
+
+	/* must be done before the screen reads it */
+	setenv("GALLIUM_THREAD", "true", 0);
+
+	/* find a hardware device */
+	ret = pipe_loader_probe(&p->dev, 1);
+	assert(ret);
+
+	/* init a pipe screen */
+	p->screen = pipe_loader_create_screen(p->dev);
+	assert(p->screen);
+
+	printf("%s, %u draws per frame, %u frames\n",
+	       p->screen->get_name(p->screen), p->num_draws, frames);
+	printf("direct:   %10.0f draws/s\n", run(p, 0, frames));
+	printf("threaded: %10.0f draws/s\n",
+	       run(p, PIPE_CONTEXT_PREFER_THREADED, frames));
+
+	p->screen->destroy(p->screen);
+	pipe_loader_release(&p->dev, 1);
+	FREE(p);
+
+	return 0;
+}
@@ -1571,6 +1571,9 @@ check_init_viewport(struct gl_context *ctx, GLuint width, GLuint height)
          _mesa_set_viewport(ctx, i, 0, 0, width, height);
          _mesa_set_scissor(ctx, i, 0, 0, width, height);
       }
+
+      /* glthread may have read the viewport before it was initialized. */
+      _mesa_glthread_invalidate_state(ctx);
    }
 }
 
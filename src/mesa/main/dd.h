@@ -492,6 +492,19 @@ struct dd_function_table {
     */
    GLboolean (*LinkShader)(struct gl_context *ctx,
                            struct gl_shader_program *shader);
+
+   /**
+    * Set the number of threads the driver may use to compile shaders in
+    * the background (GL_KHR_parallel_shader_compile).
+    */
+   void (*SetMaxShaderCompilerThreads)(struct gl_context *ctx, unsigned count);
+
+   /**
+    * Return whether the driver is done compiling the code of a linked
+    * program in the background (GL_COMPLETION_STATUS_KHR).
+    */
+   bool (*GetShaderProgramCompletionStatus)(struct gl_context *ctx,
+                                            struct gl_shader_program *shprog);
    /*@}*/
 
 
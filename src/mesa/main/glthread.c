@@ -220,4 +220,25 @@ _mesa_glthread_finish(struct gl_context *ctx)
 
    if (synced)
       p_atomic_inc(&glthread->stats.num_syncs);
+
+   /* The worker thread is idle, so this is the time to read back the state
+    * that isn't known on this thread.
+    */
+   _mesa_glthread_read_state(ctx);
+}
+
+/**
+ * Called when the state tracked on the main thread is changed in a way that
+ * isn't tracked, including outside of the GL API.
+ */
+void
+_mesa_glthread_invalidate_state(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   if (!glthread)
+      return;
+
+   glthread->arrays_dirty = true;
+   glthread->inside_begin_end = true;
+   glthread->shadow.valid = 0;
 }
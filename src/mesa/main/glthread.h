@@ -43,8 +43,16 @@
  */
 #define MARSHAL_MAX_BATCHES 8
 
+/* The maximum number of bytes of user vertex and index data that draws can
+ * have copied to the heap for the worker thread.  Draws needing more than
+ * that wait for the worker thread to catch up and are executed directly.
+ */
+#define MARSHAL_MAX_UPLOAD_SIZE (64 * 1024 * 1024)
+
 #include <inttypes.h>
 #include <stdbool.h>
+#include "main/glheader.h"
+#include "compiler/shader_enums.h"
 #include "util/u_queue.h"
 
 enum marshal_dispatch_cmd_id;
@@ -66,6 +74,73 @@ struct glthread_batch
    uint8_t buffer[MARSHAL_MAX_CMD_SIZE];
 };
 
+/** A vertex array as the main thread sees it. */
+struct glthread_attrib
+{
+   /** Address of element 0, in user memory or as an offset into a VBO. */
+   const GLubyte *pointer;
+
+   /** Size of one element in bytes. */
+   GLuint element_size;
+
+   /** Distance between elements in bytes. */
+   GLsizei stride;
+
+   /** Instance divisor, 0 for per-vertex arrays. */
+   GLuint divisor;
+};
+
+/**
+ * Groups of the state in glthread_shadow, valid separately.
+ */
+#define GLTHREAD_SHADOW_BUFFERS         (1 << 0)
+#define GLTHREAD_SHADOW_TEXTURE         (1 << 1)
+#define GLTHREAD_SHADOW_ENABLES         (1 << 2)
+#define GLTHREAD_SHADOW_VIEWPORT        (1 << 3)
+#define GLTHREAD_SHADOW_SCISSOR         (1 << 4)
+#define GLTHREAD_SHADOW_PIXEL_STORE     (1 << 5)
+#define GLTHREAD_SHADOW_ALL             ((1 << 6) - 1)
+
+struct glthread_pixel_store
+{
+   GLint alignment;
+   GLint row_length;
+   GLint skip_pixels;
+   GLint skip_rows;
+};
+
+/**
+ * Commonly queried state, shadowed on the main thread so that glGet*() can
+ * return it without waiting for the worker thread.
+ *
+ * A group is only used while its GLTHREAD_SHADOW_* bit is set in \c valid.
+ * Calls changing it in ways that aren't tracked clear the bit, and the group
+ * is read back from the context the next time the main thread waits for the
+ * worker thread anyway.
+ */
+struct glthread_shadow
+{
+   GLbitfield valid;
+
+   /** GLTHREAD_SHADOW_BUFFERS: buffer object names. */
+   GLuint array_buffer;
+   GLuint element_array_buffer;
+
+   /** GLTHREAD_SHADOW_TEXTURE: GL_TEXTURE0 + the active texture unit. */
+   GLenum active_texture;
+
+   /** GLTHREAD_SHADOW_ENABLES: bits of the caps in shadow_enables[]. */
+   GLbitfield enables;
+
+   /** GLTHREAD_SHADOW_VIEWPORT, GLTHREAD_SHADOW_SCISSOR: x, y, w, h. */
+   GLint viewport[4];
+   GLint scissor[4];
+
+   /** GLTHREAD_SHADOW_PIXEL_STORE */
+   struct glthread_pixel_store pack;
+   struct glthread_pixel_store unpack;
+};
+
 struct glthread_state
 {
    /** Multithreaded queue. */
@@ -94,6 +169,46 @@ struct glthread_state
     * buffer) binding is in a VBO.
     */
    bool element_array_is_vbo;
+
+   /**
+    * The vertex arrays of the bound vertex array object, tracked on the main
+    * thread so that draws can copy the user memory they read instead of
+    * waiting for the worker thread.
+    */
+   struct glthread_attrib attribs[VERT_ATTRIB_MAX];
+
+   /** Mask of VERT_BIT_* values of the enabled arrays. */
+   GLbitfield enabled_attribs;
+
+   /** Mask of VERT_BIT_* values of the arrays in user memory. */
+   GLbitfield user_attribs;
+
+   /** Client active texture unit, for glTexCoordPointer(). */
+   GLuint client_active_texture;
+
+   /** Primitive restart state, for the index range of glDrawElements(). */
+   bool primitive_restart;
+   bool primitive_restart_fixed_index;
+   GLuint restart_index;
+
+   /**
+    * Set when the vertex arrays were changed in a way that isn't tracked.
+    * The next draw reading user memory waits for the worker thread and
+    * reads the arrays back from the context.
+    */
+   bool arrays_dirty;
+
+   /** Bytes of vertex and index data copied to the heap and not freed yet. */
+   unsigned upload_size;
+
+   /**
+    * Whether glBegin() was called without glEnd().  Most calls are errors
+    * and don't change anything then, including glGet*().
+    */
+   bool inside_begin_end;
+
+   /** State returned by glGet*() without synchronizing. */
+   struct glthread_shadow shadow;
 };
 
 void _mesa_glthread_init(struct gl_context *ctx);
@@ -102,5 +217,6 @@ void _mesa_glthread_destroy(struct gl_context *ctx);
 void _mesa_glthread_restore_dispatch(struct gl_context *ctx, const char *func);
 void _mesa_glthread_flush_batch(struct gl_context *ctx);
 void _mesa_glthread_finish(struct gl_context *ctx);
+void _mesa_glthread_invalidate_state(struct gl_context *ctx);
 
 #endif /* _GLTHREAD_H*/
@@ -37,7 +37,535 @@
 #include "errors.h"
 #include "glheader.h"
 #include "hash.h"
+#include "util/bitscan.h"
 #include "util/hash_table.h"
+#include "util/u_atomic.h"
+#include "util/u_math.h"
+
+
+/**
+ * \name Free key tracking
+ *
+ * A tree tracking which keys are in use, so that blocks of free keys can be
+ * found without probing the hash table key by key.
+ *
+ * Leaves are bitmaps of KEY_LEAF_SIZE keys, and inner nodes have
+ * KEY_NODE_SIZE children.  Each node records, for each of its children, the
+ * longest runs of free keys at the start, at the end and anywhere within the
+ * child.  That's enough to find the lowest block of N free keys by walking
+ * down from the root, and to update the runs when a key is inserted or
+ * removed, stopping at the first node whose runs don't change.
+ *
+ * A missing child means that all of its keys are free, so the tree only
+ * holds nodes around used keys.  The root covers key 0, which is never free,
+ * and as many keys above it as needed for the highest used key: all the keys
+ * above the root are free.
+ */
+/*@{*/
+
+#define KEY_LEAF_BITS 9
+#define KEY_LEAF_SIZE (1 << KEY_LEAF_BITS)
+#define KEY_NODE_BITS 4
+#define KEY_NODE_SIZE (1 << KEY_NODE_BITS)
+#define KEY_MAX_HEIGHT DIV_ROUND_UP(32 - KEY_LEAF_BITS, KEY_NODE_BITS)
+
+/* ~0 may be used as a name, but is never returned by
+ * _mesa_HashFindFreeKeyBlock(), so it's not tracked.
+ */
+#define KEY_MAX (~0u - 1)
+
+struct hash_key_runs {
+   uint32_t prefix_free;
+   uint32_t suffix_free;
+   uint32_t max_free;
+};
+
+struct hash_key_leaf {
+   uint64_t used[KEY_LEAF_SIZE / 64];
+};
+
+struct hash_key_node {
+   struct hash_key_runs runs[KEY_NODE_SIZE];
+   void *child[KEY_NODE_SIZE];
+};
+
+struct hash_free_keys {
+   void *root;
+   unsigned height;                /**< 0 if the root is a leaf */
+   struct hash_key_runs runs;      /**< free runs of the root */
+};
+
+/** Number of keys covered by a node */
+static inline uint64_t
+key_node_size(unsigned height)
+{
+   return (uint64_t) 1 << (KEY_LEAF_BITS + height * KEY_NODE_BITS);
+}
+
+static inline unsigned
+key_node_child(unsigned height, GLuint key)
+{
+   const unsigned shift = KEY_LEAF_BITS + (height - 1) * KEY_NODE_BITS;
+   return ((uint64_t) key >> shift) & (KEY_NODE_SIZE - 1);
+}
+
+/**
+ * Accumulates the runs of consecutive ranges of keys into those of the whole.
+ */
+struct hash_key_runs_builder {
+   uint64_t prefix_free;
+   uint64_t run;
+   uint64_t max_free;
+   bool all_free;
+};
+
+static inline void
+key_runs_add(struct hash_key_runs_builder *b, uint64_t size, uint64_t prefix_free,
+             uint64_t suffix_free, uint64_t max_free)
+{
+   if (prefix_free == size) {
+      b->run += size;
+      if (b->all_free)
+         b->prefix_free += size;
+   } else {
+      if (b->all_free)
+         b->prefix_free += prefix_free;
+      b->max_free = MAX3(b->max_free, max_free, b->run + prefix_free);
+      b->run = suffix_free;
+      b->all_free = false;
+   }
+}
+
+static inline void
+key_runs_finish(const struct hash_key_runs_builder *b, struct hash_key_runs *runs)
+{
+   /* Only the root covers more than 2^32 keys, and key 0 is never free, so
+    * these fit.
+    */
+   assert(b->run <= UINT32_MAX && b->max_free <= UINT32_MAX);
+   runs->prefix_free = b->prefix_free;
+   runs->suffix_free = b->run;
+   runs->max_free = MAX2(b->max_free, b->run);
+}
+
+/** Longest run of zero bits */
+static unsigned
+word_max_free(uint64_t used)
+{
+   uint64_t free_bits = ~used;
+   unsigned max_free = 0;
+
+   while (free_bits) {
+      const unsigned start = ffsll(free_bits) - 1;
+      const uint64_t rest = used >> start;
+      const unsigned len = rest ? ffsll(rest) - 1 : 64 - start;
+
+      max_free = MAX2(max_free, len);
+      if (start + len == 64)
+         break;
+      free_bits &= ~0ull << (start + len);
+   }
+
+   return max_free;
+}
+
+static void
+key_leaf_runs(const struct hash_key_leaf *leaf, struct hash_key_runs *runs)
+{
+   struct hash_key_runs_builder b = { .all_free = true };
+
+   for (unsigned i = 0; i < ARRAY_SIZE(leaf->used); i++) {
+      const uint64_t used = leaf->used[i];
+
+      if (used) {
+         key_runs_add(&b, 64, ffsll(used) - 1, 64 - util_last_bit64(used),
+                      word_max_free(used));
+      } else {
+         key_runs_add(&b, 64, 64, 64, 64);
+      }
+   }
+
+   key_runs_finish(&b, runs);
+}
+
+static void
+key_node_runs(const struct hash_key_node *node, unsigned height,
+              struct hash_key_runs *runs)
+{
+   const uint64_t child_size = key_node_size(height - 1);
+   struct hash_key_runs_builder b = { .all_free = true };
+
+   for (unsigned i = 0; i < KEY_NODE_SIZE; i++) {
+      key_runs_add(&b, child_size, node->runs[i].prefix_free,
+                   node->runs[i].suffix_free, node->runs[i].max_free);
+   }
+
+   key_runs_finish(&b, runs);
+}
+
+static inline bool
+key_runs_all_free(const struct hash_key_runs *runs, unsigned height)
+{
+   return runs->prefix_free == key_node_size(height);
+}
+
+static struct hash_key_node *
+key_node_create(unsigned height)
+{
+   struct hash_key_node *node = calloc(1, sizeof(*node));
+   const uint64_t child_size = key_node_size(height - 1);
+
+   if (!node)
+      return NULL;
+
+   for (unsigned i = 0; i < KEY_NODE_SIZE; i++) {
+      /* Keys above ~0 don't exist, leave them marked used. */
+      if (i * child_size <= UINT32_MAX) {
+         node->runs[i].prefix_free = child_size;
+         node->runs[i].suffix_free = child_size;
+         node->runs[i].max_free = child_size;
+      }
+   }
+
+   return node;
+}
+
+static void
+key_node_destroy(void *node, unsigned height)
+{
+   if (!node)
+      return;
+
+   if (height) {
+      struct hash_key_node *inner = node;
+
+      for (unsigned i = 0; i < KEY_NODE_SIZE; i++)
+         key_node_destroy(inner->child[i], height - 1);
+   }
+   free(node);
+}
+
+/**
+ * Mark a key used or free.
+ *
+ * \return false if we ran out of memory, leaving the tree unusable.
+ */
+static bool
+free_keys_set(struct hash_free_keys *keys, GLuint key, bool used)
+{
+   struct hash_key_node *path[KEY_MAX_HEIGHT];
+   unsigned path_child[KEY_MAX_HEIGHT];
+   struct hash_key_runs runs;
+   void *node;
+
+   /* Grow the root to cover the key. */
+   while ((uint64_t) key >= key_node_size(keys->height)) {
+      struct hash_key_node *root;
+
+      if (!used)
+         return true;
+
+      root = key_node_create(keys->height + 1);
+      if (!root)
+         return false;
+
+      root->child[0] = keys->root;
+      root->runs[0] = keys->runs;
+      keys->root = root;
+      keys->height++;
+      key_node_runs(root, keys->height, &keys->runs);
+   }
+
+   node = keys->root;
+   for (unsigned h = keys->height; h > 0; h--) {
+      struct hash_key_node *inner = node;
+      const unsigned i = key_node_child(h, key);
+
+      if (!inner->child[i]) {
+         if (!used)
+            return true;
+
+         if (h > 1)
+            inner->child[i] = key_node_create(h - 1);
+         else
+            inner->child[i] = calloc(1, sizeof(struct hash_key_leaf));
+         if (!inner->child[i])
+            return false;
+      }
+
+      path[h - 1] = inner;
+      path_child[h - 1] = i;
+      node = inner->child[i];
+   }
+
+   {
+      struct hash_key_leaf *leaf = node;
+      const uint64_t bit = (uint64_t) 1 << (key % 64);
+
+      if (used)
+         leaf->used[(key % KEY_LEAF_SIZE) / 64] |= bit;
+      else
+         leaf->used[(key % KEY_LEAF_SIZE) / 64] &= ~bit;
+
+      key_leaf_runs(leaf, &runs);
+   }
+
+   /* Update the runs back up to the first node whose runs don't change, as
+    * its parents' can't either.  Nodes which are now all free are dropped.
+    */
+   for (unsigned h = 0; h < keys->height; h++) {
+      struct hash_key_node *parent = path[h];
+      const unsigned i = path_child[h];
+
+      if (!memcmp(&parent->runs[i], &runs, sizeof(runs)))
+         return true;
+
+      parent->runs[i] = runs;
+      if (key_runs_all_free(&runs, h)) {
+         free(parent->child[i]);
+         parent->child[i] = NULL;
+      }
+
+      key_node_runs(parent, h + 1, &runs);
+   }
+   keys->runs = runs;
+
+   /* Shrink the root down to the highest used key. */
+   while (keys->height) {
+      struct hash_key_node *root = keys->root;
+
+      for (unsigned i = 1; i < KEY_NODE_SIZE; i++) {
+         if (root->child[i])
+            return true;
+      }
+
+      keys->root = root->child[0];
+      keys->runs = root->runs[0];
+      keys->height--;
+      free(root);
+   }
+
+   return true;
+}
+
+/**
+ * Return the lowest key starting a block of \p count free keys, or 0.
+ */
+static GLuint
+free_keys_find(const struct hash_free_keys *keys, uint64_t count)
+{
+   const void *node = keys->root;
+   unsigned height = keys->height;
+   uint64_t base = 0;
+
+   /* The run at the end of the root continues with the keys above it, so
+    * it's always the last candidate.
+    */
+   if (keys->runs.max_free < count) {
+      base = key_node_size(height) - keys->runs.suffix_free;
+      return base + count - 1 <= KEY_MAX ? base : 0;
+   }
+
+   while (node && height) {
+      const struct hash_key_node *inner = node;
+      const uint64_t child_size = key_node_size(height - 1);
+      uint64_t run = 0;
+      unsigned i;
+
+      for (i = 0; i < KEY_NODE_SIZE; i++) {
+         const struct hash_key_runs *runs = &inner->runs[i];
+
+         /* A run starting before this child comes first. */
+         if (run + runs->prefix_free >= count) {
+            base += i * child_size - run;
+            return base + count - 1 <= KEY_MAX ? base : 0;
+         }
+         if (runs->max_free >= count)
+            break;
+
+         run = key_runs_all_free(runs, height - 1) ? run + child_size :
+                                                     runs->suffix_free;
+      }
+
+      assert(i < KEY_NODE_SIZE);
+      base += i * child_size;
+      node = inner->child[i];
+      height--;
+   }
+
+   if (node) {
+      const struct hash_key_leaf *leaf = node;
+      uint64_t run = 0;
+
+      for (unsigned i = 0; i < ARRAY_SIZE(leaf->used); i++) {
+         const uint64_t used = leaf->used[i];
+         const uint64_t free_bits = ~used;
+
+         if (run + (used ? ffsll(used) - 1 : 64) >= count) {
+            base += i * 64 - run;
+            break;
+         }
+
+         if (count <= 64) {
+            /* Bit j of starts is set if bits j to j + count - 1 are free. */
+            uint64_t starts = free_bits;
+
+            for (unsigned j = 1; j < count && starts; j++)
+               starts &= free_bits >> j;
+
+            if (starts) {
+               base += i * 64 + ffsll(starts) - 1;
+               break;
+            }
+         }
+
+         run = used ? 64 - util_last_bit64(used) : run + 64;
+      }
+   }
+
+   return base + count - 1 <= KEY_MAX ? base : 0;
+}
+
+static void
+free_keys_destroy(struct hash_free_keys *keys)
+{
+   if (keys) {
+      key_node_destroy(keys->root, keys->height);
+      free(keys);
+   }
+}
+
+/**
+ * Start tracking free keys, with all keys free but 0, which isn't a valid
+ * name.
+ */
+static struct hash_free_keys *
+free_keys_create(void)
+{
+   struct hash_free_keys *keys = calloc(1, sizeof(*keys));
+   struct hash_key_leaf *leaf = calloc(1, sizeof(*leaf));
+
+   if (!keys || !leaf) {
+      free(keys);
+      free(leaf);
+      return NULL;
+   }
+
+   leaf->used[0] = 1;
+   keys->root = leaf;
+   key_leaf_runs(leaf, &keys->runs);
+   return keys;
+}
+
+static void
+free_keys_mark(struct _mesa_HashTable *table, GLuint key, bool used)
+{
+   if (!table->FreeKeys || key == 0 || key > KEY_MAX)
+      return;
+
+   if (!free_keys_set(table->FreeKeys, key, used)) {
+      /* A key we failed to track would be handed out again. */
+      free_keys_destroy(table->FreeKeys);
+      table->FreeKeys = NULL;
+   }
+}
+
+/*@}*/
+
+
+/**
+ * \name Lockless lookups
+ *
+ * GL object names are mostly small and dense, so besides the hash table, we
+ * keep an array of the data of the keys below its size, which lookups can
+ * read without locking the table.  The table still needs to be locked to
+ * change it.
+ *
+ * The array is replaced by a larger one when keys above it are inserted, as
+ * long as it stays within a few times the number of entries: lookups of
+ * sparse keys just lock the table.  Lookups may still be reading the
+ * previous arrays, so those are only freed with the table.  As the size at
+ * least doubles each time, that at most doubles the memory used.
+ */
+/*@{*/
+
+#define LOOKUP_ARRAY_MIN_SIZE 64
+
+struct hash_lookup_array {
+   GLuint size;
+   struct hash_lookup_array *previous;
+   void *data[];
+};
+
+static void
+lookup_array_set(struct _mesa_HashTable *table, GLuint key, void *data)
+{
+   struct hash_lookup_array *array = table->LookupArray;
+
+   if (array && key < array->size) {
+      /* Make the object visible to lookups before its pointer. */
+      p_atomic_set(&array->data[key], data);
+      return;
+   }
+
+   if (!data)
+      return;
+
+   const GLuint max_size =
+      MAX2(LOOKUP_ARRAY_MIN_SIZE,
+           2 * util_next_power_of_two(_mesa_HashNumEntries(table)));
+   if (key >= max_size)
+      return;
+
+   const GLuint size = MAX2(LOOKUP_ARRAY_MIN_SIZE,
+                            util_next_power_of_two(key + 1));
+   struct hash_lookup_array *new_array =
+      calloc(1, sizeof(*new_array) + size * sizeof(new_array->data[0]));
+
+   /* Lookups of the keys above the array just keep locking the table. */
+   if (!new_array)
+      return;
+
+   new_array->size = size;
+   new_array->previous = array;
+
+   hash_table_foreach(table->ht, entry) {
+      const GLuint entry_key = (uintptr_t) entry->key;
+
+      if (entry_key < size)
+         new_array->data[entry_key] = entry->data;
+   }
+   new_array->data[DELETED_KEY_VALUE] = table->deleted_key_data;
+
+   p_atomic_set(&table->LookupArray, new_array);
+}
+
+static void
+lookup_array_clear(struct _mesa_HashTable *table)
+{
+   struct hash_lookup_array *array = table->LookupArray;
+
+   if (array) {
+      for (GLuint i = 0; i < array->size; i++)
+         p_atomic_set(&array->data[i], NULL);
+   }
+}
+
+static void
+lookup_array_destroy(struct _mesa_HashTable *table)
+{
+   struct hash_lookup_array *array = table->LookupArray;
+
+   while (array) {
+      struct hash_lookup_array *previous = array->previous;
+
+      free(array);
+      array = previous;
+   }
+   table->LookupArray = NULL;
+}
+
+/*@}*/
 
 
 /**
@@ -65,6 +593,8 @@ _mesa_NewHashTable(void)
        * is allowed to call _mesa_HashRemove().
        */
       mtx_init(&table->Mutex, mtx_recursive);
+
+      table->FreeKeys = free_keys_create();
    }
    else {
       _mesa_error_no_memory(__func__);
@@ -93,6 +623,8 @@ _mesa_DeleteHashTable(struct _mesa_HashTable *table)
    }
 
    _mesa_hash_table_destroy(table->ht, NULL);
+   free_keys_destroy(table->FreeKeys);
+   lookup_array_destroy(table);
 
    mtx_destroy(&table->Mutex);
    free(table);
@@ -127,6 +659,8 @@ _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 
 /**
  * Lookup an entry in the hash table.
+ *
+ * Doesn't lock the table if the key is covered by the lookup array.
  * 
  * \param table the hash table.
  * \param key the key.
@@ -136,7 +670,12 @@ _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 void *
 _mesa_HashLookup(struct _mesa_HashTable *table, GLuint key)
 {
+   const struct hash_lookup_array *array = p_atomic_read(&table->LookupArray);
    void *res;
+
+   if (array && key < array->size)
+      return p_atomic_read(&array->data[key]);
+
    _mesa_HashLockMutex(table);
    res = _mesa_HashLookup_unlocked(table, key);
    _mesa_HashUnlockMutex(table);
@@ -176,14 +715,18 @@ _mesa_HashInsert_unlocked(struct _mesa_HashTable *table, GLuint key, void *data)
 
    if (key == DELETED_KEY_VALUE) {
       table->deleted_key_data = data;
+      free_keys_mark(table, key, true);
    } else {
       entry = _mesa_hash_table_search_pre_hashed(table->ht, hash, uint_key(key));
       if (entry) {
          entry->data = data;
       } else {
          _mesa_hash_table_insert_pre_hashed(table->ht, hash, uint_key(key), data);
+         free_keys_mark(table, key, true);
       }
    }
+
+   lookup_array_set(table, key, data);
 }
 
 
@@ -252,6 +795,8 @@ _mesa_HashRemove_unlocked(struct _mesa_HashTable *table, GLuint key)
                                                  uint_key(key));
       _mesa_hash_table_remove(table->ht, entry);
    }
+   free_keys_mark(table, key, false);
+   lookup_array_set(table, key, NULL);
 }
 
 
@@ -286,6 +831,7 @@ _mesa_HashDeleteAll(struct _mesa_HashTable *table,
    assert(callback);
    _mesa_HashLockMutex(table);
    table->InDeleteAll = GL_TRUE;
+   lookup_array_clear(table);
    hash_table_foreach(table->ht, entry) {
       callback((uintptr_t)entry->key, entry->data, userData);
       _mesa_hash_table_remove(table->ht, entry);
@@ -295,6 +841,8 @@ _mesa_HashDeleteAll(struct _mesa_HashTable *table,
       table->deleted_key_data = NULL;
    }
    table->InDeleteAll = GL_FALSE;
+   free_keys_destroy(table->FreeKeys);
+   table->FreeKeys = free_keys_create();
    _mesa_HashUnlockMutex(table);
 }
 
@@ -371,16 +919,21 @@ _mesa_HashPrint(const struct _mesa_HashTable *table)
  * 
  * \return Starting key of free block or 0 if failure.
  *
- * If there are enough free keys between the maximum key existing in the table
- * (_mesa_HashTable::MaxKey) and the maximum key possible, then simply return
- * the adjacent key. Otherwise do a full search for a free key block in the
- * allowable key range.
+ * Returns the lowest block of free keys, so the keys of deleted objects get
+ * reused.  If we ran out of memory tracking the free keys, we only return
+ * keys above the maximum key existing in the table
+ * (_mesa_HashTable::MaxKey), or do a full search for a free key block in the
+ * allowable key range if there aren't enough of those.
  */
 GLuint
 _mesa_HashFindFreeKeyBlock(struct _mesa_HashTable *table, GLuint numKeys)
 {
    const GLuint maxKey = ~((GLuint) 0) - 1;
-   if (maxKey - numKeys > table->MaxKey) {
+
+   if (table->FreeKeys) {
+      return free_keys_find(table->FreeKeys, MAX2(numKeys, 1));
+   }
+   else if (maxKey - numKeys > table->MaxKey) {
       /* the quick solution */
       return table->MaxKey + 1;
    }
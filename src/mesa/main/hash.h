@@ -36,6 +36,10 @@
 #include "imports.h"
 #include "c11/threads.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * Magic GLuint object name that gets stored outside of the struct hash_table.
  *
@@ -93,6 +97,9 @@ uint_key(GLuint id)
 }
 /** @} */
 
+struct hash_free_keys;
+struct hash_lookup_array;
+
 /**
  * The hash table data structure.
  */
@@ -103,6 +110,16 @@ struct _mesa_HashTable {
    GLboolean InDeleteAll;                /**< Debug check */
    /** Value that would be in the table for DELETED_KEY_VALUE. */
    void *deleted_key_data;
+   /**
+    * Free key ranges, for _mesa_HashFindFreeKeyBlock().  NULL if we ran out
+    * of memory tracking them, in which case we fall back to a linear search.
+    */
+   struct hash_free_keys *FreeKeys;
+   /**
+    * Data of the keys below its size, for _mesa_HashLookup() to read without
+    * locking.  Only changed with the mutex held.
+    */
+   struct hash_lookup_array *LookupArray;
 };
 
 extern struct _mesa_HashTable *_mesa_NewHashTable(void);
@@ -175,5 +192,8 @@ _mesa_HashNumEntries(const struct _mesa_HashTable *table);
 
 extern void _mesa_test_hash_functions(void);
 
+#ifdef __cplusplus
+}
+#endif
 
 #endif
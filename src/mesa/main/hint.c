@@ -131,6 +131,24 @@ invalid_target:
 }
 
 
+void GLAPIENTRY
+_mesa_MaxShaderCompilerThreadsKHR(GLuint count)
+{
+   GET_CURRENT_CONTEXT(ctx);
+
+   if (!ctx->Extensions.KHR_parallel_shader_compile) {
+      _mesa_error(ctx, GL_INVALID_OPERATION,
+                  "glMaxShaderCompilerThreadsKHR(unsupported)");
+      return;
+   }
+
+   ctx->Hint.MaxShaderCompilerThreads = count;
+
+   if (ctx->Driver.SetMaxShaderCompilerThreads)
+      ctx->Driver.SetMaxShaderCompilerThreads(ctx, count);
+}
+
+
 /**********************************************************************/
 /*****                      Initialization                        *****/
 /**********************************************************************/
@@ -146,4 +164,5 @@ void _mesa_init_hint( struct gl_context * ctx )
    ctx->Hint.TextureCompression = GL_DONT_CARE;
    ctx->Hint.GenerateMipmap = GL_DONT_CARE;
    ctx->Hint.FragmentShaderDerivative = GL_DONT_CARE;
+   ctx->Hint.MaxShaderCompilerThreads = 0xffffffff;
 }
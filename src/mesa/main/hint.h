@@ -43,6 +43,9 @@ struct gl_context;
 extern void GLAPIENTRY
 _mesa_Hint( GLenum target, GLenum mode );
 
+extern void GLAPIENTRY
+_mesa_MaxShaderCompilerThreadsKHR(GLuint count);
+
 extern void 
 _mesa_init_hint( struct gl_context * ctx );
 
@@ -27,11 +27,18 @@
  * thread when automatic code generation isn't appropriate.
  */
 
+#include "main/bufferobj.h"
 #include "main/enums.h"
+#include "main/glformats.h"
 #include "main/macros.h"
+#include "main/texstate.h"
+#include "main/varray.h"
 #include "marshal.h"
 #include "dispatch.h"
 #include "marshal_generated.h"
+#include "util/bitscan.h"
+#include "util/u_atomic.h"
+#include "vbo/vbo.h"
 
 struct marshal_cmd_Flush
 {
@@ -94,6 +101,7 @@ _mesa_marshal_Enable(GLenum cap)
       cmd = _mesa_glthread_allocate_command(ctx, DISPATCH_CMD_Enable,
                                             sizeof(*cmd));
       cmd->cap = cap;
+      _mesa_glthread_Enable(ctx, cap, true);
       _mesa_post_marshal_hook(ctx);
       return;
    }
@@ -101,6 +109,7 @@ _mesa_marshal_Enable(GLenum cap)
    _mesa_glthread_finish(ctx);
    debug_print_sync_fallback("Enable");
    CALL_Enable(ctx->CurrentServerDispatch, (cap));
+   _mesa_glthread_Enable(ctx, cap, true);
 }
 
 struct marshal_cmd_ShaderSource
@@ -206,10 +215,9 @@ struct marshal_cmd_BindBufferBase
 
 /** Tracks the current bindings for the vertex array and index array buffers.
  *
- * This is part of what we need to enable glthread on compat-GL contexts that
- * happen to use VBOs, without also supporting the full tracking of VBO vs
- * user vertex array bindings per attribute on each vertex array for
- * determining what to upload at draw call time.
+ * Together with the per-attribute tracking of the client arrays below, this
+ * tells draw calls on compat-GL contexts which arrays and indices have to be
+ * copied from user memory when the draw is marshalled.
  *
  * Note that GL core makes it so that a buffer binding with an invalid handle
  * in the "buffer" parameter will throw an error, and then a
@@ -232,9 +240,13 @@ track_vbo_binding(struct gl_context *ctx, GLenum target, GLuint buffer)
 {
    struct glthread_state *glthread = ctx->GLThread;
 
+   if (glthread->inside_begin_end)
+      glthread->shadow.valid &= ~GLTHREAD_SHADOW_BUFFERS;
+
    switch (target) {
    case GL_ARRAY_BUFFER:
       glthread->vertex_array_is_vbo = (buffer != 0);
+      glthread->shadow.array_buffer = buffer;
       break;
    case GL_ELEMENT_ARRAY_BUFFER:
       /* The current element array buffer binding is actually tracked in the
@@ -242,6 +254,7 @@ track_vbo_binding(struct gl_context *ctx, GLenum target, GLuint buffer)
        * change on vertex array object updates.
        */
       glthread->element_array_is_vbo = (buffer != 0);
+      glthread->shadow.element_array_buffer = buffer;
       break;
    }
 }
@@ -747,3 +760,1442 @@ _mesa_marshal_ClearBufferfi(GLenum buffer, GLint drawbuffer,
                          (buffer, drawbuffer, depth, stencil));
    }
 }
+
+
+/* Client vertex arrays
+ *
+ * Draws reading vertices or indices from user memory copy what they read
+ * into the batch, or into a heap allocation if that doesn't fit, so that the
+ * application can modify the memory as soon as the call returns.  The worker
+ * thread points the arrays at the copies for the duration of the draw.
+ *
+ * That needs the enabled arrays and their layout on the main thread, which
+ * is tracked for the calls setting them on the default vertex array object.
+ * Binding another vertex array object on a compatibility context disables
+ * glthread, see _mesa_glthread_is_compat_bind_vertex_array().  Any other
+ * change to the arrays sets arrays_dirty, and the arrays are read back from
+ * the context the next time the main thread waits for the worker thread.
+ */
+
+static void
+read_arrays(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   const struct gl_vertex_array_object *vao = ctx->Array.VAO;
+
+   glthread->vertex_array_is_vbo = _mesa_is_bufferobj(ctx->Array.ArrayBufferObj);
+   glthread->element_array_is_vbo = _mesa_is_bufferobj(vao->IndexBufferObj);
+   glthread->enabled_attribs = vao->Enabled;
+   glthread->user_attribs = 0;
+   glthread->client_active_texture = ctx->Array.ActiveTexture;
+   glthread->primitive_restart = ctx->Array.PrimitiveRestart;
+   glthread->primitive_restart_fixed_index =
+      ctx->Array.PrimitiveRestartFixedIndex;
+   glthread->restart_index = ctx->Array.RestartIndex;
+   glthread->arrays_dirty = false;
+
+   for (unsigned i = 0; i < VERT_ATTRIB_MAX; i++) {
+      const struct gl_array_attributes *attrib = &vao->VertexAttrib[i];
+      const struct gl_vertex_buffer_binding *binding =
+         &vao->BufferBinding[attrib->BufferBindingIndex];
+      struct glthread_attrib *array = &glthread->attribs[i];
+
+      array->pointer = _mesa_vertex_attrib_address(attrib, binding);
+      array->element_size = attrib->Format._ElementSize;
+      array->stride = binding->Stride;
+      array->divisor = binding->InstanceDivisor;
+
+      if (_mesa_is_bufferobj(binding->BufferObj))
+         continue;
+
+      glthread->user_attribs |= VERT_BIT(i);
+
+      /* Draws point the binding at the copy, so it mustn't be shared with
+       * other arrays.  Keep synchronizing if it is.
+       */
+      if ((vao->Enabled & VERT_BIT(i)) && attrib->BufferBindingIndex != i)
+         glthread->arrays_dirty = true;
+   }
+}
+
+
+/* Vertex data types of the *Pointer calls.  Packed formats and types that
+ * depend on extensions aren't listed and fall back to arrays_dirty.
+ */
+#define TYPE_BYTE_BIT   (1 << 0)
+#define TYPE_UBYTE_BIT  (1 << 1)
+#define TYPE_SHORT_BIT  (1 << 2)
+#define TYPE_USHORT_BIT (1 << 3)
+#define TYPE_INT_BIT    (1 << 4)
+#define TYPE_UINT_BIT   (1 << 5)
+#define TYPE_HALF_BIT   (1 << 6)
+#define TYPE_FLOAT_BIT  (1 << 7)
+#define TYPE_DOUBLE_BIT (1 << 8)
+#define TYPE_FIXED_BIT  (1 << 9)
+
+static GLbitfield
+attrib_type_bit(GLenum type)
+{
+   switch (type) {
+   case GL_BYTE:           return TYPE_BYTE_BIT;
+   case GL_UNSIGNED_BYTE:  return TYPE_UBYTE_BIT;
+   case GL_SHORT:          return TYPE_SHORT_BIT;
+   case GL_UNSIGNED_SHORT: return TYPE_USHORT_BIT;
+   case GL_INT:            return TYPE_INT_BIT;
+   case GL_UNSIGNED_INT:   return TYPE_UINT_BIT;
+   case GL_HALF_FLOAT:     return TYPE_HALF_BIT;
+   case GL_FLOAT:          return TYPE_FLOAT_BIT;
+   case GL_DOUBLE:         return TYPE_DOUBLE_BIT;
+   case GL_FIXED:          return TYPE_FIXED_BIT;
+   default:                return 0;
+   }
+}
+
+
+/**
+ * Returns whether a *Pointer call setting \p attrib is known to succeed,
+ * following the checks of varray.c.  It may return false for valid calls
+ * the main thread doesn't bother to check, but never true for a call that
+ * fails, because the draws copy user memory with the size and stride
+ * recorded here.  GL_BGRA in \p size is replaced by 4.
+ */
+static bool
+attrib_pointer_is_valid(const struct gl_context *ctx, gl_vert_attrib attrib,
+                        GLint *size, GLenum type, GLsizei stride)
+{
+   const bool es1 = ctx->API == API_OPENGLES;
+   const bool desktop = _mesa_is_desktop_gl(ctx);
+   GLbitfield types;
+   GLint size_min = 1;
+
+   /* Core contexts only accept buffer objects, on a vertex array object that
+    * glthread doesn't track.
+    */
+   if (ctx->API == API_OPENGL_CORE && !ctx->GLThread->vertex_array_is_vbo)
+      return false;
+
+   if (stride < 0 ||
+       (desktop && ctx->Version >= 44 &&
+        stride > ctx->Const.MaxVertexAttribStride))
+      return false;
+
+   if (attrib >= VERT_ATTRIB_GENERIC0) {
+      if (attrib - VERT_ATTRIB_GENERIC0 >=
+          ctx->Const.Program[MESA_SHADER_VERTEX].MaxAttribs)
+         return false;
+
+      /* GL_BGRA also depends on the normalized flag, which isn't passed. */
+      types = TYPE_BYTE_BIT | TYPE_UBYTE_BIT | TYPE_SHORT_BIT |
+              TYPE_USHORT_BIT | TYPE_FLOAT_BIT;
+      if (desktop || ctx->Version >= 30)
+         types |= TYPE_INT_BIT | TYPE_UINT_BIT | TYPE_HALF_BIT;
+      if (desktop)
+         types |= TYPE_DOUBLE_BIT;
+      if (_mesa_is_gles(ctx))
+         types |= TYPE_FIXED_BIT;
+   } else {
+      /* The fixed-function arrays only exist in these APIs. */
+      if (!es1 && ctx->API != API_OPENGL_COMPAT)
+         return false;
+
+      switch (attrib) {
+      case VERT_ATTRIB_POS:
+      case VERT_ATTRIB_TEX0:
+      case VERT_ATTRIB_TEX1:
+      case VERT_ATTRIB_TEX2:
+      case VERT_ATTRIB_TEX3:
+      case VERT_ATTRIB_TEX4:
+      case VERT_ATTRIB_TEX5:
+      case VERT_ATTRIB_TEX6:
+      case VERT_ATTRIB_TEX7:
+         if (es1 || attrib == VERT_ATTRIB_POS)
+            size_min = 2;
+         types = es1 ? TYPE_BYTE_BIT | TYPE_SHORT_BIT | TYPE_FLOAT_BIT |
+                       TYPE_FIXED_BIT :
+                       TYPE_SHORT_BIT | TYPE_INT_BIT | TYPE_HALF_BIT |
+                       TYPE_FLOAT_BIT | TYPE_DOUBLE_BIT;
+         break;
+      case VERT_ATTRIB_NORMAL:
+         types = es1 ? TYPE_BYTE_BIT | TYPE_SHORT_BIT | TYPE_FLOAT_BIT |
+                       TYPE_FIXED_BIT :
+                       TYPE_BYTE_BIT | TYPE_SHORT_BIT | TYPE_INT_BIT |
+                       TYPE_HALF_BIT | TYPE_FLOAT_BIT | TYPE_DOUBLE_BIT;
+         break;
+      case VERT_ATTRIB_COLOR0:
+      case VERT_ATTRIB_COLOR1:
+         if (es1) {
+            if (attrib != VERT_ATTRIB_COLOR0)
+               return false;
+            size_min = 4;
+            types = TYPE_UBYTE_BIT | TYPE_FLOAT_BIT | TYPE_FIXED_BIT;
+         } else {
+            if (*size == GL_BGRA && type == GL_UNSIGNED_BYTE &&
+                ctx->Extensions.EXT_vertex_array_bgra)
+               *size = 4;
+            size_min = 3;
+            types = TYPE_BYTE_BIT | TYPE_UBYTE_BIT | TYPE_SHORT_BIT |
+                    TYPE_USHORT_BIT | TYPE_INT_BIT | TYPE_UINT_BIT |
+                    TYPE_HALF_BIT | TYPE_FLOAT_BIT | TYPE_DOUBLE_BIT;
+         }
+         break;
+      case VERT_ATTRIB_FOG:
+         types = es1 ? 0 : TYPE_HALF_BIT | TYPE_FLOAT_BIT | TYPE_DOUBLE_BIT;
+         break;
+      case VERT_ATTRIB_COLOR_INDEX:
+         types = es1 ? 0 : TYPE_UBYTE_BIT | TYPE_SHORT_BIT | TYPE_INT_BIT |
+                           TYPE_FLOAT_BIT | TYPE_DOUBLE_BIT;
+         break;
+      case VERT_ATTRIB_EDGEFLAG:
+         types = es1 ? 0 : TYPE_UBYTE_BIT;
+         break;
+      case VERT_ATTRIB_POINT_SIZE:
+         types = es1 ? TYPE_FLOAT_BIT | TYPE_FIXED_BIT : 0;
+         break;
+      default:
+         return false;
+      }
+   }
+
+   return *size >= size_min && *size <= 4 &&
+          (attrib_type_bit(type) & types) != 0;
+}
+
+
+void
+_mesa_glthread_AttribPointer(struct gl_context *ctx, gl_vert_attrib attrib,
+                             GLint size, GLenum type, GLsizei stride,
+                             const GLvoid *pointer)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   struct glthread_attrib *array = &glthread->attribs[attrib];
+   int element_size;
+
+   /* The call doesn't change the array if it fails.  Rather than checking
+    * every rule here, read the array back at the next draw that needs it
+    * unless the parameters are known to be valid.
+    */
+   if (glthread->inside_begin_end ||
+       !attrib_pointer_is_valid(ctx, attrib, &size, type, stride)) {
+      glthread->arrays_dirty = true;
+      return;
+   }
+
+   element_size = _mesa_bytes_per_vertex_attrib(size, type);
+
+   array->pointer = pointer;
+   array->element_size = element_size;
+   array->stride = stride ? stride : element_size;
+
+   if (glthread->vertex_array_is_vbo)
+      glthread->user_attribs &= ~VERT_BIT(attrib);
+   else
+      glthread->user_attribs |= VERT_BIT(attrib);
+}
+
+
+static void
+set_attrib_enabled(struct glthread_state *glthread, gl_vert_attrib attrib,
+                   bool enable)
+{
+   if (enable)
+      glthread->enabled_attribs |= VERT_BIT(attrib);
+   else
+      glthread->enabled_attribs &= ~VERT_BIT(attrib);
+}
+
+
+/**
+ * Tracks glEnableClientState() and glEnable(), which both accept the
+ * client array and primitive restart enums on compatibility contexts.
+ */
+void
+_mesa_glthread_ClientState(struct gl_context *ctx, GLenum cap, bool enable)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   /* The calls fail inside glBegin/glEnd. */
+   if (glthread->inside_begin_end) {
+      glthread->arrays_dirty = true;
+      return;
+   }
+
+   switch (cap) {
+   case GL_PRIMITIVE_RESTART_NV:
+   case GL_PRIMITIVE_RESTART:
+      glthread->primitive_restart = enable;
+      return;
+   case GL_PRIMITIVE_RESTART_FIXED_INDEX:
+      glthread->primitive_restart_fixed_index = enable;
+      return;
+   }
+
+   if (ctx->API != API_OPENGL_COMPAT && ctx->API != API_OPENGLES)
+      return;
+
+   switch (cap) {
+   case GL_VERTEX_ARRAY:
+      set_attrib_enabled(glthread, VERT_ATTRIB_POS, enable);
+      break;
+   case GL_NORMAL_ARRAY:
+      set_attrib_enabled(glthread, VERT_ATTRIB_NORMAL, enable);
+      break;
+   case GL_COLOR_ARRAY:
+      set_attrib_enabled(glthread, VERT_ATTRIB_COLOR0, enable);
+      break;
+   case GL_INDEX_ARRAY:
+      set_attrib_enabled(glthread, VERT_ATTRIB_COLOR_INDEX, enable);
+      break;
+   case GL_TEXTURE_COORD_ARRAY:
+      set_attrib_enabled(glthread,
+                         VERT_ATTRIB_TEX(glthread->client_active_texture),
+                         enable);
+      break;
+   case GL_EDGE_FLAG_ARRAY:
+      set_attrib_enabled(glthread, VERT_ATTRIB_EDGEFLAG, enable);
+      break;
+   case GL_FOG_COORDINATE_ARRAY:
+      set_attrib_enabled(glthread, VERT_ATTRIB_FOG, enable);
+      break;
+   case GL_SECONDARY_COLOR_ARRAY:
+      set_attrib_enabled(glthread, VERT_ATTRIB_COLOR1, enable);
+      break;
+   case GL_POINT_SIZE_ARRAY_OES:
+      set_attrib_enabled(glthread, VERT_ATTRIB_POINT_SIZE, enable);
+      break;
+   }
+}
+
+
+void
+_mesa_glthread_AttribArray(struct gl_context *ctx, GLuint index, bool enable)
+{
+   if (index < VERT_ATTRIB_GENERIC_MAX)
+      set_attrib_enabled(ctx->GLThread, VERT_ATTRIB_GENERIC(index), enable);
+}
+
+
+void
+_mesa_glthread_AttribDivisor(struct gl_context *ctx, GLuint index,
+                             GLuint divisor)
+{
+   if (index < VERT_ATTRIB_GENERIC_MAX)
+      ctx->GLThread->attribs[VERT_ATTRIB_GENERIC(index)].divisor = divisor;
+}
+
+
+void
+_mesa_glthread_ClientActiveTexture(struct gl_context *ctx, GLenum texture)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   const GLuint unit = texture - GL_TEXTURE0;
+
+   if (unit < ctx->Const.MaxTextureCoordUnits && !glthread->inside_begin_end)
+      glthread->client_active_texture = unit;
+   else
+      glthread->arrays_dirty = true;
+}
+
+
+void
+_mesa_glthread_PrimitiveRestartIndex(struct gl_context *ctx, GLuint index)
+{
+   ctx->GLThread->restart_index = index;
+}
+
+
+struct marshal_cmd_Draw
+{
+   struct marshal_cmd_base cmd_base;
+   GLenum mode;
+   GLenum type;
+   GLint first;               /**< first vertex, or the start of the range */
+   GLuint end;
+   GLsizei count;
+   GLsizei instance_count;
+   GLint basevertex;
+
+   /** Mask of VERT_BIT_* values of the arrays pointed at copies. */
+   GLbitfield user_attribs;
+
+   /** The index buffer offset, or a pointer to the copied indices. */
+   const GLvoid *indices;
+
+   /** Heap allocation holding the copies, or NULL if they're in the batch. */
+   GLubyte *upload;
+   GLuint upload_size;
+
+   /* Followed by a pointer to element 0 of each array in user_attribs,
+    * then the copies if they fit in the batch.
+    */
+};
+
+
+/**
+ * Returns the enabled arrays in user memory in *user_attribs, or waits for
+ * the worker thread and returns false if they aren't known.
+ */
+static bool
+get_user_attribs(struct gl_context *ctx, GLbitfield *user_attribs)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (ctx->API == API_OPENGL_CORE) {
+      *user_attribs = 0;
+      return true;
+   }
+
+   if (unlikely(glthread->arrays_dirty)) {
+      /* This reads the arrays back. */
+      _mesa_glthread_finish(ctx);
+      return false;
+   }
+
+   *user_attribs = glthread->enabled_attribs & glthread->user_attribs;
+   return true;
+}
+
+
+/**
+ * Allocates a draw command with copies of the elements [min_index,
+ * max_index] of the arrays in user_attribs, and of index_bytes bytes of
+ * user indices if that isn't 0.  Instanced arrays are copied for
+ * num_instances instances, unless that's 0.
+ *
+ * Returns NULL after waiting for the worker thread if the data is too large
+ * to copy; the caller executes the draw directly then.
+ */
+static struct marshal_cmd_Draw *
+marshal_draw(struct gl_context *ctx, enum marshal_dispatch_cmd_id cmd_id,
+             GLbitfield user_attribs, unsigned min_index, unsigned max_index,
+             unsigned num_instances, const GLvoid *indices,
+             uint64_t index_bytes)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   const size_t cmd_size = sizeof(struct marshal_cmd_Draw) +
+                           util_bitcount(user_attribs) * sizeof(GLubyte *);
+   unsigned first[VERT_ATTRIB_MAX];
+   uint64_t size[VERT_ATTRIB_MAX];
+   uint64_t upload_size = ALIGN(index_bytes, 8);
+   struct marshal_cmd_Draw *cmd;
+   const GLubyte **pointers;
+   GLubyte *upload, *heap = NULL;
+   GLbitfield mask;
+
+   mask = user_attribs;
+   while (mask) {
+      const int i = u_bit_scan(&mask);
+      const struct glthread_attrib *array = &glthread->attribs[i];
+      unsigned last;
+
+      if (array->divisor && num_instances) {
+         first[i] = 0;
+         last = (num_instances - 1) / array->divisor;
+      } else {
+         first[i] = min_index;
+         last = max_index;
+      }
+
+      size[i] = (uint64_t) (last - first[i]) * array->stride +
+                array->element_size;
+      upload_size += ALIGN(size[i], 8);
+   }
+
+   if (ALIGN(cmd_size, 8) + upload_size <= MARSHAL_MAX_CMD_SIZE) {
+      cmd = _mesa_glthread_allocate_command(ctx, cmd_id,
+                                            ALIGN(cmd_size, 8) + upload_size);
+      upload = (GLubyte *) cmd + ALIGN(cmd_size, 8);
+   } else {
+      if (upload_size + p_atomic_read(&glthread->upload_size) >
+          MARSHAL_MAX_UPLOAD_SIZE ||
+          !(heap = malloc(upload_size))) {
+         _mesa_glthread_finish(ctx);
+         return NULL;
+      }
+
+      p_atomic_add(&glthread->upload_size, upload_size);
+      cmd = _mesa_glthread_allocate_command(ctx, cmd_id, cmd_size);
+      upload = heap;
+   }
+
+   cmd->user_attribs = user_attribs;
+   cmd->upload = heap;
+   cmd->upload_size = heap ? upload_size : 0;
+
+   pointers = (const GLubyte **) (cmd + 1);
+   mask = user_attribs;
+   while (mask) {
+      const int i = u_bit_scan(&mask);
+      const struct glthread_attrib *array = &glthread->attribs[i];
+      const uintptr_t offset = (uintptr_t) first[i] * array->stride;
+
+      memcpy(upload, array->pointer + offset, size[i]);
+      *pointers++ = (const GLubyte *) ((uintptr_t) upload - offset);
+      upload += ALIGN(size[i], 8);
+   }
+
+   if (index_bytes) {
+      memcpy(upload, indices, index_bytes);
+      cmd->indices = upload;
+   } else {
+      cmd->indices = indices;
+   }
+
+   return cmd;
+}
+
+
+static struct marshal_cmd_Draw *
+marshal_draw_arrays(struct gl_context *ctx,
+                    enum marshal_dispatch_cmd_id cmd_id,
+                    GLint first, GLsizei count, GLsizei num_instances)
+{
+   GLbitfield user_attribs;
+
+   if (!get_user_attribs(ctx, &user_attribs))
+      return NULL;
+
+   /* Empty and invalid draws don't read anything, and the unmarshalled call
+    * reports the errors.
+    */
+   if (first < 0 || count <= 0 || num_instances <= 0)
+      user_attribs = 0;
+
+   return marshal_draw(ctx, cmd_id, user_attribs, first,
+                       (unsigned) first + count - 1, num_instances, NULL, 0);
+}
+
+
+static struct marshal_cmd_Draw *
+marshal_draw_elements(struct gl_context *ctx,
+                      enum marshal_dispatch_cmd_id cmd_id,
+                      GLsizei count, GLenum type, const GLvoid *indices,
+                      GLint basevertex, GLsizei num_instances,
+                      bool has_range, GLuint start, GLuint end)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   unsigned index_size, min_index = 0, max_index = 0;
+   GLbitfield user_attribs;
+   bool user_indices;
+
+   if (!get_user_attribs(ctx, &user_attribs))
+      return NULL;
+
+   switch (type) {
+   case GL_UNSIGNED_BYTE:
+      index_size = 1;
+      break;
+   case GL_UNSIGNED_SHORT:
+      index_size = 2;
+      break;
+   case GL_UNSIGNED_INT:
+      index_size = 4;
+      break;
+   default:
+      index_size = 0;
+      break;
+   }
+
+   if (count <= 0 || num_instances <= 0 || !index_size ||
+       (has_range && end < start))
+      return marshal_draw(ctx, cmd_id, 0, 0, 0, 0, indices, 0);
+
+   user_indices = ctx->API != API_OPENGL_CORE && !glthread->element_array_is_vbo;
+
+   if (user_attribs) {
+      if (user_indices) {
+         const bool restart = glthread->primitive_restart ||
+                              glthread->primitive_restart_fixed_index;
+         const GLuint restart_index = glthread->primitive_restart_fixed_index ?
+            0xffffffffu >> 8 * (4 - index_size) : glthread->restart_index;
+
+         vbo_get_minmax_index_mapped(count, index_size, restart_index,
+                                     restart, indices,
+                                     &min_index, &max_index);
+      } else if (has_range) {
+         min_index = start;
+         max_index = end;
+      } else {
+         /* The range is only known by reading the index buffer. */
+         _mesa_glthread_finish(ctx);
+         return NULL;
+      }
+
+      if (min_index > max_index) {
+         /* All the indices are restart indices. */
+         user_attribs = 0;
+      } else {
+         const int64_t first = (int64_t) min_index + basevertex;
+         const int64_t last = (int64_t) max_index + basevertex;
+
+         if (first < 0 || last > UINT32_MAX) {
+            _mesa_glthread_finish(ctx);
+            return NULL;
+         }
+
+         min_index = first;
+         max_index = last;
+      }
+   }
+
+   return marshal_draw(ctx, cmd_id, user_attribs, min_index, max_index,
+                       num_instances, indices,
+                       user_indices ? (uint64_t) count * index_size : 0);
+}
+
+
+/**
+ * Points the arrays of a draw command at the copies, and returns the mask
+ * of the arrays to restore afterwards.
+ */
+static GLbitfield
+unmarshal_draw_begin(struct gl_context *ctx,
+                     const struct marshal_cmd_Draw *cmd,
+                     const GLubyte **saved)
+{
+   struct gl_vertex_array_object *vao = ctx->Array.VAO;
+   const GLubyte *const *pointers = (const GLubyte *const *) (cmd + 1);
+   GLbitfield mask = cmd->user_attribs;
+   GLbitfield bound = 0;
+
+   while (mask) {
+      const int i = u_bit_scan(&mask);
+      struct gl_array_attributes *attrib = &vao->VertexAttrib[i];
+      struct gl_vertex_buffer_binding *binding =
+         &vao->BufferBinding[attrib->BufferBindingIndex];
+      const GLubyte *pointer = *pointers++;
+
+      if (_mesa_is_bufferobj(binding->BufferObj))
+         continue;
+
+      saved[i] = attrib->Ptr;
+      attrib->Ptr = pointer;
+      _mesa_bind_vertex_buffer(ctx, vao, attrib->BufferBindingIndex,
+                               binding->BufferObj,
+                               (GLintptr) pointer - attrib->RelativeOffset,
+                               binding->Stride);
+      bound |= VERT_BIT(i);
+   }
+
+   return bound;
+}
+
+
+static void
+unmarshal_draw_end(struct gl_context *ctx,
+                   const struct marshal_cmd_Draw *cmd,
+                   GLbitfield bound, const GLubyte **saved)
+{
+   struct gl_vertex_array_object *vao = ctx->Array.VAO;
+
+   while (bound) {
+      const int i = u_bit_scan(&bound);
+      struct gl_array_attributes *attrib = &vao->VertexAttrib[i];
+      struct gl_vertex_buffer_binding *binding =
+         &vao->BufferBinding[attrib->BufferBindingIndex];
+
+      attrib->Ptr = saved[i];
+      _mesa_bind_vertex_buffer(ctx, vao, attrib->BufferBindingIndex,
+                               binding->BufferObj,
+                               (GLintptr) saved[i] - attrib->RelativeOffset,
+                               binding->Stride);
+   }
+
+   if (cmd->upload) {
+      free(cmd->upload);
+      p_atomic_add(&ctx->GLThread->upload_size, -(int) cmd->upload_size);
+   }
+}
+
+
+void
+_mesa_unmarshal_ArrayElement(struct gl_context *ctx,
+                             const struct marshal_cmd_Draw *cmd)
+{
+   const GLubyte *saved[VERT_ATTRIB_MAX];
+   GLbitfield bound = unmarshal_draw_begin(ctx, cmd, saved);
+
+   CALL_ArrayElement(ctx->CurrentServerDispatch, (cmd->first));
+   unmarshal_draw_end(ctx, cmd, bound, saved);
+}
+
+void GLAPIENTRY
+_mesa_marshal_ArrayElement(GLint i)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   struct marshal_cmd_Draw *cmd;
+   GLbitfield user_attribs;
+   debug_print_marshal("ArrayElement");
+
+   if (get_user_attribs(ctx, &user_attribs)) {
+      /* glArrayElement() reads element i of instanced arrays too. */
+      cmd = marshal_draw(ctx, DISPATCH_CMD_ArrayElement,
+                         i >= 0 ? user_attribs : 0, i, i, 0, NULL, 0);
+      if (cmd) {
+         cmd->first = i;
+         _mesa_post_marshal_hook(ctx);
+         return;
+      }
+   }
+
+   debug_print_sync_fallback("ArrayElement");
+   CALL_ArrayElement(ctx->CurrentServerDispatch, (i));
+}
+
+
+void
+_mesa_unmarshal_DrawArrays(struct gl_context *ctx,
+                           const struct marshal_cmd_Draw *cmd)
+{
+   const GLubyte *saved[VERT_ATTRIB_MAX];
+   GLbitfield bound = unmarshal_draw_begin(ctx, cmd, saved);
+
+   CALL_DrawArrays(ctx->CurrentServerDispatch,
+                   (cmd->mode, cmd->first, cmd->count));
+   unmarshal_draw_end(ctx, cmd, bound, saved);
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   struct marshal_cmd_Draw *cmd;
+   debug_print_marshal("DrawArrays");
+
+   cmd = marshal_draw_arrays(ctx, DISPATCH_CMD_DrawArrays, first, count, 1);
+   if (cmd) {
+      cmd->mode = mode;
+      cmd->first = first;
+      cmd->count = count;
+      _mesa_post_marshal_hook(ctx);
+      return;
+   }
+
+   debug_print_sync_fallback("DrawArrays");
+   CALL_DrawArrays(ctx->CurrentServerDispatch, (mode, first, count));
+}
+
+
+void
+_mesa_unmarshal_DrawArraysInstancedARB(struct gl_context *ctx,
+                                       const struct marshal_cmd_Draw *cmd)
+{
+   const GLubyte *saved[VERT_ATTRIB_MAX];
+   GLbitfield bound = unmarshal_draw_begin(ctx, cmd, saved);
+
+   CALL_DrawArraysInstancedARB(ctx->CurrentServerDispatch,
+                               (cmd->mode, cmd->first, cmd->count,
+                                cmd->instance_count));
+   unmarshal_draw_end(ctx, cmd, bound, saved);
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawArraysInstancedARB(GLenum mode, GLint first, GLsizei count,
+                                     GLsizei primcount)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   struct marshal_cmd_Draw *cmd;
+   debug_print_marshal("DrawArraysInstancedARB");
+
+   cmd = marshal_draw_arrays(ctx, DISPATCH_CMD_DrawArraysInstancedARB,
+                             first, count, primcount);
+   if (cmd) {
+      cmd->mode = mode;
+      cmd->first = first;
+      cmd->count = count;
+      cmd->instance_count = primcount;
+      _mesa_post_marshal_hook(ctx);
+      return;
+   }
+
+   debug_print_sync_fallback("DrawArraysInstancedARB");
+   CALL_DrawArraysInstancedARB(ctx->CurrentServerDispatch,
+                               (mode, first, count, primcount));
+}
+
+
+void
+_mesa_unmarshal_DrawElements(struct gl_context *ctx,
+                             const struct marshal_cmd_Draw *cmd)
+{
+   const GLubyte *saved[VERT_ATTRIB_MAX];
+   GLbitfield bound = unmarshal_draw_begin(ctx, cmd, saved);
+
+   CALL_DrawElements(ctx->CurrentServerDispatch,
+                     (cmd->mode, cmd->count, cmd->type, cmd->indices));
+   unmarshal_draw_end(ctx, cmd, bound, saved);
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawElements(GLenum mode, GLsizei count, GLenum type,
+                           const GLvoid *indices)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   struct marshal_cmd_Draw *cmd;
+   debug_print_marshal("DrawElements");
+
+   cmd = marshal_draw_elements(ctx, DISPATCH_CMD_DrawElements, count, type,
+                               indices, 0, 1, false, 0, 0);
+   if (cmd) {
+      cmd->mode = mode;
+      cmd->count = count;
+      cmd->type = type;
+      _mesa_post_marshal_hook(ctx);
+      return;
+   }
+
+   debug_print_sync_fallback("DrawElements");
+   CALL_DrawElements(ctx->CurrentServerDispatch,
+                     (mode, count, type, indices));
+}
+
+
+void
+_mesa_unmarshal_DrawRangeElements(struct gl_context *ctx,
+                                  const struct marshal_cmd_Draw *cmd)
+{
+   const GLubyte *saved[VERT_ATTRIB_MAX];
+   GLbitfield bound = unmarshal_draw_begin(ctx, cmd, saved);
+
+   CALL_DrawRangeElements(ctx->CurrentServerDispatch,
+                          (cmd->mode, cmd->first, cmd->end, cmd->count,
+                           cmd->type, cmd->indices));
+   unmarshal_draw_end(ctx, cmd, bound, saved);
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawRangeElements(GLenum mode, GLuint start, GLuint end,
+                                GLsizei count, GLenum type,
+                                const GLvoid *indices)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   struct marshal_cmd_Draw *cmd;
+   debug_print_marshal("DrawRangeElements");
+
+   cmd = marshal_draw_elements(ctx, DISPATCH_CMD_DrawRangeElements, count,
+                               type, indices, 0, 1, true, start, end);
+   if (cmd) {
+      cmd->mode = mode;
+      cmd->first = start;
+      cmd->end = end;
+      cmd->count = count;
+      cmd->type = type;
+      _mesa_post_marshal_hook(ctx);
+      return;
+   }
+
+   debug_print_sync_fallback("DrawRangeElements");
+   CALL_DrawRangeElements(ctx->CurrentServerDispatch,
+                          (mode, start, end, count, type, indices));
+}
+
+
+void
+_mesa_unmarshal_DrawElementsBaseVertex(struct gl_context *ctx,
+                                       const struct marshal_cmd_Draw *cmd)
+{
+   const GLubyte *saved[VERT_ATTRIB_MAX];
+   GLbitfield bound = unmarshal_draw_begin(ctx, cmd, saved);
+
+   CALL_DrawElementsBaseVertex(ctx->CurrentServerDispatch,
+                               (cmd->mode, cmd->count, cmd->type,
+                                cmd->indices, cmd->basevertex));
+   unmarshal_draw_end(ctx, cmd, bound, saved);
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type,
+                                     const GLvoid *indices, GLint basevertex)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   struct marshal_cmd_Draw *cmd;
+   debug_print_marshal("DrawElementsBaseVertex");
+
+   cmd = marshal_draw_elements(ctx, DISPATCH_CMD_DrawElementsBaseVertex,
+                               count, type, indices, basevertex, 1,
+                               false, 0, 0);
+   if (cmd) {
+      cmd->mode = mode;
+      cmd->count = count;
+      cmd->type = type;
+      cmd->basevertex = basevertex;
+      _mesa_post_marshal_hook(ctx);
+      return;
+   }
+
+   debug_print_sync_fallback("DrawElementsBaseVertex");
+   CALL_DrawElementsBaseVertex(ctx->CurrentServerDispatch,
+                               (mode, count, type, indices, basevertex));
+}
+
+
+void
+_mesa_unmarshal_DrawRangeElementsBaseVertex(struct gl_context *ctx,
+                                            const struct marshal_cmd_Draw *cmd)
+{
+   const GLubyte *saved[VERT_ATTRIB_MAX];
+   GLbitfield bound = unmarshal_draw_begin(ctx, cmd, saved);
+
+   CALL_DrawRangeElementsBaseVertex(ctx->CurrentServerDispatch,
+                                    (cmd->mode, cmd->first, cmd->end,
+                                     cmd->count, cmd->type, cmd->indices,
+                                     cmd->basevertex));
+   unmarshal_draw_end(ctx, cmd, bound, saved);
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawRangeElementsBaseVertex(GLenum mode, GLuint start,
+                                          GLuint end, GLsizei count,
+                                          GLenum type, const GLvoid *indices,
+                                          GLint basevertex)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   struct marshal_cmd_Draw *cmd;
+   debug_print_marshal("DrawRangeElementsBaseVertex");
+
+   cmd = marshal_draw_elements(ctx, DISPATCH_CMD_DrawRangeElementsBaseVertex,
+                               count, type, indices, basevertex, 1,
+                               true, start, end);
+   if (cmd) {
+      cmd->mode = mode;
+      cmd->first = start;
+      cmd->end = end;
+      cmd->count = count;
+      cmd->type = type;
+      cmd->basevertex = basevertex;
+      _mesa_post_marshal_hook(ctx);
+      return;
+   }
+
+   debug_print_sync_fallback("DrawRangeElementsBaseVertex");
+   CALL_DrawRangeElementsBaseVertex(ctx->CurrentServerDispatch,
+                                    (mode, start, end, count, type, indices,
+                                     basevertex));
+}
+
+
+void
+_mesa_unmarshal_DrawElementsInstancedARB(struct gl_context *ctx,
+                                         const struct marshal_cmd_Draw *cmd)
+{
+   const GLubyte *saved[VERT_ATTRIB_MAX];
+   GLbitfield bound = unmarshal_draw_begin(ctx, cmd, saved);
+
+   CALL_DrawElementsInstancedARB(ctx->CurrentServerDispatch,
+                                 (cmd->mode, cmd->count, cmd->type,
+                                  cmd->indices, cmd->instance_count));
+   unmarshal_draw_end(ctx, cmd, bound, saved);
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsInstancedARB(GLenum mode, GLsizei count,
+                                       GLenum type, const GLvoid *indices,
+                                       GLsizei primcount)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   struct marshal_cmd_Draw *cmd;
+   debug_print_marshal("DrawElementsInstancedARB");
+
+   cmd = marshal_draw_elements(ctx, DISPATCH_CMD_DrawElementsInstancedARB,
+                               count, type, indices, 0, primcount,
+                               false, 0, 0);
+   if (cmd) {
+      cmd->mode = mode;
+      cmd->count = count;
+      cmd->type = type;
+      cmd->instance_count = primcount;
+      _mesa_post_marshal_hook(ctx);
+      return;
+   }
+
+   debug_print_sync_fallback("DrawElementsInstancedARB");
+   CALL_DrawElementsInstancedARB(ctx->CurrentServerDispatch,
+                                 (mode, count, type, indices, primcount));
+}
+
+
+void
+_mesa_unmarshal_DrawElementsInstancedBaseVertex(struct gl_context *ctx,
+                                                const struct marshal_cmd_Draw *cmd)
+{
+   const GLubyte *saved[VERT_ATTRIB_MAX];
+   GLbitfield bound = unmarshal_draw_begin(ctx, cmd, saved);
+
+   CALL_DrawElementsInstancedBaseVertex(ctx->CurrentServerDispatch,
+                                        (cmd->mode, cmd->count, cmd->type,
+                                         cmd->indices, cmd->instance_count,
+                                         cmd->basevertex));
+   unmarshal_draw_end(ctx, cmd, bound, saved);
+}
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsInstancedBaseVertex(GLenum mode, GLsizei count,
+                                              GLenum type,
+                                              const GLvoid *indices,
+                                              GLsizei primcount,
+                                              GLint basevertex)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   struct marshal_cmd_Draw *cmd;
+   debug_print_marshal("DrawElementsInstancedBaseVertex");
+
+   cmd = marshal_draw_elements(ctx,
+                               DISPATCH_CMD_DrawElementsInstancedBaseVertex,
+                               count, type, indices, basevertex, primcount,
+                               false, 0, 0);
+   if (cmd) {
+      cmd->mode = mode;
+      cmd->count = count;
+      cmd->type = type;
+      cmd->instance_count = primcount;
+      cmd->basevertex = basevertex;
+      _mesa_post_marshal_hook(ctx);
+      return;
+   }
+
+   debug_print_sync_fallback("DrawElementsInstancedBaseVertex");
+   CALL_DrawElementsInstancedBaseVertex(ctx->CurrentServerDispatch,
+                                        (mode, count, type, indices,
+                                         primcount, basevertex));
+}
+
+
+/* State queries
+ *
+ * glGet*() returns the state in glthread_shadow without waiting for the
+ * worker thread.  The calls setting it update the shadow after queuing the
+ * command, as long as the new value is the one the worker thread will set.
+ * Otherwise the group is invalidated, and it's read back from the context at
+ * the next sync, along with the client arrays.
+ *
+ * glGetError() still has to wait, since the errors come from the queued
+ * calls.
+ */
+
+/** Caps shadowed in glthread_shadow::enables, valid in all APIs. */
+static const GLenum shadow_enables[] = {
+   GL_BLEND,
+   GL_CULL_FACE,
+   GL_DEPTH_TEST,
+   GL_DITHER,
+   GL_POLYGON_OFFSET_FILL,
+   GL_SCISSOR_TEST,
+   GL_STENCIL_TEST,
+};
+
+static GLbitfield
+shadow_enable_bit(GLenum cap)
+{
+   for (unsigned i = 0; i < ARRAY_SIZE(shadow_enables); i++) {
+      if (shadow_enables[i] == cap)
+         return 1u << i;
+   }
+   return 0;
+}
+
+
+static bool
+read_viewport(const struct gl_context *ctx, GLint viewport[4])
+{
+   const struct gl_viewport_attrib *vp = &ctx->ViewportArray[0];
+   const GLfloat v[4] = { vp->X, vp->Y, vp->Width, vp->Height };
+
+   /* Only integers are shadowed, which are exact in every glGet*(). */
+   for (unsigned i = 0; i < 4; i++) {
+      if (!(v[i] >= INT_MIN && v[i] <= INT_MAX) || v[i] != (GLint) v[i])
+         return false;
+      viewport[i] = (GLint) v[i];
+   }
+   return true;
+}
+
+
+static void
+read_pixel_store(struct glthread_pixel_store *store,
+                 const struct gl_pixelstore_attrib *attrib)
+{
+   store->alignment = attrib->Alignment;
+   store->row_length = attrib->RowLength;
+   store->skip_pixels = attrib->SkipPixels;
+   store->skip_rows = attrib->SkipRows;
+}
+
+
+/**
+ * Reads back the state tracked on the main thread that isn't known.  Called
+ * by _mesa_glthread_finish() when the worker thread is idle.
+ */
+void
+_mesa_glthread_read_state(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   struct glthread_shadow *shadow = &glthread->shadow;
+
+   glthread->inside_begin_end = _mesa_inside_begin_end(ctx);
+
+   if (glthread->arrays_dirty)
+      read_arrays(ctx);
+
+   if (shadow->valid == GLTHREAD_SHADOW_ALL)
+      return;
+
+   shadow->array_buffer = ctx->Array.ArrayBufferObj->Name;
+   shadow->element_array_buffer = ctx->Array.VAO->IndexBufferObj->Name;
+   shadow->active_texture = GL_TEXTURE0 + ctx->Texture.CurrentUnit;
+
+   const bool enabled[] = {
+      ctx->Color.BlendEnabled & 1,
+      ctx->Polygon.CullFlag,
+      ctx->Depth.Test,
+      ctx->Color.DitherFlag,
+      ctx->Polygon.OffsetFill,
+      ctx->Scissor.EnableFlags & 1,
+      ctx->Stencil.Enabled,
+   };
+   STATIC_ASSERT(ARRAY_SIZE(enabled) == ARRAY_SIZE(shadow_enables));
+
+   shadow->enables = 0;
+   for (unsigned i = 0; i < ARRAY_SIZE(shadow_enables); i++) {
+      if (enabled[i])
+         shadow->enables |= 1u << i;
+   }
+
+   shadow->scissor[0] = ctx->Scissor.ScissorArray[0].X;
+   shadow->scissor[1] = ctx->Scissor.ScissorArray[0].Y;
+   shadow->scissor[2] = ctx->Scissor.ScissorArray[0].Width;
+   shadow->scissor[3] = ctx->Scissor.ScissorArray[0].Height;
+
+   read_pixel_store(&shadow->pack, &ctx->Pack);
+   read_pixel_store(&shadow->unpack, &ctx->Unpack);
+
+   shadow->valid = GLTHREAD_SHADOW_ALL;
+   if (!read_viewport(ctx, shadow->viewport))
+      shadow->valid &= ~GLTHREAD_SHADOW_VIEWPORT;
+}
+
+
+void
+_mesa_glthread_Enable(struct gl_context *ctx, GLenum cap, bool enable)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+   const GLbitfield bit = shadow_enable_bit(cap);
+
+   if (bit) {
+      if (ctx->GLThread->inside_begin_end)
+         shadow->valid &= ~GLTHREAD_SHADOW_ENABLES;
+      else if (enable)
+         shadow->enables |= bit;
+      else
+         shadow->enables &= ~bit;
+      return;
+   }
+
+   _mesa_glthread_ClientState(ctx, cap, enable);
+}
+
+
+void
+_mesa_glthread_ActiveTexture(struct gl_context *ctx, GLenum texture)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   if (texture - GL_TEXTURE0 < _mesa_max_tex_unit(ctx) &&
+       !ctx->GLThread->inside_begin_end)
+      shadow->active_texture = texture;
+   else
+      shadow->valid &= ~GLTHREAD_SHADOW_TEXTURE;
+}
+
+
+void
+_mesa_glthread_Viewport(struct gl_context *ctx, GLint x, GLint y,
+                        GLsizei width, GLsizei height)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+   bool clamped = width > ctx->Const.MaxViewportWidth ||
+                  height > ctx->Const.MaxViewportHeight;
+
+   if (_mesa_has_ARB_viewport_array(ctx) ||
+       _mesa_has_OES_viewport_array(ctx)) {
+      clamped |= x < ctx->Const.ViewportBounds.Min ||
+                 x > ctx->Const.ViewportBounds.Max ||
+                 y < ctx->Const.ViewportBounds.Min ||
+                 y > ctx->Const.ViewportBounds.Max;
+   }
+
+   /* The viewport is stored as floats, which only hold 24-bit integers. */
+   if (width < 0 || height < 0 || clamped ||
+       abs(x) > (1 << 24) || abs(y) > (1 << 24) ||
+       ctx->GLThread->inside_begin_end) {
+      shadow->valid &= ~GLTHREAD_SHADOW_VIEWPORT;
+      return;
+   }
+
+   shadow->viewport[0] = x;
+   shadow->viewport[1] = y;
+   shadow->viewport[2] = width;
+   shadow->viewport[3] = height;
+}
+
+
+void
+_mesa_glthread_Scissor(struct gl_context *ctx, GLint x, GLint y,
+                       GLsizei width, GLsizei height)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+
+   if (width < 0 || height < 0 || ctx->GLThread->inside_begin_end) {
+      shadow->valid &= ~GLTHREAD_SHADOW_SCISSOR;
+      return;
+   }
+
+   shadow->scissor[0] = x;
+   shadow->scissor[1] = y;
+   shadow->scissor[2] = width;
+   shadow->scissor[3] = height;
+}
+
+
+void
+_mesa_glthread_PixelStorei(struct gl_context *ctx, GLenum pname, GLint param)
+{
+   struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+   GLint *value;
+
+   switch (pname) {
+   case GL_PACK_ALIGNMENT:
+      value = &shadow->pack.alignment;
+      break;
+   case GL_PACK_ROW_LENGTH:
+      value = &shadow->pack.row_length;
+      break;
+   case GL_PACK_SKIP_PIXELS:
+      value = &shadow->pack.skip_pixels;
+      break;
+   case GL_PACK_SKIP_ROWS:
+      value = &shadow->pack.skip_rows;
+      break;
+   case GL_UNPACK_ALIGNMENT:
+      value = &shadow->unpack.alignment;
+      break;
+   case GL_UNPACK_ROW_LENGTH:
+      value = &shadow->unpack.row_length;
+      break;
+   case GL_UNPACK_SKIP_PIXELS:
+      value = &shadow->unpack.skip_pixels;
+      break;
+   case GL_UNPACK_SKIP_ROWS:
+      value = &shadow->unpack.skip_rows;
+      break;
+   default:
+      return;
+   }
+
+   if (pname == GL_PACK_ALIGNMENT || pname == GL_UNPACK_ALIGNMENT ?
+       param != 1 && param != 2 && param != 4 && param != 8 : param < 0) {
+      shadow->valid &= ~GLTHREAD_SHADOW_PIXEL_STORE;
+      return;
+   }
+
+   if (ctx->GLThread->inside_begin_end)
+      shadow->valid &= ~GLTHREAD_SHADOW_PIXEL_STORE;
+   else
+      *value = param;
+}
+
+
+void
+_mesa_glthread_PixelStoref(struct gl_context *ctx, GLenum pname,
+                           GLfloat param)
+{
+   _mesa_glthread_PixelStorei(ctx, pname, IROUND(param));
+}
+
+
+void
+_mesa_glthread_DeleteBuffers(struct gl_context *ctx, GLsizei n,
+                             const GLuint *buffers)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   /* Deleting bound buffers unbinds them, and changes the arrays. */
+   glthread->arrays_dirty = true;
+
+   if (n < 0 || !buffers)
+      return;
+
+   for (GLsizei i = 0; i < n; i++) {
+      if (!buffers[i])
+         continue;
+
+      if (buffers[i] == glthread->shadow.array_buffer) {
+         glthread->shadow.array_buffer = 0;
+         glthread->vertex_array_is_vbo = false;
+      }
+      if (buffers[i] == glthread->shadow.element_array_buffer) {
+         glthread->shadow.element_array_buffer = 0;
+         glthread->element_array_is_vbo = false;
+      }
+   }
+}
+
+
+/**
+ * Writes the value of pname to values and returns the number of values, if
+ * it can be answered from the shadowed state.  Returns 0 otherwise.
+ */
+static unsigned
+get_shadow_value(struct gl_context *ctx, GLenum pname, GLint *values)
+{
+   const struct glthread_state *glthread = ctx->GLThread;
+   const struct glthread_shadow *shadow = &glthread->shadow;
+   const struct glthread_pixel_store *store;
+   GLbitfield group, bit;
+
+   /* glGet*() generates an error instead. */
+   if (glthread->inside_begin_end)
+      return 0;
+
+   switch (pname) {
+   case GL_ARRAY_BUFFER_BINDING:
+   case GL_ELEMENT_ARRAY_BUFFER_BINDING:
+      /* Binding names that weren't generated is an error in core profiles,
+       * and the bindings aren't validated.
+       */
+      if (ctx->API == API_OPENGL_CORE ||
+          !(shadow->valid & GLTHREAD_SHADOW_BUFFERS))
+         return 0;
+      values[0] = pname == GL_ARRAY_BUFFER_BINDING ?
+                  shadow->array_buffer : shadow->element_array_buffer;
+      return 1;
+
+   case GL_ACTIVE_TEXTURE:
+      if (!(shadow->valid & GLTHREAD_SHADOW_TEXTURE))
+         return 0;
+      values[0] = shadow->active_texture;
+      return 1;
+
+   case GL_CLIENT_ACTIVE_TEXTURE:
+      if (ctx->API == API_OPENGLES2 || glthread->arrays_dirty)
+         return 0;
+      values[0] = GL_TEXTURE0 + glthread->client_active_texture;
+      return 1;
+
+   case GL_VIEWPORT:
+   case GL_SCISSOR_BOX:
+      group = pname == GL_VIEWPORT ? GLTHREAD_SHADOW_VIEWPORT :
+                                     GLTHREAD_SHADOW_SCISSOR;
+      if (!(shadow->valid & group))
+         return 0;
+      memcpy(values, pname == GL_VIEWPORT ? shadow->viewport : shadow->scissor,
+             4 * sizeof(GLint));
+      return 4;
+
+   case GL_PACK_ALIGNMENT:
+   case GL_UNPACK_ALIGNMENT:
+      if (!(shadow->valid & GLTHREAD_SHADOW_PIXEL_STORE))
+         return 0;
+      store = pname == GL_PACK_ALIGNMENT ? &shadow->pack : &shadow->unpack;
+      values[0] = store->alignment;
+      return 1;
+
+   case GL_PACK_ROW_LENGTH:
+   case GL_PACK_SKIP_PIXELS:
+   case GL_PACK_SKIP_ROWS:
+   case GL_UNPACK_ROW_LENGTH:
+   case GL_UNPACK_SKIP_PIXELS:
+   case GL_UNPACK_SKIP_ROWS:
+      /* These aren't valid in all GLES versions. */
+      if (!_mesa_is_desktop_gl(ctx) ||
+          !(shadow->valid & GLTHREAD_SHADOW_PIXEL_STORE))
+         return 0;
+      store = pname == GL_PACK_ROW_LENGTH || pname == GL_PACK_SKIP_PIXELS ||
+              pname == GL_PACK_SKIP_ROWS ? &shadow->pack : &shadow->unpack;
+      if (pname == GL_PACK_ROW_LENGTH || pname == GL_UNPACK_ROW_LENGTH)
+         values[0] = store->row_length;
+      else if (pname == GL_PACK_SKIP_PIXELS || pname == GL_UNPACK_SKIP_PIXELS)
+         values[0] = store->skip_pixels;
+      else
+         values[0] = store->skip_rows;
+      return 1;
+
+   default:
+      bit = shadow_enable_bit(pname);
+      if (!bit || !(shadow->valid & GLTHREAD_SHADOW_ENABLES))
+         return 0;
+      values[0] = (shadow->enables & bit) != 0;
+      return 1;
+   }
+}
+
+
+void GLAPIENTRY
+_mesa_marshal_GetBooleanv(GLenum pname, GLboolean *params)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   GLint values[4];
+   unsigned count = get_shadow_value(ctx, pname, values);
+
+   if (count) {
+      for (unsigned i = 0; i < count; i++)
+         params[i] = values[i] ? GL_TRUE : GL_FALSE;
+      return;
+   }
+
+   _mesa_glthread_finish(ctx);
+   debug_print_sync("GetBooleanv");
+   CALL_GetBooleanv(ctx->CurrentServerDispatch, (pname, params));
+}
+
+
+void GLAPIENTRY
+_mesa_marshal_GetIntegerv(GLenum pname, GLint *params)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   GLint values[4];
+   unsigned count = get_shadow_value(ctx, pname, values);
+
+   if (count) {
+      memcpy(params, values, count * sizeof(GLint));
+      return;
+   }
+
+   _mesa_glthread_finish(ctx);
+   debug_print_sync("GetIntegerv");
+   CALL_GetIntegerv(ctx->CurrentServerDispatch, (pname, params));
+}
+
+
+void GLAPIENTRY
+_mesa_marshal_GetFloatv(GLenum pname, GLfloat *params)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   GLint values[4];
+   unsigned count = get_shadow_value(ctx, pname, values);
+
+   if (count) {
+      for (unsigned i = 0; i < count; i++)
+         params[i] = (GLfloat) values[i];
+      return;
+   }
+
+   _mesa_glthread_finish(ctx);
+   debug_print_sync("GetFloatv");
+   CALL_GetFloatv(ctx->CurrentServerDispatch, (pname, params));
+}
+
+
+GLboolean GLAPIENTRY
+_mesa_marshal_IsEnabled(GLenum cap)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   const struct glthread_shadow *shadow = &ctx->GLThread->shadow;
+   const GLbitfield bit = shadow_enable_bit(cap);
+
+   if (bit && (shadow->valid & GLTHREAD_SHADOW_ENABLES) &&
+       !ctx->GLThread->inside_begin_end)
+      return (shadow->enables & bit) != 0;
+
+   _mesa_glthread_finish(ctx);
+   debug_print_sync("IsEnabled");
+   return CALL_IsEnabled(ctx->CurrentServerDispatch, (cap));
+}
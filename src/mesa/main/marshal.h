@@ -70,28 +70,30 @@ _mesa_glthread_allocate_command(struct gl_context *ctx,
 }
 
 /**
- * Instead of conditionally handling marshaling previously-bound user vertex
- * array data in draw calls (deprecated and removed in GL core), we just
- * disable threading at the point where the user sets a user vertex array.
+ * Whether a draw call may read vertices from user memory.  The draws that
+ * don't copy what they read from user memory into the batch are executed
+ * synchronously then.
  */
 static inline bool
-_mesa_glthread_is_non_vbo_vertex_attrib_pointer(const struct gl_context *ctx)
+_mesa_glthread_has_non_vbo_vertices(const struct gl_context *ctx)
 {
-   struct glthread_state *glthread = ctx->GLThread;
+   const struct glthread_state *glthread = ctx->GLThread;
 
-   return ctx->API != API_OPENGL_CORE && !glthread->vertex_array_is_vbo;
+   return ctx->API != API_OPENGL_CORE &&
+          (glthread->arrays_dirty ||
+           (glthread->enabled_attribs & glthread->user_attribs));
 }
 
 /**
- * Instead of conditionally handling marshaling immediate index data in draw
- * calls (deprecated and removed in GL core), we just disable threading.
+ * Whether a draw call may read vertices or indices from user memory.
  */
 static inline bool
-_mesa_glthread_is_non_vbo_draw_elements(const struct gl_context *ctx)
+_mesa_glthread_has_non_vbo_vertices_or_indices(const struct gl_context *ctx)
 {
-   struct glthread_state *glthread = ctx->GLThread;
+   const struct glthread_state *glthread = ctx->GLThread;
 
-   return ctx->API != API_OPENGL_CORE && !glthread->element_array_is_vbo;
+   return _mesa_glthread_has_non_vbo_vertices(ctx) ||
+          (ctx->API != API_OPENGL_CORE && !glthread->element_array_is_vbo);
 }
 
 #define DEBUG_MARSHAL_PRINT_CALLS 0
@@ -174,6 +176,135 @@ _mesa_glthread_is_compat_bind_vertex_array(const struct gl_context *ctx)
    return ctx->API != API_OPENGL_CORE;
 }
 
+void
+_mesa_glthread_AttribPointer(struct gl_context *ctx, gl_vert_attrib attrib,
+                             GLint size, GLenum type, GLsizei stride,
+                             const GLvoid *pointer);
+
+static inline void
+_mesa_glthread_GenericAttribPointer(struct gl_context *ctx, GLuint index,
+                                    GLint size, GLenum type, GLsizei stride,
+                                    const GLvoid *pointer)
+{
+   if (index < VERT_ATTRIB_GENERIC_MAX)
+      _mesa_glthread_AttribPointer(ctx, VERT_ATTRIB_GENERIC(index), size,
+                                   type, stride, pointer);
+}
+
+static inline void
+_mesa_glthread_TexCoordPointer(struct gl_context *ctx, GLint size,
+                               GLenum type, GLsizei stride,
+                               const GLvoid *pointer)
+{
+   _mesa_glthread_AttribPointer(ctx,
+                                VERT_ATTRIB_TEX(ctx->GLThread->client_active_texture),
+                                size, type, stride, pointer);
+}
+
+void
+_mesa_glthread_ClientState(struct gl_context *ctx, GLenum cap, bool enable);
+
+void
+_mesa_glthread_AttribArray(struct gl_context *ctx, GLuint index, bool enable);
+
+void
+_mesa_glthread_AttribDivisor(struct gl_context *ctx, GLuint index,
+                             GLuint divisor);
+
+void
+_mesa_glthread_ClientActiveTexture(struct gl_context *ctx, GLenum texture);
+
+void
+_mesa_glthread_PrimitiveRestartIndex(struct gl_context *ctx, GLuint index);
+
+void
+_mesa_glthread_read_state(struct gl_context *ctx);
+
+void
+_mesa_glthread_Enable(struct gl_context *ctx, GLenum cap, bool enable);
+
+void
+_mesa_glthread_ActiveTexture(struct gl_context *ctx, GLenum texture);
+
+void
+_mesa_glthread_Viewport(struct gl_context *ctx, GLint x, GLint y,
+                        GLsizei width, GLsizei height);
+
+void
+_mesa_glthread_Scissor(struct gl_context *ctx, GLint x, GLint y,
+                       GLsizei width, GLsizei height);
+
+void
+_mesa_glthread_PixelStorei(struct gl_context *ctx, GLenum pname, GLint param);
+
+void
+_mesa_glthread_PixelStoref(struct gl_context *ctx, GLenum pname,
+                           GLfloat param);
+
+void
+_mesa_glthread_DeleteBuffers(struct gl_context *ctx, GLsizei n,
+                             const GLuint *buffers);
+
+/**
+ * Most calls are errors between glBegin and glEnd, so they don't change the
+ * shadowed state.
+ */
+static inline void
+_mesa_glthread_Begin(struct gl_context *ctx)
+{
+   ctx->GLThread->inside_begin_end = true;
+}
+
+static inline void
+_mesa_glthread_End(struct gl_context *ctx)
+{
+   ctx->GLThread->inside_begin_end = false;
+}
+
+/**
+ * Called after calls changing the vertex arrays in ways that aren't tracked
+ * on the main thread.
+ */
+static inline void
+_mesa_glthread_invalidate_arrays(struct gl_context *ctx)
+{
+   ctx->GLThread->arrays_dirty = true;
+}
+
+/** glVertexAttribIPointer() only accepts the integer types. */
+static inline void
+_mesa_glthread_GenericAttribIPointer(struct gl_context *ctx, GLuint index,
+                                     GLint size, GLenum type, GLsizei stride,
+                                     const GLvoid *pointer)
+{
+   switch (type) {
+   case GL_BYTE:
+   case GL_UNSIGNED_BYTE:
+   case GL_SHORT:
+   case GL_UNSIGNED_SHORT:
+   case GL_INT:
+   case GL_UNSIGNED_INT:
+      _mesa_glthread_GenericAttribPointer(ctx, index, size, type, stride,
+                                          pointer);
+      break;
+   default:
+      _mesa_glthread_invalidate_arrays(ctx);
+   }
+}
+
+/** glVertexAttribLPointer() only accepts GL_DOUBLE. */
+static inline void
+_mesa_glthread_GenericAttribLPointer(struct gl_context *ctx, GLuint index,
+                                     GLint size, GLenum type, GLsizei stride,
+                                     const GLvoid *pointer)
+{
+   if (type == GL_DOUBLE)
+      _mesa_glthread_GenericAttribPointer(ctx, index, size, type, stride,
+                                          pointer);
+   else
+      _mesa_glthread_invalidate_arrays(ctx);
+}
+
 struct marshal_cmd_Enable;
 struct marshal_cmd_ShaderSource;
 struct marshal_cmd_Flush;
@@ -187,6 +318,16 @@ struct marshal_cmd_ClearBuffer;
 #define marshal_cmd_ClearBufferiv   marshal_cmd_ClearBuffer
 #define marshal_cmd_ClearBufferuiv  marshal_cmd_ClearBuffer
 #define marshal_cmd_ClearBufferfi   marshal_cmd_ClearBuffer
+struct marshal_cmd_Draw;
+#define marshal_cmd_ArrayElement                   marshal_cmd_Draw
+#define marshal_cmd_DrawArrays                     marshal_cmd_Draw
+#define marshal_cmd_DrawArraysInstancedARB         marshal_cmd_Draw
+#define marshal_cmd_DrawElements                   marshal_cmd_Draw
+#define marshal_cmd_DrawRangeElements              marshal_cmd_Draw
+#define marshal_cmd_DrawElementsBaseVertex         marshal_cmd_Draw
+#define marshal_cmd_DrawRangeElementsBaseVertex    marshal_cmd_Draw
+#define marshal_cmd_DrawElementsInstancedARB       marshal_cmd_Draw
+#define marshal_cmd_DrawElementsInstancedBaseVertex marshal_cmd_Draw
 
 void
 _mesa_unmarshal_Enable(struct gl_context *ctx,
@@ -281,4 +422,93 @@ void GLAPIENTRY
 _mesa_marshal_ClearBufferfi(GLenum buffer, GLint drawbuffer,
                             const GLfloat depth, const GLint stencil);
 
+void
+_mesa_unmarshal_ArrayElement(struct gl_context *ctx,
+                             const struct marshal_cmd_Draw *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_ArrayElement(GLint i);
+
+void
+_mesa_unmarshal_DrawArrays(struct gl_context *ctx,
+                           const struct marshal_cmd_Draw *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawArrays(GLenum mode, GLint first, GLsizei count);
+
+void
+_mesa_unmarshal_DrawArraysInstancedARB(struct gl_context *ctx,
+                                       const struct marshal_cmd_Draw *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawArraysInstancedARB(GLenum mode, GLint first, GLsizei count,
+                                     GLsizei primcount);
+
+void
+_mesa_unmarshal_DrawElements(struct gl_context *ctx,
+                             const struct marshal_cmd_Draw *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawElements(GLenum mode, GLsizei count, GLenum type,
+                           const GLvoid *indices);
+
+void
+_mesa_unmarshal_DrawRangeElements(struct gl_context *ctx,
+                                  const struct marshal_cmd_Draw *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawRangeElements(GLenum mode, GLuint start, GLuint end,
+                                GLsizei count, GLenum type,
+                                const GLvoid *indices);
+
+void
+_mesa_unmarshal_DrawElementsBaseVertex(struct gl_context *ctx,
+                                       const struct marshal_cmd_Draw *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type,
+                                     const GLvoid *indices, GLint basevertex);
+
+void
+_mesa_unmarshal_DrawRangeElementsBaseVertex(struct gl_context *ctx,
+                                            const struct marshal_cmd_Draw *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawRangeElementsBaseVertex(GLenum mode, GLuint start,
+                                          GLuint end, GLsizei count,
+                                          GLenum type, const GLvoid *indices,
+                                          GLint basevertex);
+
+void
+_mesa_unmarshal_DrawElementsInstancedARB(struct gl_context *ctx,
+                                         const struct marshal_cmd_Draw *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsInstancedARB(GLenum mode, GLsizei count,
+                                       GLenum type, const GLvoid *indices,
+                                       GLsizei primcount);
+
+void
+_mesa_unmarshal_DrawElementsInstancedBaseVertex(struct gl_context *ctx,
+                                                const struct marshal_cmd_Draw *cmd);
+
+void GLAPIENTRY
+_mesa_marshal_DrawElementsInstancedBaseVertex(GLenum mode, GLsizei count,
+                                              GLenum type,
+                                              const GLvoid *indices,
+                                              GLsizei primcount,
+                                              GLint basevertex);
+
+void GLAPIENTRY
+_mesa_marshal_GetBooleanv(GLenum pname, GLboolean *params);
+
+void GLAPIENTRY
+_mesa_marshal_GetIntegerv(GLenum pname, GLint *params);
+
+void GLAPIENTRY
+_mesa_marshal_GetFloatv(GLenum pname, GLfloat *params);
+
+GLboolean GLAPIENTRY
+_mesa_marshal_IsEnabled(GLenum cap);
+
 #endif /* MARSHAL_H */
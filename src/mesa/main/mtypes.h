@@ -603,6 +603,7 @@ struct gl_hint_attrib
    GLenum16 TextureCompression;   /**< GL_ARB_texture_compression */
    GLenum16 GenerateMipmap;       /**< GL_SGIS_generate_mipmap */
    GLenum16 FragmentShaderDerivative; /**< GL_ARB_fragment_shader */
+   GLuint MaxShaderCompilerThreads;     /**< GL_KHR_parallel_shader_compile */
 };
 
 
@@ -1367,12 +1368,9 @@ struct gl_buffer_object
 
    struct gl_buffer_mapping Mappings[MAP_COUNT];
 
-   /** Memoization of min/max index computations for static index buffers */
+   /** Min/max index computations for index buffers, see vbo_minmax_index.c */
    simple_mtx_t MinMaxCacheMutex;
-   struct hash_table *MinMaxCache;
-   unsigned MinMaxCacheHitIndices;
-   unsigned MinMaxCacheMissIndices;
-   bool MinMaxCacheDirty;
+   struct vbo_minmax_cache *MinMaxCache;
 
    bool HandleAllocated; /**< GL_ARB_bindless_texture */
 };
@@ -4313,6 +4311,7 @@ struct gl_extensions
    GLboolean INTEL_shader_atomic_float_minmax;
    GLboolean KHR_blend_equation_advanced;
    GLboolean KHR_blend_equation_advanced_coherent;
+   GLboolean KHR_parallel_shader_compile;
    GLboolean KHR_robustness;
    GLboolean KHR_texture_compression_astc_hdr;
    GLboolean KHR_texture_compression_astc_ldr;
@@ -871,6 +871,14 @@ get_programiv(struct gl_context *ctx, GLuint program, GLenum pname,
             Program->info.cs.local_size[i];
       return;
    }
+   case GL_COMPLETION_STATUS_ARB:
+      if (!ctx->Extensions.KHR_parallel_shader_compile)
+         break;
+      if (ctx->Driver.GetShaderProgramCompletionStatus)
+         *params = ctx->Driver.GetShaderProgramCompletionStatus(ctx, shProg);
+      else
+         *params = GL_TRUE;
+      return;
    case GL_PROGRAM_SEPARABLE:
       /* If the program has not been linked, return initial value 0. */
       *params = (shProg->data->LinkStatus == LINKING_FAILURE) ? 0 : shProg->SeparateShader;
@@ -973,10 +981,19 @@ get_shaderiv(struct gl_context *ctx, GLuint name, GLenum pname, GLint *params)
    case GL_SPIR_V_BINARY_ARB:
       *params = (shader->spirv_data != NULL);
       break;
+   case GL_COMPLETION_STATUS_ARB:
+      if (!ctx->Extensions.KHR_parallel_shader_compile)
+         goto invalid_enum;
+      /* Shaders are compiled when glCompileShader is called. */
+      *params = GL_TRUE;
+      break;
    default:
-      _mesa_error(ctx, GL_INVALID_ENUM, "glGetShaderiv(pname)");
-      return;
+      goto invalid_enum;
    }
+   return;
+
+invalid_enum:
+   _mesa_error(ctx, GL_INVALID_ENUM, "glGetShaderiv(pname)");
 }
 
 
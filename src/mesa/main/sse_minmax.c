@@ -26,6 +26,7 @@
  */
 
 #include "main/sse_minmax.h"
+#include "util/macros.h"
 #include <smmintrin.h>
 #include <stdint.h>
 
@@ -92,3 +93,100 @@ _mesa_uint_array_min_max(const unsigned *ui_indices, unsigned *min_index,
    *min_index = min_ui;
    *max_index = max_ui;
 }
+
+
+/**
+ * Define a function computing the minimum, maximum and maximum other than
+ * the largest value of an unsigned type, for arrays of that type.
+ * The largest value is left out of the second maximum by masking the lanes
+ * holding it to zero.
+ */
+#define INDEX_ARRAY_MIN_MAX(name, type, lanes, min_op, max_op, cmpeq_op)   \
+static void                                                                \
+name(const type *indices, unsigned count, unsigned *min_index,             \
+     unsigned *max_index, unsigned *max_non_restart)                       \
+{                                                                          \
+   const type restart = (type) ~0U;                                        \
+   type min = restart, max = 0, max_nr = 0;                                \
+   unsigned i;                                                             \
+                                                                           \
+   while (((uintptr_t)indices & 15) && count) {                            \
+      min = MIN2(min, *indices);                                           \
+      max = MAX2(max, *indices);                                           \
+      if (*indices != restart)                                             \
+         max_nr = MAX2(max_nr, *indices);                                  \
+      count--;                                                             \
+      indices++;                                                           \
+   }                                                                       \
+                                                                           \
+   if (count >= 2 * (lanes)) {                                             \
+      type min_arr[lanes] __attribute__ ((aligned (16)));                  \
+      type max_arr[lanes] __attribute__ ((aligned (16)));                  \
+      type max_nr_arr[lanes] __attribute__ ((aligned (16)));               \
+      const __m128i *ptr = (const __m128i *)indices;                       \
+      const __m128i ones = _mm_set1_epi32(~0);                             \
+      __m128i min4 = ones;                                                 \
+      __m128i max4 = _mm_setzero_si128();                                  \
+      __m128i max_nr4 = _mm_setzero_si128();                               \
+                                                                           \
+      for (i = 0; i < count / (lanes); i++) {                              \
+         const __m128i v = _mm_load_si128(&ptr[i]);                        \
+         min4 = min_op(v, min4);                                           \
+         max4 = max_op(v, max4);                                           \
+         max_nr4 = max_op(_mm_andnot_si128(cmpeq_op(v, ones), v),          \
+                          max_nr4);                                        \
+      }                                                                    \
+                                                                           \
+      _mm_store_si128((__m128i *)min_arr, min4);                           \
+      _mm_store_si128((__m128i *)max_arr, max4);                           \
+      _mm_store_si128((__m128i *)max_nr_arr, max_nr4);                     \
+                                                                           \
+      for (i = 0; i < (lanes); i++) {                                      \
+         min = MIN2(min, min_arr[i]);                                      \
+         max = MAX2(max, max_arr[i]);                                      \
+         max_nr = MAX2(max_nr, max_nr_arr[i]);                             \
+      }                                                                    \
+                                                                           \
+      indices += count & ~((lanes) - 1);                                   \
+      count &= (lanes) - 1;                                                \
+   }                                                                       \
+                                                                           \
+   for (i = 0; i < count; i++) {                                           \
+      min = MIN2(min, indices[i]);                                         \
+      max = MAX2(max, indices[i]);                                         \
+      if (indices[i] != restart)                                           \
+         max_nr = MAX2(max_nr, indices[i]);                                \
+   }                                                                       \
+                                                                           \
+   *min_index = min;                                                       \
+   *max_index = max;                                                       \
+   *max_non_restart = max_nr;                                              \
+}
+
+INDEX_ARRAY_MIN_MAX(uint_array_min_max, uint32_t, 4,
+                    _mm_min_epu32, _mm_max_epu32, _mm_cmpeq_epi32)
+INDEX_ARRAY_MIN_MAX(ushort_array_min_max, uint16_t, 8,
+                    _mm_min_epu16, _mm_max_epu16, _mm_cmpeq_epi16)
+INDEX_ARRAY_MIN_MAX(ubyte_array_min_max, uint8_t, 16,
+                    _mm_min_epu8, _mm_max_epu8, _mm_cmpeq_epi8)
+
+void
+_mesa_index_array_min_max(const void *indices, unsigned index_size,
+                          unsigned count, unsigned *min_index,
+                          unsigned *max_index, unsigned *max_non_restart)
+{
+   switch (index_size) {
+   case 4:
+      uint_array_min_max(indices, count, min_index, max_index,
+                         max_non_restart);
+      break;
+   case 2:
+      ushort_array_min_max(indices, count, min_index, max_index,
+                           max_non_restart);
+      break;
+   default:
+      ubyte_array_min_max(indices, count, min_index, max_index,
+                          max_non_restart);
+      break;
+   }
+}
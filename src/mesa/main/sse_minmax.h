@@ -32,4 +32,14 @@ void
 _mesa_uint_array_min_max(const unsigned *ui_indices, unsigned *min_index,
                          unsigned *max_index, const unsigned count);
 
+/**
+ * Compute the minimum and maximum of an array of 1, 2 or 4 byte indices,
+ * and the maximum other than the largest value of the index type, which
+ * is the maximum to use when that value is the primitive restart index.
+ */
+void
+_mesa_index_array_min_max(const void *indices, unsigned index_size,
+                          unsigned count, unsigned *min_index,
+                          unsigned *max_index, unsigned *max_non_restart);
+
 #endif /* SSE_MINMAX_H */
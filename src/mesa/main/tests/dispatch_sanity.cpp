@@ -1173,6 +1173,10 @@ const struct function common_desktop_functions_possible[] = {
    /* GL_ARB_gl_spirv */
    { "glSpecializeShaderARB", 45, -1 },
 
+   /* GL_ARB_parallel_shader_compile / GL_KHR_parallel_shader_compile */
+   { "glMaxShaderCompilerThreadsARB", 11, -1 },
+   { "glMaxShaderCompilerThreadsKHR", 11, -1 },
+
    /* GL_EXT_shader_framebuffer_fetch_non_coherent */
    { "glFramebufferFetchBarrierEXT", 20, -1 },
 
@@ -2209,6 +2213,9 @@ const struct function gles2_functions_possible[] = {
    /* GL_KHR_blend_equation_advanced */
    { "glBlendBarrierKHR", 20, -1 },
 
+   /* GL_KHR_parallel_shader_compile */
+   { "glMaxShaderCompilerThreadsKHR", 20, -1 },
+
    /* GL_EXT_occlusion_query_boolean */
    { "glGenQueriesEXT", 20, -1 },
    { "glDeleteQueriesEXT", 20, -1 },
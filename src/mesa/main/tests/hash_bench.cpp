@@ -0,0 +1,177 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Measures glGen*()-style name allocation in the GL object hash tables, as
+ * an application churning through objects would do it: with a fresh table,
+ * with a table where many names were deleted, and with a table holding a name
+ * near the top of the key space, which used to force a linear search.
+ *
+ * Then measures lookups from several threads sharing a table, with dense
+ * names, which don't lock the table, and with sparse names, which do.
+ *
+ * Usage: hash_bench [live objects] [allocations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "c11/threads.h"
+#include "main/hash.h"
+#include "util/os_time.h"
+
+static void
+ignore_entry(GLuint key, void *data, void *userData)
+{
+}
+
+static void
+bench(const char *name, struct _mesa_HashTable *table, unsigned live,
+      unsigned allocations, unsigned block)
+{
+   std::vector<GLuint> keys;
+   int64_t start;
+
+   /* Fill the table up to the number of live objects first. */
+   while (keys.size() < live) {
+      GLuint first = _mesa_HashFindFreeKeyBlock(table, block);
+      for (unsigned i = 0; i < block; i++) {
+         _mesa_HashInsert(table, first + i, table);
+         keys.push_back(first + i);
+      }
+   }
+
+   start = os_time_get_nano();
+
+   for (unsigned n = 0; n < allocations; n++) {
+      /* Delete a random block of live objects and gen a new one. */
+      unsigned victim = (rand() % (keys.size() / block)) * block;
+
+      _mesa_HashLockMutex(table);
+      for (unsigned i = 0; i < block; i++)
+         _mesa_HashRemoveLocked(table, keys[victim + i]);
+
+      GLuint first = _mesa_HashFindFreeKeyBlock(table, block);
+      if (!first) {
+         _mesa_HashUnlockMutex(table);
+         fprintf(stderr, "  out of names\n");
+         break;
+      }
+      for (unsigned i = 0; i < block; i++) {
+         _mesa_HashInsertLocked(table, first + i, table);
+         keys[victim + i] = first + i;
+      }
+      _mesa_HashUnlockMutex(table);
+   }
+
+   printf("%-24s %8.3f us/gen of %u\n", name,
+          (os_time_get_nano() - start) / 1000.0 / allocations, block);
+
+   _mesa_HashDeleteAll(table, ignore_entry, NULL);
+   _mesa_DeleteHashTable(table);
+}
+
+#define LOOKUPS_PER_THREAD 2000000
+
+struct lookup_thread {
+   struct _mesa_HashTable *table;
+   unsigned live;
+   GLuint stride;
+   unsigned seed;
+   unsigned found;
+};
+
+static int
+lookup_thread_func(void *data)
+{
+   struct lookup_thread *t = (struct lookup_thread *) data;
+   unsigned seed = t->seed;
+
+   for (unsigned i = 0; i < LOOKUPS_PER_THREAD; i++) {
+      seed = seed * 1103515245 + 12345;
+      GLuint key = (1 + (seed >> 8) % t->live) * t->stride;
+
+      if (_mesa_HashLookup(t->table, key))
+         t->found++;
+   }
+
+   return 0;
+}
+
+static void
+bench_lookups(const char *name, unsigned live, GLuint stride)
+{
+   struct _mesa_HashTable *table = _mesa_NewHashTable();
+
+   for (unsigned i = 1; i <= live; i++)
+      _mesa_HashInsert(table, i * stride, table);
+
+   for (unsigned num_threads = 1; num_threads <= 8; num_threads *= 2) {
+      struct lookup_thread threads[8];
+      thrd_t handles[8];
+      int64_t start = os_time_get_nano();
+
+      for (unsigned i = 0; i < num_threads; i++) {
+         threads[i].table = table;
+         threads[i].live = live;
+         threads[i].stride = stride;
+         threads[i].seed = i + 1;
+         threads[i].found = 0;
+         thrd_create(&handles[i], lookup_thread_func, &threads[i]);
+      }
+      for (unsigned i = 0; i < num_threads; i++)
+         thrd_join(handles[i], NULL);
+
+      double secs = (os_time_get_nano() - start) / 1e9;
+      printf("%-24s %u threads: %8.2f M lookups/s\n", name, num_threads,
+             num_threads * (double) LOOKUPS_PER_THREAD / secs / 1e6);
+   }
+
+   _mesa_HashDeleteAll(table, ignore_entry, NULL);
+   _mesa_DeleteHashTable(table);
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned live = argc > 1 ? atoi(argv[1]) : 100000;
+   unsigned allocations = argc > 2 ? atoi(argv[2]) : 100000;
+
+   if (live < 64 || allocations == 0)
+      return 1;
+
+   srand(1);
+   printf("%u live objects, %u allocations\n", live, allocations);
+
+   bench("churn", _mesa_NewHashTable(), live, allocations, 1);
+   bench("churn, blocks", _mesa_NewHashTable(), live, allocations, 64);
+
+   struct _mesa_HashTable *table = _mesa_NewHashTable();
+   _mesa_HashInsert(table, ~0u - 2, table);
+   bench("churn, high name used", table, live, allocations, 1);
+
+   bench_lookups("lookup, dense names", live, 1);
+   bench_lookups("lookup, sparse names", live, 1000);
+
+   return 0;
+}
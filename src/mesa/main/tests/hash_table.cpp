@@ -0,0 +1,217 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name hash_table.cpp
+ *
+ * Test the allocation of free keys and the lookups in the GL object hash
+ * tables.
+ */
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <map>
+
+#include "main/hash.h"
+
+namespace {
+
+class HashFreeKeys : public ::testing::Test {
+protected:
+   virtual void SetUp()
+   {
+      table = _mesa_NewHashTable();
+   }
+
+   virtual void TearDown()
+   {
+      _mesa_HashDeleteAll(table, ignore_entry, NULL);
+      _mesa_DeleteHashTable(table);
+   }
+
+   static void ignore_entry(GLuint key, void *data, void *userData)
+   {
+   }
+
+   void insert_block(GLuint first, GLuint count)
+   {
+      for (GLuint i = 0; i < count; i++)
+         _mesa_HashInsert(table, first + i, this);
+   }
+
+   void remove_block(GLuint first, GLuint count)
+   {
+      for (GLuint i = 0; i < count; i++)
+         _mesa_HashRemove(table, first + i);
+   }
+
+   struct _mesa_HashTable *table;
+};
+
+} /* anonymous namespace */
+
+TEST_F(HashFreeKeys, Sequential)
+{
+   EXPECT_EQ(1u, _mesa_HashFindFreeKeyBlock(table, 10));
+   insert_block(1, 10);
+   EXPECT_EQ(11u, _mesa_HashFindFreeKeyBlock(table, 1));
+   EXPECT_EQ(11u, _mesa_HashFindFreeKeyBlock(table, 1000));
+}
+
+TEST_F(HashFreeKeys, ReuseDeletedKeys)
+{
+   insert_block(1, 200);
+   remove_block(51, 50);
+
+   /* The lowest block large enough is used. */
+   EXPECT_EQ(51u, _mesa_HashFindFreeKeyBlock(table, 50));
+   EXPECT_EQ(51u, _mesa_HashFindFreeKeyBlock(table, 10));
+   EXPECT_EQ(201u, _mesa_HashFindFreeKeyBlock(table, 51));
+
+   /* Adjacent free keys are merged. */
+   remove_block(101, 50);
+   EXPECT_EQ(51u, _mesa_HashFindFreeKeyBlock(table, 100));
+   EXPECT_EQ(201u, _mesa_HashFindFreeKeyBlock(table, 101));
+
+   /* DELETED_KEY_VALUE is tracked outside of the table. */
+   _mesa_HashRemove(table, DELETED_KEY_VALUE);
+   EXPECT_EQ((GLuint) DELETED_KEY_VALUE, _mesa_HashFindFreeKeyBlock(table, 1));
+   _mesa_HashInsert(table, DELETED_KEY_VALUE, this);
+   EXPECT_EQ(51u, _mesa_HashFindFreeKeyBlock(table, 1));
+}
+
+TEST_F(HashFreeKeys, UserChosenKeys)
+{
+   /* Legacy GL lets applications pick their names, including huge ones. */
+   _mesa_HashInsert(table, 100, this);
+   _mesa_HashInsert(table, 0xfffffff0u, this);
+   _mesa_HashInsert(table, ~0u, this);
+
+   EXPECT_EQ(1u, _mesa_HashFindFreeKeyBlock(table, 99));
+   EXPECT_EQ(101u, _mesa_HashFindFreeKeyBlock(table, 100));
+   EXPECT_EQ(101u, _mesa_HashFindFreeKeyBlock(table, 0xfffffff0u - 101));
+   EXPECT_EQ(0u, _mesa_HashFindFreeKeyBlock(table, 0xfffffff0u - 100));
+
+}
+
+TEST_F(HashFreeKeys, ReservedKeys)
+{
+   /* 0 isn't a valid name and ~0 is never returned, even once used and
+    * deleted.
+    */
+   EXPECT_EQ(1u, _mesa_HashFindFreeKeyBlock(table, 0xfffffffeu));
+   EXPECT_EQ(0u, _mesa_HashFindFreeKeyBlock(table, 0xffffffffu));
+
+   _mesa_HashInsert(table, ~0u, this);
+   _mesa_HashRemove(table, ~0u);
+   EXPECT_EQ(1u, _mesa_HashFindFreeKeyBlock(table, 0xfffffffeu));
+   EXPECT_EQ(0u, _mesa_HashFindFreeKeyBlock(table, 0xffffffffu));
+}
+
+TEST_F(HashFreeKeys, MatchesLinearSearch)
+{
+   const GLuint range = 2000;
+   bool used[range + 1] = { false };
+
+   srand(42);
+   for (unsigned i = 0; i < 20000; i++) {
+      if (rand() % 2) {
+         const GLuint count = 1 + rand() % (rand() % 4 ? 4 : 100);
+         GLuint expected = 0, run = 0;
+
+         for (GLuint key = 1; key <= range && !expected; key++) {
+            run = used[key] ? 0 : run + 1;
+            if (run == count)
+               expected = key - count + 1;
+         }
+         if (!expected)
+            continue;
+
+         ASSERT_EQ(expected, _mesa_HashFindFreeKeyBlock(table, count));
+         insert_block(expected, count);
+         for (GLuint key = expected; key < expected + count; key++)
+            used[key] = true;
+      } else {
+         const GLuint key = 1 + rand() % range;
+
+         _mesa_HashRemove(table, key);
+         used[key] = false;
+      }
+   }
+}
+
+namespace {
+
+class HashLookup : public HashFreeKeys {
+};
+
+} /* anonymous namespace */
+
+TEST_F(HashLookup, MatchesLockedLookup)
+{
+   std::map<GLuint, void *> data;
+
+   srand(7);
+   for (unsigned i = 0; i < 50000; i++) {
+      /* Mostly dense keys, which are looked up without locking, and a few
+       * sparse ones, which aren't.
+       */
+      GLuint key = 1 + rand() % 5000;
+      if (rand() % 16 == 0)
+         key *= 100003;
+
+      switch (rand() % 3) {
+      case 0:
+         data[key] = &data;
+         _mesa_HashInsert(table, key, &data);
+         break;
+      case 1:
+         data.erase(key);
+         _mesa_HashRemove(table, key);
+         break;
+      default:
+         void *expected = data.count(key) ? data[key] : NULL;
+
+         ASSERT_EQ(expected, _mesa_HashLookup(table, key));
+         _mesa_HashLockMutex(table);
+         ASSERT_EQ(expected, _mesa_HashLookupLocked(table, key));
+         _mesa_HashUnlockMutex(table);
+         break;
+      }
+   }
+
+   _mesa_HashDeleteAll(table, ignore_entry, NULL);
+   for (auto entry : data)
+      ASSERT_EQ(NULL, _mesa_HashLookup(table, entry.first));
+}
+
+TEST_F(HashLookup, SparseKeys)
+{
+   for (GLuint i = 1; i <= 100; i++)
+      _mesa_HashInsert(table, i * 100000, this);
+
+   for (GLuint i = 1; i <= 100; i++) {
+      EXPECT_EQ(this, _mesa_HashLookup(table, i * 100000));
+      EXPECT_EQ(NULL, _mesa_HashLookup(table, i * 100000 + 1));
+   }
+}
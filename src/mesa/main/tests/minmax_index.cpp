@@ -0,0 +1,321 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \name minmax_index.cpp
+ *
+ * Test the min/max index computations of index buffers against a plain scan
+ * of the indices: the per-buffer cache with writes invalidating part of it,
+ * primitive restart, and the SSE4.1 scan.
+ */
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "main/mtypes.h"
+#include "vbo/vbo.h"
+
+extern "C" {
+#include "main/sse_minmax.h"
+#include "x86/common_x86_asm.h"
+}
+
+namespace {
+
+struct min_max {
+   unsigned min;
+   unsigned max;
+};
+
+/**
+ * Min/max of the indices, leaving out restart_index if restart is set.
+ */
+static min_max
+reference_min_max(const void *indices, unsigned index_size, unsigned count,
+                  bool restart, unsigned restart_index)
+{
+   min_max result = { ~0u, 0 };
+
+   for (unsigned i = 0; i < count; i++) {
+      unsigned value;
+
+      switch (index_size) {
+      case 4:
+         value = ((const uint32_t *) indices)[i];
+         break;
+      case 2:
+         value = ((const uint16_t *) indices)[i];
+         break;
+      default:
+         value = ((const uint8_t *) indices)[i];
+         break;
+      }
+
+      if (restart && value == restart_index)
+         continue;
+
+      result.min = MIN2(result.min, value);
+      result.max = MAX2(result.max, value);
+   }
+   return result;
+}
+
+class MinMaxIndex : public ::testing::Test {
+protected:
+   virtual void SetUp()
+   {
+      ctx = (struct gl_context *) calloc(1, sizeof(*ctx));
+      ctx->Driver.MapBufferRange = map_buffer_range;
+      ctx->Driver.UnmapBuffer = unmap_buffer;
+
+      memset(&obj, 0, sizeof(obj));
+      obj.Name = 1;
+      simple_mtx_init(&obj.MinMaxCacheMutex, mtx_plain);
+   }
+
+   virtual void TearDown()
+   {
+      vbo_delete_minmax_cache(&obj);
+      simple_mtx_destroy(&obj.MinMaxCacheMutex);
+      free(ctx);
+   }
+
+   static void *map_buffer_range(struct gl_context *ctx, GLintptr offset,
+                                 GLsizeiptr length, GLbitfield access,
+                                 struct gl_buffer_object *obj,
+                                 gl_map_buffer_index index)
+   {
+      return obj->Data + offset;
+   }
+
+   static GLboolean unmap_buffer(struct gl_context *ctx,
+                                 struct gl_buffer_object *obj,
+                                 gl_map_buffer_index index)
+   {
+      return GL_TRUE;
+   }
+
+   void set_buffer(unsigned index_size, unsigned num_indices)
+   {
+      vbo_delete_minmax_cache(&obj);
+      data.assign(index_size * num_indices, 0);
+      obj.Data = data.data();
+      obj.Size = data.size();
+      this->index_size = index_size;
+   }
+
+   void set_index(unsigned i, unsigned value)
+   {
+      switch (index_size) {
+      case 4:
+         ((uint32_t *) obj.Data)[i] = value;
+         break;
+      case 2:
+         ((uint16_t *) obj.Data)[i] = value;
+         break;
+      default:
+         obj.Data[i] = value;
+         break;
+      }
+   }
+
+   /** Write indices [first, first + count), as glBufferSubData would. */
+   void write(unsigned first, unsigned count, unsigned max_value)
+   {
+      for (unsigned i = first; i < first + count; i++)
+         set_index(i, rand() % (max_value + 1));
+      vbo_invalidate_minmax_cache(&obj, first * index_size,
+                                  count * index_size);
+   }
+
+   min_max draw(unsigned start, unsigned count)
+   {
+      struct _mesa_prim prim;
+      struct _mesa_index_buffer ib;
+      min_max result;
+
+      memset(&prim, 0, sizeof(prim));
+      prim.start = start;
+      prim.count = count;
+
+      ib.count = count;
+      ib.index_size = index_size;
+      ib.obj = &obj;
+      ib.ptr = NULL;
+
+      vbo_get_minmax_indices(ctx, &prim, &ib, &result.min, &result.max, 1);
+      return result;
+   }
+
+   void expect_draw(unsigned start, unsigned count)
+   {
+      const bool restart = ctx->Array._PrimitiveRestart;
+      const min_max expected =
+         reference_min_max(obj.Data + start * index_size, index_size, count,
+                           restart, ctx->Array.RestartIndex);
+      const min_max result = draw(start, count);
+
+      if (expected.min > expected.max) {
+         /* Only restart indices, any empty range will do. */
+         EXPECT_GT(result.min, result.max);
+      } else {
+         EXPECT_EQ(expected.min, result.min);
+         EXPECT_EQ(expected.max, result.max);
+      }
+   }
+
+   struct gl_context *ctx;
+   struct gl_buffer_object obj;
+   std::vector<GLubyte> data;
+   unsigned index_size;
+};
+
+} /* anonymous namespace */
+
+TEST_F(MinMaxIndex, PartialInvalidation)
+{
+   /* 64 blocks of 1024 bytes. */
+   set_buffer(2, 32 * 1024);
+   write(0, 32 * 1024, 1000);
+   expect_draw(0, 32 * 1024);
+
+   /* Only the blocks in the written range are scanned again: the write
+    * to the last block, which isn't reported, goes unnoticed.
+    */
+   set_index(5000, 2000);
+   vbo_invalidate_minmax_cache(&obj, 5000 * 2, 2);
+   set_index(32 * 1024 - 1, 3000);
+   EXPECT_EQ(2000u, draw(0, 32 * 1024).max);
+   EXPECT_EQ(2000u, draw(4096, 2048).max);
+
+   vbo_invalidate_minmax_cache(&obj, (32 * 1024 - 1) * 2, 2);
+   EXPECT_EQ(3000u, draw(0, 32 * 1024).max);
+
+   /* Ranges ending anywhere within blocks, as well as past the end. */
+   set_index(100, 0);
+   vbo_invalidate_minmax_cache(&obj, 0, 1024 * 1024);
+   expect_draw(100, 16 * 1024);
+   expect_draw(101, 16 * 1024);
+   expect_draw(511, 514);
+   expect_draw(512, 512);
+}
+
+TEST_F(MinMaxIndex, MatchesScan)
+{
+   static const unsigned sizes[] = { 1, 2, 4 };
+
+   srand(23);
+   for (unsigned s = 0; s < ARRAY_SIZE(sizes); s++) {
+      const unsigned num_indices = 50000;
+      const unsigned max_value = sizes[s] == 1 ? 0xff :
+                                 sizes[s] == 2 ? 0xffff : 0xfffff;
+
+      set_buffer(sizes[s], num_indices);
+      write(0, num_indices, max_value);
+
+      for (unsigned i = 0; i < 2000; i++) {
+         const unsigned start = rand() % num_indices;
+         const unsigned count =
+            rand() % (rand() % 4 ? 3000 : num_indices - start + 1);
+
+         if (rand() % 2) {
+            write(start, MIN2(count, num_indices - start), max_value);
+            continue;
+         }
+
+         ctx->Array._PrimitiveRestart = rand() % 2;
+         ctx->Array.RestartIndex = 0xffffffffu >> 8 * (4 - sizes[s]);
+         if (rand() % 8 == 0) {
+            /* Restart indices other than the largest value skip the cache */
+            ctx->Array.RestartIndex = rand() % (max_value + 1);
+         }
+         if (rand() % 4 == 0) {
+            /* Restart indices spread over the buffer */
+            for (unsigned j = 0; j < 8; j++) {
+               const unsigned k = rand() % num_indices;
+
+               set_index(k, ctx->Array.RestartIndex);
+               vbo_invalidate_minmax_cache(&obj, k * sizes[s], sizes[s]);
+            }
+         }
+
+         expect_draw(start, MIN2(count, num_indices - start));
+      }
+   }
+}
+
+TEST_F(MinMaxIndex, RestartOnly)
+{
+   set_buffer(2, 4096);
+   for (unsigned i = 0; i < 4096; i++)
+      set_index(i, 0xffff);
+
+   ctx->Array._PrimitiveRestart = GL_TRUE;
+   ctx->Array.RestartIndex = 0xffff;
+   expect_draw(0, 4096);
+   expect_draw(3, 10);
+
+   set_index(2000, 7);
+   vbo_invalidate_minmax_cache(&obj, 4000, 2);
+   expect_draw(0, 4096);
+}
+
+#if defined(USE_SSE41)
+TEST(MinMaxIndexSSE41, MatchesScalar)
+{
+   static const unsigned sizes[] = { 1, 2, 4 };
+   std::vector<uint32_t> storage(1024 + 4);
+
+   _mesa_get_x86_features();
+   if (!cpu_has_sse4_1)
+      return;
+
+   srand(41);
+   for (unsigned i = 0; i < 20000; i++) {
+      const unsigned index_size = sizes[rand() % ARRAY_SIZE(sizes)];
+      const unsigned type_max = 0xffffffffu >> 8 * (4 - index_size);
+      /* Unaligned starts and lengths which aren't a multiple of a vector */
+      const unsigned offset = rand() % 16;
+      const unsigned count = 1 + rand() % (rand() % 4 ? 64 : 1023);
+      GLubyte *indices = (GLubyte *) storage.data() + offset;
+      unsigned min, max, max_non_restart;
+
+      for (unsigned j = 0; j < count * index_size; j++)
+         indices[j] = rand() % 8 == 0 ? 0xff : rand();
+
+      _mesa_index_array_min_max(indices, index_size, count, &min, &max,
+                                &max_non_restart);
+
+      const min_max all = reference_min_max(indices, index_size, count,
+                                            false, 0);
+      const min_max non_restart = reference_min_max(indices, index_size,
+                                                    count, true, type_max);
+
+      ASSERT_EQ(all.min, min);
+      ASSERT_EQ(all.max, max);
+      ASSERT_EQ(non_restart.max, max_non_restart);
+   }
+}
+#endif
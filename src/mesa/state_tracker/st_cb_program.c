@@ -246,7 +246,8 @@ st_program_string_notify( struct gl_context *ctx,
    }
 
    if (ST_DEBUG & DEBUG_PRECOMPILE ||
-       st->shader_has_one_variant[stage])
+       st->shader_has_one_variant[stage] ||
+       st_compiles_in_background(st))
       st_precompile_shader_variant(st, prog);
 
    return GL_TRUE;
@@ -266,6 +267,72 @@ st_new_ati_fs(struct gl_context *ctx, struct ati_fragment_shader *curProg)
    return prog;
 }
 
+/**
+ * Called via ctx->Driver.SetMaxShaderCompilerThreads()
+ */
+static void
+st_max_shader_compiler_threads(struct gl_context *ctx, unsigned count)
+{
+   struct pipe_context *pipe = st_context(ctx)->pipe;
+
+   if (pipe->set_max_shader_compiler_threads)
+      pipe->set_max_shader_compiler_threads(pipe, count);
+}
+
+/**
+ * Return the driver shader of the variant created at link time, if any.
+ */
+static void *
+st_get_precompiled_driver_shader(struct gl_program *prog)
+{
+   switch (prog->Target) {
+   case GL_VERTEX_PROGRAM_ARB: {
+      struct st_vertex_program *stvp = (struct st_vertex_program *) prog;
+      return stvp->variants ? stvp->variants->driver_shader : NULL;
+   }
+   case GL_FRAGMENT_PROGRAM_ARB: {
+      struct st_fragment_program *stfp = (struct st_fragment_program *) prog;
+      return stfp->variants ? stfp->variants->driver_shader : NULL;
+   }
+   case GL_COMPUTE_PROGRAM_NV: {
+      struct st_compute_program *stcp = (struct st_compute_program *) prog;
+      return stcp->variants ? stcp->variants->driver_shader : NULL;
+   }
+   default: {
+      struct st_common_program *stp = st_common_program(prog);
+      return stp->variants ? stp->variants->driver_shader : NULL;
+   }
+   }
+}
+
+/**
+ * Called via ctx->Driver.GetShaderProgramCompletionStatus()
+ */
+static bool
+st_get_shader_program_completion_status(struct gl_context *ctx,
+                                        struct gl_shader_program *shprog)
+{
+   struct pipe_screen *screen = st_context(ctx)->pipe->screen;
+
+   if (!screen->is_parallel_shader_compilation_finished)
+      return true;
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      struct gl_linked_shader *linked = shprog->_LinkedShaders[i];
+      void *sh;
+
+      if (!linked || !linked->Program)
+         continue;
+
+      sh = st_get_precompiled_driver_shader(linked->Program);
+      if (sh &&
+          !screen->is_parallel_shader_compilation_finished(screen, sh,
+                                          pipe_shader_type_from_mesa(i)))
+         return false;
+   }
+   return true;
+}
+
 /**
  * Plug in the program and shader-related device driver functions.
  */
@@ -278,4 +345,7 @@ st_init_program_functions(struct dd_function_table *functions)
    functions->NewATIfs = st_new_ati_fs;
    
    functions->LinkShader = st_link_shader;
+   functions->SetMaxShaderCompilerThreads = st_max_shader_compiler_threads;
+   functions->GetShaderProgramCompletionStatus =
+      st_get_shader_program_completion_status;
 }
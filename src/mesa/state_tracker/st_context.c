@@ -277,6 +277,9 @@ st_destroy_context_priv(struct st_context *st, bool destroy_pipe)
    st_invalidate_readpix_cache(st);
    util_throttle_deinit(st->pipe->screen, &st->throttle);
 
+   if (util_queue_is_initialized(&st->link_queue))
+      util_queue_destroy(&st->link_queue);
+
    cso_destroy_context(st->cso_context);
 
    if (st->pipe && destroy_pipe)
@@ -618,6 +621,83 @@ destroy_tex_sampler_cb(GLuint id, void *data, void *userData)
 }
 
 
+struct st_stage_job {
+   struct util_queue_fence fence;
+   st_stage_job_func func;
+   struct st_context *st;
+   struct gl_shader_program *prog;
+   struct gl_linked_shader *shader;
+};
+
+
+static void
+st_execute_stage_job(void *data, int thread_index)
+{
+   struct st_stage_job *job = (struct st_stage_job *) data;
+
+   job->func(job->st, job->prog, job->shader);
+}
+
+
+/**
+ * Call func for each linked stage of prog and return once all the calls
+ * are done.  The stages are processed concurrently on the link queue, so
+ * func must only change the linked shader it is given.
+ */
+void
+st_run_stage_jobs(struct st_context *st, struct gl_shader_program *prog,
+                  st_stage_job_func func)
+{
+   struct st_stage_job jobs[MESA_SHADER_STAGES];
+   unsigned num_jobs = 0;
+   unsigned i;
+
+   for (i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (prog->_LinkedShaders[i]) {
+         jobs[num_jobs].func = func;
+         jobs[num_jobs].st = st;
+         jobs[num_jobs].prog = prog;
+         jobs[num_jobs].shader = prog->_LinkedShaders[i];
+         num_jobs++;
+      }
+   }
+
+   if (num_jobs > 1 && util_cpu_caps.nr_cpus > 1 &&
+       !(ST_DEBUG & DEBUG_SERIAL_LINK) &&
+       !util_queue_is_initialized(&st->link_queue)) {
+      /* The calling thread processes one of the stages itself. */
+      util_queue_init(&st->link_queue, "st_link", MESA_SHADER_STAGES,
+                      MIN2(util_cpu_caps.nr_cpus, MESA_SHADER_STAGES) - 1,
+                      UTIL_QUEUE_INIT_RESIZE_IF_FULL);
+   }
+
+   if (num_jobs <= 1 || !util_queue_is_initialized(&st->link_queue)) {
+      for (i = 0; i < num_jobs; i++)
+         func(st, prog, jobs[i].shader);
+      return;
+   }
+
+   struct util_queue_job queue_jobs[MESA_SHADER_STAGES];
+
+   for (i = 0; i < num_jobs - 1; i++) {
+      util_queue_fence_init(&jobs[i].fence);
+      queue_jobs[i].job = &jobs[i];
+      queue_jobs[i].fence = &jobs[i].fence;
+      queue_jobs[i].execute = st_execute_stage_job;
+      queue_jobs[i].cleanup = NULL;
+   }
+   util_queue_add_jobs(&st->link_queue, queue_jobs, num_jobs - 1,
+                       UTIL_QUEUE_PRIORITY_HIGH);
+
+   func(st, prog, jobs[num_jobs - 1].shader);
+
+   for (i = 0; i < num_jobs - 1; i++) {
+      util_queue_fence_wait(&jobs[i].fence);
+      util_queue_fence_destroy(&jobs[i].fence);
+   }
+}
+
+
 void
 st_destroy_context(struct st_context *st)
 {
@@ -35,6 +35,7 @@
 #include "util/u_helpers.h"
 #include "util/u_inlines.h"
 #include "util/list.h"
+#include "util/u_queue.h"
 #include "vbo/vbo.h"
 
 
@@ -310,6 +311,11 @@ struct st_context
     * the estimated allocated size needed to execute those operations.
     */
    struct util_throttle throttle;
+
+   /* Threads lowering and optimizing the stages of a program being linked,
+    * created on the first link with more than one stage.
+    */
+   struct util_queue link_queue;
 };
 
 
@@ -412,6 +418,14 @@ st_destroy_context(struct st_context *st);
 uint64_t
 st_get_active_states(struct gl_context *ctx);
 
+typedef void (*st_stage_job_func)(struct st_context *st,
+                                  struct gl_shader_program *prog,
+                                  struct gl_linked_shader *shader);
+
+extern void
+st_run_stage_jobs(struct st_context *st, struct gl_shader_program *prog,
+                  st_stage_job_func func);
+
 
 #ifdef __cplusplus
 }
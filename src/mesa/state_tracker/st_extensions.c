@@ -1410,6 +1410,9 @@ void st_init_extensions(struct pipe_screen *screen,
       extensions->ARB_vertex_attrib_64bit = GL_TRUE;
    }
 
+   if (screen->is_parallel_shader_compilation_finished)
+      extensions->KHR_parallel_shader_compile = GL_TRUE;
+
    if ((ST_DEBUG & DEBUG_GREMEDY) &&
        screen->get_param(screen, PIPE_CAP_STRING_MARKER))
       extensions->GREMEDY_string_marker = GL_TRUE;
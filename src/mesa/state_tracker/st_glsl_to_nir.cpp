@@ -547,7 +547,6 @@ st_nir_get_mesa_program(struct gl_context *ctx,
                         struct gl_shader_program *shader_program,
                         struct gl_linked_shader *shader)
 {
-   struct st_context *st = st_context(ctx);
    struct pipe_screen *pscreen = ctx->st->pipe->screen;
    struct gl_program *prog;
 
@@ -576,11 +575,74 @@ st_nir_get_mesa_program(struct gl_context *ctx,
 
    prog->ExternalSamplersUsed = gl_external_samplers(prog);
    _mesa_update_shader_textures_used(shader_program, prog);
+}
+
+/* Translate one linked stage to NIR and optimize it.  Called from the link
+ * queue, concurrently for all the stages of a program.
+ */
+static void
+st_nir_translate_stage(struct st_context *st,
+                       struct gl_shader_program *shader_program,
+                       struct gl_linked_shader *shader)
+{
+   struct pipe_screen *screen = st->pipe->screen;
+   struct gl_program *prog = shader->Program;
+   enum pipe_shader_type type = pipe_shader_type_from_mesa(shader->Stage);
+   bool is_scalar =
+      screen->get_shader_param(screen, type, PIPE_SHADER_CAP_SCALAR_ISA);
 
    nir_shader *nir = st_glsl_to_nir(st, prog, shader_program, shader->Stage);
 
    set_st_program(prog, shader_program, nir);
    prog->nir = nir;
+
+   /* Only the inputs of the first stage and the outputs of the last one
+    * aren't varyings.
+    */
+   nir_variable_mode mask = (nir_variable_mode) 0;
+   for (int i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (!shader_program->_LinkedShaders[i])
+         continue;
+      if (i < shader->Stage)
+         mask = (nir_variable_mode)(mask | nir_var_shader_in);
+      if (i > shader->Stage)
+         mask = (nir_variable_mode)(mask | nir_var_shader_out);
+   }
+
+   if (is_scalar) {
+      NIR_PASS_V(nir, nir_lower_io_to_scalar_early, mask);
+      NIR_PASS_V(nir, nir_lower_load_const_to_scalar);
+   }
+
+   st_nir_opts(nir, is_scalar);
+}
+
+/* Lowering of one stage after the varyings were linked.  Called from the
+ * link queue, concurrently for all the stages of a program.
+ */
+static void
+st_nir_lower_linked_stage(struct st_context *st,
+                          struct gl_shader_program *shader_program,
+                          struct gl_linked_shader *shader)
+{
+   nir_shader *nir = shader->Program->nir;
+
+   NIR_PASS_V(nir, st_nir_lower_wpos_ytransform, shader->Program,
+              st->pipe->screen);
+
+   NIR_PASS_V(nir, nir_lower_system_values);
+
+   nir_shader_gather_info(nir, nir_shader_get_entrypoint(nir));
+   shader->Program->info = nir->info;
+   if (shader->Stage == MESA_SHADER_VERTEX) {
+      /* NIR expands dual-slot inputs out to two locations.  We need to
+       * compact things back down GL-style single-slot inputs to avoid
+       * confusing the state tracker.
+       */
+      shader->Program->info.inputs_read =
+         nir_get_single_slot_attribs_mask(nir->info.inputs_read,
+                                          shader->Program->DualSlotInputs);
+   }
 }
 
 static void
@@ -675,15 +737,11 @@ st_link_nir(struct gl_context *ctx,
       is_scalar[i] = screen->get_shader_param(screen, type, PIPE_SHADER_CAP_SCALAR_ISA);
    }
 
-   /* Determine first and last stage. */
-   unsigned first = MESA_SHADER_STAGES;
+   /* Determine last stage. */
    unsigned last = 0;
    for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
-      if (!shader_program->_LinkedShaders[i])
-         continue;
-      if (first == MESA_SHADER_STAGES)
-         first = i;
-      last = i;
+      if (shader_program->_LinkedShaders[i])
+         last = i;
    }
 
    for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
@@ -692,24 +750,10 @@ st_link_nir(struct gl_context *ctx,
          continue;
 
       st_nir_get_mesa_program(ctx, shader_program, shader);
-
-      nir_variable_mode mask = (nir_variable_mode) 0;
-      if (i != first)
-         mask = (nir_variable_mode)(mask | nir_var_shader_in);
-
-      if (i != last)
-         mask = (nir_variable_mode)(mask | nir_var_shader_out);
-
-      nir_shader *nir = shader->Program->nir;
-
-      if (is_scalar[i]) {
-         NIR_PASS_V(nir, nir_lower_io_to_scalar_early, mask);
-         NIR_PASS_V(nir, nir_lower_load_const_to_scalar);
-      }
-
-      st_nir_opts(nir, is_scalar[i]);
    }
 
+   st_run_stage_jobs(st, shader_program, st_nir_translate_stage);
+
    /* Linking the stages in the opposite order (from fragment to vertex)
     * ensures that inter-shader outputs written to in an earlier stage
     * are eliminated if they are (transitively) not used in a later
@@ -727,31 +771,14 @@ st_link_nir(struct gl_context *ctx,
       next = i;
    }
 
+   st_run_stage_jobs(st, shader_program, st_nir_lower_linked_stage);
+
    int prev = -1;
    for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
       struct gl_linked_shader *shader = shader_program->_LinkedShaders[i];
       if (shader == NULL)
          continue;
 
-      nir_shader *nir = shader->Program->nir;
-
-      NIR_PASS_V(nir, st_nir_lower_wpos_ytransform, shader->Program,
-                 st->pipe->screen);
-
-      NIR_PASS_V(nir, nir_lower_system_values);
-
-      nir_shader_gather_info(nir, nir_shader_get_entrypoint(nir));
-      shader->Program->info = nir->info;
-      if (i == MESA_SHADER_VERTEX) {
-         /* NIR expands dual-slot inputs out to two locations.  We need to
-          * compact things back down GL-style single-slot inputs to avoid
-          * confusing the state tracker.
-          */
-         shader->Program->info.inputs_read =
-            nir_get_single_slot_attribs_mask(nir->info.inputs_read,
-                                             shader->Program->DualSlotInputs);
-      }
-
       if (prev != -1) {
          struct gl_program *prev_shader =
             shader_program->_LinkedShaders[prev]->Program;
@@ -763,7 +790,8 @@ st_link_nir(struct gl_context *ctx,
          if (!(prev_shader->sh.LinkedTransformFeedback &&
                prev_shader->sh.LinkedTransformFeedback->NumVarying > 0))
             nir_compact_varyings(shader_program->_LinkedShaders[prev]->Program->nir,
-                              nir, ctx->API != API_OPENGL_COMPAT);
+                              shader->Program->nir,
+                              ctx->API != API_OPENGL_COMPAT);
       }
       prev = i;
    }
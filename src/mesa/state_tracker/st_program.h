@@ -454,6 +454,17 @@ extern void
 st_precompile_shader_variant(struct st_context *st,
                              struct gl_program *prog);
 
+/**
+ * Whether shaders should be created at link time so that the driver can
+ * compile them in the background (KHR_parallel_shader_compile).
+ */
+static inline bool
+st_compiles_in_background(const struct st_context *st)
+{
+   return st->ctx->Extensions.KHR_parallel_shader_compile &&
+          st->ctx->Hint.MaxShaderCompilerThreads > 0;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -369,7 +369,8 @@ st_deserialise_ir_program(struct gl_context *ctx,
 
    /* Create Gallium shaders now instead of on demand. */
    if (ST_DEBUG & DEBUG_PRECOMPILE ||
-       st->shader_has_one_variant[prog->info.stage])
+       st->shader_has_one_variant[prog->info.stage] ||
+       st_compiles_in_background(st))
       st_precompile_shader_variant(st, prog);
 }
 
@@ -87,6 +87,16 @@ vbo_save_EndCallList(struct gl_context *ctx);
 void
 vbo_delete_minmax_cache(struct gl_buffer_object *bufferObj);
 
+void
+vbo_invalidate_minmax_cache(struct gl_buffer_object *bufferObj,
+                            GLintptr offset, GLsizeiptr size);
+
+void
+vbo_get_minmax_index_mapped(unsigned count, unsigned index_size,
+                            unsigned restart_index, bool restart,
+                            const void *indices,
+                            unsigned *min_index, unsigned *max_index);
+
 void
 vbo_get_minmax_indices(struct gl_context *ctx, const struct _mesa_prim *prim,
                        const struct _mesa_index_buffer *ib,
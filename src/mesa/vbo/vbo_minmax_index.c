@@ -32,44 +32,53 @@
 #include "main/macros.h"
 #include "main/sse_minmax.h"
 #include "x86/common_x86_asm.h"
-#include "util/hash_table.h"
+#include "util/u_math.h"
 
 
-struct minmax_cache_key {
-   GLintptr offset;
-   GLuint count;
-   unsigned index_size;
+/**
+ * Bytes of indices summarized by each leaf of the min/max trees.
+ */
+#define MINMAX_BLOCK_SIZE 1024
+
+
+enum minmax_node_state {
+   MINMAX_VALID,  /**< the node and all the nodes below it are up to date */
+   MINMAX_STALE,  /**< some of the nodes below the node are out of date */
+   MINMAX_EMPTY,  /**< the node is out of date, the nodes below are garbage */
 };
 
 
-struct minmax_cache_entry {
-   struct minmax_cache_key key;
+/**
+ * Minimum and maximum of the indices of a block, or of all the blocks below
+ * a tree node.  max_non_restart leaves out the largest value of the index
+ * type, which is the primitive restart index almost all applications use.
+ */
+struct minmax_node {
    GLuint min;
    GLuint max;
+   GLuint max_non_restart;
+   GLuint state;
 };
 
 
-static uint32_t
-vbo_minmax_cache_hash(const struct minmax_cache_key *key)
-{
-   return _mesa_hash_data(key, sizeof(*key));
-}
-
-
-static bool
-vbo_minmax_cache_key_equal(const struct minmax_cache_key *a,
-                           const struct minmax_cache_key *b)
-{
-   return (a->offset == b->offset) && (a->count == b->count) &&
-          (a->index_size == b->index_size);
-}
-
-
-static void
-vbo_minmax_cache_delete_entry(struct hash_entry *entry)
-{
-   free(entry->data);
-}
+/**
+ * Segment tree of the min/max indices of fixed size blocks of a buffer.
+ * Writes only invalidate the nodes over the written blocks, and nodes are
+ * only brought up to date when a draw uses them.
+ */
+struct vbo_minmax_cache {
+   unsigned index_size;
+   unsigned num_indices;    /**< indices fitting in the buffer */
+   unsigned block_indices;  /**< indices per block */
+   unsigned num_blocks;
+   unsigned num_leaves;     /**< num_blocks rounded up to a power of two */
+
+   /**
+    * nodes[1] is the root, the children of nodes[i] are nodes[2 * i] and
+    * nodes[2 * i + 1], and the leaves start at nodes[num_leaves].
+    */
+   struct minmax_node nodes[];
+};
 
 
 static GLboolean
@@ -95,135 +104,444 @@ vbo_use_minmax_cache(struct gl_buffer_object *bufferObj)
 void
 vbo_delete_minmax_cache(struct gl_buffer_object *bufferObj)
 {
-   _mesa_hash_table_destroy(bufferObj->MinMaxCache, vbo_minmax_cache_delete_entry);
+   free(bufferObj->MinMaxCache);
    bufferObj->MinMaxCache = NULL;
 }
 
 
-static GLboolean
-vbo_get_minmax_cached(struct gl_buffer_object *bufferObj,
-                      unsigned index_size, GLintptr offset, GLuint count,
-                      GLuint *min_index, GLuint *max_index)
+static void
+vbo_minmax_reset(struct minmax_node *node)
 {
-   GLboolean found = GL_FALSE;
-   struct minmax_cache_key key;
-   uint32_t hash;
-   struct hash_entry *result;
+   node->min = ~0U;
+   node->max = 0;
+   node->max_non_restart = 0;
+}
 
-   if (!bufferObj->MinMaxCache)
-      return GL_FALSE;
-   if (!vbo_use_minmax_cache(bufferObj))
-      return GL_FALSE;
 
-   simple_mtx_lock(&bufferObj->MinMaxCacheMutex);
+static void
+vbo_minmax_merge(struct minmax_node *dst, const struct minmax_node *src)
+{
+   dst->min = MIN2(dst->min, src->min);
+   dst->max = MAX2(dst->max, src->max);
+   dst->max_non_restart = MAX2(dst->max_non_restart, src->max_non_restart);
+}
 
-   if (bufferObj->MinMaxCacheDirty) {
-      /* Disable the cache permanently for this BO if the number of hits
-       * is asymptotically less than the number of misses. This happens when
-       * applications use the BO for streaming.
-       *
-       * However, some initial optimism allows applications that interleave
-       * draw calls with glBufferSubData during warmup.
-       */
-      unsigned optimism = bufferObj->Size;
-      if (bufferObj->MinMaxCacheMissIndices > optimism &&
-          bufferObj->MinMaxCacheHitIndices < bufferObj->MinMaxCacheMissIndices - optimism) {
-         bufferObj->UsageHistory |= USAGE_DISABLE_MINMAX_CACHE;
-         vbo_delete_minmax_cache(bufferObj);
-         goto out_disable;
-      }
 
-      _mesa_hash_table_clear(bufferObj->MinMaxCache, vbo_minmax_cache_delete_entry);
-      bufferObj->MinMaxCacheDirty = false;
-      goto out_invalidate;
+/**
+ * Compute the min/max of count indices, without primitive restart.
+ */
+static void
+vbo_minmax_scan(const void *indices, unsigned index_size, unsigned count,
+                struct minmax_node *node)
+{
+   unsigned i;
+
+#if defined(USE_SSE41)
+   if (cpu_has_sse4_1) {
+      _mesa_index_array_min_max(indices, index_size, count, &node->min,
+                                &node->max, &node->max_non_restart);
+      return;
    }
+#endif
 
-   key.index_size = index_size;
-   key.offset = offset;
-   key.count = count;
-   hash = vbo_minmax_cache_hash(&key);
-   result = _mesa_hash_table_search_pre_hashed(bufferObj->MinMaxCache, hash, &key);
-   if (result) {
-      struct minmax_cache_entry *entry = result->data;
-      *min_index = entry->min;
-      *max_index = entry->max;
-      found = GL_TRUE;
+#define SCAN(type)                                                \
+   do {                                                           \
+      const type *typed = (const type *) indices;                 \
+      type min = (type) ~0U, max = 0, max_nr = 0;                 \
+      for (i = 0; i < count; i++) {                               \
+         min = MIN2(min, typed[i]);                               \
+         max = MAX2(max, typed[i]);                               \
+         if (typed[i] != (type) ~0U)                              \
+            max_nr = MAX2(max_nr, typed[i]);                      \
+      }                                                           \
+      node->min = min;                                            \
+      node->max = max;                                            \
+      node->max_non_restart = max_nr;                             \
+   } while (0)
+
+   switch (index_size) {
+   case 4:
+      SCAN(GLuint);
+      break;
+   case 2:
+      SCAN(GLushort);
+      break;
+   default:
+      SCAN(GLubyte);
+      break;
    }
 
-out_invalidate:
-   if (found) {
-      /* The hit counter saturates so that we don't accidently disable the
-       * cache in a long-running program.
-       */
-      unsigned new_hit_count = bufferObj->MinMaxCacheHitIndices + count;
-
-      if (new_hit_count >= bufferObj->MinMaxCacheHitIndices)
-         bufferObj->MinMaxCacheHitIndices = new_hit_count;
-      else
-         bufferObj->MinMaxCacheHitIndices = ~(unsigned)0;
+#undef SCAN
+}
+
+
+/**
+ * Map count indices of the buffer, starting at index first.
+ */
+static const char *
+vbo_minmax_map(struct gl_context *ctx, struct gl_buffer_object *bufferObj,
+               const struct vbo_minmax_cache *cache,
+               unsigned first, unsigned count)
+{
+   return ctx->Driver.MapBufferRange(ctx,
+                                     (GLintptr) first * cache->index_size,
+                                     (GLsizeiptr) count * cache->index_size,
+                                     GL_MAP_READ_BIT, bufferObj,
+                                     MAP_INTERNAL);
+}
+
+
+/**
+ * Scan count indices of the buffer starting at index first, and merge
+ * their min/max into result.
+ */
+static void
+vbo_minmax_scan_range(struct gl_context *ctx,
+                      struct gl_buffer_object *bufferObj,
+                      const struct vbo_minmax_cache *cache,
+                      unsigned first, unsigned count,
+                      struct minmax_node *result)
+{
+   struct minmax_node node;
+
+   if (!count)
+      return;
+
+   vbo_minmax_scan(vbo_minmax_map(ctx, bufferObj, cache, first, count),
+                   cache->index_size, count, &node);
+   ctx->Driver.UnmapBuffer(ctx, bufferObj, MAP_INTERNAL);
+
+   vbo_minmax_merge(result, &node);
+}
+
+
+/**
+ * Compute a node covering blocks [lo, hi) and all the nodes below it from
+ * the indices of these blocks.
+ */
+static void
+vbo_minmax_build_node(struct vbo_minmax_cache *cache, unsigned node,
+                      unsigned lo, unsigned hi, const char *indices)
+{
+   struct minmax_node *n = &cache->nodes[node];
+
+   if (node >= cache->num_leaves) {
+      if (lo < cache->num_blocks) {
+         const unsigned first = lo * cache->block_indices;
+         const unsigned count = MIN2(cache->block_indices,
+                                     cache->num_indices - first);
+
+         vbo_minmax_scan(indices, cache->index_size, count, n);
+      } else {
+         /* Padding past the end of the buffer. */
+         vbo_minmax_reset(n);
+      }
    } else {
-      bufferObj->MinMaxCacheMissIndices += count;
+      const unsigned mid = (lo + hi) / 2;
+
+      vbo_minmax_build_node(cache, 2 * node, lo, mid, indices);
+      vbo_minmax_build_node(cache, 2 * node + 1, mid, hi,
+                            indices + (size_t) (mid - lo) *
+                                      cache->block_indices *
+                                      cache->index_size);
+      *n = cache->nodes[2 * node];
+      vbo_minmax_merge(n, &cache->nodes[2 * node + 1]);
    }
 
-out_disable:
-   simple_mtx_unlock(&bufferObj->MinMaxCacheMutex);
-   return found;
+   n->state = MINMAX_VALID;
 }
 
 
+/**
+ * Bring a node covering blocks [lo, hi) up to date.  Only the blocks which
+ * were invalidated are scanned again, mapping each out of date subtree at
+ * once.
+ */
 static void
-vbo_minmax_cache_store(struct gl_context *ctx,
+vbo_minmax_update_node(struct gl_context *ctx,
                        struct gl_buffer_object *bufferObj,
-                       unsigned index_size, GLintptr offset, GLuint count,
-                       GLuint min, GLuint max)
+                       struct vbo_minmax_cache *cache, unsigned node,
+                       unsigned lo, unsigned hi)
 {
-   struct minmax_cache_entry *entry;
-   struct hash_entry *table_entry;
-   uint32_t hash;
+   struct minmax_node *n = &cache->nodes[node];
 
-   if (!vbo_use_minmax_cache(bufferObj))
+   if (n->state == MINMAX_VALID)
+      return;
+
+   if (lo >= cache->num_blocks) {
+      /* Padding past the end of the buffer. */
+      vbo_minmax_reset(n);
+      n->state = MINMAX_VALID;
+   } else if (n->state == MINMAX_EMPTY) {
+      const unsigned first = lo * cache->block_indices;
+      const unsigned last = MIN2(hi * cache->block_indices,
+                                 cache->num_indices);
+
+      vbo_minmax_build_node(cache, node, lo, hi,
+                            vbo_minmax_map(ctx, bufferObj, cache,
+                                           first, last - first));
+      ctx->Driver.UnmapBuffer(ctx, bufferObj, MAP_INTERNAL);
+   } else {
+      const unsigned mid = (lo + hi) / 2;
+
+      vbo_minmax_update_node(ctx, bufferObj, cache, 2 * node, lo, mid);
+      vbo_minmax_update_node(ctx, bufferObj, cache, 2 * node + 1, mid, hi);
+      *n = cache->nodes[2 * node];
+      vbo_minmax_merge(n, &cache->nodes[2 * node + 1]);
+      n->state = MINMAX_VALID;
+   }
+}
+
+
+/**
+ * Merge the min/max of blocks [first, last) into result, for the node
+ * covering blocks [lo, hi).
+ */
+static void
+vbo_minmax_query_node(struct gl_context *ctx,
+                      struct gl_buffer_object *bufferObj,
+                      struct vbo_minmax_cache *cache, unsigned node,
+                      unsigned lo, unsigned hi, unsigned first, unsigned last,
+                      struct minmax_node *result)
+{
+   struct minmax_node *n = &cache->nodes[node];
+   const unsigned mid = (lo + hi) / 2;
+
+   if (hi <= first || last <= lo)
+      return;
+
+   if (first <= lo && hi <= last) {
+      vbo_minmax_update_node(ctx, bufferObj, cache, node, lo, hi);
+      vbo_minmax_merge(result, n);
       return;
+   }
+
+   /* The children of an empty node only get meaningful states now. */
+   if (n->state == MINMAX_EMPTY) {
+      cache->nodes[2 * node].state = MINMAX_EMPTY;
+      cache->nodes[2 * node + 1].state = MINMAX_EMPTY;
+      n->state = MINMAX_STALE;
+   }
+
+   vbo_minmax_query_node(ctx, bufferObj, cache, 2 * node, lo, mid,
+                         first, last, result);
+   vbo_minmax_query_node(ctx, bufferObj, cache, 2 * node + 1, mid, hi,
+                         first, last, result);
+}
+
+
+/**
+ * Mark blocks [first, last) out of date, for the node covering blocks
+ * [lo, hi).
+ */
+static void
+vbo_minmax_invalidate_node(struct vbo_minmax_cache *cache, unsigned node,
+                           unsigned lo, unsigned hi,
+                           unsigned first, unsigned last)
+{
+   struct minmax_node *n = &cache->nodes[node];
+   const unsigned mid = (lo + hi) / 2;
+
+   if (hi <= first || last <= lo || n->state == MINMAX_EMPTY)
+      return;
+
+   if (first <= lo && hi <= last) {
+      n->state = MINMAX_EMPTY;
+      return;
+   }
+
+   n->state = MINMAX_STALE;
+   vbo_minmax_invalidate_node(cache, 2 * node, lo, mid, first, last);
+   vbo_minmax_invalidate_node(cache, 2 * node + 1, mid, hi, first, last);
+}
+
+
+/**
+ * Called when size bytes of the buffer starting at offset are written.
+ */
+void
+vbo_invalidate_minmax_cache(struct gl_buffer_object *bufferObj,
+                            GLintptr offset, GLsizeiptr size)
+{
+   struct vbo_minmax_cache *cache;
 
    simple_mtx_lock(&bufferObj->MinMaxCacheMutex);
 
-   if (!bufferObj->MinMaxCache) {
-      bufferObj->MinMaxCache =
-         _mesa_hash_table_create(NULL,
-                                 (uint32_t (*)(const void *))vbo_minmax_cache_hash,
-                                 (bool (*)(const void *, const void *))vbo_minmax_cache_key_equal);
-      if (!bufferObj->MinMaxCache)
-         goto out;
+   cache = bufferObj->MinMaxCache;
+   if (cache && size > 0) {
+      const GLsizeiptr block_size = MINMAX_BLOCK_SIZE;
+      const GLsizeiptr first = offset / block_size;
+      const GLsizeiptr last = MIN2(DIV_ROUND_UP(offset + size, block_size),
+                                   cache->num_blocks);
+
+      if (first < last)
+         vbo_minmax_invalidate_node(cache, 1, 0, cache->num_leaves,
+                                    first, last);
    }
 
-   entry = MALLOC_STRUCT(minmax_cache_entry);
-   if (!entry)
-      goto out;
-
-   entry->key.offset = offset;
-   entry->key.count = count;
-   entry->key.index_size = index_size;
-   entry->min = min;
-   entry->max = max;
-   hash = vbo_minmax_cache_hash(&entry->key);
-
-   table_entry = _mesa_hash_table_search_pre_hashed(bufferObj->MinMaxCache,
-                                                    hash, &entry->key);
-   if (table_entry) {
-      /* It seems like this could happen when two contexts are rendering using
-       * the same buffer object from multiple threads.
-       */
-      _mesa_debug(ctx, "duplicate entry in minmax cache\n");
-      free(entry);
-      goto out;
+   simple_mtx_unlock(&bufferObj->MinMaxCacheMutex);
+}
+
+
+/**
+ * Return the min/max tree of the buffer for the index size, (re)creating it
+ * if needed.
+ */
+static struct vbo_minmax_cache *
+vbo_get_minmax_cache(struct gl_buffer_object *bufferObj, unsigned index_size)
+{
+   struct vbo_minmax_cache *cache = bufferObj->MinMaxCache;
+   const GLsizeiptr num_indices = bufferObj->Size / index_size;
+   unsigned num_blocks, num_leaves;
+
+   if (cache && cache->index_size == index_size &&
+       cache->num_indices == num_indices)
+      return cache;
+
+   if (num_indices > UINT_MAX / 2)
+      return NULL;
+
+   num_blocks = DIV_ROUND_UP(num_indices, MINMAX_BLOCK_SIZE / index_size);
+   num_leaves = util_next_power_of_two(MAX2(num_blocks, 1));
+
+   vbo_delete_minmax_cache(bufferObj);
+   cache = malloc(sizeof(*cache) + 2 * num_leaves * sizeof(cache->nodes[0]));
+   if (!cache)
+      return NULL;
+
+   cache->index_size = index_size;
+   cache->num_indices = num_indices;
+   cache->block_indices = MINMAX_BLOCK_SIZE / index_size;
+   cache->num_blocks = num_blocks;
+   cache->num_leaves = num_leaves;
+   cache->nodes[1].state = MINMAX_EMPTY;
+
+   bufferObj->MinMaxCache = cache;
+   return cache;
+}
+
+
+/**
+ * Compute the min/max of count indices of the buffer starting at offset
+ * from the buffer's min/max tree, scanning only the indices at both ends
+ * which don't fill a block, and the blocks written since the last time.
+ * Return false if the tree can't be used.
+ */
+static GLboolean
+vbo_get_minmax_cached(struct gl_context *ctx,
+                      struct gl_buffer_object *bufferObj,
+                      unsigned index_size, GLintptr offset, GLuint count,
+                      GLboolean restart, GLuint restart_index,
+                      GLuint *min_index, GLuint *max_index)
+{
+   const GLuint max_value = index_size == 4 ? ~0U : (1U << (index_size * 8)) - 1;
+   struct vbo_minmax_cache *cache;
+   struct minmax_node result;
+   unsigned first, last, first_block, last_block;
+
+   if (!vbo_use_minmax_cache(bufferObj))
+      return GL_FALSE;
+
+   /* Only the largest value of the index type is handled as restart index,
+    * and the indices must be naturally aligned.
+    */
+   if ((restart && restart_index != max_value) || offset % index_size)
+      return GL_FALSE;
+
+   simple_mtx_lock(&bufferObj->MinMaxCacheMutex);
+
+   cache = vbo_get_minmax_cache(bufferObj, index_size);
+   first = offset / index_size;
+   if (!cache || first > cache->num_indices ||
+       count > cache->num_indices - first) {
+      simple_mtx_unlock(&bufferObj->MinMaxCacheMutex);
+      return GL_FALSE;
+   }
+
+   last = first + count;
+   first_block = DIV_ROUND_UP(first, cache->block_indices);
+   last_block = last / cache->block_indices;
+   if (first_block >= last_block) {
+      /* Not even a whole block, just scan the indices. */
+      simple_mtx_unlock(&bufferObj->MinMaxCacheMutex);
+      return GL_FALSE;
    }
 
-   table_entry = _mesa_hash_table_insert_pre_hashed(bufferObj->MinMaxCache,
-                                                    hash, &entry->key, entry);
-   if (!table_entry)
-      free(entry);
+   vbo_minmax_reset(&result);
+   vbo_minmax_scan_range(ctx, bufferObj, cache, first,
+                         first_block * cache->block_indices - first, &result);
+   vbo_minmax_scan_range(ctx, bufferObj, cache,
+                         last_block * cache->block_indices,
+                         last - last_block * cache->block_indices, &result);
+   vbo_minmax_query_node(ctx, bufferObj, cache, 1, 0, cache->num_leaves,
+                         first_block, last_block, &result);
 
-out:
    simple_mtx_unlock(&bufferObj->MinMaxCacheMutex);
+
+   if (restart) {
+      /* Only restart indices give a minimum this large. */
+      *min_index = result.min >= max_value ? ~0U : result.min;
+      *max_index = result.max_non_restart;
+   } else {
+      *min_index = result.min;
+      *max_index = result.max;
+   }
+   return GL_TRUE;
+}
+
+
+/**
+ * Compute min and max of count indices in memory.  If primitive restart is
+ * enabled, the restart indexes are ignored.
+ */
+void
+vbo_get_minmax_index_mapped(unsigned count, unsigned index_size,
+                            unsigned restart_index, bool restart,
+                            const void *indices,
+                            unsigned *min_index, unsigned *max_index)
+{
+   const unsigned type_max = 0xffffffffu >> 8 * (4 - index_size);
+   struct minmax_node node;
+   unsigned i;
+
+   /* The largest value of the index type is left out of max_non_restart,
+    * so only other restart indexes need a separate scan.
+    */
+   if (!restart || restart_index >= type_max) {
+      vbo_minmax_scan(indices, index_size, count, &node);
+      *min_index = node.min;
+      *max_index = restart_index == type_max && restart ?
+                   node.max_non_restart : node.max;
+      return;
+   }
+
+#define SCAN_RESTART(type)                                        \
+   do {                                                           \
+      const type *typed = (const type *) indices;                 \
+      unsigned min = ~0U, max = 0;                                \
+      for (i = 0; i < count; i++) {                               \
+         if (typed[i] != restart_index) {                         \
+            min = MIN2(min, typed[i]);                            \
+            max = MAX2(max, typed[i]);                            \
+         }                                                        \
+      }                                                           \
+      *min_index = min;                                           \
+      *max_index = max;                                           \
+   } while (0)
+
+   switch (index_size) {
+   case 4:
+      SCAN_RESTART(GLuint);
+      break;
+   case 2:
+      SCAN_RESTART(GLushort);
+      break;
+   default:
+      SCAN_RESTART(GLubyte);
+      break;
+   }
+
+#undef SCAN_RESTART
 }
 
 
@@ -244,15 +562,15 @@ vbo_get_minmax_index(struct gl_context *ctx,
    const GLuint restartIndex =
       _mesa_primitive_restart_index(ctx, ib->index_size);
    const char *indices;
-   GLuint i;
    GLintptr offset = 0;
 
    indices = (char *) ib->ptr + prim->start * ib->index_size;
    if (_mesa_is_bufferobj(ib->obj)) {
       GLsizeiptr size = MIN2(count * ib->index_size, ib->obj->Size);
 
-      if (vbo_get_minmax_cached(ib->obj, ib->index_size, (GLintptr) indices,
-                                count, min_index, max_index))
+      if (vbo_get_minmax_cached(ctx, ib->obj, ib->index_size,
+                                (GLintptr) indices, count, restart,
+                                restartIndex, min_index, max_index))
          return;
 
       offset = (GLintptr) indices;
@@ -261,86 +579,10 @@ vbo_get_minmax_index(struct gl_context *ctx,
                                            MAP_INTERNAL);
    }
 
-   switch (ib->index_size) {
-   case 4: {
-      const GLuint *ui_indices = (const GLuint *)indices;
-      GLuint max_ui = 0;
-      GLuint min_ui = ~0U;
-      if (restart) {
-         for (i = 0; i < count; i++) {
-            if (ui_indices[i] != restartIndex) {
-               if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
-               if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
-            }
-         }
-      }
-      else {
-#if defined(USE_SSE41)
-         if (cpu_has_sse4_1) {
-            _mesa_uint_array_min_max(ui_indices, &min_ui, &max_ui, count);
-         }
-         else
-#endif
-            for (i = 0; i < count; i++) {
-               if (ui_indices[i] > max_ui) max_ui = ui_indices[i];
-               if (ui_indices[i] < min_ui) min_ui = ui_indices[i];
-            }
-      }
-      *min_index = min_ui;
-      *max_index = max_ui;
-      break;
-   }
-   case 2: {
-      const GLushort *us_indices = (const GLushort *)indices;
-      GLuint max_us = 0;
-      GLuint min_us = ~0U;
-      if (restart) {
-         for (i = 0; i < count; i++) {
-            if (us_indices[i] != restartIndex) {
-               if (us_indices[i] > max_us) max_us = us_indices[i];
-               if (us_indices[i] < min_us) min_us = us_indices[i];
-            }
-         }
-      }
-      else {
-         for (i = 0; i < count; i++) {
-            if (us_indices[i] > max_us) max_us = us_indices[i];
-            if (us_indices[i] < min_us) min_us = us_indices[i];
-         }
-      }
-      *min_index = min_us;
-      *max_index = max_us;
-      break;
-   }
-   case 1: {
-      const GLubyte *ub_indices = (const GLubyte *)indices;
-      GLuint max_ub = 0;
-      GLuint min_ub = ~0U;
-      if (restart) {
-         for (i = 0; i < count; i++) {
-            if (ub_indices[i] != restartIndex) {
-               if (ub_indices[i] > max_ub) max_ub = ub_indices[i];
-               if (ub_indices[i] < min_ub) min_ub = ub_indices[i];
-            }
-         }
-      }
-      else {
-         for (i = 0; i < count; i++) {
-            if (ub_indices[i] > max_ub) max_ub = ub_indices[i];
-            if (ub_indices[i] < min_ub) min_ub = ub_indices[i];
-         }
-      }
-      *min_index = min_ub;
-      *max_index = max_ub;
-      break;
-   }
-   default:
-      unreachable("not reached");
-   }
+   vbo_get_minmax_index_mapped(count, ib->index_size, restartIndex, restart,
+                               indices, min_index, max_index);
 
    if (_mesa_is_bufferobj(ib->obj)) {
-      vbo_minmax_cache_store(ctx, ib->obj, ib->index_size, offset,
-                             count, *min_index, *max_index);
       ctx->Driver.UnmapBuffer(ctx, ib->obj, MAP_INTERNAL);
    }
 }
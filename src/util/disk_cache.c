@@ -37,7 +37,6 @@
 #include <pwd.h>
 #include <errno.h>
 #include <dirent.h>
-#include "zlib.h"
 
 #include "util/crc32.h"
 #include "util/debug.h"
@@ -50,6 +49,8 @@
 #include "main/errors.h"
 
 #include "disk_cache.h"
+#include "disk_cache_codec.h"
+#include "disk_cache_pack.h"
 
 /* Number of bits to mask off from a cache key to get an index. */
 #define CACHE_INDEX_KEY_BITS 16
@@ -104,6 +105,17 @@ struct disk_cache {
 
    disk_cache_put_cb blob_put_cb;
    disk_cache_get_cb blob_get_cb;
+
+   /* Single-file storage, used instead of one file per entry when
+    * MESA_DISK_CACHE_SINGLE_FILE is set.
+    */
+   struct disk_cache_pack *pack;
+
+   /* Signalled when no compaction of the pack is queued */
+   struct util_queue_fence compact_fence;
+
+   /* Compresses new entries, and decompresses entries of any codec */
+   struct disk_cache_codec *codec;
 };
 
 struct disk_cache_put_job {
@@ -370,6 +382,29 @@ disk_cache_create(const char *gpu_name, const char *driver_id,
 
    cache->max_size = max_size;
 
+   const char *codec_name = getenv("MESA_DISK_CACHE_CODEC");
+   const char *dict_path = getenv("MESA_DISK_CACHE_ZSTD_DICT");
+   if (codec_name) {
+      cache->codec = disk_cache_codec_create(codec_name, dict_path);
+      if (!cache->codec) {
+         fprintf(stderr, "Unsupported shader cache codec %s, using zlib.\n",
+                 codec_name);
+      }
+   }
+   if (!cache->codec)
+      cache->codec = disk_cache_codec_create("zlib", dict_path);
+   if (!cache->codec)
+      goto path_fail;
+
+   if (env_var_as_boolean("MESA_DISK_CACHE_SINGLE_FILE", false)) {
+      cache->pack = disk_cache_pack_open(cache->path, max_size);
+      if (!cache->pack) {
+         fprintf(stderr, "Failed to open the single-file shader cache in %s, "
+                         "using one file per entry.\n", cache->path);
+      }
+   }
+   util_queue_fence_init(&cache->compact_fence);
+
    /* 1 thread was chosen because we don't really care about getting things
     * to disk quickly just that it's not blocking other tasks.
     *
@@ -437,6 +472,9 @@ disk_cache_destroy(struct disk_cache *cache)
 {
    if (cache && !cache->path_init_failed) {
       util_queue_destroy(&cache->cache_queue);
+      util_queue_fence_destroy(&cache->compact_fence);
+      disk_cache_pack_close(cache->pack);
+      disk_cache_codec_destroy(cache->codec);
       munmap(cache->index_mmap, cache->index_mmap_size);
    }
 
@@ -667,11 +705,32 @@ evict_lru_item(struct disk_cache *cache)
       p_atomic_add(cache->size, - (uint64_t)size);
 }
 
+static void
+compact_pack(void *job, int thread_index)
+{
+   struct disk_cache *cache = (struct disk_cache *) job;
+
+   disk_cache_pack_compact(cache->pack);
+}
+
 void
 disk_cache_remove(struct disk_cache *cache, const cache_key key)
 {
    struct stat sb;
 
+   if (cache->pack) {
+      disk_cache_pack_remove(cache->pack, key);
+
+      /* Reclaim the space in the background, once enough was freed. */
+      if (disk_cache_pack_needs_compaction(cache->pack) &&
+          util_queue_fence_is_signalled(&cache->compact_fence)) {
+         util_queue_add_job_with_priority(&cache->cache_queue, cache,
+                                          &cache->compact_fence, compact_pack,
+                                          NULL, UTIL_QUEUE_PRIORITY_LOW);
+      }
+      return;
+   }
+
    char *filename = get_cache_file(cache, key);
    if (filename == NULL) {
       return;
@@ -719,75 +778,6 @@ write_all(int fd, const void *buf, size_t count)
    return done;
 }
 
-/* From the zlib docs:
- *    "If the memory is available, buffers sizes on the order of 128K or 256K
- *    bytes should be used."
- */
-#define BUFSIZE 256 * 1024
-
-/**
- * Compresses cache entry in memory and writes it to disk. Returns the size
- * of the data written to disk.
- */
-static size_t
-deflate_and_write_to_disk(const void *in_data, size_t in_data_size, int dest,
-                          const char *filename)
-{
-   unsigned char out[BUFSIZE];
-
-   /* allocate deflate state */
-   z_stream strm;
-   strm.zalloc = Z_NULL;
-   strm.zfree = Z_NULL;
-   strm.opaque = Z_NULL;
-   strm.next_in = (uint8_t *) in_data;
-   strm.avail_in = in_data_size;
-
-   int ret = deflateInit(&strm, Z_BEST_COMPRESSION);
-   if (ret != Z_OK)
-       return 0;
-
-   /* compress until end of in_data */
-   size_t compressed_size = 0;
-   int flush;
-   do {
-      int remaining = in_data_size - BUFSIZE;
-      flush = remaining > 0 ? Z_NO_FLUSH : Z_FINISH;
-      in_data_size -= BUFSIZE;
-
-      /* Run deflate() on input until the output buffer is not full (which
-       * means there is no more data to deflate).
-       */
-      do {
-         strm.avail_out = BUFSIZE;
-         strm.next_out = out;
-
-         ret = deflate(&strm, flush);    /* no bad return value */
-         assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
-
-         size_t have = BUFSIZE - strm.avail_out;
-         compressed_size += have;
-
-         ssize_t written = write_all(dest, out, have);
-         if (written == -1) {
-            (void)deflateEnd(&strm);
-            return 0;
-         }
-      } while (strm.avail_out == 0);
-
-      /* all input should be used */
-      assert(strm.avail_in == 0);
-
-   } while (flush != Z_FINISH);
-
-   /* stream should be complete */
-   assert(ret == Z_STREAM_END);
-
-   /* clean up and return */
-   (void)deflateEnd(&strm);
-   return compressed_size;
-}
-
 static struct disk_cache_put_job *
 create_put_job(struct disk_cache *cache, const cache_key key,
                const void *data, size_t size,
@@ -846,9 +836,101 @@ destroy_put_job(void *job, int thread_index)
 
 struct cache_entry_file_data {
    uint32_t crc32;
-   uint32_t uncompressed_size;
+   /* The top bits hold the ID of the codec the data was compressed with.
+    * They were always 0 in entries written before codecs were added, which
+    * is zlib's ID.
+    */
+   uint32_t size_and_codec;
 };
 
+#define CACHE_ENTRY_CODEC_SHIFT 28
+#define CACHE_ENTRY_SIZE_MASK ((1u << CACHE_ENTRY_CODEC_SHIFT) - 1)
+
+/**
+ * Build the cache entry for a put job in memory: the driver keys blob, the
+ * cache item metadata, the CRC and size of the data and finally the
+ * compressed data.  Returns a malloc'ed buffer, or NULL on failure.
+ */
+static uint8_t *
+create_cache_entry(struct disk_cache_put_job *dc_job, size_t *entry_size)
+{
+   struct disk_cache *cache = dc_job->cache;
+   struct cache_item_metadata *md = &dc_job->cache_item_metadata;
+   size_t header_size = cache->driver_keys_blob_size + sizeof(uint32_t);
+   size_t compressed_size;
+   uint8_t *entry, *p;
+
+   if (dc_job->size > CACHE_ENTRY_SIZE_MASK)
+      return NULL;
+
+   if (md->type == CACHE_ITEM_TYPE_GLSL)
+      header_size += sizeof(uint32_t) + md->num_keys * sizeof(cache_key);
+   header_size += sizeof(struct cache_entry_file_data);
+
+   compressed_size = disk_cache_codec_compress_bound(cache->codec,
+                                                     dc_job->size);
+   entry = malloc(header_size + compressed_size);
+   if (!entry)
+      return NULL;
+
+   /* Write the driver_keys_blob, this can be used find information about the
+    * mesa version that produced the entry or deal with hash collisions,
+    * should that ever become a real problem.
+    */
+   p = entry;
+   memcpy(p, cache->driver_keys_blob, cache->driver_keys_blob_size);
+   p += cache->driver_keys_blob_size;
+
+   /* Write the cache item metadata. This data can be used to deal with
+    * hash collisions, as well as providing useful information to 3rd party
+    * tools reading the cache files.
+    */
+   memcpy(p, &md->type, sizeof(uint32_t));
+   p += sizeof(uint32_t);
+   if (md->type == CACHE_ITEM_TYPE_GLSL) {
+      memcpy(p, &md->num_keys, sizeof(uint32_t));
+      p += sizeof(uint32_t);
+      memcpy(p, md->keys, md->num_keys * sizeof(cache_key));
+      p += md->num_keys * sizeof(cache_key);
+   }
+
+   /* Create CRC of the data. We will read this when restoring the cache and
+    * use it to check for corruption.
+    */
+   struct cache_entry_file_data cf_data;
+   cf_data.crc32 = util_hash_crc32(dc_job->data, dc_job->size);
+   cf_data.size_and_codec = dc_job->size |
+      disk_cache_codec_get_id(cache->codec) << CACHE_ENTRY_CODEC_SHIFT;
+   memcpy(p, &cf_data, sizeof(cf_data));
+   p += sizeof(cf_data);
+
+   compressed_size = disk_cache_codec_compress(cache->codec, dc_job->data,
+                                               dc_job->size, p,
+                                               compressed_size);
+   if (compressed_size == 0) {
+      free(entry);
+      return NULL;
+   }
+
+   *entry_size = header_size + compressed_size;
+   return entry;
+}
+
+static void
+cache_put_pack(struct disk_cache_put_job *dc_job)
+{
+   struct disk_cache *cache = dc_job->cache;
+   uint8_t *entry;
+   size_t entry_size;
+
+   entry = create_cache_entry(dc_job, &entry_size);
+   if (!entry)
+      return;
+
+   disk_cache_pack_append(cache->pack, dc_job->key, entry, entry_size);
+   free(entry);
+}
+
 static void
 cache_put(void *job, int thread_index)
 {
@@ -857,8 +939,15 @@ cache_put(void *job, int thread_index)
    int fd = -1, fd_final = -1, err, ret;
    unsigned i = 0;
    char *filename = NULL, *filename_tmp = NULL;
+   uint8_t *entry = NULL;
+   size_t entry_size;
    struct disk_cache_put_job *dc_job = (struct disk_cache_put_job *) job;
 
+   if (dc_job->cache->pack) {
+      cache_put_pack(dc_job);
+      return;
+   }
+
    filename = get_cache_file(dc_job->cache, dc_job->key);
    if (filename == NULL)
       goto done;
@@ -917,69 +1006,21 @@ cache_put(void *job, int thread_index)
     * by some other process.
     */
 
-   /* Write the driver_keys_blob, this can be used find information about the
-    * mesa version that produced the entry or deal with hash collisions,
-    * should that ever become a real problem.
-    */
-   ret = write_all(fd, dc_job->cache->driver_keys_blob,
-                   dc_job->cache->driver_keys_blob_size);
-   if (ret == -1) {
-      unlink(filename_tmp);
-      goto done;
-   }
-
-   /* Write the cache item metadata. This data can be used to deal with
-    * hash collisions, as well as providing useful information to 3rd party
-    * tools reading the cache files.
+   /* Now, finally, write out the contents to the temporary file, then
+    * rename them atomically to the destination filename, and also
+    * perform an atomic increment of the total cache size.
     */
-   ret = write_all(fd, &dc_job->cache_item_metadata.type,
-                   sizeof(uint32_t));
-   if (ret == -1) {
+   entry = create_cache_entry(dc_job, &entry_size);
+   if (!entry) {
       unlink(filename_tmp);
       goto done;
    }
 
-   if (dc_job->cache_item_metadata.type == CACHE_ITEM_TYPE_GLSL) {
-      ret = write_all(fd, &dc_job->cache_item_metadata.num_keys,
-                      sizeof(uint32_t));
-      if (ret == -1) {
-         unlink(filename_tmp);
-         goto done;
-      }
-
-      ret = write_all(fd, dc_job->cache_item_metadata.keys[0],
-                      dc_job->cache_item_metadata.num_keys *
-                      sizeof(cache_key));
-      if (ret == -1) {
-         unlink(filename_tmp);
-         goto done;
-      }
-   }
-
-   /* Create CRC of the data. We will read this when restoring the cache and
-    * use it to check for corruption.
-    */
-   struct cache_entry_file_data cf_data;
-   cf_data.crc32 = util_hash_crc32(dc_job->data, dc_job->size);
-   cf_data.uncompressed_size = dc_job->size;
-
-   size_t cf_data_size = sizeof(cf_data);
-   ret = write_all(fd, &cf_data, cf_data_size);
+   ret = write_all(fd, entry, entry_size);
    if (ret == -1) {
       unlink(filename_tmp);
       goto done;
    }
-
-   /* Now, finally, write out the contents to the temporary file, then
-    * rename them atomically to the destination filename, and also
-    * perform an atomic increment of the total cache size.
-    */
-   size_t file_size = deflate_and_write_to_disk(dc_job->data, dc_job->size,
-                                                fd, filename_tmp);
-   if (file_size == 0) {
-      unlink(filename_tmp);
-      goto done;
-   }
    ret = rename(filename_tmp, filename);
    if (ret == -1) {
       unlink(filename_tmp);
@@ -1003,6 +1044,7 @@ cache_put(void *job, int thread_index)
     */
    if (fd != -1)
       close(fd);
+   free(entry);
    free(filename_tmp);
    free(filename);
 }
@@ -1025,48 +1067,91 @@ disk_cache_put(struct disk_cache *cache, const cache_key key,
 
    if (dc_job) {
       util_queue_fence_init(&dc_job->fence);
-      util_queue_add_job(&cache->cache_queue, dc_job, &dc_job->fence,
-                         cache_put, destroy_put_job);
+      util_queue_add_job_with_priority(&cache->cache_queue, dc_job,
+                                       &dc_job->fence, cache_put,
+                                       destroy_put_job,
+                                       UTIL_QUEUE_PRIORITY_LOW);
    }
 }
 
 /**
- * Decompresses cache entry, returns true if successful.
+ * Check and decompress a cache entry as written by create_cache_entry().
+ * Returns the malloc'ed data, or NULL if the entry is corrupt.
  */
-static bool
-inflate_cache_data(uint8_t *in_data, size_t in_data_size,
-                   uint8_t *out_data, size_t out_data_size)
+static void *
+parse_cache_entry(struct disk_cache *cache, const uint8_t *entry,
+                  size_t entry_size, size_t *size)
 {
-   z_stream strm;
-
-   /* allocate inflate state */
-   strm.zalloc = Z_NULL;
-   strm.zfree = Z_NULL;
-   strm.opaque = Z_NULL;
-   strm.next_in = in_data;
-   strm.avail_in = in_data_size;
-   strm.next_out = out_data;
-   strm.avail_out = out_data_size;
-
-   int ret = inflateInit(&strm);
-   if (ret != Z_OK)
-      return false;
+   const uint8_t *p = entry, *end = entry + entry_size;
+   uint8_t *uncompressed_data = NULL;
 
-   ret = inflate(&strm, Z_NO_FLUSH);
-   assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
+   size_t ck_size = cache->driver_keys_blob_size;
+   if (end - p < ck_size)
+      return NULL;
 
-   /* Unless there was an error we should have decompressed everything in one
-    * go as we know the uncompressed file size.
-    */
-   if (ret != Z_STREAM_END) {
-      (void)inflateEnd(&strm);
-      return false;
+   /* Check for extremely unlikely hash collisions */
+   if (memcmp(cache->driver_keys_blob, p, ck_size) != 0) {
+      assert(!"Mesa cache keys mismatch!");
+      return NULL;
    }
-   assert(strm.avail_out == 0);
+   p += ck_size;
 
-   /* clean up and return */
-   (void)inflateEnd(&strm);
-   return true;
+   uint32_t md_type;
+   if (end - p < sizeof(uint32_t))
+      return NULL;
+   memcpy(&md_type, p, sizeof(uint32_t));
+   p += sizeof(uint32_t);
+
+   if (md_type == CACHE_ITEM_TYPE_GLSL) {
+      uint32_t num_keys;
+      if (end - p < sizeof(uint32_t))
+         return NULL;
+      memcpy(&num_keys, p, sizeof(uint32_t));
+      p += sizeof(uint32_t);
+
+      /* The cache item metadata is currently just used for distributing
+       * precompiled shaders, they are not used by Mesa so just skip them for
+       * now.
+       * TODO: pass the metadata back to the caller and do some basic
+       * validation.
+       */
+      if ((end - p) / sizeof(cache_key) < num_keys)
+         return NULL;
+      p += num_keys * sizeof(cache_key);
+   }
+
+   /* Load the CRC that was created when the file was written. */
+   struct cache_entry_file_data cf_data;
+   if (end - p < sizeof(cf_data))
+      return NULL;
+   memcpy(&cf_data, p, sizeof(cf_data));
+   p += sizeof(cf_data);
+
+   size_t uncompressed_size = cf_data.size_and_codec & CACHE_ENTRY_SIZE_MASK;
+   enum disk_cache_codec_id codec_id =
+      cf_data.size_and_codec >> CACHE_ENTRY_CODEC_SHIFT;
+
+   /* Uncompress the cache data */
+   uncompressed_data = malloc(uncompressed_size);
+   if (!uncompressed_data)
+      return NULL;
+
+   if (!disk_cache_codec_decompress(cache->codec, codec_id, p, end - p,
+                                    uncompressed_data, uncompressed_size))
+      goto fail;
+
+   /* Check the data for corruption */
+   if (cf_data.crc32 != util_hash_crc32(uncompressed_data, uncompressed_size))
+      goto fail;
+
+   if (size)
+      *size = uncompressed_size;
+
+   return uncompressed_data;
+
+ fail:
+   free(uncompressed_data);
+   return NULL;
 }
 
 void *
@@ -1076,8 +1161,7 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
    struct stat sb;
    char *filename = NULL;
    uint8_t *data = NULL;
-   uint8_t *uncompressed_data = NULL;
-   uint8_t *file_header = NULL;
+   void *uncompressed_data = NULL;
 
    if (size)
       *size = 0;
@@ -1104,112 +1188,46 @@ disk_cache_get(struct disk_cache *cache, const cache_key key, size_t *size)
       return blob;
    }
 
+   if (cache->pack) {
+      /* Decompress straight out of the mapping, no syscall involved. */
+      const void *entry;
+      size_t entry_size;
+
+      entry = disk_cache_pack_lookup(cache->pack, key, &entry_size);
+      if (!entry)
+         return NULL;
+
+      return parse_cache_entry(cache, entry, entry_size, size);
+   }
+
    filename = get_cache_file(cache, key);
    if (filename == NULL)
-      goto fail;
+      goto done;
 
    fd = open(filename, O_RDONLY | O_CLOEXEC);
    if (fd == -1)
-      goto fail;
+      goto done;
 
    if (fstat(fd, &sb) == -1)
-      goto fail;
+      goto done;
 
    data = malloc(sb.st_size);
    if (data == NULL)
-      goto fail;
-
-   size_t ck_size = cache->driver_keys_blob_size;
-   file_header = malloc(ck_size);
-   if (!file_header)
-      goto fail;
-
-   if (sb.st_size < ck_size)
-      goto fail;
-
-   ret = read_all(fd, file_header, ck_size);
-   if (ret == -1)
-      goto fail;
-
-   /* Check for extremely unlikely hash collisions */
-   if (memcmp(cache->driver_keys_blob, file_header, ck_size) != 0) {
-      assert(!"Mesa cache keys mismatch!");
-      goto fail;
-   }
-
-   size_t cache_item_md_size = sizeof(uint32_t);
-   uint32_t md_type;
-   ret = read_all(fd, &md_type, cache_item_md_size);
-   if (ret == -1)
-      goto fail;
-
-   if (md_type == CACHE_ITEM_TYPE_GLSL) {
-      uint32_t num_keys;
-      cache_item_md_size += sizeof(uint32_t);
-      ret = read_all(fd, &num_keys, sizeof(uint32_t));
-      if (ret == -1)
-         goto fail;
-
-      /* The cache item metadata is currently just used for distributing
-       * precompiled shaders, they are not used by Mesa so just skip them for
-       * now.
-       * TODO: pass the metadata back to the caller and do some basic
-       * validation.
-       */
-      cache_item_md_size += num_keys * sizeof(cache_key);
-      ret = lseek(fd, num_keys * sizeof(cache_key), SEEK_CUR);
-      if (ret == -1)
-         goto fail;
-   }
-
-   /* Load the CRC that was created when the file was written. */
-   struct cache_entry_file_data cf_data;
-   size_t cf_data_size = sizeof(cf_data);
-   ret = read_all(fd, &cf_data, cf_data_size);
-   if (ret == -1)
-      goto fail;
+      goto done;
 
-   /* Load the actual cache data. */
-   size_t cache_data_size =
-      sb.st_size - cf_data_size - ck_size - cache_item_md_size;
-   ret = read_all(fd, data, cache_data_size);
+   ret = read_all(fd, data, sb.st_size);
    if (ret == -1)
-      goto fail;
-
-   /* Uncompress the cache data */
-   uncompressed_data = malloc(cf_data.uncompressed_size);
-   if (!inflate_cache_data(data, cache_data_size, uncompressed_data,
-                           cf_data.uncompressed_size))
-      goto fail;
+      goto done;
 
-   /* Check the data for corruption */
-   if (cf_data.crc32 != util_hash_crc32(uncompressed_data,
-                                        cf_data.uncompressed_size))
-      goto fail;
+   uncompressed_data = parse_cache_entry(cache, data, sb.st_size, size);
 
+ done:
    free(data);
    free(filename);
-   free(file_header);
-   close(fd);
-
-   if (size)
-      *size = cf_data.uncompressed_size;
-
-   return uncompressed_data;
-
- fail:
-   if (data)
-      free(data);
-   if (uncompressed_data)
-      free(uncompressed_data);
-   if (filename)
-      free(filename);
-   if (file_header)
-      free(file_header);
    if (fd != -1)
       close(fd);
 
-   return NULL;
+   return uncompressed_data;
 }
 
 void
@@ -1272,6 +1290,24 @@ disk_cache_compute_key(struct disk_cache *cache, const void *data, size_t size,
    _mesa_sha1_final(&ctx, key);
 }
 
+bool
+disk_cache_set_codec(struct disk_cache *cache, const char *name)
+{
+   struct disk_cache_codec *codec;
+
+   /* The environment takes precedence. */
+   if (cache->path_init_failed || getenv("MESA_DISK_CACHE_CODEC"))
+      return false;
+
+   codec = disk_cache_codec_create(name, getenv("MESA_DISK_CACHE_ZSTD_DICT"));
+   if (!codec)
+      return false;
+
+   disk_cache_codec_destroy(cache->codec);
+   cache->codec = codec;
+   return true;
+}
+
 void
 disk_cache_set_callbacks(struct disk_cache *cache, disk_cache_put_cb put,
                          disk_cache_get_cb get)
@@ -246,6 +246,17 @@ void
 disk_cache_set_callbacks(struct disk_cache *cache, disk_cache_put_cb put,
                          disk_cache_get_cb get);
 
+/**
+ * Select the codec used to compress new entries: "zlib" (the default),
+ * "none", "lz4" or "zstd", the last two depending on build options.  This is
+ * meant for drivers forwarding a driconf option and must be called before
+ * the cache is used.  MESA_DISK_CACHE_CODEC takes precedence.
+ *
+ * Returns false if the codec wasn't changed.
+ */
+bool
+disk_cache_set_codec(struct disk_cache *cache, const char *name);
+
 #else
 
 static inline struct disk_cache *
@@ -306,6 +317,12 @@ disk_cache_set_callbacks(struct disk_cache *cache, disk_cache_put_cb put,
    return;
 }
 
+static inline bool
+disk_cache_set_codec(struct disk_cache *cache, const char *name)
+{
+   return false;
+}
+
 #endif /* ENABLE_SHADER_CACHE */
 
 #ifdef __cplusplus
@@ -0,0 +1,361 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifdef ENABLE_SHADER_CACHE
+
+#include <assert.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "zlib.h"
+
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#include "c11/threads.h"
+#endif
+
+#include "util/macros.h"
+
+#include "disk_cache_codec.h"
+
+/* zstd decompression speed barely depends on the level, so favour
+ * compression speed, which is still better than zlib's at a similar ratio.
+ */
+#define DISK_CACHE_ZSTD_LEVEL 3
+
+struct disk_cache_codec {
+   enum disk_cache_codec_id id;
+
+#ifdef HAVE_ZSTD
+   /* Only used on the cache thread */
+   ZSTD_CCtx *cctx;
+   ZSTD_CDict *cdict;
+
+   ZSTD_DDict *ddict;
+
+   /* A decompression context shared by the threads which don't race for
+    * it, the others create their own.
+    */
+   mtx_t dctx_mutex;
+   ZSTD_DCtx *dctx;
+#endif
+};
+
+static const struct {
+   const char *name;
+   enum disk_cache_codec_id id;
+} codec_names[] = {
+   { "zlib", DISK_CACHE_CODEC_ZLIB },
+   { "none", DISK_CACHE_CODEC_NONE },
+#ifdef HAVE_LZ4
+   { "lz4", DISK_CACHE_CODEC_LZ4 },
+#endif
+#ifdef HAVE_ZSTD
+   { "zstd", DISK_CACHE_CODEC_ZSTD },
+#endif
+};
+
+#ifdef HAVE_ZSTD
+static void *
+read_dictionary(const char *path, size_t *size)
+{
+   FILE *f = fopen(path, "rb");
+   void *dict = NULL;
+   long len;
+
+   if (!f)
+      return NULL;
+
+   if (fseek(f, 0, SEEK_END) == 0 && (len = ftell(f)) > 0 &&
+       fseek(f, 0, SEEK_SET) == 0) {
+      dict = malloc(len);
+      if (dict && fread(dict, 1, len, f) != (size_t) len) {
+         free(dict);
+         dict = NULL;
+      }
+      *size = len;
+   }
+
+   fclose(f);
+   return dict;
+}
+#endif
+
+struct disk_cache_codec *
+disk_cache_codec_create(const char *name, const char *dict_path)
+{
+   struct disk_cache_codec *codec;
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(codec_names); i++) {
+      if (strcmp(codec_names[i].name, name) == 0)
+         break;
+   }
+   if (i == ARRAY_SIZE(codec_names))
+      return NULL;
+
+   codec = calloc(1, sizeof(*codec));
+   if (!codec)
+      return NULL;
+
+   codec->id = codec_names[i].id;
+
+#ifdef HAVE_ZSTD
+   mtx_init(&codec->dctx_mutex, mtx_plain);
+
+   /* The dictionary is loaded whatever the codec, as entries written with
+    * it may need to be read.
+    */
+   if (dict_path) {
+      size_t dict_size;
+      void *dict = read_dictionary(dict_path, &dict_size);
+
+      if (dict) {
+         codec->ddict = ZSTD_createDDict(dict, dict_size);
+         if (codec->id == DISK_CACHE_CODEC_ZSTD)
+            codec->cdict = ZSTD_createCDict(dict, dict_size,
+                                            DISK_CACHE_ZSTD_LEVEL);
+         free(dict);
+      } else {
+         fprintf(stderr, "Failed to read the shader cache dictionary %s\n",
+                 dict_path);
+      }
+   }
+
+   if (codec->id == DISK_CACHE_CODEC_ZSTD) {
+      codec->cctx = ZSTD_createCCtx();
+      if (!codec->cctx) {
+         disk_cache_codec_destroy(codec);
+         return NULL;
+      }
+   }
+#endif
+
+   return codec;
+}
+
+void
+disk_cache_codec_destroy(struct disk_cache_codec *codec)
+{
+   if (!codec)
+      return;
+
+#ifdef HAVE_ZSTD
+   ZSTD_freeCCtx(codec->cctx);
+   ZSTD_freeCDict(codec->cdict);
+   ZSTD_freeDDict(codec->ddict);
+   ZSTD_freeDCtx(codec->dctx);
+   mtx_destroy(&codec->dctx_mutex);
+#endif
+
+   free(codec);
+}
+
+enum disk_cache_codec_id
+disk_cache_codec_get_id(const struct disk_cache_codec *codec)
+{
+   return codec->id;
+}
+
+size_t
+disk_cache_codec_compress_bound(const struct disk_cache_codec *codec,
+                                size_t size)
+{
+   switch (codec->id) {
+   case DISK_CACHE_CODEC_ZLIB:
+      return compressBound(size);
+   case DISK_CACHE_CODEC_NONE:
+      return size;
+#ifdef HAVE_LZ4
+   case DISK_CACHE_CODEC_LZ4:
+      return size <= LZ4_MAX_INPUT_SIZE ? LZ4_compressBound(size) : 0;
+#endif
+#ifdef HAVE_ZSTD
+   case DISK_CACHE_CODEC_ZSTD:
+      return ZSTD_compressBound(size);
+#endif
+   default:
+      unreachable("unsupported disk cache codec");
+   }
+}
+
+size_t
+disk_cache_codec_compress(struct disk_cache_codec *codec,
+                          const void *in, size_t in_size,
+                          void *out, size_t out_size)
+{
+   switch (codec->id) {
+   case DISK_CACHE_CODEC_ZLIB: {
+      uLongf compressed_size = out_size;
+
+      if (compress2(out, &compressed_size, in, in_size,
+                    Z_BEST_COMPRESSION) != Z_OK)
+         return 0;
+      return compressed_size;
+   }
+   case DISK_CACHE_CODEC_NONE:
+      if (out_size < in_size)
+         return 0;
+      memcpy(out, in, in_size);
+      return in_size;
+#ifdef HAVE_LZ4
+   case DISK_CACHE_CODEC_LZ4:
+      if (in_size > LZ4_MAX_INPUT_SIZE)
+         return 0;
+      return LZ4_compress_default(in, out, in_size, MIN2(out_size, INT_MAX));
+#endif
+#ifdef HAVE_ZSTD
+   case DISK_CACHE_CODEC_ZSTD: {
+      size_t ret;
+
+      if (codec->cdict) {
+         ret = ZSTD_compress_usingCDict(codec->cctx, out, out_size,
+                                        in, in_size, codec->cdict);
+      } else {
+         ret = ZSTD_compressCCtx(codec->cctx, out, out_size, in, in_size,
+                                 DISK_CACHE_ZSTD_LEVEL);
+      }
+      return ZSTD_isError(ret) ? 0 : ret;
+   }
+#endif
+   default:
+      unreachable("unsupported disk cache codec");
+   }
+}
+
+static bool
+inflate_cache_data(const uint8_t *in_data, size_t in_data_size,
+                   uint8_t *out_data, size_t out_data_size)
+{
+   z_stream strm;
+
+   /* allocate inflate state */
+   strm.zalloc = Z_NULL;
+   strm.zfree = Z_NULL;
+   strm.opaque = Z_NULL;
+   strm.next_in = (uint8_t *) in_data;
+   strm.avail_in = in_data_size;
+   strm.next_out = out_data;
+   strm.avail_out = out_data_size;
+
+   int ret = inflateInit(&strm);
+   if (ret != Z_OK)
+      return false;
+
+   ret = inflate(&strm, Z_NO_FLUSH);
+   assert(ret != Z_STREAM_ERROR);  /* state not clobbered */
+
+   /* Unless there was an error we should have decompressed everything in one
+    * go as we know the uncompressed file size.
+    */
+   if (ret != Z_STREAM_END) {
+      (void)inflateEnd(&strm);
+      return false;
+   }
+   assert(strm.avail_out == 0);
+
+   /* clean up and return */
+   (void)inflateEnd(&strm);
+   return true;
+}
+
+#ifdef HAVE_ZSTD
+static bool
+zstd_decompress(struct disk_cache_codec *codec, const void *in,
+                size_t in_size, void *out, size_t out_size)
+{
+   ZSTD_DCtx *dctx;
+   bool shared;
+   size_t ret;
+
+   shared = mtx_trylock(&codec->dctx_mutex) == thrd_success;
+   if (shared) {
+      if (!codec->dctx)
+         codec->dctx = ZSTD_createDCtx();
+      dctx = codec->dctx;
+   } else {
+      dctx = ZSTD_createDCtx();
+   }
+
+   if (!dctx) {
+      if (shared)
+         mtx_unlock(&codec->dctx_mutex);
+      return false;
+   }
+
+   /* zstd checks the dictionary ID recorded in the frame, so an entry
+    * written with another dictionary just fails here.
+    */
+   if (codec->ddict) {
+      ret = ZSTD_decompress_usingDDict(dctx, out, out_size, in, in_size,
+                                       codec->ddict);
+   } else {
+      ret = ZSTD_decompressDCtx(dctx, out, out_size, in, in_size);
+   }
+
+   if (shared)
+      mtx_unlock(&codec->dctx_mutex);
+   else
+      ZSTD_freeDCtx(dctx);
+
+   return !ZSTD_isError(ret) && ret == out_size;
+}
+#endif
+
+bool
+disk_cache_codec_decompress(struct disk_cache_codec *codec,
+                            enum disk_cache_codec_id id,
+                            const void *in, size_t in_size,
+                            void *out, size_t out_size)
+{
+   switch (id) {
+   case DISK_CACHE_CODEC_ZLIB:
+      return inflate_cache_data(in, in_size, out, out_size);
+   case DISK_CACHE_CODEC_NONE:
+      if (in_size != out_size)
+         return false;
+      memcpy(out, in, out_size);
+      return true;
+#ifdef HAVE_LZ4
+   case DISK_CACHE_CODEC_LZ4:
+      if (in_size > INT_MAX || out_size > INT_MAX)
+         return false;
+      return LZ4_decompress_safe(in, out, in_size, out_size) ==
+             (int) out_size;
+#endif
+#ifdef HAVE_ZSTD
+   case DISK_CACHE_CODEC_ZSTD:
+      return zstd_decompress(codec, in, in_size, out, out_size);
+#endif
+   default:
+      return false;
+   }
+}
+
+#endif /* ENABLE_SHADER_CACHE */
@@ -0,0 +1,106 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * Compression of disk_cache entries.
+ *
+ * Entries record the ID of the codec they were compressed with, so that a
+ * cache can hold entries written with different codecs.  Entries written
+ * before codec IDs existed use zlib, which is ID 0.
+ *
+ * This is internal to disk_cache.c.
+ */
+
+#ifndef DISK_CACHE_CODEC_H
+#define DISK_CACHE_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum disk_cache_codec_id {
+   DISK_CACHE_CODEC_ZLIB = 0,
+   /* No compression, for when decompression time matters most */
+   DISK_CACHE_CODEC_NONE = 1,
+   DISK_CACHE_CODEC_LZ4 = 2,
+   DISK_CACHE_CODEC_ZSTD = 3,
+};
+
+struct disk_cache_codec;
+
+/**
+ * Create a codec compressing with the codec called \p name ("zlib", "none",
+ * "lz4" or "zstd").  If \p dict_path is not NULL, the zstd dictionary in that
+ * file is used for both compression and decompression.
+ *
+ * Returns NULL if the codec is unknown or not supported by this build.
+ */
+struct disk_cache_codec *
+disk_cache_codec_create(const char *name, const char *dict_path);
+
+void
+disk_cache_codec_destroy(struct disk_cache_codec *codec);
+
+enum disk_cache_codec_id
+disk_cache_codec_get_id(const struct disk_cache_codec *codec);
+
+/**
+ * Worst-case compressed size of \p size bytes.
+ */
+size_t
+disk_cache_codec_compress_bound(const struct disk_cache_codec *codec,
+                                size_t size);
+
+/**
+ * Compress \p in into \p out, which must be at least
+ * disk_cache_codec_compress_bound() bytes.  Returns the compressed size, or
+ * 0 on failure.
+ *
+ * Not thread-safe, the cache only compresses on its queue thread.
+ */
+size_t
+disk_cache_codec_compress(struct disk_cache_codec *codec,
+                          const void *in, size_t in_size,
+                          void *out, size_t out_size);
+
+/**
+ * Decompress \p in, which was compressed with codec \p id, into exactly
+ * \p out_size bytes at \p out.  Returns false if the data is corrupt or if
+ * \p id isn't supported by this build.
+ *
+ * Thread-safe.
+ */
+bool
+disk_cache_codec_decompress(struct disk_cache_codec *codec,
+                            enum disk_cache_codec_id id,
+                            const void *in, size_t in_size,
+                            void *out, size_t out_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DISK_CACHE_CODEC_H */
@@ -0,0 +1,779 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifdef ENABLE_SHADER_CACHE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/file.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#include "c11/threads.h"
+#include "util/macros.h"
+#include "util/u_atomic.h"
+
+#include "disk_cache_pack.h"
+
+/* On-disk layout
+ *
+ * pack:  struct pack_file_header, followed by records.  Each record is a
+ *        struct pack_record_header followed by the entry, padded to
+ *        PACK_RECORD_ALIGN.  Records are only ever appended, past the
+ *        committed size stored in the index.
+ *
+ * index: struct pack_index_header followed by PACK_INDEX_BUCKETS slots of an
+ *        open-addressing hash table keyed by the first bytes of the cache
+ *        key.
+ *
+ * Nothing is ever rewritten in place except index slots and the counters of
+ * the index header.  A crash or a racing reader can therefore only observe
+ * a record that isn't referenced yet or a slot which doesn't match the
+ * record it points to, and lookups check for both.  Whatever gets through
+ * is finally checked by disk_cache.c against the CRC stored in the entry.
+ *
+ * Compaction writes a new pair of files and renames them over the old
+ * ones, then flags the old index as obsolete so that other processes know
+ * to remap.  The old mappings are kept around until the pack is closed, so
+ * that pointers handed out by lookups stay valid.
+ */
+
+#define PACK_MAGIC           0x4b434150 /* "PACK" */
+#define PACK_RECORD_MAGIC    0x44524352 /* "RCRD" */
+#define PACK_VERSION         1
+
+#define PACK_INDEX_BUCKETS   (1 << 17)
+#define PACK_INDEX_MASK      (PACK_INDEX_BUCKETS - 1)
+#define PACK_MAX_PROBES      32
+
+#define PACK_RECORD_ALIGN    8
+
+#define PACK_SLOT_EMPTY      0
+#define PACK_SLOT_DELETED    UINT64_MAX
+
+struct pack_file_header {
+   uint32_t magic;
+   uint32_t version;
+   uint64_t capacity;
+};
+
+struct pack_record_header {
+   uint32_t magic;
+   uint32_t size;
+   uint8_t key[CACHE_KEY_SIZE];
+   uint32_t pad;
+};
+
+struct pack_index_header {
+   uint32_t magic;
+   uint32_t version;
+   uint32_t num_buckets;
+   /* Set once compaction has replaced these files */
+   uint32_t obsolete;
+   /* Size of the pack file mapping, fixed at creation */
+   uint64_t capacity;
+   /* Bytes of the pack file holding committed records */
+   uint64_t pack_size;
+   /* Bytes of records which are no longer referenced */
+   uint64_t dead_size;
+};
+
+struct pack_index_slot {
+   uint64_t offset;
+   uint32_t size;
+   uint8_t key[CACHE_KEY_SIZE];
+};
+
+#define PACK_INDEX_SIZE \
+   (sizeof(struct pack_index_header) + \
+    PACK_INDEX_BUCKETS * sizeof(struct pack_index_slot))
+
+struct pack_mapping {
+   struct pack_mapping *next;
+
+   int data_fd;
+   const uint8_t *data;
+   uint64_t data_size;
+
+   struct pack_index_header *header;
+   struct pack_index_slot *slots;
+};
+
+struct disk_cache_pack {
+   char *data_path;
+   char *index_path;
+
+   uint64_t max_size;
+
+   /* flock()ed around any modification */
+   int lock_fd;
+
+   /* Protects switching the current mapping */
+   mtx_t mutex;
+   struct pack_mapping *current;
+
+   /* Mappings replaced by compaction, unmapped on close */
+   struct pack_mapping *retired;
+};
+
+static inline uint64_t
+record_size(size_t entry_size)
+{
+   return ALIGN_POT(sizeof(struct pack_record_header) + (uint64_t) entry_size,
+                    PACK_RECORD_ALIGN);
+}
+
+static inline unsigned
+key_bucket(const cache_key key)
+{
+   uint32_t bucket;
+
+   /* The keys are SHA-1 hashes, so any of their bits will do */
+   memcpy(&bucket, key, sizeof(bucket));
+   return bucket & PACK_INDEX_MASK;
+}
+
+static ssize_t
+write_all_at(int fd, const void *buf, size_t count, off_t offset)
+{
+   const char *out = buf;
+   ssize_t written;
+   size_t done;
+
+   for (done = 0; done < count; done += written) {
+      written = pwrite(fd, out + done, count - done, offset + done);
+      if (written == -1)
+         return -1;
+   }
+   return done;
+}
+
+static void
+pack_lock(struct disk_cache_pack *pack)
+{
+   while (flock(pack->lock_fd, LOCK_EX) == -1 && errno == EINTR)
+      ;
+}
+
+static void
+pack_unlock(struct disk_cache_pack *pack)
+{
+   flock(pack->lock_fd, LOCK_UN);
+}
+
+static void
+unmap_files(struct pack_mapping *map)
+{
+   if (map->data)
+      munmap((void *) map->data, map->data_size);
+   if (map->header)
+      munmap(map->header, PACK_INDEX_SIZE);
+   if (map->data_fd != -1)
+      close(map->data_fd);
+   free(map);
+}
+
+/* Map the current pack and index files.  Returns NULL if they are missing
+ * or don't look right.
+ */
+static struct pack_mapping *
+map_files(struct disk_cache_pack *pack)
+{
+   struct pack_mapping *map;
+   struct pack_file_header file_header;
+   struct stat sb;
+   void *ptr;
+   int index_fd;
+
+   map = calloc(1, sizeof(*map));
+   if (!map)
+      return NULL;
+
+   map->data_fd = open(pack->data_path, O_RDWR | O_CLOEXEC);
+   if (map->data_fd == -1)
+      goto fail;
+
+   if (pread(map->data_fd, &file_header, sizeof(file_header), 0) !=
+       sizeof(file_header) ||
+       file_header.magic != PACK_MAGIC ||
+       file_header.version != PACK_VERSION)
+      goto fail;
+
+   index_fd = open(pack->index_path, O_RDWR | O_CLOEXEC);
+   if (index_fd == -1)
+      goto fail;
+
+   if (fstat(index_fd, &sb) == -1 || sb.st_size != PACK_INDEX_SIZE) {
+      close(index_fd);
+      goto fail;
+   }
+
+   ptr = mmap(NULL, PACK_INDEX_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+              index_fd, 0);
+   close(index_fd);
+   if (ptr == MAP_FAILED)
+      goto fail;
+
+   map->header = ptr;
+   map->slots = (struct pack_index_slot *) (map->header + 1);
+
+   if (map->header->magic != PACK_MAGIC ||
+       map->header->version != PACK_VERSION ||
+       map->header->num_buckets != PACK_INDEX_BUCKETS ||
+       map->header->capacity != file_header.capacity ||
+       map->header->obsolete)
+      goto fail;
+
+   /* Reserve the whole capacity up front so that we never have to remap
+    * while other threads are reading.  Only the committed part, which is
+    * always backed by the file, is ever accessed.
+    */
+   map->data_size = map->header->capacity;
+   ptr = mmap(NULL, map->data_size, PROT_READ, MAP_SHARED, map->data_fd, 0);
+   if (ptr == MAP_FAILED)
+      goto fail;
+
+   map->data = ptr;
+
+   return map;
+
+ fail:
+   unmap_files(map);
+   return NULL;
+}
+
+static bool
+record_matches(const struct pack_mapping *map, uint64_t offset, uint32_t size,
+               const cache_key key)
+{
+   const struct pack_record_header *record;
+   uint64_t pack_size = p_atomic_read(&map->header->pack_size);
+
+   if (offset < sizeof(struct pack_file_header) ||
+       offset > pack_size || record_size(size) > pack_size - offset ||
+       pack_size > map->data_size)
+      return false;
+
+   record = (const struct pack_record_header *) (map->data + offset);
+
+   return record->magic == PACK_RECORD_MAGIC && record->size == size &&
+          memcmp(record->key, key, CACHE_KEY_SIZE) == 0;
+}
+
+/* Returns the slot holding \p key, or NULL. */
+static struct pack_index_slot *
+find_slot(const struct pack_mapping *map, const cache_key key)
+{
+   unsigned bucket = key_bucket(key);
+
+   for (unsigned i = 0; i < PACK_MAX_PROBES; i++) {
+      struct pack_index_slot *slot =
+         &map->slots[(bucket + i) & PACK_INDEX_MASK];
+      uint64_t offset = p_atomic_read(&slot->offset);
+
+      if (offset == PACK_SLOT_EMPTY)
+         return NULL;
+
+      if (offset != PACK_SLOT_DELETED &&
+          memcmp(slot->key, key, CACHE_KEY_SIZE) == 0)
+         return slot;
+   }
+
+   return NULL;
+}
+
+/* Returns a slot to store \p key in, evicting whatever is in the home
+ * bucket if all the probed slots are taken.
+ */
+static struct pack_index_slot *
+alloc_slot(const struct pack_mapping *map, const cache_key key)
+{
+   unsigned bucket = key_bucket(key);
+   struct pack_index_slot *victim = &map->slots[bucket];
+
+   for (unsigned i = 0; i < PACK_MAX_PROBES; i++) {
+      struct pack_index_slot *slot =
+         &map->slots[(bucket + i) & PACK_INDEX_MASK];
+
+      if (slot->offset == PACK_SLOT_EMPTY ||
+          slot->offset == PACK_SLOT_DELETED)
+         return slot;
+   }
+
+   map->header->dead_size += record_size(victim->size);
+   return victim;
+}
+
+/* qsort() comparator ordering pointers to index slots by record offset */
+static int
+compare_slot_offsets(const void *a, const void *b)
+{
+   const struct pack_index_slot *slot_a =
+      *(const struct pack_index_slot * const *) a;
+   const struct pack_index_slot *slot_b =
+      *(const struct pack_index_slot * const *) b;
+
+   if (slot_a->offset < slot_b->offset)
+      return -1;
+   return slot_a->offset > slot_b->offset;
+}
+
+/* Write a new pair of files holding the records of \p src which are still
+ * referenced, most recent first, up to \p budget bytes, and rename them into
+ * place.  \p src may be NULL to create empty files.
+ *
+ * Must be called with the lock held.
+ */
+static bool
+write_files(struct disk_cache_pack *pack, struct pack_mapping *src,
+            uint64_t budget)
+{
+   struct pack_file_header file_header;
+   struct pack_index_header *header = NULL;
+   struct pack_index_slot *slots, **live = NULL;
+   char *data_tmp = NULL, *index_tmp = NULL;
+   unsigned num_live = 0, first = 0;
+   uint64_t offset, total = 0;
+   int data_fd = -1, index_fd = -1;
+   bool ret = false;
+
+   if (asprintf(&data_tmp, "%s.tmp", pack->data_path) == -1) {
+      data_tmp = NULL;
+      goto done;
+   }
+   if (asprintf(&index_tmp, "%s.tmp", pack->index_path) == -1) {
+      index_tmp = NULL;
+      goto done;
+   }
+
+   header = calloc(1, PACK_INDEX_SIZE);
+   if (!header)
+      goto done;
+   slots = (struct pack_index_slot *) (header + 1);
+
+   /* Gather the records to keep, oldest first */
+   if (src) {
+      live = malloc(PACK_INDEX_BUCKETS * sizeof(*live));
+      if (!live)
+         goto done;
+
+      for (unsigned i = 0; i < PACK_INDEX_BUCKETS; i++) {
+         struct pack_index_slot *slot = &src->slots[i];
+
+         if (slot->offset != PACK_SLOT_EMPTY &&
+             slot->offset != PACK_SLOT_DELETED &&
+             record_matches(src, slot->offset, slot->size, slot->key))
+            live[num_live++] = slot;
+      }
+
+      /* Records are appended, so the offset gives the age */
+      qsort(live, num_live, sizeof(*live), compare_slot_offsets);
+
+      first = num_live;
+      while (first > 0 &&
+             total + record_size(live[first - 1]->size) <= budget) {
+         total += record_size(live[first - 1]->size);
+         first--;
+      }
+   }
+
+   data_fd = open(data_tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+   if (data_fd == -1)
+      goto done;
+
+   memset(&file_header, 0, sizeof(file_header));
+   file_header.magic = PACK_MAGIC;
+   file_header.version = PACK_VERSION;
+   file_header.capacity = pack->max_size;
+   if (write_all_at(data_fd, &file_header, sizeof(file_header), 0) == -1)
+      goto done;
+
+   offset = sizeof(file_header);
+   for (unsigned i = first; i < num_live; i++) {
+      const struct pack_index_slot *src_slot = live[i];
+      uint64_t size = record_size(src_slot->size);
+      struct pack_index_slot *slot = NULL;
+      unsigned bucket = key_bucket(src_slot->key);
+
+      for (unsigned j = 0; j < PACK_MAX_PROBES; j++) {
+         slot = &slots[(bucket + j) & PACK_INDEX_MASK];
+         if (slot->offset == PACK_SLOT_EMPTY)
+            break;
+      }
+      if (slot->offset != PACK_SLOT_EMPTY)
+         continue;
+
+      if (write_all_at(data_fd, src->data + src_slot->offset, size,
+                       offset) == -1)
+         goto done;
+
+      slot->offset = offset;
+      slot->size = src_slot->size;
+      memcpy(slot->key, src_slot->key, CACHE_KEY_SIZE);
+      offset += size;
+   }
+
+   header->magic = PACK_MAGIC;
+   header->version = PACK_VERSION;
+   header->num_buckets = PACK_INDEX_BUCKETS;
+   header->capacity = pack->max_size;
+   header->pack_size = offset;
+
+   index_fd = open(index_tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+   if (index_fd == -1)
+      goto done;
+
+   if (write_all_at(index_fd, header, PACK_INDEX_SIZE, 0) == -1)
+      goto done;
+
+   /* Make sure the new contents hit the disk before the renames do, or a
+    * crash could leave us with truncated files.
+    */
+   if (fdatasync(data_fd) == -1 || fdatasync(index_fd) == -1)
+      goto done;
+
+   /* If we crash in between the two renames, the old index won't match the
+    * records of the new pack, which lookups detect.
+    */
+   if (rename(data_tmp, pack->data_path) == -1 ||
+       rename(index_tmp, pack->index_path) == -1)
+      goto done;
+
+   if (src)
+      src->header->obsolete = 1;
+
+   ret = true;
+
+ done:
+   if (data_fd != -1)
+      close(data_fd);
+   if (index_fd != -1)
+      close(index_fd);
+   if (!ret) {
+      if (data_tmp)
+         unlink(data_tmp);
+      if (index_tmp)
+         unlink(index_tmp);
+   }
+   free(data_tmp);
+   free(index_tmp);
+   free(header);
+   free(live);
+
+   return ret;
+}
+
+/* Returns the current mapping, switching to new files if another process
+ * compacted the pack.
+ */
+static struct pack_mapping *
+get_mapping(struct disk_cache_pack *pack)
+{
+   struct pack_mapping *map = p_atomic_read(&pack->current);
+
+   if (likely(!map || !p_atomic_read(&map->header->obsolete)))
+      return map;
+
+   mtx_lock(&pack->mutex);
+   if (pack->current == map) {
+      struct pack_mapping *new_map = map_files(pack);
+
+      if (new_map) {
+         map->next = pack->retired;
+         pack->retired = map;
+         p_atomic_set(&pack->current, new_map);
+      }
+   }
+   map = pack->current;
+   mtx_unlock(&pack->mutex);
+
+   return map;
+}
+
+/* Same as get_mapping(), but also (re)creates the files if they are broken.
+ * Must be called with the lock held.
+ */
+static struct pack_mapping *
+get_mapping_locked(struct disk_cache_pack *pack)
+{
+   struct pack_mapping *map = get_mapping(pack);
+
+   if (map && !map->header->obsolete)
+      return map;
+
+   mtx_lock(&pack->mutex);
+   if (pack->current == map) {
+      struct pack_mapping *new_map = map_files(pack);
+
+      if (!new_map && write_files(pack, map, 0))
+         new_map = map_files(pack);
+
+      if (new_map) {
+         if (map) {
+            map->next = pack->retired;
+            pack->retired = map;
+         }
+         p_atomic_set(&pack->current, new_map);
+      }
+   }
+   map = pack->current;
+   mtx_unlock(&pack->mutex);
+
+   return map && !map->header->obsolete ? map : NULL;
+}
+
+/* Must be called with the lock held. */
+static struct pack_mapping *
+compact_locked(struct disk_cache_pack *pack, struct pack_mapping *map,
+               uint64_t budget)
+{
+   if (!write_files(pack, map, budget))
+      return map;
+
+   return get_mapping_locked(pack);
+}
+
+struct disk_cache_pack *
+disk_cache_pack_open(const char *path, uint64_t max_size)
+{
+   struct disk_cache_pack *pack;
+   char *lock_path;
+
+   /* The whole pack gets mapped */
+   if (max_size > SIZE_MAX / 2)
+      return NULL;
+
+   pack = calloc(1, sizeof(*pack));
+   if (!pack)
+      return NULL;
+
+   pack->lock_fd = -1;
+   pack->max_size = max_size;
+   mtx_init(&pack->mutex, mtx_plain);
+
+   if (asprintf(&pack->data_path, "%s/pack", path) == -1) {
+      pack->data_path = NULL;
+      goto fail;
+   }
+   if (asprintf(&pack->index_path, "%s/pack.idx", path) == -1) {
+      pack->index_path = NULL;
+      goto fail;
+   }
+   if (asprintf(&lock_path, "%s/pack.lock", path) == -1)
+      goto fail;
+
+   pack->lock_fd = open(lock_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+   free(lock_path);
+   if (pack->lock_fd == -1)
+      goto fail;
+
+   /* Try without the lock first, which is all a warm start needs. */
+   pack->current = map_files(pack);
+   if (!pack->current) {
+      pack_lock(pack);
+      get_mapping_locked(pack);
+      pack_unlock(pack);
+   }
+
+   if (!pack->current)
+      goto fail;
+
+   return pack;
+
+ fail:
+   disk_cache_pack_close(pack);
+   return NULL;
+}
+
+void
+disk_cache_pack_close(struct disk_cache_pack *pack)
+{
+   if (!pack)
+      return;
+
+   while (pack->retired) {
+      struct pack_mapping *map = pack->retired;
+      pack->retired = map->next;
+      unmap_files(map);
+   }
+   if (pack->current)
+      unmap_files(pack->current);
+
+   if (pack->lock_fd != -1)
+      close(pack->lock_fd);
+
+   mtx_destroy(&pack->mutex);
+   free(pack->data_path);
+   free(pack->index_path);
+   free(pack);
+}
+
+const void *
+disk_cache_pack_lookup(struct disk_cache_pack *pack, const cache_key key,
+                       size_t *size)
+{
+   struct pack_mapping *map = get_mapping(pack);
+   struct pack_index_slot *slot;
+   uint64_t offset;
+   uint32_t entry_size;
+
+   slot = find_slot(map, key);
+   if (!slot)
+      return NULL;
+
+   offset = p_atomic_read(&slot->offset);
+   entry_size = p_atomic_read(&slot->size);
+   if (!record_matches(map, offset, entry_size, key))
+      return NULL;
+
+   *size = entry_size;
+   return map->data + offset + sizeof(struct pack_record_header);
+}
+
+bool
+disk_cache_pack_append(struct disk_cache_pack *pack, const cache_key key,
+                       const void *data, size_t size)
+{
+   struct pack_record_header record;
+   struct pack_mapping *map;
+   struct pack_index_slot *slot;
+   uint64_t offset;
+   bool ret = false;
+
+   if (size > UINT32_MAX)
+      return false;
+
+   pack_lock(pack);
+
+   map = get_mapping_locked(pack);
+   if (!map)
+      goto done;
+
+   /* Another process may have beaten us to it.  A slot for the key which
+    * doesn't point to a valid record is left over from a crash, and gets
+    * reused below.
+    */
+   slot = find_slot(map, key);
+   if (slot && record_matches(map, slot->offset, slot->size, key)) {
+      ret = true;
+      goto done;
+   }
+
+   /* When full, keep the most recent half of the entries */
+   if (map->header->pack_size + record_size(size) > map->header->capacity) {
+      map = compact_locked(pack, map, map->header->capacity / 2);
+      slot = NULL;
+      if (!map ||
+          map->header->pack_size + record_size(size) > map->header->capacity)
+         goto done;
+   }
+
+   offset = map->header->pack_size;
+
+   memset(&record, 0, sizeof(record));
+   record.magic = PACK_RECORD_MAGIC;
+   record.size = size;
+   memcpy(record.key, key, CACHE_KEY_SIZE);
+
+   /* Write the record past the committed size, so that a partial write is
+    * simply overwritten next time.
+    */
+   if (write_all_at(map->data_fd, &record, sizeof(record), offset) == -1 ||
+       write_all_at(map->data_fd, data, size,
+                    offset + sizeof(record)) == -1)
+      goto done;
+
+   /* Pad the file to the record end, which also guarantees that mapped
+    * pages up to pack_size are backed by the file.
+    */
+   if (ftruncate(map->data_fd, offset + record_size(size)) == -1)
+      goto done;
+
+   p_atomic_set(&map->header->pack_size, offset + record_size(size));
+
+   /* Publish the slot, the offset last.  Readers racing with us either
+    * miss, or see a mismatching record.
+    */
+   if (!slot)
+      slot = alloc_slot(map, key);
+   p_atomic_set(&slot->offset, PACK_SLOT_DELETED);
+   slot->size = size;
+   memcpy(slot->key, key, CACHE_KEY_SIZE);
+   p_atomic_set(&slot->offset, offset);
+
+   ret = true;
+
+ done:
+   pack_unlock(pack);
+   return ret;
+}
+
+void
+disk_cache_pack_remove(struct disk_cache_pack *pack, const cache_key key)
+{
+   struct pack_mapping *map;
+   struct pack_index_slot *slot;
+
+   pack_lock(pack);
+
+   map = get_mapping_locked(pack);
+   if (map) {
+      slot = find_slot(map, key);
+      if (slot) {
+         map->header->dead_size += record_size(slot->size);
+         p_atomic_set(&slot->offset, PACK_SLOT_DELETED);
+      }
+   }
+
+   pack_unlock(pack);
+}
+
+bool
+disk_cache_pack_needs_compaction(struct disk_cache_pack *pack)
+{
+   struct pack_mapping *map = get_mapping(pack);
+
+   return p_atomic_read(&map->header->dead_size) >
+          p_atomic_read(&map->header->capacity) / 4;
+}
+
+void
+disk_cache_pack_compact(struct disk_cache_pack *pack)
+{
+   struct pack_mapping *map;
+
+   pack_lock(pack);
+
+   map = get_mapping_locked(pack);
+   if (map && map->header->dead_size > map->header->capacity / 4)
+      compact_locked(pack, map, map->header->capacity);
+
+   pack_unlock(pack);
+}
+
+#endif /* ENABLE_SHADER_CACHE */
@@ -0,0 +1,111 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/**
+ * Single-file storage for disk_cache entries.
+ *
+ * Entries are appended to one pack file and located through a hash index,
+ * both of which are memory mapped and shared between all processes using
+ * the cache directory.  Lookups don't take any lock nor issue any syscall;
+ * appends, removals and compaction are serialized by an flock() on a
+ * separate lock file.
+ *
+ * This is internal to disk_cache.c, which takes care of the entry format.
+ */
+
+#ifndef DISK_CACHE_PACK_H
+#define DISK_CACHE_PACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "disk_cache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct disk_cache_pack;
+
+/**
+ * Open (creating it if needed) the pack in the directory \p path.
+ *
+ * \p max_size is the capacity of newly created pack files.
+ * Returns NULL on any error.
+ */
+struct disk_cache_pack *
+disk_cache_pack_open(const char *path, uint64_t max_size);
+
+/**
+ * Close the pack.  Pointers returned by disk_cache_pack_lookup() become
+ * invalid.
+ */
+void
+disk_cache_pack_close(struct disk_cache_pack *pack);
+
+/**
+ * Find the entry stored for \p key.
+ *
+ * Returns a pointer into the pack file mapping, which stays valid until the
+ * pack is closed, or NULL if there is no such entry.  The contents are not
+ * validated beyond the record header, so callers must check them.
+ */
+const void *
+disk_cache_pack_lookup(struct disk_cache_pack *pack, const cache_key key,
+                       size_t *size);
+
+/**
+ * Append an entry for \p key, compacting the pack first if it is full.
+ * Does nothing if the key is already present.
+ */
+bool
+disk_cache_pack_append(struct disk_cache_pack *pack, const cache_key key,
+                       const void *data, size_t size);
+
+/**
+ * Drop the entry for \p key from the index.  The space is reclaimed on the
+ * next compaction.
+ */
+void
+disk_cache_pack_remove(struct disk_cache_pack *pack, const cache_key key);
+
+/**
+ * Whether enough space is wasted on removed entries for compaction to be
+ * worth it.
+ */
+bool
+disk_cache_pack_needs_compaction(struct disk_cache_pack *pack);
+
+/**
+ * Rewrite the pack without the removed entries, which is slow and meant to
+ * be run on a background thread.
+ */
+void
+disk_cache_pack_compact(struct disk_cache_pack *pack);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* DISK_CACHE_PACK_H */
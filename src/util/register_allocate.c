@@ -68,6 +68,15 @@
  * up front and stored in a 2-dimensional array, so that the cost of
  * coloring a node is constant with the number of registers.  We do
  * this during ra_set_finalize().
+ *
+ * Shaders may have tens of thousands of nodes, so the interference graph
+ * is kept sparse: each node only has a list of its neighbors, from which
+ * duplicate interferences are dropped before the list grows and once the
+ * graph is complete.
+ * Simplification keeps the q totals up to date as nodes are removed from
+ * the graph, with a set of the nodes that became trivially colorable and a
+ * heap of the others ordered by q total for the optimistic choice, rather
+ * than scanning the whole graph for each node pushed.
  */
 
 #include <stdbool.h>
@@ -79,6 +88,7 @@
 #include "register_allocate.h"
 
 #define NO_REG ~0U
+#define NO_HEAP_POS ~0U
 
 struct ra_reg {
    BITSET_WORD *conflicts;
@@ -126,7 +136,6 @@ struct ra_node {
     * List of which nodes this node interferes with.  This should be
     * symmetric with the other node.
     */
-   BITSET_WORD *adjacency;
    unsigned int *adjacency_list;
    unsigned int adjacency_list_size;
    unsigned int adjacency_count;
@@ -155,6 +164,9 @@ struct ra_node {
     * approximate cost of spilling this node.
     */
    float spill_cost;
+
+   /** Index of the node in ra_graph::heap, or NO_HEAP_POS. */
+   unsigned int heap_pos;
 };
 
 struct ra_graph {
@@ -165,6 +177,27 @@ struct ra_graph {
    struct ra_node *nodes;
    unsigned int count; /**< count of nodes. */
 
+   /**
+    * Set when interferences were added since the adjacency lists were last
+    * rid of duplicates and the q totals computed.
+    */
+   bool adjacency_dirty;
+
+   /**
+    * For each node, the value of adjacency_stamp when it was last seen in
+    * the adjacency list being rid of duplicates.
+    */
+   unsigned int *adjacency_seen;
+   unsigned int adjacency_stamp;
+
+   /**
+    * During ra_simplify(), the nodes left in the graph that aren't
+    * trivially colorable, which may have to be pushed optimistically, as a
+    * binary heap with the lowest q total first.
+    */
+   unsigned int *heap;
+   unsigned int heap_count;
+
    unsigned int *stack;
    unsigned int stack_count;
 
@@ -390,23 +423,55 @@ ra_set_finalize(struct ra_regs *regs, unsigned int **q_values)
    }
 }
 
+/**
+ * Drops the duplicate interferences from the adjacency list of node n,
+ * keeping the first one.
+ */
 static void
-ra_add_node_adjacency(struct ra_graph *g, unsigned int n1, unsigned int n2)
+ra_compact_adjacency(struct ra_graph *g, unsigned int n)
 {
-   BITSET_SET(g->nodes[n1].adjacency, n2);
+   struct ra_node *node = &g->nodes[n];
+   unsigned int count = 0, i;
 
-   assert(n1 != n2);
+   if (++g->adjacency_stamp == 0) {
+      memset(g->adjacency_seen, 0, g->count * sizeof(*g->adjacency_seen));
+      g->adjacency_stamp = 1;
+   }
 
-   int n1_class = g->nodes[n1].class;
-   int n2_class = g->nodes[n2].class;
-   g->nodes[n1].q_total += g->regs->classes[n1_class]->q[n2_class];
+   for (i = 0; i < node->adjacency_count; i++) {
+      unsigned int n2 = node->adjacency_list[i];
+
+      if (g->adjacency_seen[n2] == g->adjacency_stamp)
+         continue;
+
+      g->adjacency_seen[n2] = g->adjacency_stamp;
+      node->adjacency_list[count++] = n2;
+   }
+
+   node->adjacency_count = count;
+}
+
+static void
+ra_add_node_adjacency(struct ra_graph *g, unsigned int n1, unsigned int n2)
+{
+   assert(n1 != n2);
 
    if (g->nodes[n1].adjacency_count >=
        g->nodes[n1].adjacency_list_size) {
-      g->nodes[n1].adjacency_list_size *= 2;
-      g->nodes[n1].adjacency_list = reralloc(g, g->nodes[n1].adjacency_list,
-                                             unsigned int,
-                                             g->nodes[n1].adjacency_list_size);
+      /* Backends may add the same interference many times, so only grow
+       * the list if it is still half full without the duplicates.  That
+       * keeps it within four times the number of distinct interferences,
+       * and each compaction follows at least half a list of additions.
+       */
+      ra_compact_adjacency(g, n1);
+
+      if (g->nodes[n1].adjacency_count >=
+          g->nodes[n1].adjacency_list_size / 2) {
+         g->nodes[n1].adjacency_list_size *= 2;
+         g->nodes[n1].adjacency_list = reralloc(g, g->nodes[n1].adjacency_list,
+                                                unsigned int,
+                                                g->nodes[n1].adjacency_list_size);
+      }
    }
 
    g->nodes[n1].adjacency_list[g->nodes[n1].adjacency_count] = n2;
@@ -425,11 +490,9 @@ ra_alloc_interference_graph(struct ra_regs *regs, unsigned int count)
    g->count = count;
 
    g->stack = rzalloc_array(g, unsigned int, count);
+   g->adjacency_seen = rzalloc_array(g, unsigned int, count);
 
    for (i = 0; i < count; i++) {
-      int bitset_count = BITSET_WORDS(count);
-      g->nodes[i].adjacency = rzalloc_array(g, BITSET_WORD, bitset_count);
-
       g->nodes[i].adjacency_list_size = 4;
       g->nodes[i].adjacency_list =
          ralloc_array(g, unsigned int, g->nodes[i].adjacency_list_size);
@@ -437,6 +500,7 @@ ra_alloc_interference_graph(struct ra_regs *regs, unsigned int count)
       g->nodes[i].q_total = 0;
 
       g->nodes[i].reg = NO_REG;
+      g->nodes[i].heap_pos = NO_HEAP_POS;
    }
 
    return g;
@@ -463,10 +527,43 @@ void
 ra_add_node_interference(struct ra_graph *g,
                          unsigned int n1, unsigned int n2)
 {
-   if (n1 != n2 && !BITSET_TEST(g->nodes[n1].adjacency, n2)) {
+   if (n1 != n2) {
       ra_add_node_adjacency(g, n1, n2);
       ra_add_node_adjacency(g, n2, n1);
+      g->adjacency_dirty = true;
+   }
+}
+
+/**
+ * Drops the duplicate interferences left in the adjacency lists and
+ * computes the q totals.
+ *
+ * This is cheaper than looking up every interference as it is added, which
+ * would take a bitset of all the nodes per node or a hash set of the edges.
+ */
+static void
+ra_finalize_adjacency(struct ra_graph *g)
+{
+   unsigned int n, i;
+
+   if (!g->adjacency_dirty)
+      return;
+
+   for (n = 0; n < g->count; n++) {
+      struct ra_node *node = &g->nodes[n];
+      struct ra_class *n_class = g->regs->classes[node->class];
+
+      ra_compact_adjacency(g, n);
+
+      node->q_total = 0;
+      for (i = 0; i < node->adjacency_count; i++) {
+         unsigned int n2 = node->adjacency_list[i];
+
+         node->q_total += n_class->q[g->nodes[n2].class];
+      }
    }
+
+   g->adjacency_dirty = false;
 }
 
 static bool
@@ -477,12 +574,119 @@ pq_test(struct ra_graph *g, unsigned int n)
    return g->nodes[n].q_total < g->regs->classes[n_class]->p;
 }
 
+/**
+ * Returns whether node a comes before node b in the heap: lowest q total
+ * first and, on ties, highest numbered first.
+ */
+static bool
+ra_heap_less(struct ra_graph *g, unsigned int a, unsigned int b)
+{
+   return g->nodes[a].q_total < g->nodes[b].q_total ||
+          (g->nodes[a].q_total == g->nodes[b].q_total && a > b);
+}
+
+static void
+ra_heap_set(struct ra_graph *g, unsigned int pos, unsigned int n)
+{
+   g->heap[pos] = n;
+   g->nodes[n].heap_pos = pos;
+}
+
 static void
-decrement_q(struct ra_graph *g, unsigned int n)
+ra_heap_sift_up(struct ra_graph *g, unsigned int pos)
+{
+   unsigned int n = g->heap[pos];
+
+   while (pos > 0) {
+      unsigned int parent = (pos - 1) / 2;
+
+      if (!ra_heap_less(g, n, g->heap[parent]))
+         break;
+
+      ra_heap_set(g, pos, g->heap[parent]);
+      pos = parent;
+   }
+
+   ra_heap_set(g, pos, n);
+}
+
+static void
+ra_heap_sift_down(struct ra_graph *g, unsigned int pos)
+{
+   unsigned int n = g->heap[pos];
+
+   for (;;) {
+      unsigned int child = pos * 2 + 1;
+
+      if (child >= g->heap_count)
+         break;
+
+      if (child + 1 < g->heap_count &&
+          ra_heap_less(g, g->heap[child + 1], g->heap[child]))
+         child++;
+
+      if (!ra_heap_less(g, g->heap[child], n))
+         break;
+
+      ra_heap_set(g, pos, g->heap[child]);
+      pos = child;
+   }
+
+   ra_heap_set(g, pos, n);
+}
+
+static void
+ra_heap_remove(struct ra_graph *g, unsigned int n)
+{
+   unsigned int pos = g->nodes[n].heap_pos;
+   unsigned int last = g->heap[--g->heap_count];
+
+   g->nodes[n].heap_pos = NO_HEAP_POS;
+
+   if (last != n) {
+      ra_heap_set(g, pos, last);
+      ra_heap_sift_up(g, pos);
+      ra_heap_sift_down(g, g->nodes[last].heap_pos);
+   }
+}
+
+/**
+ * Returns the highest numbered node up to n in the set of trivially
+ * colorable nodes, or -1.
+ */
+static int
+ra_find_last_ready(const BITSET_WORD *ready, int n)
+{
+   int w = n / BITSET_WORDBITS;
+   BITSET_WORD word =
+      ready[w] & (~0u >> (BITSET_WORDBITS - 1 - n % BITSET_WORDBITS));
+
+   for (;;) {
+      if (word)
+         return w * BITSET_WORDBITS + util_last_bit(word) - 1;
+      if (--w < 0)
+         return -1;
+      word = ready[w];
+   }
+}
+
+/**
+ * Removes node n from the graph and pushes it on the stack, updating the q
+ * totals of its neighbors and moving those which become trivially colorable
+ * from the heap to the ready set.
+ */
+static void
+ra_push_node(struct ra_graph *g, unsigned int n, BITSET_WORD *ready)
 {
    unsigned int i;
    int n_class = g->nodes[n].class;
 
+   if (g->nodes[n].heap_pos != NO_HEAP_POS)
+      ra_heap_remove(g, n);
+   g->stack[g->stack_count] = n;
+   g->stack_count++;
+   g->nodes[n].in_stack = true;
+
    for (i = 0; i < g->nodes[n].adjacency_count; i++) {
       unsigned int n2 = g->nodes[n].adjacency_list[i];
       unsigned int n2_class = g->nodes[n2].class;
@@ -490,6 +694,15 @@ decrement_q(struct ra_graph *g, unsigned int n)
       if (!g->nodes[n2].in_stack) {
          assert(g->nodes[n2].q_total >= g->regs->classes[n2_class]->q[n_class]);
          g->nodes[n2].q_total -= g->regs->classes[n2_class]->q[n_class];
+
+         if (g->nodes[n2].heap_pos != NO_HEAP_POS) {
+            if (pq_test(g, n2)) {
+               ra_heap_remove(g, n2);
+               BITSET_SET(ready, n2);
+            } else {
+               ra_heap_sift_up(g, g->nodes[n2].heap_pos);
+            }
+         }
       }
    }
 }
@@ -503,69 +716,69 @@ decrement_q(struct ra_graph *g, unsigned int n)
  * we optimistically choose a node and push it on the stack. We heuristically
  * push the node with the lowest total q value, since it has the fewest
  * neighbors and therefore is most likely to be allocated.
+ *
+ * Each pass pushes the trivially colorable nodes from the highest numbered
+ * down, those becoming trivially colorable below the current one included.
+ * When there are none left, the optimistic choice is the first node of the
+ * heap.
  */
 static void
 ra_simplify(struct ra_graph *g)
 {
-   bool progress = true;
    unsigned int stack_optimistic_start = UINT_MAX;
-   int i;
-
-   while (progress) {
-      unsigned int best_optimistic_node = ~0;
-      unsigned int lowest_q_total = ~0;
-
-      progress = false;
-
-      for (i = g->count - 1; i >= 0; i--) {
-	 if (g->nodes[i].in_stack || g->nodes[i].reg != NO_REG)
-	    continue;
-
-	 if (pq_test(g, i)) {
-	    decrement_q(g, i);
-	    g->stack[g->stack_count] = i;
-	    g->stack_count++;
-	    g->nodes[i].in_stack = true;
-	    progress = true;
-	 } else {
-	    unsigned int new_q_total = g->nodes[i].q_total;
-	    if (new_q_total < lowest_q_total) {
-	       best_optimistic_node = i;
-	       lowest_q_total = new_q_total;
-	    }
-	 }
-      }
-
-      if (!progress && best_optimistic_node != ~0U) {
-         if (stack_optimistic_start == UINT_MAX)
-            stack_optimistic_start = g->stack_count;
+   BITSET_WORD *ready;
+   unsigned int i;
 
-	 decrement_q(g, best_optimistic_node);
-	 g->stack[g->stack_count] = best_optimistic_node;
-	 g->stack_count++;
-	 g->nodes[best_optimistic_node].in_stack = true;
-	 progress = true;
-      }
+   if (g->count == 0) {
+      g->stack_optimistic_start = stack_optimistic_start;
+      return;
    }
 
-   g->stack_optimistic_start = stack_optimistic_start;
-}
+   ready = rzalloc_array(g, BITSET_WORD, BITSET_WORDS(g->count));
+   g->heap = ralloc_array(g, unsigned int, g->count);
+   g->heap_count = 0;
 
-static bool
-ra_any_neighbors_conflict(struct ra_graph *g, unsigned int n, unsigned int r)
-{
-   unsigned int i;
+   for (i = 0; i < g->count; i++) {
+      if (g->nodes[i].in_stack || g->nodes[i].reg != NO_REG)
+         continue;
 
-   for (i = 0; i < g->nodes[n].adjacency_count; i++) {
-      unsigned int n2 = g->nodes[n].adjacency_list[i];
+      if (pq_test(g, i))
+         BITSET_SET(ready, i);
+      else
+         ra_heap_set(g, g->heap_count++, i);
+   }
+   for (i = g->heap_count / 2; i-- > 0;)
+      ra_heap_sift_down(g, i);
+
+   for (;;) {
+      bool progress = false;
+      int n = g->count - 1;
+
+      while ((n = ra_find_last_ready(ready, n)) >= 0) {
+         BITSET_CLEAR(ready, n);
+         ra_push_node(g, n, ready);
+         progress = true;
+         n--;
+         if (n < 0)
+            break;
+      }
 
-      if (!g->nodes[n2].in_stack &&
-          BITSET_TEST(g->regs->regs[r].conflicts, g->nodes[n2].reg)) {
-         return true;
+      if (!progress) {
+         if (g->heap_count == 0)
+            break;
+
+         if (stack_optimistic_start == UINT_MAX)
+            stack_optimistic_start = g->stack_count;
+
+         ra_push_node(g, g->heap[0], ready);
       }
    }
 
-   return false;
+   ralloc_free(g->heap);
+   g->heap = NULL;
+   ralloc_free(ready);
+
+   g->stack_optimistic_start = stack_optimistic_start;
 }
 
 /* Computes a bitfield of what regs are available for a given register
@@ -614,28 +827,26 @@ static bool
 ra_select(struct ra_graph *g)
 {
    int start_search_reg = 0;
-   BITSET_WORD *select_regs = NULL;
+   BITSET_WORD *select_regs;
 
-   if (g->select_reg_callback)
-      select_regs = malloc(BITSET_WORDS(g->regs->count) * sizeof(BITSET_WORD));
+   select_regs = malloc(BITSET_WORDS(g->regs->count) * sizeof(BITSET_WORD));
 
    while (g->stack_count != 0) {
       unsigned int ri;
       unsigned int r = -1;
       int n = g->stack[g->stack_count - 1];
-      struct ra_class *c = g->regs->classes[g->nodes[n].class];
 
       /* set this to false even if we return here so that
        * ra_get_best_spill_node() considers this node later.
        */
       g->nodes[n].in_stack = false;
 
-      if (g->select_reg_callback) {
-         if (!ra_compute_available_regs(g, n, select_regs)) {
-            free(select_regs);
-            return false;
-         }
+      if (!ra_compute_available_regs(g, n, select_regs)) {
+         free(select_regs);
+         return false;
+      }
 
+      if (g->select_reg_callback) {
          r = g->select_reg_callback(g, select_regs, g->select_reg_callback_data);
       } else {
          /* Find the lowest-numbered reg which is not used by a member
@@ -643,15 +854,9 @@ ra_select(struct ra_graph *g)
           */
          for (ri = 0; ri < g->regs->count; ri++) {
             r = (start_search_reg + ri) % g->regs->count;
-            if (!reg_belongs_to_class(r, c))
-               continue;
-
-            if (!ra_any_neighbors_conflict(g, n, r))
+            if (BITSET_TEST(select_regs, r))
                break;
          }
-
-         if (ri >= g->regs->count)
-            return false;
       }
 
       g->nodes[n].reg = r;
@@ -679,6 +884,7 @@ ra_select(struct ra_graph *g)
 bool
 ra_allocate(struct ra_graph *g)
 {
+   ra_finalize_adjacency(g);
    ra_simplify(g);
    return ra_select(g);
 }
@@ -742,6 +948,8 @@ ra_get_best_spill_node(struct ra_graph *g)
    float best_benefit = 0.0;
    unsigned int n;
 
+   ra_finalize_adjacency(g);
+
    /* Consider any nodes that we colored successfully or the node we failed to
     * color for spilling. When we failed to color a node in ra_select(), we
     * only considered these nodes, so spilling any other ones would not result
@@ -0,0 +1,192 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Measures util_queue with many small jobs, like draw calls offloaded to
+ * worker threads: the throughput of 1 to 8 threads with jobs added one at a
+ * time and in batches, the round trip of a job the caller waits for, and the
+ * latency of a high priority job added behind a backlog of low priority ones.
+ *
+ * Usage: queue_bench [jobs] [work per job]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "util/os_time.h"
+#include "util/u_queue.h"
+
+struct bench_job {
+   struct util_queue_fence fence;
+   unsigned work;
+   unsigned result;
+};
+
+static void
+execute_job(void *data, int thread_index)
+{
+   struct bench_job *job = (struct bench_job *) data;
+   unsigned x = job->work;
+
+   for (unsigned i = 0; i < job->work; i++)
+      x = x * 1103515245 + 12345;
+   job->result = x;
+}
+
+static void
+init_jobs(std::vector<bench_job> &jobs, unsigned work)
+{
+   for (struct bench_job &job : jobs) {
+      util_queue_fence_init(&job.fence);
+      job.work = work;
+   }
+}
+
+static void
+destroy_jobs(std::vector<bench_job> &jobs)
+{
+   for (struct bench_job &job : jobs)
+      util_queue_fence_destroy(&job.fence);
+}
+
+static void
+bench_throughput(unsigned num_jobs, unsigned work, bool batched)
+{
+   std::vector<bench_job> jobs(num_jobs);
+   std::vector<struct util_queue_job> batch;
+
+   init_jobs(jobs, work);
+   for (struct bench_job &job : jobs)
+      batch.push_back({ &job, &job.fence, execute_job, NULL });
+
+   for (unsigned num_threads = 1; num_threads <= 8; num_threads *= 2) {
+      struct util_queue queue;
+
+      if (!util_queue_init(&queue, "bench", 256, num_threads, 0))
+         exit(1);
+
+      int64_t start = os_time_get_nano();
+
+      if (batched) {
+         for (unsigned i = 0; i < num_jobs; i += 32) {
+            util_queue_add_jobs(&queue, &batch[i], MIN2(32, num_jobs - i),
+                                UTIL_QUEUE_PRIORITY_NORMAL);
+         }
+      } else {
+         for (struct bench_job &job : jobs) {
+            util_queue_add_job(&queue, &job, &job.fence, execute_job, NULL);
+         }
+      }
+      util_queue_finish(&queue);
+
+      double secs = (os_time_get_nano() - start) / 1e9;
+      printf("%-24s %u threads: %8.3f M jobs/s\n",
+             batched ? "throughput, batched" : "throughput",
+             num_threads, num_jobs / secs / 1e6);
+
+      util_queue_destroy(&queue);
+   }
+
+   destroy_jobs(jobs);
+}
+
+static void
+bench_round_trip(unsigned num_jobs, unsigned num_threads)
+{
+   struct util_queue queue;
+   struct bench_job job;
+
+   if (!util_queue_init(&queue, "bench", 256, num_threads, 0))
+      exit(1);
+
+   util_queue_fence_init(&job.fence);
+   job.work = 0;
+
+   int64_t start = os_time_get_nano();
+
+   for (unsigned i = 0; i < num_jobs; i++) {
+      util_queue_add_job(&queue, &job, &job.fence, execute_job, NULL);
+      util_queue_fence_wait(&job.fence);
+   }
+
+   printf("%-24s %u threads: %8.3f us/job\n", "round trip", num_threads,
+          (os_time_get_nano() - start) / 1000.0 / num_jobs);
+
+   util_queue_fence_destroy(&job.fence);
+   util_queue_destroy(&queue);
+}
+
+static void
+bench_high_priority(unsigned num_jobs, unsigned work, unsigned num_threads)
+{
+   std::vector<bench_job> jobs(num_jobs);
+   struct util_queue queue;
+   struct bench_job high;
+
+   if (!util_queue_init(&queue, "bench", num_jobs + 1, num_threads, 0))
+      exit(1);
+
+   init_jobs(jobs, work);
+   util_queue_fence_init(&high.fence);
+   high.work = work;
+
+   for (struct bench_job &job : jobs) {
+      util_queue_add_job_with_priority(&queue, &job, &job.fence, execute_job,
+                                       NULL, UTIL_QUEUE_PRIORITY_LOW);
+   }
+
+   int64_t start = os_time_get_nano();
+
+   util_queue_add_job_with_priority(&queue, &high, &high.fence, execute_job,
+                                    NULL, UTIL_QUEUE_PRIORITY_HIGH);
+   util_queue_fence_wait(&high.fence);
+
+   printf("%-24s %u threads: %8.3f us behind %u jobs\n", "high priority",
+          num_threads, (os_time_get_nano() - start) / 1000.0, num_jobs);
+
+   util_queue_finish(&queue);
+   util_queue_fence_destroy(&high.fence);
+   destroy_jobs(jobs);
+   util_queue_destroy(&queue);
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned num_jobs = argc > 1 ? atoi(argv[1]) : 200000;
+   unsigned work = argc > 2 ? atoi(argv[2]) : 100;
+
+   if (num_jobs == 0)
+      return 1;
+
+   printf("%u jobs, %u iterations of work per job\n", num_jobs, work);
+
+   bench_throughput(num_jobs, work, false);
+   bench_throughput(num_jobs, work, true);
+   bench_round_trip(num_jobs / 10, 1);
+   bench_round_trip(num_jobs / 10, 4);
+   bench_high_priority(MIN2(num_jobs, 10000), work * 10, 1);
+   bench_high_priority(MIN2(num_jobs, 10000), work * 10, 4);
+
+   return 0;
+}
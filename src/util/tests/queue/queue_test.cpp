@@ -0,0 +1,319 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+#include <vector>
+
+#include "util/u_queue.h"
+
+namespace {
+
+struct test_job {
+   struct util_queue_fence fence;
+   struct util_queue_fence *started; /* signalled when executing, if any */
+   struct util_queue_fence *gate; /* waited for before executing, if any */
+   std::vector<unsigned> *order; /* where executed jobs are recorded */
+   unsigned id;
+   int executed;
+   int cleaned_up;
+};
+
+static void
+execute_job(void *data, int thread_index)
+{
+   struct test_job *job = (struct test_job *) data;
+
+   if (job->started)
+      util_queue_fence_signal(job->started);
+   if (job->gate)
+      util_queue_fence_wait(job->gate);
+   if (job->order)
+      job->order->push_back(job->id);
+   p_atomic_inc(&job->executed);
+}
+
+static void
+cleanup_job(void *data, int thread_index)
+{
+   struct test_job *job = (struct test_job *) data;
+
+   p_atomic_inc(&job->cleaned_up);
+}
+
+class util_queue_test : public ::testing::Test {
+protected:
+   virtual void TearDown()
+   {
+      if (util_queue_is_initialized(&queue))
+         util_queue_destroy(&queue);
+      for (struct test_job &job : jobs)
+         util_queue_fence_destroy(&job.fence);
+      if (gate_used)
+         util_queue_fence_destroy(&gate);
+   }
+
+   void init(unsigned max_jobs, unsigned num_threads, unsigned flags,
+             unsigned num_jobs)
+   {
+      memset(&queue, 0, sizeof(queue));
+      ASSERT_TRUE(util_queue_init(&queue, "test", max_jobs, num_threads,
+                                  flags));
+      jobs.resize(num_jobs);
+      for (unsigned i = 0; i < num_jobs; i++) {
+         memset(&jobs[i], 0, sizeof(jobs[i]));
+         util_queue_fence_init(&jobs[i].fence);
+         jobs[i].id = i;
+      }
+   }
+
+   /* Makes the given job wait for release_gate(). */
+   void close_gate(unsigned i)
+   {
+      if (!gate_used) {
+         util_queue_fence_init(&gate);
+         util_queue_fence_reset(&gate);
+         gate_used = true;
+      }
+      jobs[i].gate = &gate;
+   }
+
+   void release_gate()
+   {
+      util_queue_fence_signal(&gate);
+   }
+
+   void add(unsigned i, enum util_queue_priority priority)
+   {
+      util_queue_add_job_with_priority(&queue, &jobs[i], &jobs[i].fence,
+                                       execute_job, cleanup_job, priority);
+   }
+
+   void check_all_executed()
+   {
+      for (struct test_job &job : jobs) {
+         EXPECT_TRUE(util_queue_fence_is_signalled(&job.fence));
+         EXPECT_EQ(1, job.executed);
+         EXPECT_EQ(1, job.cleaned_up);
+      }
+   }
+
+   struct util_queue queue;
+   struct util_queue_fence gate;
+   bool gate_used = false;
+   std::vector<test_job> jobs;
+};
+
+} /* anonymous namespace */
+
+TEST_F(util_queue_test, fences)
+{
+   init(64, 4, 0, 1000);
+
+   for (unsigned i = 0; i < jobs.size(); i++)
+      add(i, UTIL_QUEUE_PRIORITY_NORMAL);
+   for (struct test_job &job : jobs)
+      util_queue_fence_wait(&job.fence);
+
+   util_queue_finish(&queue);
+   check_all_executed();
+}
+
+TEST_F(util_queue_test, single_thread_order)
+{
+   std::vector<unsigned> order;
+
+   init(64, 1, 0, 1000);
+   for (struct test_job &job : jobs)
+      job.order = &order;
+
+   for (unsigned i = 0; i < jobs.size(); i++)
+      add(i, UTIL_QUEUE_PRIORITY_NORMAL);
+   util_queue_finish(&queue);
+
+   check_all_executed();
+   ASSERT_EQ(jobs.size(), order.size());
+   for (unsigned i = 0; i < order.size(); i++)
+      EXPECT_EQ(i, order[i]);
+}
+
+TEST_F(util_queue_test, priorities)
+{
+   static const enum util_queue_priority priorities[] = {
+      UTIL_QUEUE_PRIORITY_LOW,
+      UTIL_QUEUE_PRIORITY_NORMAL,
+      UTIL_QUEUE_PRIORITY_HIGH,
+   };
+   std::vector<unsigned> order;
+
+   init(64, 1, 0, 1 + 3 * 10);
+   for (struct test_job &job : jobs)
+      job.order = &order;
+
+   /* Keep the thread busy until all jobs are queued. */
+   struct util_queue_fence started;
+   util_queue_fence_init(&started);
+   util_queue_fence_reset(&started);
+   jobs[0].started = &started;
+   close_gate(0);
+   add(0, UTIL_QUEUE_PRIORITY_NORMAL);
+   util_queue_fence_wait(&started);
+   util_queue_fence_destroy(&started);
+   for (unsigned i = 1; i < jobs.size(); i++)
+      add(i, priorities[(i - 1) % 3]);
+   release_gate();
+   util_queue_finish(&queue);
+
+   /* The highest priority first, in the order they were added. */
+   check_all_executed();
+   ASSERT_EQ(jobs.size(), order.size());
+   EXPECT_EQ(0u, order[0]);
+   for (unsigned p = 0; p < 3; p++) {
+      for (unsigned i = 0; i < 10; i++)
+         EXPECT_EQ(1 + (2 - p) + i * 3, order[1 + p * 10 + i]);
+   }
+}
+
+TEST_F(util_queue_test, add_jobs)
+{
+   std::vector<struct util_queue_job> batch;
+   std::vector<unsigned> order;
+
+   init(64, 1, 0, 500);
+   for (struct test_job &job : jobs) {
+      job.order = &order;
+      batch.push_back({ &job, &job.fence, execute_job, cleanup_job });
+   }
+
+   /* More jobs than max_jobs are added at once. */
+   util_queue_add_jobs(&queue, batch.data(), batch.size(),
+                       UTIL_QUEUE_PRIORITY_NORMAL);
+   util_queue_finish(&queue);
+
+   check_all_executed();
+   ASSERT_EQ(jobs.size(), order.size());
+   for (unsigned i = 0; i < order.size(); i++)
+      EXPECT_EQ(i, order[i]);
+}
+
+TEST_F(util_queue_test, add_jobs_threads)
+{
+   std::vector<struct util_queue_job> batch;
+
+   init(64, 4, 0, 1000);
+   for (struct test_job &job : jobs)
+      batch.push_back({ &job, &job.fence, execute_job, cleanup_job });
+
+   for (unsigned i = 0; i < batch.size(); i += 7) {
+      util_queue_add_jobs(&queue, &batch[i], MIN2(7, batch.size() - i),
+                          UTIL_QUEUE_PRIORITY_NORMAL);
+   }
+   util_queue_finish(&queue);
+
+   check_all_executed();
+}
+
+TEST_F(util_queue_test, stealing)
+{
+   init(64, 4, 0, 200);
+
+   /* The first job blocks its thread, so the other threads must steal the
+    * jobs added to it.
+    */
+   close_gate(0);
+   for (unsigned i = 0; i < jobs.size(); i++)
+      add(i, UTIL_QUEUE_PRIORITY_NORMAL);
+   for (unsigned i = 1; i < jobs.size(); i++)
+      util_queue_fence_wait(&jobs[i].fence);
+
+   EXPECT_FALSE(util_queue_fence_is_signalled(&jobs[0].fence));
+   release_gate();
+   util_queue_finish(&queue);
+   check_all_executed();
+}
+
+TEST_F(util_queue_test, drop_job)
+{
+   init(64, 1, 0, 3);
+
+   close_gate(0);
+   add(0, UTIL_QUEUE_PRIORITY_NORMAL);
+   add(1, UTIL_QUEUE_PRIORITY_NORMAL);
+   add(2, UTIL_QUEUE_PRIORITY_LOW);
+
+   /* Queued jobs are removed and only cleaned up. */
+   util_queue_drop_job(&queue, &jobs[1].fence);
+   util_queue_drop_job(&queue, &jobs[2].fence);
+   EXPECT_TRUE(util_queue_fence_is_signalled(&jobs[1].fence));
+   EXPECT_TRUE(util_queue_fence_is_signalled(&jobs[2].fence));
+   EXPECT_EQ(1, jobs[2].cleaned_up);
+
+   release_gate();
+   util_queue_finish(&queue);
+   EXPECT_EQ(1, jobs[0].executed);
+   EXPECT_EQ(0, jobs[1].executed);
+   EXPECT_EQ(0, jobs[2].executed);
+   EXPECT_EQ(1, jobs[1].cleaned_up);
+}
+
+TEST_F(util_queue_test, full_queue)
+{
+   init(4, 2, 0, 1000);
+
+   /* Adding waits for free slots. */
+   for (unsigned i = 0; i < jobs.size(); i++)
+      add(i, (enum util_queue_priority) (i % 3));
+   util_queue_finish(&queue);
+
+   check_all_executed();
+}
+
+TEST_F(util_queue_test, resize_if_full)
+{
+   init(4, 2, UTIL_QUEUE_INIT_RESIZE_IF_FULL, 1000);
+
+   /* Adding doesn't wait for free slots. */
+   close_gate(0);
+   close_gate(1);
+   for (unsigned i = 0; i < jobs.size(); i++)
+      add(i, UTIL_QUEUE_PRIORITY_NORMAL);
+   release_gate();
+   util_queue_finish(&queue);
+
+   check_all_executed();
+}
+
+TEST_F(util_queue_test, destroy_with_queued_jobs)
+{
+   init(64, 2, 0, 100);
+
+   close_gate(0);
+   for (unsigned i = 0; i < jobs.size(); i++)
+      add(i, UTIL_QUEUE_PRIORITY_NORMAL);
+   release_gate();
+
+   /* All fences are signalled, whether the jobs were executed or not. */
+   util_queue_destroy(&queue);
+   memset(&queue, 0, sizeof(queue));
+   for (struct test_job &job : jobs)
+      EXPECT_TRUE(util_queue_fence_is_signalled(&job.fence));
+}
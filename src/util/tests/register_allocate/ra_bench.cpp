@@ -0,0 +1,146 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/* Measures register allocation on large interference graphs: random graphs,
+ * and graphs of the live ranges of long straight-line programs, which look
+ * like the ones of big compute shaders, with a register file of 128 single
+ * registers and aligned pairs of them.
+ *
+ * Usage: ra_bench [nodes]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "util/os_time.h"
+#include "util/ralloc.h"
+#include "util/register_allocate.h"
+
+#define NUM_REGS 128
+
+static struct ra_regs *regs;
+static unsigned single, pair;
+
+static void
+create_reg_set(void)
+{
+   regs = ra_alloc_reg_set(NULL, NUM_REGS + NUM_REGS / 2, true);
+
+   single = ra_alloc_reg_class(regs);
+   for (unsigned r = 0; r < NUM_REGS; r++)
+      ra_class_add_reg(regs, single, r);
+
+   pair = ra_alloc_reg_class(regs);
+   for (unsigned i = 0; i < NUM_REGS / 2; i++) {
+      ra_class_add_reg(regs, pair, NUM_REGS + i);
+      ra_add_transitive_reg_conflict(regs, i * 2, NUM_REGS + i);
+      ra_add_transitive_reg_conflict(regs, i * 2 + 1, NUM_REGS + i);
+   }
+
+   ra_set_finalize(regs, NULL);
+}
+
+static struct ra_graph *
+create_graph(unsigned count)
+{
+   struct ra_graph *g = ra_alloc_interference_graph(regs, count);
+
+   for (unsigned n = 0; n < count; n++) {
+      ra_set_node_class(g, n, rand() % 4 ? single : pair);
+      ra_set_node_spill_cost(g, n, 1.0 + rand() % 100);
+   }
+
+   return g;
+}
+
+static void
+bench(const char *name, struct ra_graph *g, int64_t start)
+{
+   int64_t built = os_time_get_nano();
+   bool success = ra_allocate(g);
+   int64_t allocated = os_time_get_nano();
+
+   if (!success)
+      ra_get_best_spill_node(g);
+
+   printf("%-32s build %8.2f ms, allocate %8.2f ms%s\n", name,
+          (built - start) / 1e6, (allocated - built) / 1e6,
+          success ? "" : ", spilled");
+
+   ralloc_free(g);
+}
+
+/* Each value lives for up to max_live instructions after its definition. */
+static void
+bench_live_ranges(unsigned count, unsigned max_live)
+{
+   char name[64];
+   int64_t start = os_time_get_nano();
+   struct ra_graph *g = create_graph(count);
+
+   for (unsigned n = 0; n < count; n++) {
+      unsigned end = n + 1 + rand() % max_live;
+
+      for (unsigned m = n + 1; m < count && m < end; m++)
+         ra_add_node_interference(g, n, m);
+   }
+
+   snprintf(name, sizeof(name), "live ranges, up to %u", max_live);
+   bench(name, g, start);
+}
+
+static void
+bench_random(unsigned count, unsigned degree)
+{
+   char name[64];
+   int64_t start = os_time_get_nano();
+   struct ra_graph *g = create_graph(count);
+
+   for (unsigned e = 0; e < count * degree / 2; e++)
+      ra_add_node_interference(g, rand() % count, rand() % count);
+
+   snprintf(name, sizeof(name), "random, degree %u", degree);
+   bench(name, g, start);
+}
+
+int
+main(int argc, char **argv)
+{
+   unsigned count = argc > 1 ? atoi(argv[1]) : 50000;
+
+   if (count == 0)
+      return 1;
+
+   srand(1);
+   create_reg_set();
+   printf("%u nodes\n", count);
+
+   bench_live_ranges(count, NUM_REGS / 4);
+   bench_live_ranges(count, NUM_REGS);
+   bench_random(count, 16);
+   bench_random(count, 128);
+
+   ralloc_free(regs);
+
+   return 0;
+}
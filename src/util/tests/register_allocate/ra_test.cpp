@@ -0,0 +1,268 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <utility>
+#include <vector>
+
+#include "util/ralloc.h"
+#include "util/register_allocate.h"
+
+#define NUM_REGS 64
+
+namespace {
+
+/* A register file of NUM_REGS registers with a class of single registers
+ * and a class of aligned pairs of them, as the Intel backend sets it up.
+ */
+class ra_test : public ::testing::Test {
+protected:
+   virtual void SetUp()
+   {
+      mem_ctx = ralloc_context(NULL);
+      regs = ra_alloc_reg_set(mem_ctx, NUM_REGS + NUM_REGS / 2, true);
+
+      single = ra_alloc_reg_class(regs);
+      for (unsigned r = 0; r < NUM_REGS; r++)
+         ra_class_add_reg(regs, single, r);
+
+      pair = ra_alloc_reg_class(regs);
+      for (unsigned i = 0; i < NUM_REGS / 2; i++) {
+         unsigned r = NUM_REGS + i;
+
+         ra_class_add_reg(regs, pair, r);
+         ra_add_transitive_reg_conflict(regs, i * 2, r);
+         ra_add_transitive_reg_conflict(regs, i * 2 + 1, r);
+      }
+
+      ra_set_finalize(regs, NULL);
+   }
+
+   virtual void TearDown()
+   {
+      ralloc_free(mem_ctx);
+   }
+
+   struct ra_graph *create_graph(unsigned count,
+                                 const std::vector<unsigned> &classes)
+   {
+      struct ra_graph *g = ra_alloc_interference_graph(regs, count);
+
+      ralloc_steal(mem_ctx, g);
+      for (unsigned n = 0; n < count; n++)
+         ra_set_node_class(g, n, classes[n]);
+
+      return g;
+   }
+
+   /* The registers of each node of the pair interfering with each other. */
+   bool conflict(unsigned r1, unsigned r2)
+   {
+      for (unsigned r = 0; r < NUM_REGS; r++) {
+         if (covers(r1, r) && covers(r2, r))
+            return true;
+      }
+      return false;
+   }
+
+   bool covers(unsigned reg, unsigned base)
+   {
+      if (reg < NUM_REGS)
+         return reg == base;
+      return (reg - NUM_REGS) * 2 == base || (reg - NUM_REGS) * 2 + 1 == base;
+   }
+
+   void check_allocation(struct ra_graph *g, const std::vector<unsigned> &classes,
+                         const std::vector<std::pair<unsigned, unsigned> > &edges)
+   {
+      for (unsigned n = 0; n < classes.size(); n++) {
+         unsigned r = ra_get_node_reg(g, n);
+
+         if (classes[n] == single)
+            ASSERT_LT(r, (unsigned) NUM_REGS);
+         else
+            ASSERT_GE(r, (unsigned) NUM_REGS);
+      }
+
+      for (auto edge : edges) {
+         ASSERT_FALSE(conflict(ra_get_node_reg(g, edge.first),
+                               ra_get_node_reg(g, edge.second)))
+            << "nodes " << edge.first << " and " << edge.second;
+      }
+   }
+
+   void *mem_ctx;
+   struct ra_regs *regs;
+   unsigned single, pair;
+};
+
+} /* anonymous namespace */
+
+TEST_F(ra_test, clique)
+{
+   std::vector<unsigned> classes(NUM_REGS, single);
+   std::vector<std::pair<unsigned, unsigned> > edges;
+   struct ra_graph *g = create_graph(NUM_REGS, classes);
+
+   /* Adding the edges twice mustn't count them twice. */
+   for (unsigned pass = 0; pass < 2; pass++) {
+      for (unsigned i = 0; i < NUM_REGS; i++) {
+         for (unsigned j = 0; j < NUM_REGS; j++) {
+            ra_add_node_interference(g, i, j);
+            if (pass == 0 && i < j)
+               edges.push_back(std::make_pair(i, j));
+         }
+      }
+   }
+
+   ASSERT_TRUE(ra_allocate(g));
+   check_allocation(g, classes, edges);
+}
+
+TEST_F(ra_test, too_many_pairs)
+{
+   const unsigned count = NUM_REGS / 2 + 1;
+   std::vector<unsigned> classes(count, pair);
+   struct ra_graph *g = create_graph(count, classes);
+
+   for (unsigned i = 0; i < count; i++) {
+      for (unsigned j = i + 1; j < count; j++)
+         ra_add_node_interference(g, i, j);
+      ra_set_node_spill_cost(g, i, 1.0);
+   }
+
+   EXPECT_FALSE(ra_allocate(g));
+   EXPECT_NE(-1, ra_get_best_spill_node(g));
+}
+
+TEST_F(ra_test, fixed_regs)
+{
+   std::vector<unsigned> classes(3, single);
+   struct ra_graph *g = create_graph(3, classes);
+
+   ra_add_node_interference(g, 0, 1);
+   ra_add_node_interference(g, 1, 2);
+   ra_set_node_reg(g, 0, 0);
+   ra_set_node_reg(g, 2, 1);
+
+   ASSERT_TRUE(ra_allocate(g));
+   EXPECT_EQ(0u, ra_get_node_reg(g, 0));
+   EXPECT_EQ(1u, ra_get_node_reg(g, 2));
+   EXPECT_EQ(2u, ra_get_node_reg(g, 1));
+}
+
+/* The live ranges of a long program, each value living for a random number
+ * of instructions with at most NUM_REGS / 2 - 1 of them live at once, so
+ * that there are always registers left for a pair.
+ */
+TEST_F(ra_test, live_ranges)
+{
+   const unsigned count = 20000;
+   std::vector<unsigned> classes(count);
+   std::vector<unsigned> end(count);
+   std::vector<std::pair<unsigned, unsigned> > edges;
+
+   srand(1);
+   for (unsigned n = 0; n < count; n++) {
+      classes[n] = rand() % 4 ? single : pair;
+      end[n] = n + 1 + rand() % (NUM_REGS / 4 - 1);
+   }
+
+   struct ra_graph *g = create_graph(count, classes);
+
+   for (unsigned n = 0; n < count; n++) {
+      for (unsigned m = n + 1; m < count && m < end[n]; m++) {
+         ra_add_node_interference(g, n, m);
+         edges.push_back(std::make_pair(n, m));
+      }
+   }
+
+   ASSERT_TRUE(ra_allocate(g));
+   check_allocation(g, classes, edges);
+}
+
+/* Live ranges whose interferences are added again for every instruction
+ * where both values are live, as a backend walking a loop may do.
+ */
+TEST_F(ra_test, repeated_interferences)
+{
+   const unsigned count = 2000;
+   std::vector<unsigned> classes(count);
+   std::vector<unsigned> end(count);
+   std::vector<std::pair<unsigned, unsigned> > edges;
+
+   srand(3);
+   for (unsigned n = 0; n < count; n++) {
+      classes[n] = rand() % 4 ? single : pair;
+      end[n] = n + 1 + rand() % (NUM_REGS / 4 - 1);
+   }
+
+   struct ra_graph *g = create_graph(count, classes);
+
+   for (unsigned ip = 0; ip < count; ip++) {
+      for (unsigned n = ip >= NUM_REGS / 4 ? ip - NUM_REGS / 4 : 0;
+           n <= ip; n++) {
+         if (end[n] <= ip)
+            continue;
+
+         for (unsigned m = n + 1; m <= ip; m++)
+            ra_add_node_interference(g, m, n);
+      }
+   }
+
+   for (unsigned n = 0; n < count; n++) {
+      for (unsigned m = n + 1; m < count && m < end[n]; m++)
+         edges.push_back(std::make_pair(n, m));
+   }
+
+   ASSERT_TRUE(ra_allocate(g));
+   check_allocation(g, classes, edges);
+}
+
+TEST_F(ra_test, random)
+{
+   srand(2);
+   for (unsigned i = 0; i < 100; i++) {
+      const unsigned count = 1 + rand() % 500;
+      const unsigned num_edges = rand() % (count * 8);
+      std::vector<unsigned> classes(count);
+      std::vector<std::pair<unsigned, unsigned> > edges;
+
+      for (unsigned n = 0; n < count; n++)
+         classes[n] = rand() % 4 ? single : pair;
+
+      struct ra_graph *g = create_graph(count, classes);
+
+      for (unsigned e = 0; e < num_edges; e++) {
+         unsigned n1 = rand() % count, n2 = rand() % count;
+
+         ra_add_node_interference(g, n1, n2);
+         if (n1 != n2)
+            edges.push_back(std::make_pair(n1, n2));
+      }
+
+      if (ra_allocate(g))
+         check_allocation(g, classes, edges);
+   }
+}
@@ -224,6 +224,18 @@ util_queue_fence_destroy(struct util_queue_fence *fence)
 
 /****************************************************************************
  * util_queue implementation
+ *
+ * Each thread has its own ring buffers of jobs, one per priority, protected
+ * by its own lock. Jobs are added to the threads which are awake in turn. A
+ * thread executes its own jobs first, the highest priority first, and then
+ * steals the jobs of the other threads. A thread only sleeps after finding no
+ * job in any of the threads.
+ *
+ * Threads which are awake and not executing a job are searching for one.
+ * Adding a job only wakes up a sleeping thread if no thread is searching, and
+ * the last searching thread to find a job wakes up another one if there are
+ * more jobs. So threads aren't woken up for every job, but no job is left
+ * behind a busy thread while another one sleeps.
  */
 
 struct thread_input {
@@ -231,11 +243,229 @@ struct thread_input {
    int thread_index;
 };
 
+static bool
+util_queue_ring_init(struct util_queue_ring *ring)
+{
+   ring->size = 8;
+   ring->read_idx = ring->write_idx = 0;
+   ring->jobs = (struct util_queue_job*)
+                calloc(ring->size, sizeof(struct util_queue_job));
+   return ring->jobs != NULL;
+}
+
+static void
+util_queue_ring_push(struct util_queue_ring *ring,
+                     const struct util_queue_job *job)
+{
+   if (ring->write_idx - ring->read_idx == ring->size) {
+      /* The capacity of the queue is enforced by util_queue::num_queued, so
+       * rings just grow.
+       */
+      unsigned new_size = ring->size * 2;
+      struct util_queue_job *jobs =
+         (struct util_queue_job*)calloc(new_size,
+                                        sizeof(struct util_queue_job));
+      assert(jobs);
+
+      for (unsigned i = 0; i < ring->size; i++) {
+         jobs[i] = ring->jobs[(ring->read_idx + i) & (ring->size - 1)];
+      }
+
+      free(ring->jobs);
+      ring->jobs = jobs;
+      ring->read_idx = 0;
+      ring->write_idx = ring->size;
+      ring->size = new_size;
+   }
+
+   ring->jobs[ring->write_idx++ & (ring->size - 1)] = *job;
+}
+
+/* Takes the first job of the highest priority. The lock must be held. */
+static bool
+util_queue_thread_jobs_pop(struct util_queue_thread_jobs *tj,
+                           struct util_queue_job *job)
+{
+   if (!tj->num_queued)
+      return false;
+
+   for (unsigned p = 0; p < UTIL_QUEUE_NUM_PRIORITIES; p++) {
+      struct util_queue_ring *ring = &tj->rings[p];
+
+      if (ring->read_idx != ring->write_idx) {
+         struct util_queue_job *ptr =
+            &ring->jobs[ring->read_idx++ & (ring->size - 1)];
+
+         *job = *ptr;
+         memset(ptr, 0, sizeof(*ptr));
+         tj->num_queued--;
+         return true;
+      }
+   }
+
+   unreachable("num_queued doesn't match the rings");
+}
+
+/* Threads waiting for free slots only continue once the queue is half empty,
+ * so that they aren't woken up for every slot.
+ */
+static int
+util_queue_space_threshold(struct util_queue *queue)
+{
+   return queue->max_jobs / 2;
+}
+
+/* Releases the slot of a job taken from the queue. */
+static void
+util_queue_release_slot(struct util_queue *queue)
+{
+   int num_queued = p_atomic_dec_return(&queue->num_queued);
+
+   if (queue->flags & UTIL_QUEUE_INIT_RESIZE_IF_FULL ||
+       num_queued > util_queue_space_threshold(queue))
+      return;
+
+   /* Read with a full barrier, like num_queued by util_queue_reserve_slots,
+    * so that either side sees the update of the other.
+    */
+   if (p_atomic_cmpxchg(&queue->num_waiting_for_space, 0, 0)) {
+      mtx_lock(&queue->space_lock);
+      cnd_broadcast(&queue->has_space_cond);
+      mtx_unlock(&queue->space_lock);
+   }
+}
+
+/* Wakes up the thread if it sleeps, which then counts as searching for a
+ * job. Its lock must be held.
+ */
+static bool
+util_queue_wake_thread(struct util_queue *queue,
+                       struct util_queue_thread_jobs *tj)
+{
+   if (!tj->sleeping)
+      return false;
+
+   tj->sleeping = 0;
+   p_atomic_dec(&queue->num_sleeping);
+   p_atomic_inc(&queue->num_searching);
+   cnd_signal(&tj->has_queued_cond);
+   return true;
+}
+
+static void
+util_queue_wake_any_thread(struct util_queue *queue)
+{
+   for (unsigned i = 0; i < queue->num_threads &&
+                        p_atomic_read(&queue->num_sleeping); i++) {
+      struct util_queue_thread_jobs *tj = &queue->thread_jobs[i];
+      bool woken;
+
+      mtx_lock(&tj->lock);
+      woken = util_queue_wake_thread(queue, tj);
+      mtx_unlock(&tj->lock);
+
+      if (woken)
+         break;
+   }
+}
+
+/* Looks for a job in all threads, starting with the given one. */
+static bool
+util_queue_find_job(struct util_queue *queue, unsigned thread_index,
+                     struct util_queue_job *job, bool check_all)
+{
+   for (unsigned i = 0; i < queue->num_threads; i++) {
+      struct util_queue_thread_jobs *tj =
+         &queue->thread_jobs[(thread_index + i) % queue->num_threads];
+      bool found;
+
+      /* Reading num_queued without the lock is only a hint. */
+      if (!check_all && !p_atomic_read(&tj->num_queued))
+         continue;
+
+      mtx_lock(&tj->lock);
+      found = util_queue_thread_jobs_pop(tj, job);
+      mtx_unlock(&tj->lock);
+
+      if (found) {
+         util_queue_release_slot(queue);
+         return true;
+      }
+   }
+
+   return false;
+}
+
+/* Called by a searching thread which found a job. */
+static void
+util_queue_stop_searching(struct util_queue *queue)
+{
+   /* If this was the last searching thread, wake up another one for the
+    * remaining jobs. num_queued is read with a full barrier, like
+    * num_searching by util_queue_push_jobs, so that either side sees the
+    * update of the other.
+    */
+   if (p_atomic_dec_return(&queue->num_searching) == 0 &&
+       p_atomic_read(&queue->num_sleeping) &&
+       p_atomic_cmpxchg(&queue->num_queued, -1, -1) > 0)
+      util_queue_wake_any_thread(queue);
+}
+
+/* Returns the next job to execute, or false if the threads must terminate.
+ * The thread must count as searching.
+ */
+static bool
+util_queue_get_job(struct util_queue *queue, unsigned thread_index,
+                   struct util_queue_job *job)
+{
+   struct util_queue_thread_jobs *tj = &queue->thread_jobs[thread_index];
+
+   while (!p_atomic_read(&queue->kill_threads)) {
+      if (util_queue_find_job(queue, thread_index, job, false)) {
+         util_queue_stop_searching(queue);
+         return true;
+      }
+
+      /* Announce that this thread is about to sleep, stop searching, and
+       * look at all threads again with their locks. Either this finds a job
+       * added in the meantime, or whoever added it sees this thread
+       * sleeping.
+       */
+      mtx_lock(&tj->lock);
+      tj->sleeping = 1;
+      p_atomic_inc(&queue->num_sleeping);
+      mtx_unlock(&tj->lock);
+      p_atomic_dec(&queue->num_searching);
+
+      bool found = util_queue_find_job(queue, thread_index, job, true);
+
+      mtx_lock(&tj->lock);
+      while (!found && tj->sleeping && !tj->num_queued &&
+             !p_atomic_read(&queue->kill_threads))
+         cnd_wait(&tj->has_queued_cond, &tj->lock);
+
+      if (tj->sleeping) {
+         tj->sleeping = 0;
+         p_atomic_dec(&queue->num_sleeping);
+         p_atomic_inc(&queue->num_searching);
+      }
+      mtx_unlock(&tj->lock);
+
+      if (found) {
+         util_queue_stop_searching(queue);
+         return true;
+      }
+   }
+
+   return false;
+}
+
 static int
 util_queue_thread_func(void *input)
 {
    struct util_queue *queue = ((struct thread_input*)input)->queue;
    int thread_index = ((struct thread_input*)input)->thread_index;
+   struct util_queue_thread_jobs *tj = &queue->thread_jobs[thread_index];
 
    free(input);
 
@@ -251,6 +481,27 @@ util_queue_thread_func(void *input)
 
       pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
    }
+
+   if (queue->flags & UTIL_QUEUE_INIT_BIND_THREADS_TO_CPUS) {
+      /* Bind each thread to one of the allowed CPUs in turn, so that a
+       * thread doesn't migrate away from the caches filled by its jobs.
+       */
+      cpu_set_t cpuset;
+
+      if (pthread_getaffinity_np(pthread_self(), sizeof(cpuset),
+                                 &cpuset) == 0) {
+         unsigned n = thread_index % CPU_COUNT(&cpuset);
+
+         for (unsigned i = 0; i < CPU_SETSIZE; i++) {
+            if (CPU_ISSET(i, &cpuset) && n-- == 0) {
+               CPU_ZERO(&cpuset);
+               CPU_SET(i, &cpuset);
+               pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+               break;
+            }
+         }
+      }
+   }
 #endif
 
    if (strlen(queue->name) > 0) {
@@ -262,25 +513,9 @@ util_queue_thread_func(void *input)
    while (1) {
       struct util_queue_job job;
 
-      mtx_lock(&queue->lock);
-      assert(queue->num_queued >= 0 && queue->num_queued <= queue->max_jobs);
-
-      /* wait if the queue is empty */
-      while (!queue->kill_threads && queue->num_queued == 0)
-         cnd_wait(&queue->has_queued_cond, &queue->lock);
-
-      if (queue->kill_threads) {
-         mtx_unlock(&queue->lock);
+      p_atomic_inc(&queue->num_searching);
+      if (!util_queue_get_job(queue, thread_index, &job))
          break;
-      }
-
-      job = queue->jobs[queue->read_idx];
-      memset(&queue->jobs[queue->read_idx], 0, sizeof(struct util_queue_job));
-      queue->read_idx = (queue->read_idx + 1) % queue->max_jobs;
-
-      queue->num_queued--;
-      cnd_signal(&queue->has_space_cond);
-      mtx_unlock(&queue->lock);
 
       if (job.job) {
          job.execute(job.job, thread_index);
@@ -291,20 +526,33 @@ util_queue_thread_func(void *input)
    }
 
    /* signal remaining jobs before terminating */
-   mtx_lock(&queue->lock);
-   for (unsigned i = queue->read_idx; i != queue->write_idx;
-        i = (i + 1) % queue->max_jobs) {
-      if (queue->jobs[i].job) {
-         util_queue_fence_signal(queue->jobs[i].fence);
-         queue->jobs[i].job = NULL;
-      }
+   mtx_lock(&tj->lock);
+   while (tj->num_queued) {
+      struct util_queue_job job;
+
+      util_queue_thread_jobs_pop(tj, &job);
+      if (job.job)
+         util_queue_fence_signal(job.fence);
+      util_queue_release_slot(queue);
    }
-   queue->read_idx = queue->write_idx;
-   queue->num_queued = 0;
-   mtx_unlock(&queue->lock);
+   mtx_unlock(&tj->lock);
    return 0;
 }
 
+static void
+util_queue_destroy_thread_jobs(struct util_queue *queue, unsigned count)
+{
+   for (unsigned i = 0; i < count; i++) {
+      struct util_queue_thread_jobs *tj = &queue->thread_jobs[i];
+
+      for (unsigned p = 0; p < UTIL_QUEUE_NUM_PRIORITIES; p++)
+         free(tj->rings[p].jobs);
+      cnd_destroy(&tj->has_queued_cond);
+      mtx_destroy(&tj->lock);
+   }
+   free(queue->thread_jobs);
+}
+
 bool
 util_queue_init(struct util_queue *queue,
                 const char *name,
@@ -344,18 +592,35 @@ util_queue_init(struct util_queue *queue,
 
    queue->flags = flags;
    queue->num_threads = num_threads;
+   queue->max_threads = num_threads;
    queue->max_jobs = max_jobs;
 
-   queue->jobs = (struct util_queue_job*)
-                 calloc(max_jobs, sizeof(struct util_queue_job));
-   if (!queue->jobs)
+   queue->thread_jobs = (struct util_queue_thread_jobs*)
+                        calloc(num_threads,
+                               sizeof(struct util_queue_thread_jobs));
+   if (!queue->thread_jobs)
       goto fail;
 
-   (void) mtx_init(&queue->lock, mtx_plain);
+   for (i = 0; i < num_threads; i++) {
+      struct util_queue_thread_jobs *tj = &queue->thread_jobs[i];
+
+      for (unsigned p = 0; p < UTIL_QUEUE_NUM_PRIORITIES; p++) {
+         if (!util_queue_ring_init(&tj->rings[p])) {
+            for (unsigned q = 0; q < p; q++)
+               free(tj->rings[q].jobs);
+            util_queue_destroy_thread_jobs(queue, i);
+            queue->thread_jobs = NULL;
+            goto fail;
+         }
+      }
+      (void) mtx_init(&tj->lock, mtx_plain);
+      cnd_init(&tj->has_queued_cond);
+   }
+
+   (void) mtx_init(&queue->space_lock, mtx_plain);
    (void) mtx_init(&queue->finish_lock, mtx_plain);
 
    queue->num_queued = 0;
-   cnd_init(&queue->has_queued_cond);
    cnd_init(&queue->has_space_cond);
 
    queue->threads = (thrd_t*) calloc(num_threads, sizeof(thrd_t));
@@ -405,11 +670,11 @@ util_queue_init(struct util_queue *queue,
 fail:
    free(queue->threads);
 
-   if (queue->jobs) {
+   if (queue->thread_jobs) {
       cnd_destroy(&queue->has_space_cond);
-      cnd_destroy(&queue->has_queued_cond);
-      mtx_destroy(&queue->lock);
-      free(queue->jobs);
+      mtx_destroy(&queue->finish_lock);
+      mtx_destroy(&queue->space_lock);
+      util_queue_destroy_thread_jobs(queue, num_threads);
    }
    /* also util_queue_is_initialized can be used to check for success */
    memset(queue, 0, sizeof(*queue));
@@ -422,10 +687,14 @@ util_queue_killall_and_wait(struct util_queue *queue)
    unsigned i;
 
    /* Signal all threads to terminate. */
-   mtx_lock(&queue->lock);
-   queue->kill_threads = 1;
-   cnd_broadcast(&queue->has_queued_cond);
-   mtx_unlock(&queue->lock);
+   p_atomic_set(&queue->kill_threads, 1);
+   for (i = 0; i < queue->num_threads; i++) {
+      struct util_queue_thread_jobs *tj = &queue->thread_jobs[i];
+
+      mtx_lock(&tj->lock);
+      cnd_broadcast(&tj->has_queued_cond);
+      mtx_unlock(&tj->lock);
+   }
 
    for (i = 0; i < queue->num_threads; i++)
       thrd_join(queue->threads[i], NULL);
@@ -439,25 +708,117 @@ util_queue_destroy(struct util_queue *queue)
    remove_from_atexit_list(queue);
 
    cnd_destroy(&queue->has_space_cond);
-   cnd_destroy(&queue->has_queued_cond);
    mtx_destroy(&queue->finish_lock);
-   mtx_destroy(&queue->lock);
-   free(queue->jobs);
+   mtx_destroy(&queue->space_lock);
+   util_queue_destroy_thread_jobs(queue, queue->max_threads);
    free(queue->threads);
 }
 
+/* Reserves slots for jobs, waiting until there are enough free ones unless
+ * the queue may grow.
+ */
+static void
+util_queue_reserve_slots(struct util_queue *queue, unsigned num_jobs)
+{
+   if (queue->flags & UTIL_QUEUE_INIT_RESIZE_IF_FULL) {
+      p_atomic_add(&queue->num_queued, num_jobs);
+      return;
+   }
+
+   /* Batches larger than the queue only wait for it to be empty. */
+   int max_queued = MAX2(queue->max_jobs - (int)num_jobs, 0);
+   int wait_until = MIN2(max_queued, util_queue_space_threshold(queue));
+
+   while (1) {
+      int num_queued = p_atomic_read(&queue->num_queued);
+
+      if (num_queued > max_queued) {
+         /* Wait until there are free slots. The threads check
+          * num_waiting_for_space after releasing one.
+          */
+         mtx_lock(&queue->space_lock);
+         p_atomic_inc(&queue->num_waiting_for_space);
+         while (p_atomic_cmpxchg(&queue->num_queued, -1, -1) > wait_until)
+            cnd_wait(&queue->has_space_cond, &queue->space_lock);
+         p_atomic_dec(&queue->num_waiting_for_space);
+         mtx_unlock(&queue->space_lock);
+         continue;
+      }
+
+      if (p_atomic_cmpxchg(&queue->num_queued, num_queued,
+                           num_queued + (int)num_jobs) == num_queued)
+         return;
+   }
+}
+
+/* Chooses the thread to add jobs to: the threads which are awake in turn,
+ * so that no thread has to be woken up while others are awake.
+ */
+static unsigned
+util_queue_choose_thread(struct util_queue *queue)
+{
+   if (queue->num_threads == 1)
+      return 0;
+
+   unsigned first = p_atomic_inc_return(&queue->next_thread);
+
+   if (p_atomic_read(&queue->num_sleeping)) {
+      for (unsigned i = 0; i < queue->num_threads; i++) {
+         unsigned t = (first + i) % queue->num_threads;
+
+         if (!p_atomic_read(&queue->thread_jobs[t].sleeping))
+            return t;
+      }
+   }
+
+   return first % queue->num_threads;
+}
+
+/* Adds jobs to one thread, returning false if the queue is being destroyed. */
+static bool
+util_queue_push_jobs(struct util_queue *queue, unsigned thread_index,
+                     const struct util_queue_job *jobs, unsigned num_jobs,
+                     enum util_queue_priority priority)
+{
+   struct util_queue_thread_jobs *tj = &queue->thread_jobs[thread_index];
+   bool woken;
+
+   mtx_lock(&tj->lock);
+   if (p_atomic_read(&queue->kill_threads)) {
+      mtx_unlock(&tj->lock);
+      return false;
+   }
+
+   for (unsigned i = 0; i < num_jobs; i++) {
+      assert(jobs[i].job);
+      util_queue_ring_push(&tj->rings[priority], &jobs[i]);
+   }
+   tj->num_queued += num_jobs;
+   woken = util_queue_wake_thread(queue, tj);
+   mtx_unlock(&tj->lock);
+
+   /* Let a sleeping thread steal the jobs if no thread is searching, e.g.
+    * because they are all busy. num_searching is read with a full barrier,
+    * see util_queue_stop_searching.
+    */
+   if (!woken && p_atomic_read(&queue->num_sleeping) &&
+       !p_atomic_cmpxchg(&queue->num_searching, 0, 0))
+      util_queue_wake_any_thread(queue);
+
+   return true;
+}
+
 void
-util_queue_add_job(struct util_queue *queue,
-                   void *job,
-                   struct util_queue_fence *fence,
-                   util_queue_execute_func execute,
-                   util_queue_execute_func cleanup)
+util_queue_add_job_with_priority(struct util_queue *queue,
+                                 void *job,
+                                 struct util_queue_fence *fence,
+                                 util_queue_execute_func execute,
+                                 util_queue_execute_func cleanup,
+                                 enum util_queue_priority priority)
 {
-   struct util_queue_job *ptr;
+   struct util_queue_job queue_job = { job, fence, execute, cleanup };
 
-   mtx_lock(&queue->lock);
-   if (queue->kill_threads) {
-      mtx_unlock(&queue->lock);
+   if (p_atomic_read(&queue->kill_threads)) {
       /* well no good option here, but any leaks will be
        * short-lived as things are shutting down..
        */
@@ -465,54 +826,53 @@ util_queue_add_job(struct util_queue *queue,
    }
 
    util_queue_fence_reset(fence);
+   util_queue_reserve_slots(queue, 1);
 
-   assert(queue->num_queued >= 0 && queue->num_queued <= queue->max_jobs);
-
-   if (queue->num_queued == queue->max_jobs) {
-      if (queue->flags & UTIL_QUEUE_INIT_RESIZE_IF_FULL) {
-         /* If the queue is full, make it larger to avoid waiting for a free
-          * slot.
-          */
-         unsigned new_max_jobs = queue->max_jobs + 8;
-         struct util_queue_job *jobs =
-            (struct util_queue_job*)calloc(new_max_jobs,
-                                           sizeof(struct util_queue_job));
-         assert(jobs);
-
-         /* Copy all queued jobs into the new list. */
-         unsigned num_jobs = 0;
-         unsigned i = queue->read_idx;
-
-         do {
-            jobs[num_jobs++] = queue->jobs[i];
-            i = (i + 1) % queue->max_jobs;
-         } while (i != queue->write_idx);
-
-         assert(num_jobs == queue->num_queued);
-
-         free(queue->jobs);
-         queue->jobs = jobs;
-         queue->read_idx = 0;
-         queue->write_idx = num_jobs;
-         queue->max_jobs = new_max_jobs;
-      } else {
-         /* Wait until there is a free slot. */
-         while (queue->num_queued == queue->max_jobs)
-            cnd_wait(&queue->has_space_cond, &queue->lock);
-      }
+   if (!util_queue_push_jobs(queue, util_queue_choose_thread(queue),
+                             &queue_job, 1, priority)) {
+      util_queue_release_slot(queue);
+      util_queue_fence_signal(fence);
    }
+}
+
+/**
+ * Add several jobs at once, which are spread over the threads with a single
+ * lock and wakeup per thread.
+ */
+void
+util_queue_add_jobs(struct util_queue *queue,
+                    const struct util_queue_job *jobs,
+                    unsigned num_jobs,
+                    enum util_queue_priority priority)
+{
+   if (!num_jobs || p_atomic_read(&queue->kill_threads))
+      return;
+
+   for (unsigned i = 0; i < num_jobs; i++)
+      util_queue_fence_reset(jobs[i].fence);
 
-   ptr = &queue->jobs[queue->write_idx];
-   assert(ptr->job == NULL);
-   ptr->job = job;
-   ptr->fence = fence;
-   ptr->execute = execute;
-   ptr->cleanup = cleanup;
-   queue->write_idx = (queue->write_idx + 1) % queue->max_jobs;
+   util_queue_reserve_slots(queue, num_jobs);
 
-   queue->num_queued++;
-   cnd_signal(&queue->has_queued_cond);
-   mtx_unlock(&queue->lock);
+   /* Give each thread a contiguous part of the jobs, so that a queue with a
+    * single thread still executes them in order.
+    */
+   unsigned num_threads = MIN2(queue->num_threads, num_jobs);
+   unsigned first_thread = util_queue_choose_thread(queue);
+   unsigned start = 0;
+
+   for (unsigned i = 0; i < num_threads; i++) {
+      unsigned end = (uint64_t)num_jobs * (i + 1) / num_threads;
+
+      if (!util_queue_push_jobs(queue,
+                                (first_thread + i) % queue->num_threads,
+                                &jobs[start], end - start, priority)) {
+         for (unsigned j = start; j < end; j++) {
+            util_queue_release_slot(queue);
+            util_queue_fence_signal(jobs[j].fence);
+         }
+      }
+      start = end;
+   }
 }
 
 /**
@@ -533,20 +893,29 @@ util_queue_drop_job(struct util_queue *queue, struct util_queue_fence *fence)
    if (util_queue_fence_is_signalled(fence))
       return;
 
-   mtx_lock(&queue->lock);
-   for (unsigned i = queue->read_idx; i != queue->write_idx;
-        i = (i + 1) % queue->max_jobs) {
-      if (queue->jobs[i].fence == fence) {
-         if (queue->jobs[i].cleanup)
-            queue->jobs[i].cleanup(queue->jobs[i].job, -1);
+   for (unsigned t = 0; t < queue->num_threads && !removed; t++) {
+      struct util_queue_thread_jobs *tj = &queue->thread_jobs[t];
 
-         /* Just clear it. The threads will treat as a no-op job. */
-         memset(&queue->jobs[i], 0, sizeof(queue->jobs[i]));
-         removed = true;
-         break;
+      mtx_lock(&tj->lock);
+      for (unsigned p = 0; p < UTIL_QUEUE_NUM_PRIORITIES && !removed; p++) {
+         struct util_queue_ring *ring = &tj->rings[p];
+
+         for (unsigned i = ring->read_idx; i != ring->write_idx; i++) {
+            struct util_queue_job *job = &ring->jobs[i & (ring->size - 1)];
+
+            if (job->job && job->fence == fence) {
+               if (job->cleanup)
+                  job->cleanup(job->job, -1);
+
+               /* Just clear it. The threads will treat as a no-op job. */
+               memset(job, 0, sizeof(*job));
+               removed = true;
+               break;
+            }
+         }
       }
+      mtx_unlock(&tj->lock);
    }
-   mtx_unlock(&queue->lock);
 
    if (removed)
       util_queue_fence_signal(fence);
@@ -568,6 +937,7 @@ void
 util_queue_finish(struct util_queue *queue)
 {
    util_barrier barrier;
+   struct util_queue_job *jobs = malloc(queue->num_threads * sizeof(*jobs));
    struct util_queue_fence *fences = malloc(queue->num_threads * sizeof(*fences));
 
    util_barrier_init(&barrier, queue->num_threads);
@@ -578,10 +948,19 @@ util_queue_finish(struct util_queue *queue)
     */
    mtx_lock(&queue->finish_lock);
 
+   /* The barrier jobs have the lowest priority, so that each thread only
+    * gets to one after all of its previously added jobs, and threads only
+    * steal them once they have no job left.
+    */
    for (unsigned i = 0; i < queue->num_threads; ++i) {
       util_queue_fence_init(&fences[i]);
-      util_queue_add_job(queue, &barrier, &fences[i], util_queue_finish_execute, NULL);
+      jobs[i].job = &barrier;
+      jobs[i].fence = &fences[i];
+      jobs[i].execute = util_queue_finish_execute;
+      jobs[i].cleanup = NULL;
    }
+   util_queue_add_jobs(queue, jobs, queue->num_threads,
+                       UTIL_QUEUE_PRIORITY_LOW);
 
    for (unsigned i = 0; i < queue->num_threads; ++i) {
       util_queue_fence_wait(&fences[i]);
@@ -592,6 +971,7 @@ util_queue_finish(struct util_queue *queue)
    util_barrier_destroy(&barrier);
 
    free(fences);
+   free(jobs);
 }
 
 int64_t
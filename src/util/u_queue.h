@@ -28,6 +28,12 @@
  *
  * Jobs can be added from any thread. After that, the wait call can be used
  * to wait for completion of the job.
+ *
+ * Each thread of the queue has its own jobs, which other threads of the queue
+ * steal when they run out of them, so adding and executing jobs doesn't
+ * contend on a lock shared by all threads. The jobs of a thread are executed
+ * in the order they were added within each priority, so a queue with a single
+ * thread executes jobs of the same priority in order.
  */
 
 #ifndef U_QUEUE_H
@@ -49,6 +55,7 @@ extern "C" {
 #define UTIL_QUEUE_INIT_USE_MINIMUM_PRIORITY      (1 << 0)
 #define UTIL_QUEUE_INIT_RESIZE_IF_FULL            (1 << 1)
 #define UTIL_QUEUE_INIT_SET_FULL_THREAD_AFFINITY  (1 << 2)
+#define UTIL_QUEUE_INIT_BIND_THREADS_TO_CPUS      (1 << 3)
 
 #if defined(__GNUC__) && defined(HAVE_LINUX_FUTEX_H)
 #define UTIL_QUEUE_FENCE_FUTEX
@@ -198,21 +205,50 @@ struct util_queue_job {
    util_queue_execute_func cleanup;
 };
 
+/* Jobs of higher priority are executed first, e.g. a compile which a draw is
+ * waiting for before background shader cache writes.
+ */
+enum util_queue_priority {
+   UTIL_QUEUE_PRIORITY_HIGH,
+   UTIL_QUEUE_PRIORITY_NORMAL,
+   UTIL_QUEUE_PRIORITY_LOW,
+   UTIL_QUEUE_NUM_PRIORITIES,
+};
+
+/* Ring buffer of jobs, which grows when full. */
+struct util_queue_ring {
+   struct util_queue_job *jobs;
+   unsigned size; /* power of two */
+   unsigned read_idx, write_idx; /* wrap around, masked with size - 1 */
+};
+
+/* The jobs of one thread. */
+struct util_queue_thread_jobs {
+   mtx_t lock;
+   cnd_t has_queued_cond;
+   struct util_queue_ring rings[UTIL_QUEUE_NUM_PRIORITIES];
+   int num_queued;
+   int sleeping; /* the thread waits for has_queued_cond */
+};
+
 /* Put this into your context. */
 struct util_queue {
    char name[14]; /* 13 characters = the thread name without the index */
    mtx_t finish_lock; /* only for util_queue_finish */
-   mtx_t lock;
-   cnd_t has_queued_cond;
+   mtx_t space_lock; /* only for waiting until there is a free slot */
    cnd_t has_space_cond;
    thrd_t *threads;
+   struct util_queue_thread_jobs *thread_jobs; /* one per thread */
+   unsigned max_threads; /* the number of thread_jobs */
    unsigned flags;
    int num_queued;
+   int num_waiting_for_space;
+   int num_sleeping;
+   int num_searching; /* threads which are awake and not executing a job */
+   unsigned next_thread;
    unsigned num_threads;
    int kill_threads;
    int max_jobs;
-   int write_idx, read_idx; /* ring buffer pointers */
-   struct util_queue_job *jobs;
 
    /* for cleanup at exit(), protected by exit_mutex */
    struct list_head head;
@@ -226,11 +262,28 @@ bool util_queue_init(struct util_queue *queue,
 void util_queue_destroy(struct util_queue *queue);
 
 /* optional cleanup callback is called after fence is signaled: */
-void util_queue_add_job(struct util_queue *queue,
-                        void *job,
-                        struct util_queue_fence *fence,
-                        util_queue_execute_func execute,
-                        util_queue_execute_func cleanup);
+void util_queue_add_job_with_priority(struct util_queue *queue,
+                                      void *job,
+                                      struct util_queue_fence *fence,
+                                      util_queue_execute_func execute,
+                                      util_queue_execute_func cleanup,
+                                      enum util_queue_priority priority);
+void util_queue_add_jobs(struct util_queue *queue,
+                         const struct util_queue_job *jobs,
+                         unsigned num_jobs,
+                         enum util_queue_priority priority);
+
+static inline void
+util_queue_add_job(struct util_queue *queue,
+                   void *job,
+                   struct util_queue_fence *fence,
+                   util_queue_execute_func execute,
+                   util_queue_execute_func cleanup)
+{
+   util_queue_add_job_with_priority(queue, job, fence, execute, cleanup,
+                                    UTIL_QUEUE_PRIORITY_NORMAL);
+}
+
 void util_queue_drop_job(struct util_queue *queue,
                          struct util_queue_fence *fence);
 
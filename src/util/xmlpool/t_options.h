@@ -264,6 +264,11 @@ DRI_CONF_OPT_BEGIN_B(allow_rgb10_configs, def) \
 DRI_CONF_DESC(en,gettext("Allow exposure of visuals and fbconfigs with rgb10a2 formats")) \
 DRI_CONF_OPT_END
 
+#define DRI_CONF_DISK_CACHE_CODEC(def) \
+DRI_CONF_OPT_BEGIN(disk_cache_codec, string, def) \
+        DRI_CONF_DESC(en,gettext("Compression of shader cache entries: zlib, none, lz4 or zstd")) \
+DRI_CONF_OPT_END
+
 /**
  * \brief Initialization configuration options
  */